@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "cpp/buffered_writer.h"
+#include "cpp/client.h"
+#include "cpp/core/galaxy_flag.h"
+#include "cpp/util/galaxy_util.h"
+#include "absl/flags/flag.h"
+#include "glog/logging.h"
+
+using galaxy_schema::FileAnalyzerResult;
+
+namespace galaxy {
+    namespace client {
+        BufferedWriterOptions BufferedWriterOptions::FromFlags() {
+            BufferedWriterOptions options;
+            options.flush_bytes = static_cast<int64_t>(std::max(1, absl::GetFlag(FLAGS_fs_buffered_flush_kb))) * 1024;
+            options.flush_interval_ms = std::max(1, absl::GetFlag(FLAGS_fs_buffered_flush_interval_ms));
+            options.max_buffered_bytes = static_cast<int64_t>(std::max(1, absl::GetFlag(FLAGS_fs_buffered_max_kb))) * 1024;
+            options.drop_when_full = absl::GetFlag(FLAGS_fs_buffered_drop_when_full);
+            return options;
+        }
+
+        BufferedWriter::BufferedWriter(const BufferedWriterOptions& options) : options_(options) {
+            flusher_ = std::thread(&BufferedWriter::FlushLoop, this);
+        }
+
+        BufferedWriter::~BufferedWriter() {
+            absl::Status status = Close();
+            if (!status.ok()) {
+                LOG(ERROR) << "Buffered writer closed with error " << status;
+            }
+        }
+
+        absl::Status BufferedWriter::Close() {
+            {
+                std::lock_guard<std::mutex> lock(mu_);
+                stopped_ = true;
+            }
+            flush_cv_.notify_one();
+            if (flusher_.joinable()) {
+                flusher_.join();
+            }
+            std::lock_guard<std::mutex> lock(mu_);
+            return error_;
+        }
+
+        bool BufferedWriter::Append(const std::string& path, const std::string& data) {
+            int64_t size = static_cast<int64_t>(data.size());
+            std::unique_lock<std::mutex> lock(mu_);
+            if (stopped_) {
+                return false;
+            }
+            // A single record larger than the bound is still accepted once the writer is empty.
+            auto has_room = [&]() {
+                return buffered_bytes_ == 0 || buffered_bytes_ + size <= options_.max_buffered_bytes;
+            };
+            if (!has_room()) {
+                if (options_.drop_when_full) {
+                    if (num_dropped_++ % 1000 == 0) {
+                        LOG(WARNING) << "Buffered writer is full, dropped " << num_dropped_ << " appends so far.";
+                    }
+                    return false;
+                }
+                flush_now_ = true;
+                flush_cv_.notify_one();
+                done_cv_.wait(lock, [&]() { return has_room() || stopped_; });
+                if (stopped_) {
+                    return false;
+                }
+            }
+            std::string& pending = pending_[path];
+            pending.append(data);
+            buffered_bytes_ += size;
+            if (static_cast<int64_t>(pending.size()) >= options_.flush_bytes) {
+                flush_now_ = true;
+                flush_cv_.notify_one();
+            }
+            return true;
+        }
+
+        absl::Status BufferedWriter::Flush() {
+            std::unique_lock<std::mutex> lock(mu_);
+            // Appends made so far are either pending, and taken by the next round, or in the current round.
+            int64_t target = rounds_started_ + 1;
+            flush_now_ = true;
+            flush_cv_.notify_one();
+            // Once closed, no round is left to wait for when the last one is done.
+            done_cv_.wait(lock, [&]() {
+                return rounds_done_ >= target || (stopped_ && pending_.empty() && rounds_done_ == rounds_started_);
+            });
+            return error_;
+        }
+
+        int64_t BufferedWriter::num_dropped() const {
+            std::lock_guard<std::mutex> lock(mu_);
+            return num_dropped_;
+        }
+
+        void BufferedWriter::FlushLoop() {
+            std::unique_lock<std::mutex> lock(mu_);
+            while (true) {
+                flush_cv_.wait_for(lock, std::chrono::milliseconds(options_.flush_interval_ms),
+                                   [this]() { return flush_now_ || stopped_; });
+                bool stopped = stopped_;
+                std::map<std::string, std::string> pending;
+                pending.swap(pending_);
+                flush_now_ = false;
+                rounds_started_++;
+                lock.unlock();
+
+                int64_t flushed_bytes = 0;
+                for (const auto& val : pending) {
+                    flushed_bytes += static_cast<int64_t>(val.second.size());
+                }
+                absl::Status status = absl::OkStatus();
+                if (!pending.empty()) {
+                    status = WritePending(&pending);
+                }
+
+                lock.lock();
+                for (const auto& val : pending) {
+                    if (stopped) {
+                        LOG(ERROR) << "Dropped " << val.second.size() << " bytes appended to " << val.first
+                                   << " as the writer is closed.";
+                        continue;
+                    }
+                    // Ahead of what was appended to the file since, to keep the order of its appends.
+                    pending_[val.first].insert(0, val.second);
+                    flushed_bytes -= static_cast<int64_t>(val.second.size());
+                }
+                buffered_bytes_ -= flushed_bytes;
+                error_ = status;
+                rounds_done_++;
+                done_cv_.notify_all();
+                if (stopped && pending_.empty()) {
+                    return;
+                }
+            }
+        }
+
+        absl::Status BufferedWriter::WritePending(std::map<std::string, std::string>* pending) {
+            // Appends to remote files grouped by cell, and the path given for each of them in the same order. Paths on
+            // the cells do not tell the files apart, as cells sharing a root have the same paths.
+            std::map<std::string, std::vector<std::pair<FileAnalyzerResult, std::string>>> by_cell;
+            std::map<std::string, std::vector<std::string>> paths_by_cell;
+            std::vector<std::pair<std::string, std::future<absl::Status>>> local_writes;
+            for (const auto& val : *pending) {
+                FileAnalyzerResult result = galaxy::util::InitClient(val.first);
+                if (result.is_remote()) {
+                    const std::string& cell = result.configs().to_cell_config().cell();
+                    paths_by_cell[cell].push_back(val.first);
+                    by_cell[cell].push_back({result, val.second});
+                } else {
+                    local_writes.emplace_back(val.first, galaxy::client::async::Write(val.first, val.second, "a"));
+                }
+            }
+            absl::Status status = absl::OkStatus();
+            std::set<std::string> written;
+            for (const auto& cell : by_cell) {
+                std::set<std::string> failed;
+                galaxy::client::impl::RWriteMultiple(cell.second, "a", &failed);
+                const std::vector<std::string>& paths = paths_by_cell.at(cell.first);
+                for (size_t i = 0; i < cell.second.size(); i++) {
+                    const std::string& path = paths[i];
+                    if (failed.count(cell.second[i].first.path()) == 0) {
+                        written.insert(path);
+                    } else {
+                        status = absl::UnavailableError("Fail to append to " + path + ".");
+                    }
+                }
+            }
+            for (auto& write : local_writes) {
+                absl::Status write_status = write.second.get();
+                if (write_status.ok()) {
+                    written.insert(write.first);
+                } else {
+                    status = write_status;
+                }
+            }
+            for (const auto& path : written) {
+                pending->erase(path);
+            }
+            return status;
+        }
+    }  // namespace client
+} // namespace galaxy
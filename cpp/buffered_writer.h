@@ -0,0 +1,73 @@
+#ifndef CPP_GALAXY_BUFFERED_WRITER_H
+#define CPP_GALAXY_BUFFERED_WRITER_H
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "absl/status/status.h"
+
+namespace galaxy {
+    namespace client {
+        struct BufferedWriterOptions {
+            // Pending appends to a single file of at least this size are flushed right away.
+            int64_t flush_bytes = 256 << 10;
+            // Maximum time an append stays pending before it is flushed.
+            int flush_interval_ms = 1000;
+            // Bound of the appends held by the writer, pending or being flushed.
+            int64_t max_buffered_bytes = 64 << 20;
+            // When full, drop new appends instead of blocking the caller until a flush frees enough space.
+            bool drop_when_full = false;
+
+            // Options initialized from the fs_buffered_* flags.
+            static BufferedWriterOptions FromFlags();
+        };
+
+        // Coalesces appends per file and writes them from a background thread, so that callers such as loggers
+        // pay for one append call per file and flush instead of one per record. Appends to files of the same cell
+        // are sent in a single WriteMultiple call. Appends that fail to be written are kept, still taking room, and
+        // retried with the next flush, so a file may receive an append twice if its call failed after writing it.
+        class BufferedWriter {
+        public:
+            explicit BufferedWriter(const BufferedWriterOptions& options);
+            BufferedWriter(const BufferedWriter&) = delete;
+            // Closes the writer if Close() was not called.
+            ~BufferedWriter();
+
+            // Queues data to be appended to path. Returns false if it was dropped because the writer is full or closed.
+            bool Append(const std::string& path, const std::string& data);
+            // Blocks until a flush of everything appended before the call has been tried, and returns why it failed
+            // if it did.
+            absl::Status Flush();
+            // Flushes what is still pending and stops the writer. Appends that fail this last time are dropped, and
+            // the error is returned.
+            absl::Status Close();
+            int64_t num_dropped() const;
+
+        private:
+            void FlushLoop();
+            // Writes pending and leaves in it the appends that failed.
+            absl::Status WritePending(std::map<std::string, std::string>* pending);
+
+            BufferedWriterOptions options_;
+            mutable std::mutex mu_;
+            std::condition_variable flush_cv_;
+            std::condition_variable done_cv_;
+            std::map<std::string, std::string> pending_;
+            int64_t buffered_bytes_ = 0;
+            bool flush_now_ = false;
+            bool stopped_ = false;
+            // Number of flush rounds started and finished, so that Flush() waits for the round taking its appends.
+            int64_t rounds_started_ = 0;
+            int64_t rounds_done_ = 0;
+            int64_t num_dropped_ = 0;
+            // Error of the last flush round, ok if it wrote everything.
+            absl::Status error_;
+            std::thread flusher_;
+        };
+    }  // namespace client
+} // namespace galaxy
+
+#endif // CPP_GALAXY_BUFFERED_WRITER_H
@@ -0,0 +1,102 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <gtest/gtest.h>
+#include "cpp/buffered_writer.h"
+#include "cpp/core/galaxy_test_cells.h"
+
+namespace {
+    using galaxy::TestCells;
+    using galaxy::TestCellsOptions;
+    using galaxy::client::BufferedWriter;
+    using galaxy::client::BufferedWriterOptions;
+
+    std::string ReadFile(const std::string& path) {
+        std::ifstream file(path);
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        return buffer.str();
+    }
+
+    BufferedWriterOptions TestOptions() {
+        BufferedWriterOptions options;
+        options.flush_interval_ms = 20;
+        return options;
+    }
+
+    TEST(BufferedWriterTest, CoalescesAppendsInOrder) {
+        TestCells cells("buffered_order", {"aa"});
+        BufferedWriter writer(TestOptions());
+        std::string expected;
+        for (int i = 0; i < 100; i++) {
+            std::string record = "record " + std::to_string(i) + "\n";
+            EXPECT_TRUE(writer.Append("/galaxy/aa-d/log", record));
+            expected += record;
+        }
+        EXPECT_TRUE(writer.Flush().ok());
+        EXPECT_TRUE(writer.Close().ok());
+        EXPECT_EQ(ReadFile(cells.Root("aa") + "/log"), expected);
+    }
+
+    TEST(BufferedWriterTest, CellsSharingRoot) {
+        // Both files are the same path on their cells, and must still be written once each.
+        TestCellsOptions options;
+        options.shared_root = true;
+        TestCells cells("buffered_shared", {"aa", "bb"}, options);
+        BufferedWriter writer(TestOptions());
+        EXPECT_TRUE(writer.Append("/galaxy/aa-d/log", "a\n"));
+        EXPECT_TRUE(writer.Append("/galaxy/bb-d/log", "b\n"));
+        EXPECT_TRUE(writer.Flush().ok());
+        // Further rounds have nothing left to write.
+        EXPECT_TRUE(writer.Flush().ok());
+        EXPECT_TRUE(writer.Flush().ok());
+        EXPECT_TRUE(writer.Close().ok());
+        std::string data = ReadFile(cells.Root("aa") + "/log");
+        EXPECT_TRUE(data == "a\nb\n" || data == "b\na\n") << data;
+    }
+
+    TEST(BufferedWriterTest, LocalAndRemoteFiles) {
+        TestCells cells("buffered_local", {"aa"});
+        std::string local_path = cells.Root("aa") + "/local_log";
+        BufferedWriter writer(TestOptions());
+        EXPECT_TRUE(writer.Append(local_path, "local\n"));
+        EXPECT_TRUE(writer.Append("/galaxy/aa-d/remote_log", "remote\n"));
+        EXPECT_TRUE(writer.Flush().ok());
+        EXPECT_EQ(ReadFile(local_path), "local\n");
+        EXPECT_EQ(ReadFile(cells.Root("aa") + "/remote_log"), "remote\n");
+    }
+
+    TEST(BufferedWriterTest, FailedAppendsAreRetried) {
+        TestCellsOptions options;
+        options.down = {"bb"};
+        TestCells cells("buffered_retry", {"aa", "bb"}, options);
+        BufferedWriter writer(TestOptions());
+        EXPECT_TRUE(writer.Append("/galaxy/aa-d/log", "a\n"));
+        EXPECT_TRUE(writer.Append("/galaxy/bb-d/log", "b\n"));
+        EXPECT_FALSE(writer.Flush().ok());
+        EXPECT_FALSE(writer.Flush().ok());
+        // Dropped when closing, and the file of the cell that is up written once.
+        EXPECT_FALSE(writer.Close().ok());
+        EXPECT_EQ(ReadFile(cells.Root("aa") + "/log"), "a\n");
+        EXPECT_FALSE(writer.Append("/galaxy/aa-d/log", "a\n"));
+    }
+
+    TEST(BufferedWriterTest, DropsWhenFull) {
+        TestCells cells("buffered_full", {"aa"});
+        std::string path = cells.Root("aa") + "/log";
+        BufferedWriterOptions options;
+        // Nothing is flushed until asked for.
+        options.flush_interval_ms = 3600 * 1000;
+        options.max_buffered_bytes = 16;
+        options.drop_when_full = true;
+        BufferedWriter writer(options);
+        EXPECT_TRUE(writer.Append(path, std::string(10, 'a')));
+        EXPECT_FALSE(writer.Append(path, std::string(10, 'b')));
+        EXPECT_TRUE(writer.Append(path, std::string(6, 'c')));
+        EXPECT_EQ(writer.num_dropped(), 1);
+        EXPECT_TRUE(writer.Flush().ok());
+        EXPECT_TRUE(writer.Append(path, std::string(10, 'b')));
+        EXPECT_TRUE(writer.Close().ok());
+        EXPECT_EQ(ReadFile(path), std::string(10, 'a') + std::string(6, 'c') + std::string(10, 'b'));
+    }
+}  // namespace
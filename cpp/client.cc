@@ -1,18 +1,30 @@
 #include <algorithm>
+#include <atomic>
+#include <future>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include <set>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #include <google/protobuf/util/json_util.h>
 #include <google/protobuf/message.h>
 
 #include "cpp/client.h"
 #include "cpp/core/galaxy_flag.h"
 #include "cpp/core/galaxy_fs.h"
+#include "cpp/core/galaxy_txn.h"
+#include "cpp/core/galaxy_scan.h"
+#include "cpp/core/galaxy_tail.h"
+#include "cpp/core/galaxy_watch.h"
+#include "cpp/util/galaxy_hash.h"
 #include "cpp/util/galaxy_util.h"
 #include "cpp/internal/galaxy_client_internal.h"
 #include "cpp/internal/galaxy_const.h"
 #include "absl/flags/flag.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_join.h"
 #include "glog/logging.h"
 
 #include "include/rapidjson/document.h"
@@ -20,6 +32,7 @@
 #include "include/rapidjson/stringbuffer.h"
 
 using galaxy_schema::Owner;
+using galaxy_schema::CompressionType;
 using galaxy_schema::FileSystemStatus;
 using galaxy_schema::FileSystemUsage;
 using galaxy_schema::Credential;
@@ -27,11 +40,14 @@ using galaxy_schema::Attribute;
 using galaxy_schema::WriteMode;
 using galaxy_schema::CrossCellCallType;
 
+using galaxy_schema::CellConfig;
 using galaxy_schema::SingleRequestCellConfigs;
 using galaxy_schema::FileAnalyzerResult;
 
 using galaxy_schema::CopyRequest;
 using galaxy_schema::CopyResponse;
+using galaxy_schema::ChecksumRequest;
+using galaxy_schema::ChecksumResponse;
 using galaxy_schema::CreateDirRequest;
 using galaxy_schema::CreateDirResponse;
 using galaxy_schema::CreateFileRequest;
@@ -44,6 +60,8 @@ using galaxy_schema::FileOrDieRequest;
 using galaxy_schema::FileOrDieResponse;
 using galaxy_schema::GetAttrRequest;
 using galaxy_schema::GetAttrResponse;
+using galaxy_schema::LinkBlobRequest;
+using galaxy_schema::LinkBlobResponse;
 using galaxy_schema::ListDirsInDirRequest;
 using galaxy_schema::ListDirsInDirResponse;
 using galaxy_schema::ListFilesInDirRequest;
@@ -58,6 +76,7 @@ using galaxy_schema::RenameFileRequest;
 using galaxy_schema::RenameFileResponse;
 using galaxy_schema::RemoteExecutionRequest;
 using galaxy_schema::RemoteExecutionResponse;
+using galaxy_schema::RemoteExecutionStreamResponse;
 using galaxy_schema::RmDirRecursiveRequest;
 using galaxy_schema::RmDirRecursiveResponse;
 using galaxy_schema::RmDirRequest;
@@ -68,26 +87,106 @@ using galaxy_schema::WriteRequest;
 using galaxy_schema::WriteResponse;
 using galaxy_schema::WriteMultipleRequest;
 using galaxy_schema::WriteMultipleResponse;
+using galaxy_schema::WriteAtRequest;
+using galaxy_schema::WriteAtResponse;
+using galaxy_schema::TruncateRequest;
+using galaxy_schema::TruncateResponse;
+using galaxy_schema::PreallocateRequest;
+using galaxy_schema::PreallocateResponse;
 using galaxy_schema::HealthCheckRequest;
 using galaxy_schema::HealthCheckResponse;
 using galaxy_schema::ModifyCellAvailabilityRequest;
 using galaxy_schema::ModifyCellAvailabilityResponse;
+using galaxy_schema::ScanFileResult;
+using galaxy_schema::ScanRequest;
+using galaxy_schema::ScanResponse;
+using galaxy_schema::TailRequest;
+using galaxy_schema::TailResponse;
+using galaxy_schema::WatchEventType;
+using galaxy_schema::WatchRequest;
+using galaxy_schema::WatchResponse;
 
 using galaxy::GalaxyClientInternal;
 using galaxy::GalaxyFs;
 using google::protobuf::Message;
 
+// Channels are shared by all calls to the same cell, so that concurrent callers (e.g. the transfer engine)
+// multiplex over one connection instead of building a new channel per call.
+std::shared_ptr<grpc::Channel> GetChannel(const std::string& address) {
+    static std::mutex mu;
+    static std::map<std::string, std::shared_ptr<grpc::Channel>> channels;
+    std::lock_guard<std::mutex> lock(mu);
+    auto it = channels.find(address);
+    if (it != channels.end()) {
+        return it->second;
+    }
+    grpc::ChannelArguments ch_args;
+    ch_args.SetMaxReceiveMessageSize(-1);
+    std::shared_ptr<grpc::Channel> channel = grpc::CreateCustomChannel(address, grpc::InsecureChannelCredentials(), ch_args);
+    channels.insert({address, channel});
+    return channel;
+}
+
+// Compression set by the innermost ScopedCompression of this thread, if any.
+thread_local const CompressionType* scoped_compression = nullptr;
+
+galaxy::client::ScopedCompression::ScopedCompression(CompressionType type) : type_(type), previous_(scoped_compression) {
+    scoped_compression = &type_;
+}
+
+galaxy::client::ScopedCompression::~ScopedCompression() {
+    scoped_compression = previous_;
+}
+
 GalaxyClientInternal GetChannelClient(const SingleRequestCellConfigs& config) {
     FLAGS_colorlogtostderr = true;
     FLAGS_log_dir = config.from_cell_config().fs_log_dir();
     google::EnableLogCleaner(config.from_cell_config().fs_log_ttl());
-    grpc::ChannelArguments ch_args;
-    ch_args.SetMaxReceiveMessageSize(-1);
-    GalaxyClientInternal client(grpc::CreateCustomChannel(
-        config.to_cell_config().fs_ip() + ":" + std::to_string(config.to_cell_config().fs_port()), grpc::InsecureChannelCredentials(), ch_args));
+    GalaxyClientInternal client(GetChannel(
+        config.to_cell_config().fs_ip() + ":" + std::to_string(config.to_cell_config().fs_port())));
+    client.SetCompression(scoped_compression != nullptr ? *scoped_compression : config.to_cell_config().fs_compression(),
+                          static_cast<int64_t>(config.to_cell_config().fs_compression_min_kb()) * 1024);
+    client.SetMaxPayloadSize(static_cast<int64_t>(config.to_cell_config().fs_max_msg_size()) * 1024 * 1024);
     return client;
 }
 
+// Asks the target cell to materialize path from its blob store, so that content it already holds is not re-sent.
+// Returns false on a miss or on any error, in which case the caller sends the data as usual. Only worth the hash and
+// the call for cells with fs_enable_cas, as the others never link.
+bool TryLinkBlob(const SingleRequestCellConfigs& configs, const std::string& path, const std::string& hash) {
+    try {
+        GalaxyClientInternal client = GetChannelClient(configs);
+        LinkBlobRequest request;
+        request.set_name(path);
+        request.set_content_hash(hash);
+        request.mutable_cred()->set_password(configs.to_cell_config().fs_password());
+        request.set_from_cell(configs.from_cell_config().cell());
+        LinkBlobResponse response = client.LinkBlob(request);
+        return response.status().return_code() == 1 && response.linked();
+    }
+    catch (std::string errorMsg)
+    {
+        VLOG(1) << "LinkBlob failed for " << path << ": " << errorMsg;
+        return false;
+    }
+}
+
+// Content hash of a local file worth deduplicating, or an empty string if the file is too small.
+std::string HashLocalFileForBlob(const std::string& path) {
+    struct stat statbuf;
+    if (stat(path.c_str(), &statbuf) != 0 || statbuf.st_size < galaxy::constant::kCasMinBlobSize) {
+        return "";
+    }
+    absl::StatusOr<std::string> hash = galaxy::util::HashFile(path);
+    return hash.ok() ? *hash : "";
+}
+
+std::string Crc32cToString(uint32_t crc) {
+    char hex[9];
+    snprintf(hex, sizeof(hex), "%08x", crc);
+    return hex;
+}
+
 std::string StatbufToString(const struct stat& statbuf) {
     rapidjson::Document doc;
     doc.SetObject();
@@ -122,6 +221,141 @@ std::string ProtoMessageToString(const Message& message) {
     return output_str;
 }
 
+// Runs fn on the path of every cell behind a shared path concurrently.
+void ForEachSharedPath(const std::string& path, const std::function<void(const std::string&)>& fn) {
+    std::vector<std::string> paths = galaxy::util::BroadcastSharedPath(path, galaxy::client::ListCells());
+    std::vector<std::future<void>> futures;
+    for (const auto& new_path : paths) {
+        futures.push_back(std::async(std::launch::async, fn, new_path));
+    }
+    for (auto& future : futures) {
+        future.get();
+    }
+}
+
+// Sends a copy (of request.from_name(), or of request.data() if from_data is set) to every cell of the shared path
+// to_path. Payloads of at least fs_shared_chain_min_kb are sent once to the first cell and replicated down a chain
+// (or a tree with fs_shared_fanout > 1) of cells, smaller ones are sent to all the cells concurrently.
+std::map<std::string, bool> ReplicateToSharedPath(const CopyRequest& request, const std::string& to_path, const CellConfig& from_cell_config,
+                                                  bool from_data, int64_t size) {
+    const std::vector<std::string> all_cells = galaxy::client::ListCells();
+    std::vector<std::string> cells = all_cells;
+    std::map<std::string, bool> cell_status;
+    std::string suffix = to_path.substr(std::string(galaxy::constant::kSharedPrefix).length());
+
+    auto cell_configs = [&](const std::string& cell) {
+        absl::StatusOr<CellConfig> config = galaxy::util::ParseCellConfig(cell);
+        if (!config.ok()) {
+            throw config.status().ToString();
+        }
+        SingleRequestCellConfigs configs;
+        *configs.mutable_from_cell_config() = from_cell_config;
+        *configs.mutable_to_cell_config() = *config;
+        return configs;
+    };
+    auto send_to_cell = [&](const std::string& cell, CopyRequest cell_request) {
+        SingleRequestCellConfigs configs = cell_configs(cell);
+        GalaxyClientInternal client = GetChannelClient(configs);
+        cell_request.set_to_name(configs.to_cell_config().fs_root() + suffix);
+        cell_request.mutable_cred()->set_password(configs.to_cell_config().fs_password());
+        cell_request.set_from_cell(from_cell_config.cell());
+        return from_data ? client.CopyData(cell_request) : client.CopyFile(cell_request);
+    };
+
+    // Cells already holding the content only need a link, the data is sent to the others. Only the cells with a blob
+    // store are asked, and the payload is not hashed if none of them has one.
+    std::vector<std::string> cas_cells;
+    if (size >= galaxy::constant::kCasMinBlobSize) {
+        for (const auto& cell : cells) {
+            try {
+                if (cell_configs(cell).to_cell_config().fs_enable_cas()) {
+                    cas_cells.push_back(cell);
+                }
+            }
+            catch (std::string errorMsg)
+            {
+                LOG(ERROR) << errorMsg;
+            }
+        }
+    }
+    std::string hash;
+    if (!cas_cells.empty()) {
+        hash = from_data ? galaxy::util::HashData(request.data()) : HashLocalFileForBlob(request.from_name());
+    }
+    if (!hash.empty()) {
+        std::vector<std::future<bool>> futures;
+        for (const auto& cell : cas_cells) {
+            futures.push_back(std::async(std::launch::async, [&cell_configs, &hash, &suffix, cell]() {
+                try {
+                    SingleRequestCellConfigs configs = cell_configs(cell);
+                    return TryLinkBlob(configs, configs.to_cell_config().fs_root() + suffix, hash);
+                }
+                catch (std::string errorMsg)
+                {
+                    LOG(ERROR) << errorMsg;
+                    return false;
+                }
+            }));
+        }
+        for (size_t i = 0; i < cas_cells.size(); i++) {
+            if (futures[i].get()) {
+                cell_status[cas_cells[i]] = true;
+            }
+        }
+        std::vector<std::string> unlinked_cells;
+        for (const auto& cell : cells) {
+            if (cell_status.count(cell) == 0) {
+                unlinked_cells.push_back(cell);
+            }
+        }
+        cells.swap(unlinked_cells);
+    }
+
+    if (cells.size() > 2 && size >= static_cast<int64_t>(absl::GetFlag(FLAGS_fs_shared_chain_min_kb)) * 1024) {
+        VLOG(2) << "Replicating " << to_path << " through a chain of " << cells.size() << " cells.";
+        CopyRequest chain_request(request);
+        *chain_request.mutable_replicate_cells() = {cells.begin() + 1, cells.end()};
+        chain_request.set_shared_name(to_path);
+        chain_request.set_replicate_fanout(absl::GetFlag(FLAGS_fs_shared_fanout));
+        try {
+            CopyResponse response = send_to_cell(cells.at(0), chain_request);
+            for (const auto& pair : response.cell_status()) {
+                cell_status[pair.first] = pair.second.return_code() == 1;
+            }
+        }
+        catch (std::string errorMsg)
+        {
+            LOG(ERROR) << errorMsg;
+        }
+    } else {
+        std::vector<std::future<bool>> futures;
+        for (const auto& cell : cells) {
+            futures.push_back(std::async(std::launch::async, [&send_to_cell, &request, cell]() {
+                try {
+                    return send_to_cell(cell, request).status().return_code() == 1;
+                }
+                catch (std::string errorMsg)
+                {
+                    LOG(ERROR) << errorMsg;
+                    return false;
+                }
+            }));
+        }
+        for (size_t i = 0; i < cells.size(); i++) {
+            cell_status[cells[i]] = futures[i].get();
+        }
+    }
+    for (const auto& cell : all_cells) {
+        if (cell_status.find(cell) == cell_status.end()) {
+            cell_status[cell] = false;
+        }
+        if (!cell_status[cell]) {
+            LOG(ERROR) << "Failed to replicate " << to_path << " to cell [" << cell << "].";
+        }
+    }
+    return cell_status;
+}
+
 void galaxy::client::impl::RCreateDirIfNotExist(const FileAnalyzerResult& result, const int mode) {
     GalaxyClientInternal client = GetChannelClient(result.configs());
     try {
@@ -152,7 +386,13 @@ void galaxy::client::impl::RCopyFile(const FileAnalyzerResult& from_result, cons
             request.set_from_name(from_result.path());
             request.set_to_name(to_result.path());
             request.set_from_cell(from_result.configs().from_cell_config().cell());
-            CopyResponse response = client.CopyFile(request);
+            std::string hash = to_result.configs().to_cell_config().fs_enable_cas() ? HashLocalFileForBlob(from_result.path()) : "";
+            CopyResponse response;
+            if (!hash.empty() && TryLinkBlob(to_result.configs(), to_result.path(), hash)) {
+                response.mutable_status()->set_return_code(1);
+            } else {
+                response = client.CopyFile(request);
+            }
             FileSystemStatus status = response.status();
             if (status.return_code() != 1) {
                 throw "Fail to call CopyFile.";
@@ -177,6 +417,7 @@ void galaxy::client::impl::RCopyFile(const FileAnalyzerResult& from_result, cons
                 std::string from_galaxy_path = galaxy::util::ConvertToCellPath(from_result.path(), from_result.configs().to_cell_config());
                 CrossCellRequest request;
                 request.set_call_type(CrossCellCallType::COPYFILE);
+                request.mutable_cred()->set_password(from_result.configs().to_cell_config().fs_password());
                 CopyRequest copy_request;
                 copy_request.mutable_cred()->set_password(from_result.configs().to_cell_config().fs_password());
                 copy_request.set_from_name(from_galaxy_path);
@@ -209,7 +450,13 @@ void galaxy::client::impl::RMoveFile(const FileAnalyzerResult& from_result, cons
             request.set_from_name(from_result.path());
             request.set_to_name(to_result.path());
             request.set_from_cell(from_result.configs().from_cell_config().cell());
-            CopyResponse response = client.CopyFile(request);
+            std::string hash = to_result.configs().to_cell_config().fs_enable_cas() ? HashLocalFileForBlob(from_result.path()) : "";
+            CopyResponse response;
+            if (!hash.empty() && TryLinkBlob(to_result.configs(), to_result.path(), hash)) {
+                response.mutable_status()->set_return_code(1);
+            } else {
+                response = client.CopyFile(request);
+            }
             FileSystemStatus status = response.status();
             if (status.return_code() != 1) {
                 throw "Fail to call MoveFile.";
@@ -237,6 +484,7 @@ void galaxy::client::impl::RMoveFile(const FileAnalyzerResult& from_result, cons
                 std::string from_galaxy_path = galaxy::util::ConvertToCellPath(from_result.path(), from_result.configs().to_cell_config());
                 CrossCellRequest request;
                 request.set_call_type(CrossCellCallType::MOVEFILE);
+                request.mutable_cred()->set_password(from_result.configs().to_cell_config().fs_password());
                 CopyRequest copy_request;
                 copy_request.mutable_cred()->set_password(from_result.configs().to_cell_config().fs_password());
                 copy_request.set_from_name(from_galaxy_path);
@@ -528,9 +776,10 @@ std::string galaxy::client::impl::RRead(const FileAnalyzerResult& result) {
     }
 }
 
-std::map<std::string, std::string> galaxy::client::impl::RReadMultiple(const std::vector<FileAnalyzerResult>& results) {
+std::map<std::string, std::string> galaxy::client::impl::RReadMultiple(const std::vector<FileAnalyzerResult>& results, bool consistent) {
     GalaxyClientInternal client = GetChannelClient(results.at(0).configs());
     ReadMultipleRequest request;
+    request.set_consistent(consistent);
     std::map<std::string, std::string> data_map;
     for (const auto& result : results) {
         request.add_names(result.path());
@@ -549,6 +798,32 @@ std::map<std::string, std::string> galaxy::client::impl::RReadMultiple(const std
     return data_map;
 }
 
+std::map<std::string, ScanFileResult> galaxy::client::impl::RScan(const SingleRequestCellConfigs& configs, ScanRequest request) {
+    GalaxyClientInternal client = GetChannelClient(configs);
+    request.mutable_cred()->set_password(configs.to_cell_config().fs_password());
+    request.set_from_cell(configs.from_cell_config().cell());
+    std::map<std::string, ScanFileResult> results;
+    try {
+        ScanResponse response = client.Scan(request);
+        for (const auto& pair : response.results()) {
+            results.insert({galaxy::util::ConvertToCellPath(pair.first, configs.to_cell_config()), pair.second});
+        }
+    }
+    catch (std::string errorMsg)
+    {
+        // The whole request failed, e.g. on an invalid pattern, so every file of it fails with the same error.
+        LOG(ERROR) << errorMsg;
+        std::vector<std::string> names(request.names().begin(), request.names().end());
+        if (!request.dir().empty()) {
+            names.push_back(request.dir());
+        }
+        for (const auto& name : names) {
+            results[galaxy::util::ConvertToCellPath(name, configs.to_cell_config())].set_error(errorMsg);
+        }
+    }
+    return results;
+}
+
 void galaxy::client::impl::RWrite(const FileAnalyzerResult& result, const std::string& data, const std::string& mode) {
     CHECK(mode == "a" || mode == "w") << "Mode has to be either a or w";
     GalaxyClientInternal client = GetChannelClient(result.configs());
@@ -563,6 +838,10 @@ void galaxy::client::impl::RWrite(const FileAnalyzerResult& result, const std::s
         }
         request.mutable_cred()->set_password(result.configs().to_cell_config().fs_password());
         request.set_from_cell(result.configs().from_cell_config().cell());
+        if (mode == "w" && result.configs().to_cell_config().fs_enable_cas() && data.size() >= galaxy::constant::kCasMinBlobSize &&
+            TryLinkBlob(result.configs(), result.path(), galaxy::util::HashData(data))) {
+            return;
+        }
         WriteResponse response = client.Write(request);
         FileSystemStatus status = response.status();
         if (status.return_code() != 1) {
@@ -575,9 +854,72 @@ void galaxy::client::impl::RWrite(const FileAnalyzerResult& result, const std::s
     }
 }
 
-void galaxy::client::impl::RWriteMultiple(const std::vector<std::pair<galaxy_schema::FileAnalyzerResult, std::string>>& path_data_map, const std::string& mode) {
+void galaxy::client::impl::RWriteAt(const FileAnalyzerResult& result, int64_t offset, const std::string& data) {
+    GalaxyClientInternal client = GetChannelClient(result.configs());
+    try {
+        WriteAtRequest request;
+        request.set_name(result.path());
+        request.set_offset(offset);
+        request.set_data(data);
+        request.mutable_cred()->set_password(result.configs().to_cell_config().fs_password());
+        request.set_from_cell(result.configs().from_cell_config().cell());
+        WriteAtResponse response = client.WriteAt(request);
+        FileSystemStatus status = response.status();
+        if (status.return_code() != 1) {
+            throw "Fail to call WriteAt.";
+        }
+    }
+    catch (std::string errorMsg)
+    {
+        LOG(ERROR) << errorMsg;
+    }
+}
+
+void galaxy::client::impl::RTruncate(const FileAnalyzerResult& result, int64_t size) {
+    GalaxyClientInternal client = GetChannelClient(result.configs());
+    try {
+        TruncateRequest request;
+        request.set_name(result.path());
+        request.set_size(size);
+        request.mutable_cred()->set_password(result.configs().to_cell_config().fs_password());
+        request.set_from_cell(result.configs().from_cell_config().cell());
+        TruncateResponse response = client.Truncate(request);
+        FileSystemStatus status = response.status();
+        if (status.return_code() != 1) {
+            throw "Fail to call Truncate.";
+        }
+    }
+    catch (std::string errorMsg)
+    {
+        LOG(ERROR) << errorMsg;
+    }
+}
+
+void galaxy::client::impl::RPreallocate(const FileAnalyzerResult& result, int64_t size) {
+    GalaxyClientInternal client = GetChannelClient(result.configs());
+    try {
+        PreallocateRequest request;
+        request.set_name(result.path());
+        request.set_size(size);
+        request.mutable_cred()->set_password(result.configs().to_cell_config().fs_password());
+        request.set_from_cell(result.configs().from_cell_config().cell());
+        PreallocateResponse response = client.Preallocate(request);
+        FileSystemStatus status = response.status();
+        if (status.return_code() != 1) {
+            throw "Fail to call Preallocate.";
+        }
+    }
+    catch (std::string errorMsg)
+    {
+        LOG(ERROR) << errorMsg;
+    }
+}
+
+void galaxy::client::impl::RWriteMultiple(const std::vector<std::pair<galaxy_schema::FileAnalyzerResult, std::string>>& path_data_map, const std::string& mode,
+                                          std::set<std::string>* failed) {
     GalaxyClientInternal client = GetChannelClient(path_data_map.begin()->first.configs());
     CHECK(mode == "a" || mode == "w");
+    std::set<std::string> written;
     try {
         WriteMultipleRequest request;
         if (mode == "a") {
@@ -596,12 +938,43 @@ void galaxy::client::impl::RWriteMultiple(const std::vector<std::pair<galaxy_sch
             std::string path = galaxy::util::ConvertToCellPath(pair.first, path_data_map.begin()->first.configs().to_cell_config());
             if (pair.second.status().return_code() != 1) {
                 LOG(ERROR) << "Failed to write data for file " << path;
+            } else {
+                written.insert(pair.first);
+            }
+        }
+    }
+    catch (std::string errorMsg)
+    {
+        LOG(ERROR) << errorMsg;
+    }
+    if (failed != nullptr) {
+        for (const auto& val : path_data_map) {
+            if (written.count(val.first.path()) == 0) {
+                failed->insert(val.first.path());
             }
         }
     }
+}
+
+bool galaxy::client::impl::RWriteMultipleAtomic(const std::vector<std::pair<galaxy_schema::FileAnalyzerResult, std::string>>& path_data_map) {
+    GalaxyClientInternal client = GetChannelClient(path_data_map.begin()->first.configs());
+    try {
+        WriteMultipleRequest request;
+        request.set_mode(WriteMode::OVERWRITE);
+        request.set_atomic(true);
+        request.mutable_cred()->set_password(path_data_map.begin()->first.configs().to_cell_config().fs_password());
+        request.set_from_cell(path_data_map.begin()->first.configs().from_cell_config().cell());
+        for (const auto& val : path_data_map) {
+            (*request.mutable_data())[val.first.path()] = val.second;
+        }
+        // The call fails as a whole, so any response means that every file is written.
+        client.WriteMultiple(request);
+        return true;
+    }
     catch (std::string errorMsg)
     {
         LOG(ERROR) << errorMsg;
+        return false;
     }
 }
 
@@ -626,6 +999,27 @@ std::string galaxy::client::impl::RGetAttr(const FileAnalyzerResult& result) {
     }
 }
 
+std::string galaxy::client::impl::RChecksum(const FileAnalyzerResult& result) {
+    GalaxyClientInternal client = GetChannelClient(result.configs());
+    try {
+        ChecksumRequest request;
+        request.set_name(result.path());
+        request.mutable_cred()->set_password(result.configs().to_cell_config().fs_password());
+        request.set_from_cell(result.configs().from_cell_config().cell());
+        ChecksumResponse response = client.Checksum(request);
+        FileSystemStatus status = response.status();
+        if (status.return_code() != 1) {
+            throw "Fail to call Checksum.";
+        }
+        return Crc32cToString(response.crc32c());
+    }
+    catch (std::string errorMsg)
+    {
+        LOG(ERROR) << errorMsg;
+        return "";
+    }
+}
+
 std::string galaxy::client::impl::RCheckHealth(const std::string& cell) {
     std::string path = galaxy::util::GetGalaxyFsPrefixPath(cell);
     FileAnalyzerResult result = galaxy::util::InitClient(path);
@@ -674,7 +1068,7 @@ void galaxy::client::impl::RChangeAvailability(const std::string& cell, const bo
 
 void galaxy::client::impl::LCreateDirIfNotExist(const FileAnalyzerResult& result, const int mode) {
     try {
-        GalaxyFs fs("");
+        GalaxyFs& fs = *GalaxyFs::Instance();
         auto status = fs.CreateDirIfNotExist(result.path(), mode);
         if (!status.ok()) {
             throw "CreateDirIfNotExist failed with error " + status.ToString() + '.';
@@ -688,7 +1082,7 @@ void galaxy::client::impl::LCreateDirIfNotExist(const FileAnalyzerResult& result
 
 void galaxy::client::impl::LCopyFile(const FileAnalyzerResult& from_result, const FileAnalyzerResult& to_result) {
     try {
-        GalaxyFs fs("");
+        GalaxyFs& fs = *GalaxyFs::Instance();
         auto status = fs.CopyFile(from_result.path(), to_result.path());
         if (!status.ok()) {
             throw "CopyFile failed with error " + status.ToString() + '.';
@@ -700,7 +1094,7 @@ void galaxy::client::impl::LCopyFile(const FileAnalyzerResult& from_result, cons
 
 void galaxy::client::impl::LMoveFile(const FileAnalyzerResult& from_result, const FileAnalyzerResult& to_result) {
     try {
-        GalaxyFs fs("");
+        GalaxyFs& fs = *GalaxyFs::Instance();
         auto status = fs.MoveFile(from_result.path(), to_result.path());
         if (!status.ok()) {
             throw "MoveFile failed with error " + status.ToString() + '.';
@@ -712,7 +1106,7 @@ void galaxy::client::impl::LMoveFile(const FileAnalyzerResult& from_result, cons
 
 std::string galaxy::client::impl::LDirOrDie(const FileAnalyzerResult& result) {
     try {
-        GalaxyFs fs("");
+        GalaxyFs& fs = *GalaxyFs::Instance();
         std::string out_path;
         auto status = fs.DieDirIfNotExist(result.path(), out_path);
         if (!status.ok()) {
@@ -729,7 +1123,7 @@ std::string galaxy::client::impl::LDirOrDie(const FileAnalyzerResult& result) {
 
 void galaxy::client::impl::LRmDir(const FileAnalyzerResult& result, bool include_hidden) {
     try {
-        GalaxyFs fs("");
+        GalaxyFs& fs = *GalaxyFs::Instance();
         auto status = fs.RmDir(result.path(), include_hidden);
         if (!status.ok()) {
             throw "RmDir failed with error " + status.ToString() + '.';
@@ -743,7 +1137,7 @@ void galaxy::client::impl::LRmDir(const FileAnalyzerResult& result, bool include
 
 void galaxy::client::impl::LRmDirRecursive(const FileAnalyzerResult& result, bool include_hidden) {
     try {
-        GalaxyFs fs("");
+        GalaxyFs& fs = *GalaxyFs::Instance();
         auto status = fs.RmDirRecursive(result.path(), include_hidden);
         if (!status.ok()) {
             throw "RmDirRecursive failed with error " + status.ToString() + '.';
@@ -758,7 +1152,7 @@ void galaxy::client::impl::LRmDirRecursive(const FileAnalyzerResult& result, boo
 std::map<std::string, std::string> galaxy::client::impl::LListDirsInDir(const FileAnalyzerResult& result) {
     try {
         absl::flat_hash_map<std::string, struct stat> sub_dirs;
-        GalaxyFs fs("");
+        GalaxyFs& fs = *GalaxyFs::Instance();
         auto status = fs.ListDirsInDir(result.path(), sub_dirs);
         if (!status.ok()) {
             throw "ListDirsInDir failed with error " + status.ToString() + '.';
@@ -779,7 +1173,7 @@ std::map<std::string, std::string> galaxy::client::impl::LListDirsInDir(const Fi
 std::map<std::string, std::string> galaxy::client::impl::LListFilesInDir(const FileAnalyzerResult& result, bool include_hidden) {
     try {
         absl::flat_hash_map<std::string, struct stat> sub_files;
-        GalaxyFs fs("");
+        GalaxyFs& fs = *GalaxyFs::Instance();
         auto status = fs.ListFilesInDir(result.path(), sub_files, include_hidden);
         if (!status.ok()) {
             throw "ListFilesInDir failed with error " + status.ToString() + '.';
@@ -801,7 +1195,7 @@ std::map<std::string, std::string> galaxy::client::impl::LListDirsInDirRecursive
     try {
         absl::flat_hash_map<std::string, struct stat> sub_files;
         absl::flat_hash_map<std::string, struct stat> sub_dirs;
-        GalaxyFs fs("");
+        GalaxyFs& fs = *GalaxyFs::Instance();
         auto status = fs.ListAllInDirRecursive(result.path(), sub_dirs, sub_files);
         if (!status.ok()) {
             throw "ListDirsInDirRecursive failed with error " + status.ToString() + '.';
@@ -823,7 +1217,7 @@ std::map<std::string, std::string> galaxy::client::impl::LListFilesInDirRecursiv
     try {
         absl::flat_hash_map<std::string, struct stat> sub_files;
         absl::flat_hash_map<std::string, struct stat> sub_dirs;
-        GalaxyFs fs("");
+        GalaxyFs& fs = *GalaxyFs::Instance();
         auto status = fs.ListAllInDirRecursive(result.path(), sub_dirs, sub_files, include_hidden);
         if (!status.ok()) {
             throw "ListFilesInDirRecursive failed with error " + status.ToString() + '.';
@@ -844,7 +1238,7 @@ std::map<std::string, std::string> galaxy::client::impl::LListFilesInDirRecursiv
 
 void galaxy::client::impl::LCreateFileIfNotExist(const FileAnalyzerResult& result, const int mode) {
     try {
-        GalaxyFs fs("");
+        GalaxyFs& fs = *GalaxyFs::Instance();
         auto status = fs.CreateFileIfNotExist(result.path(), mode);
         if (!status.ok()) {
             throw "CreateFileIfNotExist failed with error " + status.ToString() + '.';
@@ -858,7 +1252,7 @@ void galaxy::client::impl::LCreateFileIfNotExist(const FileAnalyzerResult& resul
 
 std::string galaxy::client::impl::LFileOrDie(const FileAnalyzerResult& result) {
     try {
-        GalaxyFs fs("");
+        GalaxyFs& fs = *GalaxyFs::Instance();
         std::string out_path;
         auto status = fs.DieFileIfNotExist(result.path(), out_path);
         if (!status.ok()) {
@@ -875,7 +1269,7 @@ std::string galaxy::client::impl::LFileOrDie(const FileAnalyzerResult& result) {
 
 void galaxy::client::impl::LRmFile(const FileAnalyzerResult& result, bool is_hidden) {
     try {
-        GalaxyFs fs("");
+        GalaxyFs& fs = *GalaxyFs::Instance();
         auto status = fs.RmFile(result.path(), !is_hidden);
         if (!status.ok()) {
             throw "RmFile failed with error " + status.ToString() + '.';
@@ -889,7 +1283,7 @@ void galaxy::client::impl::LRmFile(const FileAnalyzerResult& result, bool is_hid
 
 void galaxy::client::impl::LRenameFile(const FileAnalyzerResult& old_result, const FileAnalyzerResult& new_result) {
     try {
-        GalaxyFs fs("");
+        GalaxyFs& fs = *GalaxyFs::Instance();
         auto status = fs.RenameFile(old_result.path(), new_result.path());
         if (!status.ok()) {
             throw "RenameFile failed with error " + status.ToString() + '.';
@@ -903,7 +1297,7 @@ void galaxy::client::impl::LRenameFile(const FileAnalyzerResult& old_result, con
 
 std::string galaxy::client::impl::LRead(const FileAnalyzerResult& result) {
     try {
-        GalaxyFs fs("");
+        GalaxyFs& fs = *GalaxyFs::Instance();
         std::string data;
         auto status = fs.Read(result.path(), data);
         if (!status.ok()) {
@@ -918,12 +1312,26 @@ std::string galaxy::client::impl::LRead(const FileAnalyzerResult& result) {
     }
 }
 
-std::map<std::string, std::string> galaxy::client::impl::LReadMultiple(const std::vector<FileAnalyzerResult>& results) {
-    GalaxyFs fs("");
+std::map<std::string, std::string> galaxy::client::impl::LReadMultiple(const std::vector<FileAnalyzerResult>& results, bool consistent) {
+    GalaxyFs& fs = *GalaxyFs::Instance();
     std::map<std::string, std::string> data_map;
+    // Locks are taken in path order, the same as atomic writes, so that they never deadlock.
+    std::set<std::string> locked_paths;
+    if (consistent) {
+        for (const auto& result : results) {
+            std::string abs_path;
+            if (fs.DieFileIfNotExist(result.path(), abs_path).ok()) {
+                locked_paths.insert(result.path());
+            }
+        }
+        for (auto it = locked_paths.begin(); it != locked_paths.end();) {
+            // Paths that cannot be locked are read without a lock held here, which reports their error.
+            it = fs.Lock(*it).ok() ? std::next(it) : locked_paths.erase(it);
+        }
+    }
     for (const auto& result : results) {
         std::string data;
-        auto status = fs.Read(result.path(), data);
+        auto status = fs.Read(result.path(), data, locked_paths.count(result.path()) == 0);
         if (!status.ok()) {
             LOG(ERROR) << "Read " << result.path() <<" failed with error " << status.ToString();
             data_map.insert({galaxy::util::ConvertToCellPath(result.path(), result.configs().from_cell_config()), ""});
@@ -931,12 +1339,65 @@ std::map<std::string, std::string> galaxy::client::impl::LReadMultiple(const std
             data_map.insert({galaxy::util::ConvertToCellPath(result.path(), result.configs().from_cell_config()), data});
         }
     }
+    for (const auto& path : locked_paths) {
+        fs.Unlock(path);
+    }
     return data_map;
 }
 
+std::map<std::string, ScanFileResult> galaxy::client::impl::LScan(const SingleRequestCellConfigs& configs, const ScanRequest& request) {
+    GalaxyFs& fs = *GalaxyFs::Instance();
+    std::map<std::string, ScanFileResult> results;
+    auto cell_path = [&configs](const std::string& path) {
+        return galaxy::util::ConvertToCellPath(path, configs.from_cell_config());
+    };
+    galaxy::Scanner::Options options;
+    options.op = request.op();
+    options.pattern = request.pattern();
+    options.regex = request.regex();
+    options.max_lines = request.max_lines();
+    options.max_bytes = request.max_bytes() > 0 ? request.max_bytes() : galaxy::constant::kChunkSize;
+    galaxy::Scanner scanner(options);
+    absl::Status status = scanner.Init();
+    std::vector<std::string> paths;
+    for (const auto& name : request.names()) {
+        std::string abs_path;
+        absl::Status file_status = status.ok() ? fs.DieFileIfNotExist(name, abs_path) : status;
+        if (!file_status.ok()) {
+            results[cell_path(name)].set_error(file_status.ToString());
+        } else {
+            paths.push_back(abs_path);
+        }
+    }
+    if (!request.dir().empty()) {
+        absl::flat_hash_map<std::string, struct stat> dirs, files;
+        absl::Status dir_status = !status.ok() ? status : request.recursive() ? fs.ListAllInDirRecursive(request.dir(), dirs, files)
+                                                                               : fs.ListFilesInDir(request.dir(), files);
+        if (!dir_status.ok()) {
+            LOG(ERROR) << "Scan of " << request.dir() << " failed with error " << dir_status;
+            results[cell_path(request.dir())].set_error(dir_status.ToString());
+        }
+        for (const auto& file : files) {
+            paths.push_back(file.first);
+        }
+    }
+    std::vector<absl::StatusOr<galaxy::Scanner::Output>> outputs = scanner.ScanFiles(paths);
+    for (size_t i = 0; i < paths.size(); ++i) {
+        ScanFileResult& result = results[cell_path(paths[i])];
+        if (!outputs[i].ok()) {
+            result.set_error(outputs[i].status().ToString());
+            continue;
+        }
+        result.set_data(std::move(outputs[i]->data));
+        result.set_count(outputs[i]->count);
+        result.set_truncated(outputs[i]->truncated);
+    }
+    return results;
+}
+
 void galaxy::client::impl::LWrite(const FileAnalyzerResult& result, const std::string& data, const std::string& mode) {
     try {
-        GalaxyFs fs("");
+        GalaxyFs& fs = *GalaxyFs::Instance();
         auto status = fs.Write(result.path(), data, mode);
         if (!status.ok()) {
             throw "Write failed with error " + status.ToString() + '.';
@@ -949,8 +1410,50 @@ void galaxy::client::impl::LWrite(const FileAnalyzerResult& result, const std::s
 
 }
 
+void galaxy::client::impl::LWriteAt(const FileAnalyzerResult& result, int64_t offset, const std::string& data) {
+    try {
+        GalaxyFs& fs = *GalaxyFs::Instance();
+        auto status = fs.WriteAt(result.path(), offset, data);
+        if (!status.ok()) {
+            throw "WriteAt failed with error " + status.ToString() + '.';
+        }
+    }
+    catch (std::string errorMsg)
+    {
+        LOG(ERROR) << errorMsg;
+    }
+}
+
+void galaxy::client::impl::LTruncate(const FileAnalyzerResult& result, int64_t size) {
+    try {
+        GalaxyFs& fs = *GalaxyFs::Instance();
+        auto status = fs.Truncate(result.path(), size);
+        if (!status.ok()) {
+            throw "Truncate failed with error " + status.ToString() + '.';
+        }
+    }
+    catch (std::string errorMsg)
+    {
+        LOG(ERROR) << errorMsg;
+    }
+}
+
+void galaxy::client::impl::LPreallocate(const FileAnalyzerResult& result, int64_t size) {
+    try {
+        GalaxyFs& fs = *GalaxyFs::Instance();
+        auto status = fs.Preallocate(result.path(), size);
+        if (!status.ok()) {
+            throw "Preallocate failed with error " + status.ToString() + '.';
+        }
+    }
+    catch (std::string errorMsg)
+    {
+        LOG(ERROR) << errorMsg;
+    }
+}
+
 void galaxy::client::impl::LWriteMultiple(const std::vector<std::pair<galaxy_schema::FileAnalyzerResult, std::string>>& path_data_map, const std::string& mode) {
-    GalaxyFs fs("");
+    GalaxyFs& fs = *GalaxyFs::Instance();
     for (const auto& val : path_data_map) {
         auto status = fs.Write(val.first.path(), val.second, mode);
         if (!status.ok()) {
@@ -959,9 +1462,41 @@ void galaxy::client::impl::LWriteMultiple(const std::vector<std::pair<galaxy_sch
     }
 }
 
+bool galaxy::client::impl::LWriteMultipleAtomic(const std::vector<std::pair<galaxy_schema::FileAnalyzerResult, std::string>>& path_data_map) {
+    GalaxyFs& fs = *GalaxyFs::Instance();
+    // The journal lives in a directory of this process under the root of the local cell, so that its server recovers
+    // it after a crash of the client, but never while the client may still be committing it.
+    GalaxyTxn txn(path_data_map.begin()->first.configs().from_cell_config().fs_root(), getpid());
+    std::vector<std::pair<std::string, std::string>> files;
+    for (const auto& val : path_data_map) {
+        files.emplace_back(val.first.path(), val.second);
+    }
+    std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    absl::Status status;
+    size_t num_locked = 0;
+    while (num_locked < files.size()) {
+        status = fs.Lock(files[num_locked].first);
+        if (!status.ok()) {
+            break;
+        }
+        ++num_locked;
+    }
+    if (status.ok()) {
+        status = txn.Commit(files);
+    }
+    for (size_t i = 0; i < num_locked; ++i) {
+        fs.Unlock(files[i].first);
+    }
+    if (!status.ok()) {
+        LOG(ERROR) << "Atomic write failed with error " << status.ToString();
+        return false;
+    }
+    return true;
+}
+
 std::string galaxy::client::impl::LGetAttr(const FileAnalyzerResult& result) {
     try {
-        GalaxyFs fs("");
+        GalaxyFs& fs = *GalaxyFs::Instance();
         struct stat statbuf;
         auto status = fs.GetAttr(result.path(), &statbuf);
         if (!status.ok()) {
@@ -976,6 +1511,20 @@ std::string galaxy::client::impl::LGetAttr(const FileAnalyzerResult& result) {
     }
 }
 
+std::string galaxy::client::impl::LChecksum(const FileAnalyzerResult& result) {
+    try {
+        absl::StatusOr<uint32_t> crc = galaxy::util::FileCrc32c(result.path());
+        if (!crc.ok()) {
+            throw "Checksum failed with error " + crc.status().ToString() + '.';
+        }
+        return Crc32cToString(*crc);
+    }
+    catch (std::string errorMsg)
+    {
+        LOG(ERROR) << errorMsg;
+        return "";
+    }
+}
 
 // actual functions calls
 void galaxy::client::CreateDirIfNotExist(const std::string& path, const int mode) {
@@ -986,10 +1535,9 @@ void galaxy::client::CreateDirIfNotExist(const std::string& path, const int mode
         galaxy::client::impl::RCreateDirIfNotExist(result, mode);
     } else if (result.is_shared()) {
         VLOG(3) << "Using shared mode";
-        std::vector<std::string> paths = galaxy::util::BroadcastSharedPath(path, galaxy::client::ListCells());
-        for (const auto& new_path : paths) {
+        ForEachSharedPath(path, [&](const std::string& new_path) {
             galaxy::client::CreateDirIfNotExist(new_path, mode);
-        }
+        });
     } else {
         VLOG(1) << "Using local mode";
         galaxy::client::impl::LCreateDirIfNotExist(result, mode);
@@ -1020,10 +1568,9 @@ void galaxy::client::RmDir(const std::string& path, bool include_hidden) {
         galaxy::client::impl::RRmDir(result, include_hidden);
     } else if (result.is_shared()) {
         VLOG(3) << "Using shared mode";
-        std::vector<std::string> paths = galaxy::util::BroadcastSharedPath(path, galaxy::client::ListCells());
-        for (const auto& new_path : paths) {
+        ForEachSharedPath(path, [&](const std::string& new_path) {
             galaxy::client::RmDir(new_path, include_hidden);
-        }
+        });
     } else {
         VLOG(1) << "Using local mode";
         galaxy::client::impl::LRmDir(result, include_hidden);
@@ -1038,10 +1585,9 @@ void galaxy::client::RmDirRecursive(const std::string& path, bool include_hidden
         galaxy::client::impl::RRmDirRecursive(result, include_hidden);
     } else if (result.is_shared()) {
         VLOG(3) << "Using shared mode";
-        std::vector<std::string> paths = galaxy::util::BroadcastSharedPath(path, galaxy::client::ListCells());
-        for (const auto& new_path : paths) {
+        ForEachSharedPath(path, [&](const std::string& new_path) {
             galaxy::client::RmDirRecursive(new_path, include_hidden);
-        }
+        });
     } else {
         VLOG(1) << "Using local mode";
         galaxy::client::impl::LRmDirRecursive(result, include_hidden);
@@ -1120,10 +1666,9 @@ void galaxy::client::CreateFileIfNotExist(const std::string& path, const int mod
         galaxy::client::impl::RCreateFileIfNotExist(result, mode);
     } else if (result.is_shared()) {
         VLOG(3) << "Using shared mode";
-        std::vector<std::string> paths = galaxy::util::BroadcastSharedPath(path, galaxy::client::ListCells());
-        for (const auto& new_path : paths) {
+        ForEachSharedPath(path, [&](const std::string& new_path) {
             galaxy::client::CreateFileIfNotExist(new_path, mode);
-        }
+        });
     } else {
         VLOG(1) << "Using local mode";
         galaxy::client::impl::LCreateFileIfNotExist(result, mode);
@@ -1138,10 +1683,7 @@ void galaxy::client::CopyFile(const std::string& from_path, const std::string& t
         galaxy::client::CopyFile(paths.at(0), to_path);
         return;
     } else if (to_result.is_shared()) {
-        std::vector<std::string> paths = galaxy::util::BroadcastSharedPath(to_path, galaxy::client::ListCells());
-        for (const auto& new_path : paths) {
-            galaxy::client::CopyFile(from_path, new_path);
-        }
+        galaxy::client::BroadcastCopyFile(from_path, to_path);
         return;
     }
     // If the path is a local path.
@@ -1162,10 +1704,15 @@ void galaxy::client::MoveFile(const std::string& from_path, const std::string& t
         galaxy::client::MoveFile(paths.at(0), to_path);
         return;
     } else if (to_result.is_shared()) {
-        std::vector<std::string> paths = galaxy::util::BroadcastSharedPath(to_path, galaxy::client::ListCells());
-        for (const auto& new_path : paths) {
-            galaxy::client::MoveFile(from_path, new_path);
+        // The source can only be removed once every cell has a copy.
+        std::map<std::string, bool> cell_status = galaxy::client::BroadcastCopyFile(from_path, to_path);
+        for (const auto& status : cell_status) {
+            if (!status.second) {
+                LOG(ERROR) << "Keeping " << from_path << " since it failed to be copied to cell [" << status.first << "].";
+                return;
+            }
         }
+        galaxy::client::RmFile(from_path);
         return;
     }
     // If the path is a local path.
@@ -1202,10 +1749,9 @@ void galaxy::client::RmFile(const std::string& path, bool is_hidden) {
         galaxy::client::impl::RRmFile(result, is_hidden);
     } else if (result.is_shared()) {
         VLOG(3) << "Using shared mode";
-        std::vector<std::string> paths = galaxy::util::BroadcastSharedPath(path, galaxy::client::ListCells());
-        for (const auto& new_path : paths) {
+        ForEachSharedPath(path, [&](const std::string& new_path) {
             galaxy::client::RmFile(new_path, is_hidden);
-        }
+        });
     } else {
         VLOG(1) << "Using local mode";
         galaxy::client::impl::LRmFile(result, is_hidden);
@@ -1258,7 +1804,7 @@ std::string galaxy::client::Read(const std::string& path) {
     }
 }
 
-std::map<std::string, std::string> galaxy::client::ReadMultiple(const std::vector<std::string>& paths) {
+std::map<std::string, std::string> galaxy::client::ReadMultiple(const std::vector<std::string>& paths, bool consistent) {
     std::vector<FileAnalyzerResult> local_results, remote_results;
     std::string cell = "";
     for (const auto& path : paths) {
@@ -1282,45 +1828,189 @@ std::map<std::string, std::string> galaxy::client::ReadMultiple(const std::vecto
 
     std::map<std::string, std::string> data_map;
     if (!remote_results.empty()) {
-        std::map<std::string, std::string> remote_result = galaxy::client::impl::RReadMultiple(remote_results);
+        std::map<std::string, std::string> remote_result = galaxy::client::impl::RReadMultiple(remote_results, consistent);
         data_map.insert(remote_result.begin(), remote_result.end());
     }
     if (!local_results.empty()) {
-        std::map<std::string, std::string> local_result = galaxy::client::impl::LReadMultiple(local_results);
+        std::map<std::string, std::string> local_result = galaxy::client::impl::LReadMultiple(local_results, consistent);
         data_map.insert(local_result.begin(), local_result.end());
     }
     return data_map;
 }
 
+galaxy::client::ScanResult ToScanResult(const ScanFileResult& result) {
+    galaxy::client::ScanResult scan_result;
+    scan_result.data = result.data();
+    scan_result.count = result.count();
+    scan_result.truncated = result.truncated();
+    scan_result.error = result.error();
+    return scan_result;
+}
 
-void galaxy::client::Write(const std::string& path, const std::string& data, const std::string& mode) {
-    FileAnalyzerResult result = galaxy::util::InitClient(path);
-    // If the path is a local path.
-    if (result.is_remote()) {
-        VLOG(2) << "Using remote mode";
-        galaxy::client::impl::RWrite(result, data, mode);
-    } else if (result.is_shared()) {
-        VLOG(3) << "Using shared mode";
-        std::vector<std::string> paths = galaxy::util::BroadcastSharedPath(path, galaxy::client::ListCells());
-        for (const auto& new_path : paths) {
-            galaxy::client::Write(new_path, data);
-        }
-    } else {
-        VLOG(1) << "Using local mode";
-        galaxy::client::impl::LWrite(result, data, mode);
-    }
+ScanRequest NewScanRequest(const galaxy::client::ScanOptions& options) {
+    ScanRequest request;
+    request.set_op(options.op);
+    request.set_pattern(options.pattern);
+    request.set_regex(options.regex);
+    request.set_max_lines(options.max_lines);
+    request.set_max_bytes(options.max_bytes);
+    return request;
 }
 
-void galaxy::client::WriteMultiple(const std::map<std::string, std::string>& path_data_map, const std::string& mode) {
-    std::vector<std::pair<FileAnalyzerResult, std::string>> local_data, remote_data;
-    std::set<std::string> visited_path;
-    std::string cell = "";
-    for (const auto& val : path_data_map) {
-        FileAnalyzerResult result = galaxy::util::InitClient(val.first);
-        if (visited_path.find(result.path()) == visited_path.end()) {
-            visited_path.insert(result.path());
+std::map<std::string, galaxy::client::ScanResult> galaxy::client::Scan(const std::vector<std::string>& paths, const ScanOptions& options) {
+    // One request per cell, all sent at once.
+    std::map<std::string, std::pair<SingleRequestCellConfigs, ScanRequest>> remote_requests;
+    std::pair<SingleRequestCellConfigs, ScanRequest> local_request;
+    for (const auto& path : paths) {
+        FileAnalyzerResult result = galaxy::util::InitClient(path);
+        if (result.is_remote()) {
+            auto it = remote_requests.find(result.configs().to_cell_config().cell());
+            if (it == remote_requests.end()) {
+                it = remote_requests.insert({result.configs().to_cell_config().cell(), {result.configs(), NewScanRequest(options)}}).first;
+            }
+            it->second.second.add_names(result.path());
         } else {
-            VLOG(3) << result.path() << " already parsed.";
+            if (result.is_shared()) {
+                VLOG(3) << "Using shared mode";
+                result = galaxy::util::InitClient(galaxy::util::BroadcastSharedPath(path, {}).at(0));
+            }
+            if (local_request.second.names().empty()) {
+                local_request = {result.configs(), NewScanRequest(options)};
+            }
+            local_request.second.add_names(result.path());
+        }
+    }
+
+    std::map<std::string, ScanResult> results;
+    std::mutex mu;
+    auto add_results = [&results, &mu](const std::map<std::string, ScanFileResult>& cell_results) {
+        std::lock_guard<std::mutex> lock(mu);
+        for (const auto& pair : cell_results) {
+            results[pair.first] = ToScanResult(pair.second);
+        }
+    };
+    std::vector<std::future<void>> futures;
+    for (const auto& pair : remote_requests) {
+        futures.push_back(std::async(std::launch::async, [&add_results, &pair]() {
+            add_results(galaxy::client::impl::RScan(pair.second.first, pair.second.second));
+        }));
+    }
+    if (!local_request.second.names().empty()) {
+        add_results(galaxy::client::impl::LScan(local_request.first, local_request.second));
+    }
+    for (auto& future : futures) {
+        future.get();
+    }
+    return results;
+}
+
+std::map<std::string, galaxy::client::ScanResult> galaxy::client::ScanDir(const std::string& path, bool recursive, const ScanOptions& options) {
+    FileAnalyzerResult result = galaxy::util::InitClient(path);
+    if (result.is_shared()) {
+        VLOG(3) << "Using shared mode";
+        result = galaxy::util::InitClient(galaxy::util::BroadcastSharedPath(path, {}).at(0));
+    }
+    ScanRequest request = NewScanRequest(options);
+    request.set_dir(result.path());
+    request.set_recursive(recursive);
+    std::map<std::string, ScanFileResult> cell_results;
+    if (result.is_remote()) {
+        VLOG(2) << "Using remote mode";
+        cell_results = galaxy::client::impl::RScan(result.configs(), request);
+    } else {
+        VLOG(1) << "Using local mode";
+        cell_results = galaxy::client::impl::LScan(result.configs(), request);
+    }
+    std::map<std::string, ScanResult> results;
+    for (const auto& pair : cell_results) {
+        results[pair.first] = ToScanResult(pair.second);
+    }
+    return results;
+}
+
+
+void galaxy::client::Write(const std::string& path, const std::string& data, const std::string& mode) {
+    FileAnalyzerResult result = galaxy::util::InitClient(path);
+    // If the path is a local path.
+    if (result.is_remote()) {
+        VLOG(2) << "Using remote mode";
+        galaxy::client::impl::RWrite(result, data, mode);
+    } else if (result.is_shared()) {
+        VLOG(3) << "Using shared mode";
+        if (mode == "w") {
+            galaxy::client::BroadcastWrite(path, data);
+        } else {
+            ForEachSharedPath(path, [&](const std::string& new_path) {
+                galaxy::client::Write(new_path, data, mode);
+            });
+        }
+    } else {
+        VLOG(1) << "Using local mode";
+        galaxy::client::impl::LWrite(result, data, mode);
+    }
+}
+
+void galaxy::client::WriteAt(const std::string& path, int64_t offset, const std::string& data) {
+    FileAnalyzerResult result = galaxy::util::InitClient(path);
+    // If the path is a local path.
+    if (result.is_remote()) {
+        VLOG(2) << "Using remote mode";
+        galaxy::client::impl::RWriteAt(result, offset, data);
+    } else if (result.is_shared()) {
+        VLOG(3) << "Using shared mode";
+        ForEachSharedPath(path, [&](const std::string& new_path) {
+            galaxy::client::WriteAt(new_path, offset, data);
+        });
+    } else {
+        VLOG(1) << "Using local mode";
+        galaxy::client::impl::LWriteAt(result, offset, data);
+    }
+}
+
+void galaxy::client::Truncate(const std::string& path, int64_t size) {
+    FileAnalyzerResult result = galaxy::util::InitClient(path);
+    // If the path is a local path.
+    if (result.is_remote()) {
+        VLOG(2) << "Using remote mode";
+        galaxy::client::impl::RTruncate(result, size);
+    } else if (result.is_shared()) {
+        VLOG(3) << "Using shared mode";
+        ForEachSharedPath(path, [&](const std::string& new_path) {
+            galaxy::client::Truncate(new_path, size);
+        });
+    } else {
+        VLOG(1) << "Using local mode";
+        galaxy::client::impl::LTruncate(result, size);
+    }
+}
+
+void galaxy::client::Preallocate(const std::string& path, int64_t size) {
+    FileAnalyzerResult result = galaxy::util::InitClient(path);
+    // If the path is a local path.
+    if (result.is_remote()) {
+        VLOG(2) << "Using remote mode";
+        galaxy::client::impl::RPreallocate(result, size);
+    } else if (result.is_shared()) {
+        VLOG(3) << "Using shared mode";
+        ForEachSharedPath(path, [&](const std::string& new_path) {
+            galaxy::client::Preallocate(new_path, size);
+        });
+    } else {
+        VLOG(1) << "Using local mode";
+        galaxy::client::impl::LPreallocate(result, size);
+    }
+}
+
+void galaxy::client::WriteMultiple(const std::map<std::string, std::string>& path_data_map, const std::string& mode) {
+    std::vector<std::pair<FileAnalyzerResult, std::string>> local_data, remote_data;
+    std::set<std::string> visited_path;
+    std::string cell = "";
+    for (const auto& val : path_data_map) {
+        FileAnalyzerResult result = galaxy::util::InitClient(val.first);
+        if (visited_path.find(result.path()) == visited_path.end()) {
+            visited_path.insert(result.path());
+        } else {
+            VLOG(3) << result.path() << " already parsed.";
             continue;
         }
         if (result.is_remote()) {
@@ -1346,6 +2036,40 @@ void galaxy::client::WriteMultiple(const std::map<std::string, std::string>& pat
     }
 }
 
+bool galaxy::client::WriteMultipleAtomic(const std::map<std::string, std::string>& path_data_map) {
+    if (path_data_map.empty()) {
+        return true;
+    }
+    std::vector<std::pair<FileAnalyzerResult, std::string>> local_data, remote_data;
+    std::string cell = "";
+    for (const auto& val : path_data_map) {
+        FileAnalyzerResult result = galaxy::util::InitClient(val.first);
+        if (result.is_shared()) {
+            LOG(ERROR) << "Atomic write does not support the shared path " << val.first << ".";
+            return false;
+        }
+        if (result.is_remote()) {
+            if (cell.empty()) {
+                cell = result.configs().to_cell_config().cell();
+            } else if (cell != result.configs().to_cell_config().cell()) {
+                LOG(ERROR) << "Atomic write only supports files on the same cell.";
+                return false;
+            }
+            remote_data.push_back(std::make_pair(result, val.second));
+        } else {
+            local_data.push_back(std::make_pair(result, val.second));
+        }
+    }
+    if (!remote_data.empty() && !local_data.empty()) {
+        LOG(ERROR) << "Atomic write only supports files on the same cell.";
+        return false;
+    }
+    if (!remote_data.empty()) {
+        return galaxy::client::impl::RWriteMultipleAtomic(remote_data);
+    }
+    return galaxy::client::impl::LWriteMultipleAtomic(local_data);
+}
+
 std::string galaxy::client::GetAttr(const std::string& path) {
     FileAnalyzerResult result = galaxy::util::InitClient(path);
     // If the path is a local path.
@@ -1362,6 +2086,80 @@ std::string galaxy::client::GetAttr(const std::string& path) {
     }
 }
 
+std::string galaxy::client::Checksum(const std::string& path) {
+    FileAnalyzerResult result = galaxy::util::InitClient(path);
+    if (result.is_remote()) {
+        VLOG(2) << "Using remote mode";
+        return galaxy::client::impl::RChecksum(result);
+    } else if (result.is_shared()) {
+        VLOG(3) << "Using shared mode";
+        std::vector<std::string> paths = galaxy::util::BroadcastSharedPath(path, {});
+        return galaxy::client::Checksum(paths.at(0));
+    } else {
+        VLOG(1) << "Using local mode";
+        return galaxy::client::impl::LChecksum(result);
+    }
+}
+
+std::map<std::string, bool> galaxy::client::BroadcastCopyFile(const std::string& from_path, const std::string& to_path) {
+    FileAnalyzerResult from_result = galaxy::util::InitClient(from_path);
+    FileAnalyzerResult to_result = galaxy::util::InitClient(to_path);
+    CHECK(to_result.is_shared()) << "Path needs to have /SHARED as the prefix.";
+    if (from_result.is_shared()) {
+        std::vector<std::string> paths = galaxy::util::BroadcastSharedPath(from_path, {});
+        return galaxy::client::BroadcastCopyFile(paths.at(0), to_path);
+    }
+    std::map<std::string, bool> cell_status;
+    if (from_result.is_remote()) {
+        // Let the cell owning the file replicate it, so that the data does not go through this client.
+        VLOG(2) << "Delegating the broadcast to cell [" << from_result.to_cell() << "]";
+        try {
+            GalaxyClientInternal client = GetChannelClient(from_result.configs());
+            CrossCellRequest request;
+            request.set_call_type(CrossCellCallType::COPYFILE);
+            request.mutable_cred()->set_password(from_result.configs().to_cell_config().fs_password());
+            CopyRequest copy_request;
+            copy_request.set_from_name(galaxy::util::ConvertToCellPath(from_result.path(), from_result.configs().to_cell_config()));
+            copy_request.set_to_name(to_path);
+            copy_request.set_from_cell(from_result.configs().from_cell_config().cell());
+            request.mutable_request()->PackFrom(copy_request);
+            CrossCellResponse response = client.CrossCellCall(request);
+            CopyResponse copy_response;
+            response.response().UnpackTo(&copy_response);
+            for (const auto& pair : copy_response.cell_status()) {
+                cell_status[pair.first] = pair.second.return_code() == 1;
+            }
+        }
+        catch (std::string errorMsg)
+        {
+            LOG(ERROR) << errorMsg;
+        }
+        for (const auto& cell : galaxy::client::ListCells()) {
+            cell_status.insert({cell, false});
+        }
+        return cell_status;
+    }
+
+    struct stat statbuf;
+    if (stat(from_result.path().c_str(), &statbuf) != 0) {
+        LOG(ERROR) << "Cannot stat " << from_result.path() << " for BroadcastCopyFile.";
+        for (const auto& cell : galaxy::client::ListCells()) {
+            cell_status[cell] = false;
+        }
+        return cell_status;
+    }
+    CopyRequest request;
+    request.set_from_name(from_result.path());
+    return ReplicateToSharedPath(request, to_path, from_result.configs().from_cell_config(), false, statbuf.st_size);
+}
+
+std::map<std::string, bool> galaxy::client::BroadcastWrite(const std::string& path, const std::string& data) {
+    FileAnalyzerResult result = galaxy::util::InitClient(path);
+    CHECK(result.is_shared()) << "Path needs to have /SHARED as the prefix.";
+    CopyRequest request;
+    request.set_data(data);
+    return ReplicateToSharedPath(request, path, result.configs().from_cell_config(), true, data.size());
+}
 
 std::vector<std::string> galaxy::client::ListCells(const bool bypass) {
     return galaxy::util::GetAllCells(bypass);
@@ -1386,19 +2184,91 @@ void galaxy::client::ChangeAvailability(const std::string& cell, const bool stat
     }
 }
 
+RemoteExecutionRequest NewRemoteExecutionRequest(const FileAnalyzerResult& result, const std::string& home_dir, const std::string& main,
+                                                 const std::vector<std::string>& program_args, const std::map<std::string, std::string>& env_kargs) {
+    RemoteExecutionRequest request;
+    request.mutable_cred()->set_password(result.configs().to_cell_config().fs_password());
+    request.set_from_cell(result.configs().from_cell_config().cell());
+    request.set_home_dir(home_dir);
+    request.set_main(main);
+    *request.mutable_program_args() = {program_args.begin(), program_args.end()};
+    *request.mutable_env_kargs() = {env_kargs.begin(), env_kargs.end()};
+    return request;
+}
+
+// Runs request through RemoteExecutionStream. status is the status of the stream, e.g. UNIMPLEMENTED by older servers.
+// The command is killed once timeout_sec have passed, if positive.
+galaxy::client::ExecutionResult StreamExecution(const FileAnalyzerResult& result, const RemoteExecutionRequest& request,
+                                                const galaxy::client::ExecutionOutputCallback& callback, int timeout_sec, grpc::Status* status) {
+    galaxy::client::ExecutionResult execution;
+    GalaxyClientInternal client = GetChannelClient(result.configs());
+    grpc::ClientContext context;
+    if (timeout_sec > 0) {
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(timeout_sec));
+    }
+    std::unique_ptr<grpc::ClientReader<RemoteExecutionStreamResponse>> reader = client.RemoteExecutionStream(&context, request);
+    RemoteExecutionStreamResponse response;
+    bool finished = false;
+    while (reader->Read(&response)) {
+        if (!response.raw_cmd().empty()) {
+            execution.raw_cmd = response.raw_cmd();
+        }
+        if (response.finished()) {
+            finished = true;
+            execution.exit_code = response.exit_code();
+            execution.term_signal = response.term_signal();
+            execution.wall_sec = response.rusage().wall_sec();
+            execution.user_sec = response.rusage().user_sec();
+            execution.system_sec = response.rusage().system_sec();
+            execution.max_rss_kb = response.rusage().max_rss_kb();
+            continue;
+        }
+        if (response.out_data().empty() && response.err_data().empty()) {
+            continue;
+        }
+        bool keep_going = false;
+        try {
+            keep_going = callback(response.out_data(), response.err_data());
+        } catch (...) {
+            context.TryCancel();
+            reader->Finish();
+            throw;
+        }
+        if (!keep_going) {
+            context.TryCancel();
+            execution.error = "Cancelled by the caller.";
+            break;
+        }
+    }
+    *status = reader->Finish();
+    if (execution.error.empty() && !status->ok()) {
+        execution.error = status->error_message();
+    } else if (execution.error.empty() && !finished) {
+        execution.error = "Stream ended before the command exited.";
+    }
+    return execution;
+}
+
 void galaxy::client::RemoteExecute(const std::string& cell, const std::string& home_dir, const std::string main, const std::vector<std::string>& program_args, const std::map<std::string, std::string>& env_kargs) {
     std::string path = galaxy::util::GetGalaxyFsPrefixPath(cell);
     FileAnalyzerResult result = galaxy::util::InitClient(path);
+    RemoteExecutionRequest request = NewRemoteExecutionRequest(result, home_dir, main, program_args, env_kargs);
+    grpc::Status stream_status;
+    ExecutionResult execution = StreamExecution(result, request, [](const std::string& out, const std::string& err) {
+        std::cout << out << std::flush;
+        std::cerr << err << std::flush;
+        return true;
+    }, 0, &stream_status);
+    if (stream_status.error_code() != grpc::StatusCode::UNIMPLEMENTED) {
+        CHECK(execution.error.empty()) << "Fail to call RemoteExecute with error " << execution.error;
+        std::cout << "Done executing cmd [" << execution.raw_cmd << "]"
+                    << " on cell [" << cell << "] with exit code " << execution.exit_code << "." << std::endl;
+        return;
+    }
+    // Servers without RemoteExecutionStream only return the output once the command is done.
     GalaxyClientInternal client = GetChannelClient(result.configs());
     try
     {
-        RemoteExecutionRequest request;
-        request.mutable_cred()->set_password(result.configs().to_cell_config().fs_password());
-        request.set_from_cell(result.configs().from_cell_config().cell());
-        request.set_home_dir(home_dir);
-        request.set_main(main);
-        *request.mutable_program_args() = {program_args.begin(), program_args.end()};
-        *request.mutable_env_kargs() = {env_kargs.begin(), env_kargs.end()};
         RemoteExecutionResponse response = client.RemoteExecution(request);
         FileSystemStatus status = response.status();
         CHECK_EQ(status.return_code(), 1) << "Fail to call RemoteExecute.";
@@ -1411,3 +2281,798 @@ void galaxy::client::RemoteExecute(const std::string& cell, const std::string& h
         LOG(FATAL) << errorMsg;
     }
 }
+
+galaxy::client::ExecutionResult galaxy::client::RemoteExecuteStream(const std::string& cell, const std::string& home_dir, const std::string& main,
+                                                                    const std::vector<std::string>& program_args,
+                                                                    const std::map<std::string, std::string>& env_kargs,
+                                                                    ExecutionOutputCallback callback) {
+    std::string path = galaxy::util::GetGalaxyFsPrefixPath(cell);
+    FileAnalyzerResult result = galaxy::util::InitClient(path);
+    grpc::Status status;
+    ExecutionResult execution = StreamExecution(result, NewRemoteExecutionRequest(result, home_dir, main, program_args, env_kargs),
+                                                callback, 0, &status);
+    if (!execution.error.empty()) {
+        LOG(ERROR) << "RemoteExecuteStream on cell " << cell << " failed with error " << execution.error;
+    }
+    return execution;
+}
+
+galaxy::client::ExecuteAllOptions galaxy::client::ExecuteAllOptions::FromFlags() {
+    ExecuteAllOptions options;
+    options.parallelism = std::max(1, absl::GetFlag(FLAGS_fs_execute_parallelism));
+    options.timeout_sec = std::max(0, absl::GetFlag(FLAGS_fs_execute_timeout_sec));
+    return options;
+}
+
+// Runs a command on a single cell for RemoteExecuteAll, collecting its output.
+galaxy::client::ExecutionResult ExecuteOnCell(const std::string& cell, const std::string& home_dir, const std::string& main,
+                                              const std::vector<std::string>& program_args, const std::map<std::string, std::string>& env_kargs,
+                                              int timeout_sec) {
+    galaxy::client::ExecutionResult execution;
+    // Checked like InitClient does, but reported as the error of this cell rather than aborting the others.
+    absl::StatusOr<FileAnalyzerResult> analyzed = galaxy::util::RunFileAnalyzer(galaxy::util::GetGalaxyFsPrefixPath(cell));
+    if (!analyzed.ok()) {
+        execution.error = analyzed.status().ToString();
+        return execution;
+    }
+    const FileAnalyzerResult& result = *analyzed;
+    if (result.configs().from_cell_config().disabled() || result.configs().to_cell_config().disabled()) {
+        execution.error = "Cell [" + (result.configs().to_cell_config().disabled() ? result.to_cell() : result.from_cell()) + "] is disabled.";
+        return execution;
+    }
+    RemoteExecutionRequest request = NewRemoteExecutionRequest(result, home_dir, main, program_args, env_kargs);
+    std::string out;
+    std::string err;
+    grpc::Status status;
+    execution = StreamExecution(result, request, [&out, &err](const std::string& out_data, const std::string& err_data) {
+        out += out_data;
+        err += err_data;
+        return true;
+    }, timeout_sec, &status);
+    execution.out = std::move(out);
+    execution.err = std::move(err);
+    if (status.error_code() != grpc::StatusCode::UNIMPLEMENTED) {
+        return execution;
+    }
+    // Servers without RemoteExecutionStream do not report the exit status, so exit_code stays -1. They cannot kill
+    // the command either, so timeout_sec only bounds the wait for it.
+    execution.error.clear();
+    try
+    {
+        RemoteExecutionResponse response = GetChannelClient(result.configs()).RemoteExecution(request, timeout_sec);
+        execution.raw_cmd = response.raw_cmd();
+        execution.out = response.data();
+    }
+    catch (std::string errorMsg)
+    {
+        execution.error = errorMsg;
+    }
+    return execution;
+}
+
+std::map<std::string, galaxy::client::ExecutionResult> galaxy::client::RemoteExecuteAll(const std::vector<std::string>& cells, const std::string& home_dir,
+                                                                                        const std::string& main, const std::vector<std::string>& program_args,
+                                                                                        const std::map<std::string, std::string>& env_kargs,
+                                                                                        const ExecuteAllOptions& options) {
+    // Each cell is one streaming call on the channel cached for it, so workers only wait on their own cell.
+    std::vector<ExecutionResult> results(cells.size());
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        for (size_t i = next++; i < cells.size(); i = next++) {
+            results[i] = ExecuteOnCell(cells[i], home_dir, main, program_args, env_kargs, options.timeout_sec);
+            if (!results[i].error.empty()) {
+                LOG(ERROR) << "RemoteExecuteAll on cell " << cells[i] << " failed with error " << results[i].error;
+            }
+        }
+    };
+    size_t num_threads = std::min<size_t>(std::max(1, options.parallelism), cells.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < num_threads; ++i) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    std::map<std::string, ExecutionResult> output;
+    for (size_t i = 0; i < cells.size(); ++i) {
+        output[cells[i]] = std::move(results[i]);
+    }
+    return output;
+}
+
+// Changes of local directories watched by this process.
+galaxy::WatchHub* LocalWatchHub() {
+    static galaxy::WatchHub* hub = new galaxy::WatchHub(galaxy::constant::kWatchHistorySize);
+    return hub;
+}
+
+// path of a change under the directory watched as watched_dir, moved under the path given by the caller.
+std::string CallerPath(const std::string& path, const std::string& watched_dir, const std::string& caller_dir) {
+    std::string dir = watched_dir.size() > 1 && watched_dir.back() == '/' ? watched_dir.substr(0, watched_dir.size() - 1) : watched_dir;
+    if (path.empty() || path.compare(0, dir.size(), dir) != 0) {
+        return path;
+    }
+    std::string prefix = caller_dir.size() > 1 && caller_dir.back() == '/' ? caller_dir.substr(0, caller_dir.size() - 1) : caller_dir;
+    return prefix + path.substr(dir.size());
+}
+
+galaxy::client::Watcher::Watcher(const std::string& path, bool recursive, uint32_t event_mask, const std::string& resume_token)
+    : path_(path), recursive_(recursive), event_mask_(event_mask), received_token_(resume_token), returned_token_(resume_token) {
+    thread_ = std::thread(&Watcher::Run, this);
+}
+
+galaxy::client::Watcher::~Watcher() {
+    Cancel();
+    thread_.join();
+}
+
+bool galaxy::client::Watcher::Next(WatchEvent* event, int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mu_);
+    auto ready = [this] { return !events_.empty() || finished_; };
+    if (timeout_ms < 0) {
+        cv_.wait(lock, ready);
+    } else {
+        cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready);
+    }
+    if (events_.empty()) {
+        return false;
+    }
+    *event = std::move(events_.front());
+    events_.pop_front();
+    returned_token_ = event->resume_token;
+    cv_.notify_all();
+    return true;
+}
+
+void galaxy::client::Watcher::Cancel() {
+    std::lock_guard<std::mutex> lock(mu_);
+    cancelled_ = true;
+    if (context_ != nullptr) {
+        context_->TryCancel();
+    }
+    cv_.notify_all();
+}
+
+bool galaxy::client::Watcher::done() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return finished_ && events_.empty();
+}
+
+absl::Status galaxy::client::Watcher::status() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return status_;
+}
+
+std::string galaxy::client::Watcher::resume_token() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    // Everything received was returned, including the changes the cell filtered out in between.
+    return events_.empty() ? received_token_ : returned_token_;
+}
+
+void galaxy::client::Watcher::Run() {
+    FileAnalyzerResult result = galaxy::util::InitClient(path_);
+    if (result.is_shared()) {
+        VLOG(3) << "Using shared mode";
+        result = galaxy::util::InitClient(galaxy::util::BroadcastSharedPath(path_, {}).at(0));
+    }
+    if (result.is_remote()) {
+        VLOG(2) << "Using remote mode";
+        RunRemote(result);
+    } else {
+        VLOG(1) << "Using local mode";
+        RunLocal(result);
+    }
+}
+
+void galaxy::client::Watcher::RunRemote(const FileAnalyzerResult& result) {
+    int backoff_ms = galaxy::constant::kStreamReconnectMs;
+    while (true) {
+        GalaxyClientInternal client = GetChannelClient(result.configs());
+        grpc::ClientContext context;
+        WatchRequest request;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (cancelled_) {
+                break;
+            }
+            context_ = &context;
+            request.set_resume_token(received_token_);
+        }
+        request.set_name(result.path());
+        request.set_recursive(recursive_);
+        request.set_event_mask(event_mask_);
+        request.mutable_cred()->set_password(result.configs().to_cell_config().fs_password());
+        request.set_from_cell(result.configs().from_cell_config().cell());
+        std::unique_ptr<grpc::ClientReader<WatchResponse>> reader = client.Watch(&context, request);
+        WatchResponse response;
+        while (reader->Read(&response)) {
+            backoff_ms = galaxy::constant::kStreamReconnectMs;
+            for (const auto& event : response.events()) {
+                WatchEvent watch_event;
+                watch_event.type = event.type();
+                watch_event.path = CallerPath(event.name(), result.path(), path_);
+                watch_event.old_path = CallerPath(event.old_name(), result.path(), path_);
+                watch_event.is_dir = event.is_dir();
+                watch_event.attr = event.has_attr() ? ProtoMessageToString(event.attr()) : "";
+                watch_event.resume_token = event.resume_token();
+                if (!Push(std::move(watch_event))) {
+                    context.TryCancel();
+                    break;
+                }
+            }
+            std::lock_guard<std::mutex> lock(mu_);
+            if (!response.resume_token().empty()) {
+                received_token_ = response.resume_token();
+            }
+        }
+        grpc::Status status = reader->Finish();
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            context_ = nullptr;
+            if (cancelled_) {
+                break;
+            }
+        }
+        grpc::StatusCode code = status.error_code();
+        if (code == grpc::StatusCode::PERMISSION_DENIED || code == grpc::StatusCode::NOT_FOUND ||
+            code == grpc::StatusCode::INVALID_ARGUMENT || code == grpc::StatusCode::UNIMPLEMENTED) {
+            LOG(ERROR) << "Watch of " << path_ << " failed with error " << status.error_message();
+            Finish(absl::Status(static_cast<absl::StatusCode>(code), status.error_message()));
+            return;
+        }
+        LOG(WARNING) << "Watch of " << path_ << " interrupted with error " << status.error_message()
+                     << ", resuming in " << backoff_ms << "ms.";
+        std::unique_lock<std::mutex> lock(mu_);
+        if (cv_.wait_for(lock, std::chrono::milliseconds(backoff_ms), [this] { return cancelled_; })) {
+            break;
+        }
+        backoff_ms = std::min(backoff_ms * 2, galaxy::constant::kStreamMaxReconnectMs);
+    }
+    Finish(absl::CancelledError("Watch of " + path_ + " cancelled."));
+}
+
+void galaxy::client::Watcher::RunLocal(const FileAnalyzerResult& result) {
+    galaxy::WatchHub* hub = LocalWatchHub();
+    absl::Status status = hub->Subscribe(result.path(), recursive_);
+    if (!status.ok()) {
+        LOG(ERROR) << "Watch of " << path_ << " failed with error " << status;
+        Finish(status);
+        return;
+    }
+    uint64_t after = hub->last_seq();
+    bool complete = true;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        uint64_t seq = 0;
+        if (!received_token_.empty()) {
+            if (hub->ParseToken(received_token_, &seq) && seq <= after) {
+                after = seq;
+            } else {
+                complete = false;
+            }
+        }
+    }
+    bool cancelled = false;
+    while (!cancelled) {
+        std::vector<galaxy::WatchHub::Event> events;
+        if (!complete) {
+            WatchEvent overflow;
+            overflow.type = WatchEventType::WATCH_OVERFLOW;
+            overflow.path = path_;
+            overflow.resume_token = hub->Token(after);
+            cancelled = !Push(std::move(overflow));
+        }
+        complete = hub->Wait(result.path(), recursive_, &after, absl::Milliseconds(200), &events);
+        for (const auto& event : events) {
+            if (cancelled || (event_mask_ != 0 && !(event_mask_ & event.type))) {
+                continue;
+            }
+            WatchEvent watch_event;
+            watch_event.type = static_cast<WatchEventType>(event.type);
+            watch_event.path = CallerPath(event.path, result.path(), path_);
+            watch_event.old_path = CallerPath(event.old_path, result.path(), path_);
+            watch_event.is_dir = event.is_dir;
+            struct stat statbuf;
+            if (event.type != galaxy::WatchHub::kDelete && lstat(event.path.c_str(), &statbuf) == 0) {
+                watch_event.attr = StatbufToString(statbuf);
+            }
+            watch_event.resume_token = hub->Token(event.seq);
+            cancelled = !Push(std::move(watch_event));
+        }
+        std::lock_guard<std::mutex> lock(mu_);
+        received_token_ = hub->Token(after);
+        cancelled = cancelled || cancelled_;
+    }
+    hub->Unsubscribe(result.path(), recursive_);
+    Finish(absl::CancelledError("Watch of " + path_ + " cancelled."));
+}
+
+bool galaxy::client::Watcher::Push(WatchEvent event) {
+    std::unique_lock<std::mutex> lock(mu_);
+    cv_.wait(lock, [this] { return cancelled_ || events_.size() < static_cast<size_t>(galaxy::constant::kStreamQueueSize); });
+    if (cancelled_) {
+        return false;
+    }
+    received_token_ = event.resume_token;
+    events_.push_back(std::move(event));
+    cv_.notify_all();
+    return true;
+}
+
+void galaxy::client::Watcher::Finish(const absl::Status& status) {
+    std::lock_guard<std::mutex> lock(mu_);
+    finished_ = true;
+    status_ = status;
+    cv_.notify_all();
+}
+
+std::string galaxy::client::Watch(const std::string& path, bool recursive, uint32_t event_mask, WatchCallback callback, const std::string& resume_token) {
+    Watcher watcher(path, recursive, event_mask, resume_token);
+    WatchEvent event;
+    while (watcher.Next(&event)) {
+        if (!callback(event)) {
+            return watcher.resume_token();
+        }
+    }
+    LOG(ERROR) << "Watch of " << path << " stopped with error " << watcher.status();
+    return "";
+}
+
+galaxy::client::TailReader::TailReader(const std::string& path, int64_t from_offset, int64_t last_n_lines, bool follow)
+    : from_offset_(from_offset), last_n_lines_(last_n_lines), follow_(follow) {
+    std::vector<std::string> paths = {path};
+    if (galaxy::util::InitClient(path).is_shared()) {
+        VLOG(3) << "Using shared mode";
+        paths = galaxy::util::BroadcastSharedPath(path, galaxy::client::ListCells());
+    }
+    num_running_ = paths.size();
+    for (const auto& new_path : paths) {
+        threads_.emplace_back(&TailReader::Run, this, new_path);
+    }
+}
+
+galaxy::client::TailReader::~TailReader() {
+    Cancel();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+bool galaxy::client::TailReader::Next(TailChunk* chunk, int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mu_);
+    auto ready = [this] { return !chunks_.empty() || num_running_ == 0; };
+    if (timeout_ms < 0) {
+        cv_.wait(lock, ready);
+    } else {
+        cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready);
+    }
+    if (chunks_.empty()) {
+        return false;
+    }
+    *chunk = std::move(chunks_.front());
+    chunks_.pop_front();
+    cv_.notify_all();
+    return true;
+}
+
+void galaxy::client::TailReader::Cancel() {
+    std::lock_guard<std::mutex> lock(mu_);
+    cancelled_ = true;
+    for (auto* context : contexts_) {
+        context->TryCancel();
+    }
+    cv_.notify_all();
+}
+
+bool galaxy::client::TailReader::done() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return num_running_ == 0 && chunks_.empty();
+}
+
+absl::Status galaxy::client::TailReader::status() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return status_;
+}
+
+void galaxy::client::TailReader::Run(const std::string& path) {
+    FileAnalyzerResult result = galaxy::util::InitClient(path);
+    if (result.is_remote()) {
+        VLOG(2) << "Using remote mode";
+        RunRemote(path, result);
+    } else {
+        VLOG(1) << "Using local mode";
+        RunLocal(path, result);
+    }
+}
+
+void galaxy::client::TailReader::RunRemote(const std::string& path, const FileAnalyzerResult& result) {
+    int64_t from_offset = from_offset_;
+    int64_t last_n_lines = last_n_lines_;
+    int backoff_ms = galaxy::constant::kStreamReconnectMs;
+    while (true) {
+        GalaxyClientInternal client = GetChannelClient(result.configs());
+        grpc::ClientContext context;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (cancelled_) {
+                break;
+            }
+            contexts_.insert(&context);
+        }
+        TailRequest request;
+        request.set_name(result.path());
+        request.set_from_offset(from_offset);
+        request.set_last_n_lines(last_n_lines);
+        request.set_follow(follow_);
+        request.mutable_cred()->set_password(result.configs().to_cell_config().fs_password());
+        request.set_from_cell(result.configs().from_cell_config().cell());
+        std::unique_ptr<grpc::ClientReader<TailResponse>> reader = client.Tail(&context, request);
+        TailResponse response;
+        while (reader->Read(&response)) {
+            backoff_ms = galaxy::constant::kStreamReconnectMs;
+            // A new stream resumes right after what was received, wherever the first one started.
+            from_offset = response.offset() + response.data().size();
+            last_n_lines = 0;
+            if (response.data().empty() && !response.reset()) {
+                continue;
+            }
+            TailChunk chunk;
+            chunk.cell = result.to_cell();
+            chunk.path = path;
+            chunk.offset = response.offset();
+            chunk.reset = response.reset();
+            chunk.data = std::move(*response.mutable_data());
+            if (!Push(std::move(chunk))) {
+                context.TryCancel();
+                break;
+            }
+        }
+        grpc::Status status = reader->Finish();
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            contexts_.erase(&context);
+            if (cancelled_) {
+                break;
+            }
+        }
+        grpc::StatusCode code = status.error_code();
+        if (status.ok() && !follow_) {
+            Finish(absl::OkStatus());
+            return;
+        }
+        if (code == grpc::StatusCode::PERMISSION_DENIED || code == grpc::StatusCode::NOT_FOUND ||
+            code == grpc::StatusCode::INVALID_ARGUMENT || code == grpc::StatusCode::UNIMPLEMENTED) {
+            LOG(ERROR) << "Tail of " << path << " failed with error " << status.error_message();
+            Finish(absl::Status(static_cast<absl::StatusCode>(code), status.error_message()));
+            return;
+        }
+        LOG(WARNING) << "Tail of " << path << " interrupted with error " << status.error_message()
+                     << ", resuming at offset " << from_offset << " in " << backoff_ms << "ms.";
+        std::unique_lock<std::mutex> lock(mu_);
+        if (cv_.wait_for(lock, std::chrono::milliseconds(backoff_ms), [this] { return cancelled_; })) {
+            break;
+        }
+        backoff_ms = std::min(backoff_ms * 2, galaxy::constant::kStreamMaxReconnectMs);
+    }
+    Finish(absl::CancelledError("Tail of " + path + " cancelled."));
+}
+
+void galaxy::client::TailReader::RunLocal(const std::string& path, const FileAnalyzerResult& result) {
+    galaxy::Tailer tailer(result.path());
+    absl::Status status = tailer.Open(from_offset_, last_n_lines_, follow_);
+    if (!status.ok()) {
+        LOG(ERROR) << "Tail of " << path << " failed with error " << status;
+        Finish(status);
+        return;
+    }
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (cancelled_) {
+                break;
+            }
+        }
+        TailChunk chunk;
+        status = tailer.Read(galaxy::constant::kChunkSize, follow_ ? absl::Milliseconds(200) : absl::ZeroDuration(), &chunk.data);
+        if (!status.ok()) {
+            LOG(ERROR) << "Tail of " << path << " failed with error " << status;
+            Finish(status);
+            return;
+        }
+        chunk.reset = tailer.TakeReset();
+        if (chunk.data.empty() && !chunk.reset) {
+            if (!follow_) {
+                Finish(absl::OkStatus());
+                return;
+            }
+            continue;
+        }
+        chunk.cell = result.to_cell();
+        chunk.path = path;
+        chunk.offset = tailer.offset() - chunk.data.size();
+        if (!Push(std::move(chunk))) {
+            break;
+        }
+    }
+    Finish(absl::CancelledError("Tail of " + path + " cancelled."));
+}
+
+bool galaxy::client::TailReader::Push(TailChunk chunk) {
+    std::unique_lock<std::mutex> lock(mu_);
+    cv_.wait(lock, [this] { return cancelled_ || chunks_.size() < static_cast<size_t>(galaxy::constant::kStreamQueueSize); });
+    if (cancelled_) {
+        return false;
+    }
+    chunks_.push_back(std::move(chunk));
+    cv_.notify_all();
+    return true;
+}
+
+void galaxy::client::TailReader::Finish(const absl::Status& status) {
+    std::lock_guard<std::mutex> lock(mu_);
+    --num_running_;
+    // The first failure of any cell is kept.
+    if (status_.ok()) {
+        status_ = status;
+    }
+    cv_.notify_all();
+}
+
+bool galaxy::client::Tail(const std::string& path, int64_t from_offset, int64_t last_n_lines, bool follow, TailCallback callback) {
+    TailReader reader(path, from_offset, last_n_lines, follow);
+    TailChunk chunk;
+    while (reader.Next(&chunk)) {
+        if (!callback(chunk)) {
+            return true;
+        }
+    }
+    if (!reader.status().ok()) {
+        LOG(ERROR) << "Tail of " << path << " stopped with error " << reader.status();
+        return false;
+    }
+    return true;
+}
+
+// Status of a finished remote call, from its transport status and the status of the file system operation.
+absl::Status AsyncCallStatus(const grpc::Status& status, const FileSystemStatus& fs_status, const std::string& method) {
+    if (!status.ok()) {
+        return absl::Status(static_cast<absl::StatusCode>(status.error_code()), status.error_message());
+    }
+    if (fs_status.return_code() != 1) {
+        return absl::InternalError("Fail to call " + method + ".");
+    }
+    return absl::OkStatus();
+}
+
+// Adapts a callback based call into a future.
+template <typename T>
+std::future<T> AsyncCallToFuture(const std::function<void(std::function<void(T)>)>& call) {
+    auto promise = std::make_shared<std::promise<T>>();
+    std::future<T> future = promise->get_future();
+    call([promise](T value) { promise->set_value(std::move(value)); });
+    return future;
+}
+
+void galaxy::client::async::Read(const std::string& path, StringCallback callback) {
+    FileAnalyzerResult result = galaxy::util::InitClient(path);
+    if (result.is_shared()) {
+        galaxy::client::async::Read(galaxy::util::BroadcastSharedPath(path, {}).at(0), std::move(callback));
+        return;
+    }
+    if (!result.is_remote()) {
+        std::string data;
+        absl::Status status = GalaxyFs::Instance()->Read(result.path(), data);
+        if (!status.ok()) {
+            callback(status);
+            return;
+        }
+        callback(std::move(data));
+        return;
+    }
+    GalaxyClientInternal client = GetChannelClient(result.configs());
+    ReadRequest request;
+    request.set_name(result.path());
+    request.mutable_cred()->set_password(result.configs().to_cell_config().fs_password());
+    request.set_from_cell(result.configs().from_cell_config().cell());
+    client.AsyncRead(request, [callback](const grpc::Status& status, ReadResponse& response) {
+        absl::Status call_status = AsyncCallStatus(status, response.status(), "Read");
+        if (!call_status.ok()) {
+            callback(call_status);
+            return;
+        }
+        callback(std::move(*response.mutable_data()));
+    });
+}
+
+std::future<absl::StatusOr<std::string>> galaxy::client::async::Read(const std::string& path) {
+    return AsyncCallToFuture<absl::StatusOr<std::string>>([&](StringCallback callback) {
+        galaxy::client::async::Read(path, std::move(callback));
+    });
+}
+
+void galaxy::client::async::Write(const std::string& path, const std::string& data, const std::string& mode, StatusCallback callback) {
+    if (mode != "a" && mode != "w") {
+        callback(absl::InvalidArgumentError("Mode has to be either a or w"));
+        return;
+    }
+    FileAnalyzerResult result = galaxy::util::InitClient(path);
+    if (!result.is_remote() && !result.is_shared()) {
+        callback(GalaxyFs::Instance()->Write(result.path(), data, mode));
+        return;
+    }
+    if (!result.is_remote()) {
+        galaxy::client::Write(path, data, mode);
+        callback(absl::OkStatus());
+        return;
+    }
+    GalaxyClientInternal client = GetChannelClient(result.configs());
+    WriteRequest request;
+    request.set_name(result.path());
+    request.set_data(data);
+    request.set_mode(mode == "a" ? WriteMode::APPEND : WriteMode::OVERWRITE);
+    request.mutable_cred()->set_password(result.configs().to_cell_config().fs_password());
+    request.set_from_cell(result.configs().from_cell_config().cell());
+    client.AsyncWrite(request, [callback](const grpc::Status& status, WriteResponse& response) {
+        callback(AsyncCallStatus(status, response.status(), "Write"));
+    });
+}
+
+std::future<absl::Status> galaxy::client::async::Write(const std::string& path, const std::string& data, const std::string& mode) {
+    return AsyncCallToFuture<absl::Status>([&](StatusCallback callback) {
+        galaxy::client::async::Write(path, data, mode, std::move(callback));
+    });
+}
+
+void galaxy::client::async::ListDirsInDir(const std::string& path, ListCallback callback) {
+    FileAnalyzerResult result = galaxy::util::InitClient(path);
+    if (!result.is_remote()) {
+        callback(galaxy::client::ListDirsInDir(path));
+        return;
+    }
+    GalaxyClientInternal client = GetChannelClient(result.configs());
+    ListDirsInDirRequest request;
+    request.set_name(result.path());
+    request.mutable_cred()->set_password(result.configs().to_cell_config().fs_password());
+    request.set_from_cell(result.configs().from_cell_config().cell());
+    CellConfig cell_config = result.configs().to_cell_config();
+    client.AsyncListDirsInDir(request, [callback, cell_config](const grpc::Status& status, ListDirsInDirResponse& response) {
+        absl::Status call_status = AsyncCallStatus(status, response.status(), "ListDirsInDir");
+        if (!call_status.ok()) {
+            callback(call_status);
+            return;
+        }
+        std::map<std::string, std::string> dirs;
+        for (const auto& sub_dir : response.sub_dirs()) {
+            dirs.insert({galaxy::util::ConvertToCellPath(sub_dir.first, cell_config), ProtoMessageToString(sub_dir.second)});
+        }
+        callback(std::move(dirs));
+    });
+}
+
+std::future<absl::StatusOr<std::map<std::string, std::string>>> galaxy::client::async::ListDirsInDir(const std::string& path) {
+    return AsyncCallToFuture<absl::StatusOr<std::map<std::string, std::string>>>([&](ListCallback callback) {
+        galaxy::client::async::ListDirsInDir(path, std::move(callback));
+    });
+}
+
+void galaxy::client::async::ListFilesInDir(const std::string& path, bool include_hidden, ListCallback callback) {
+    FileAnalyzerResult result = galaxy::util::InitClient(path);
+    if (!result.is_remote()) {
+        callback(galaxy::client::ListFilesInDir(path, include_hidden));
+        return;
+    }
+    GalaxyClientInternal client = GetChannelClient(result.configs());
+    ListFilesInDirRequest request;
+    request.set_name(result.path());
+    request.mutable_cred()->set_password(result.configs().to_cell_config().fs_password());
+    request.set_include_hidden(include_hidden);
+    request.set_from_cell(result.configs().from_cell_config().cell());
+    CellConfig cell_config = result.configs().to_cell_config();
+    client.AsyncListFilesInDir(request, [callback, cell_config](const grpc::Status& status, ListFilesInDirResponse& response) {
+        absl::Status call_status = AsyncCallStatus(status, response.status(), "ListFilesInDir");
+        if (!call_status.ok()) {
+            callback(call_status);
+            return;
+        }
+        std::map<std::string, std::string> files;
+        for (const auto& sub_file : response.sub_files()) {
+            files.insert({galaxy::util::ConvertToCellPath(sub_file.first, cell_config), ProtoMessageToString(sub_file.second)});
+        }
+        callback(std::move(files));
+    });
+}
+
+std::future<absl::StatusOr<std::map<std::string, std::string>>> galaxy::client::async::ListFilesInDir(const std::string& path, bool include_hidden) {
+    return AsyncCallToFuture<absl::StatusOr<std::map<std::string, std::string>>>([&](ListCallback callback) {
+        galaxy::client::async::ListFilesInDir(path, include_hidden, std::move(callback));
+    });
+}
+
+void galaxy::client::async::GetAttr(const std::string& path, StringCallback callback) {
+    FileAnalyzerResult result = galaxy::util::InitClient(path);
+    if (!result.is_remote()) {
+        callback(galaxy::client::GetAttr(path));
+        return;
+    }
+    GalaxyClientInternal client = GetChannelClient(result.configs());
+    GetAttrRequest request;
+    request.set_name(result.path());
+    request.mutable_cred()->set_password(result.configs().to_cell_config().fs_password());
+    request.set_from_cell(result.configs().from_cell_config().cell());
+    client.AsyncGetAttr(request, [callback](const grpc::Status& status, GetAttrResponse& response) {
+        absl::Status call_status = AsyncCallStatus(status, response.status(), "GetAttr");
+        if (!call_status.ok()) {
+            callback(call_status);
+            return;
+        }
+        callback(ProtoMessageToString(response.attr()));
+    });
+}
+
+std::future<absl::StatusOr<std::string>> galaxy::client::async::GetAttr(const std::string& path) {
+    return AsyncCallToFuture<absl::StatusOr<std::string>>([&](StringCallback callback) {
+        galaxy::client::async::GetAttr(path, std::move(callback));
+    });
+}
+
+void galaxy::client::async::CopyFile(const std::string& from_path, const std::string& to_path, StatusCallback callback) {
+    FileAnalyzerResult from_result = galaxy::util::InitClient(from_path);
+    FileAnalyzerResult to_result = galaxy::util::InitClient(to_path);
+    if (from_result.is_shared()) {
+        galaxy::client::async::CopyFile(galaxy::util::BroadcastSharedPath(from_path, {}).at(0), to_path, std::move(callback));
+        return;
+    }
+    if (to_result.is_shared()) {
+        std::vector<std::string> failed_cells;
+        for (const auto& pair : galaxy::client::BroadcastCopyFile(from_path, to_path)) {
+            if (!pair.second) {
+                failed_cells.push_back(pair.first);
+            }
+        }
+        callback(failed_cells.empty() ? absl::OkStatus()
+                                      : absl::InternalError("Fail to copy " + from_path + " to cells " + absl::StrJoin(failed_cells, ", ") + "."));
+        return;
+    }
+    if (!from_result.is_remote() && !to_result.is_remote()) {
+        callback(GalaxyFs::Instance()->CopyFile(from_result.path(), to_result.path()));
+        return;
+    }
+    // Only a copy between two remote cells is a single unary call, the other copies stream data through this client
+    // with CopyFile, which only logs its errors, so they are confirmed by the size of the copy.
+    if (!from_result.is_remote() || !to_result.is_remote()) {
+        galaxy::client::CopyFile(from_path, to_path);
+        int64_t from_size = galaxy::util::ParseAttrSize(galaxy::client::GetAttr(from_path));
+        int64_t to_size = galaxy::util::ParseAttrSize(galaxy::client::GetAttr(to_path));
+        callback(to_size >= 0 && to_size == from_size ? absl::OkStatus()
+                                                      : absl::InternalError("Fail to copy " + from_path + " to " + to_path + "."));
+        return;
+    }
+    std::string to_galaxy_path = galaxy::util::ConvertToCellPath(to_result.path(), to_result.configs().to_cell_config());
+    std::string prefix = galaxy::util::GetGalaxyFsPrefixPath(to_result.configs().to_cell_config().cell());
+    if (to_galaxy_path.find(prefix) == std::string::npos) {
+        callback(absl::InvalidArgumentError("The to_path is not in galaxy."));
+        return;
+    }
+    GalaxyClientInternal client = GetChannelClient(from_result.configs());
+    CrossCellRequest request;
+    request.set_call_type(CrossCellCallType::COPYFILE);
+    request.mutable_cred()->set_password(from_result.configs().to_cell_config().fs_password());
+    CopyRequest copy_request;
+    copy_request.mutable_cred()->set_password(from_result.configs().to_cell_config().fs_password());
+    copy_request.set_from_name(galaxy::util::ConvertToCellPath(from_result.path(), from_result.configs().to_cell_config()));
+    copy_request.set_to_name(to_galaxy_path);
+    copy_request.set_from_cell(from_result.configs().from_cell_config().cell());
+    request.mutable_request()->PackFrom(copy_request);
+    client.AsyncCrossCellCall(request, [callback](const grpc::Status& status, CrossCellResponse& response) {
+        CopyResponse copy_response;
+        response.response().UnpackTo(&copy_response);
+        callback(AsyncCallStatus(status, copy_response.status(), "CopyFile"));
+    });
+}
+
+std::future<absl::Status> galaxy::client::async::CopyFile(const std::string& from_path, const std::string& to_path) {
+    return AsyncCallToFuture<absl::Status>([&](StatusCallback callback) {
+        galaxy::client::async::CopyFile(from_path, to_path, std::move(callback));
+    });
+}
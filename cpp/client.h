@@ -1,10 +1,22 @@
 #ifndef CPP_GALAXY_CLIENT_H
 #define CPP_GALAXY_CLIENT_H
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
 #include <vector>
 #include <map>
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "schema/fileserver.pb.h"
 
+namespace grpc {
+    class ClientContext;
+}
 
 namespace galaxy {
     namespace client {
@@ -23,10 +35,18 @@ namespace galaxy {
             void RRmFile(const galaxy_schema::FileAnalyzerResult& result, bool is_hidden=false);
             void RRenameFile(const galaxy_schema::FileAnalyzerResult& old_result, const galaxy_schema::FileAnalyzerResult& new_result);
             std::string RRead(const galaxy_schema::FileAnalyzerResult& result);
-            std::map<std::string, std::string> RReadMultiple(const std::vector<galaxy_schema::FileAnalyzerResult>& results);
+            std::map<std::string, std::string> RReadMultiple(const std::vector<galaxy_schema::FileAnalyzerResult>& results, bool consistent=false);
+            std::map<std::string, galaxy_schema::ScanFileResult> RScan(const galaxy_schema::SingleRequestCellConfigs& configs, galaxy_schema::ScanRequest request);
             void RWrite(const galaxy_schema::FileAnalyzerResult& result, const std::string& data, const std::string& mode="w");
-            void RWriteMultiple(const std::vector<std::pair<galaxy_schema::FileAnalyzerResult, std::string>>& path_data_map, const std::string& mode="w");
+            // failed, if given, receives the paths on the cell of the files that were not written.
+            void RWriteMultiple(const std::vector<std::pair<galaxy_schema::FileAnalyzerResult, std::string>>& path_data_map, const std::string& mode="w",
+                                std::set<std::string>* failed=nullptr);
+            bool RWriteMultipleAtomic(const std::vector<std::pair<galaxy_schema::FileAnalyzerResult, std::string>>& path_data_map);
+            void RWriteAt(const galaxy_schema::FileAnalyzerResult& result, int64_t offset, const std::string& data);
+            void RTruncate(const galaxy_schema::FileAnalyzerResult& result, int64_t size);
+            void RPreallocate(const galaxy_schema::FileAnalyzerResult& result, int64_t size);
             std::string RGetAttr(const galaxy_schema::FileAnalyzerResult& result);
+            std::string RChecksum(const galaxy_schema::FileAnalyzerResult& result);
             std::string RCheckHealth(const std::string& cell);
             void RChangeAvailability(const std::string& cell, const bool status);
             void RCopyFile(const galaxy_schema::FileAnalyzerResult& from_result, const galaxy_schema::FileAnalyzerResult& to_result);
@@ -46,10 +66,16 @@ namespace galaxy {
             void LRmFile(const galaxy_schema::FileAnalyzerResult& result, bool is_hidden=false);
             void LRenameFile(const galaxy_schema::FileAnalyzerResult& old_result, const galaxy_schema::FileAnalyzerResult& new_result);
             std::string LRead(const galaxy_schema::FileAnalyzerResult& result);
-            std::map<std::string, std::string> LReadMultiple(const std::vector<galaxy_schema::FileAnalyzerResult>& results);
+            std::map<std::string, std::string> LReadMultiple(const std::vector<galaxy_schema::FileAnalyzerResult>& results, bool consistent=false);
+            std::map<std::string, galaxy_schema::ScanFileResult> LScan(const galaxy_schema::SingleRequestCellConfigs& configs, const galaxy_schema::ScanRequest& request);
             void LWrite(const galaxy_schema::FileAnalyzerResult& result, const std::string& data, const std::string& mode="w");
             void LWriteMultiple(const std::vector<std::pair<galaxy_schema::FileAnalyzerResult, std::string>>& path_data_map, const std::string& mode="w");
+            bool LWriteMultipleAtomic(const std::vector<std::pair<galaxy_schema::FileAnalyzerResult, std::string>>& path_data_map);
+            void LWriteAt(const galaxy_schema::FileAnalyzerResult& result, int64_t offset, const std::string& data);
+            void LTruncate(const galaxy_schema::FileAnalyzerResult& result, int64_t size);
+            void LPreallocate(const galaxy_schema::FileAnalyzerResult& result, int64_t size);
             std::string LGetAttr(const galaxy_schema::FileAnalyzerResult& result);
+            std::string LChecksum(const galaxy_schema::FileAnalyzerResult& result);
             void LCopyFile(const galaxy_schema::FileAnalyzerResult& from_result, const galaxy_schema::FileAnalyzerResult& to_result);
             void LMoveFile(const galaxy_schema::FileAnalyzerResult& from_result, const galaxy_schema::FileAnalyzerResult& to_result);
         }
@@ -66,16 +92,257 @@ namespace galaxy {
         void RmFile(const std::string& path, bool is_hidden=false);
         void RenameFile(const std::string& old_path, const std::string& new_path);
         std::string Read(const std::string& path);
-        std::map<std::string, std::string> ReadMultiple(const std::vector<std::string>& paths);
+        // With consistent, none of the files is read while an atomic WriteMultiple to them is being published.
+        std::map<std::string, std::string> ReadMultiple(const std::vector<std::string>& paths, bool consistent=false);
         void Write(const std::string& path, const std::string& data, const std::string& mode="w");
         void WriteMultiple(const std::map<std::string, std::string>& path_data_map, const std::string& mode="w");
+        // Overwrites all the files or none of them, e.g. after a crash of the cell. The files must all be on the same cell,
+        // and none of them under /SHARED. Returns whether the files were written.
+        bool WriteMultipleAtomic(const std::map<std::string, std::string>& path_data_map);
+        // Writes data at offset without truncating the file, creating it if needed. Writing past the end leaves a hole.
+        void WriteAt(const std::string& path, int64_t offset, const std::string& data);
+        // Sets the size of a file, dropping its end or extending it with a hole.
+        void Truncate(const std::string& path, int64_t size);
+        // Reserves the disk blocks of a file up to size ahead of its writes, without changing its size or content.
+        void Preallocate(const std::string& path, int64_t size);
         std::string GetAttr(const std::string& path);
+        // Hex CRC32C of the content of a file, computed where the file lives. Empty if it cannot be checksummed.
+        std::string Checksum(const std::string& path);
         std::vector<std::string> ListCells(const bool bypass=false);
         std::string CheckHealth(const std::string& cell);
         void ChangeAvailability(const std::string& cell, const bool status);
         void CopyFile(const std::string& from_path, const std::string& to_path);
         void MoveFile(const std::string& from_path, const std::string& to_path);
+        // Copies a file or writes data to every cell of a /SHARED path, and returns whether each cell succeeded.
+        // Large payloads are sent once and replicated through a chain of cells, small ones are sent to all cells concurrently.
+        std::map<std::string, bool> BroadcastCopyFile(const std::string& from_path, const std::string& to_path);
+        std::map<std::string, bool> BroadcastWrite(const std::string& path, const std::string& data);
+
+        // Compression of the calls this thread makes while it is alive, instead of the fs_compression of their cells,
+        // e.g. UNCOMPRESSED for data known not to compress or ZLIB over a slow link. Scopes nest.
+        class ScopedCompression {
+        public:
+            explicit ScopedCompression(galaxy_schema::CompressionType type);
+            ~ScopedCompression();
+            ScopedCompression(const ScopedCompression&) = delete;
+
+        private:
+            galaxy_schema::CompressionType type_;
+            const galaxy_schema::CompressionType* previous_;
+        };
+        // Runs main with its arguments on cell, printing its output as it is produced.
         void RemoteExecute(const std::string& cell, const std::string& home_dir, const std::string main, const std::vector<std::string>& program_args, const std::map<std::string, std::string>& env_kargs={});
+
+        struct ExecutionResult {
+            std::string raw_cmd;
+            // Exit code of the command, -1 if it was killed by a signal or did not run to its end.
+            int exit_code = -1;
+            // Signal that killed the command, 0 if it exited.
+            int term_signal = 0;
+            double wall_sec = 0;
+            double user_sec = 0;
+            double system_sec = 0;
+            int64_t max_rss_kb = 0;
+            // Why the command did not run to its end, e.g. the cell already runs fs_max_executions commands, empty otherwise.
+            std::string error;
+            // Output of the command, only collected by RemoteExecuteAll.
+            std::string out;
+            std::string err;
+        };
+
+        // Called with the stdout and stderr produced since the previous call, one of which may be empty. Returning false kills the command.
+        using ExecutionOutputCallback = std::function<bool(const std::string& out, const std::string& err)>;
+        // Runs main with its arguments on cell, streaming its output to callback while it runs, and returns its exit status.
+        ExecutionResult RemoteExecuteStream(const std::string& cell, const std::string& home_dir, const std::string& main, const std::vector<std::string>& program_args,
+                                            const std::map<std::string, std::string>& env_kargs, ExecutionOutputCallback callback);
+
+        struct ExecuteAllOptions {
+            // Cells the command runs on at once.
+            int parallelism = 32;
+            // Time given to the command on each cell before it is killed, no limit if 0.
+            int timeout_sec = 0;
+
+            // Options initialized from the fs_execute_* flags.
+            static ExecuteAllOptions FromFlags();
+        };
+
+        // Runs main with its arguments on every cell of cells concurrently, and returns the result and the output of each.
+        // A cell failing, or not done within the timeout, only fails its own result.
+        std::map<std::string, ExecutionResult> RemoteExecuteAll(const std::vector<std::string>& cells, const std::string& home_dir, const std::string& main,
+                                                                const std::vector<std::string>& program_args, const std::map<std::string, std::string>& env_kargs={},
+                                                                const ExecuteAllOptions& options=ExecuteAllOptions::FromFlags());
+
+        // Change of a watched directory, with paths under the watched path as given by the caller.
+        struct WatchEvent {
+            galaxy_schema::WatchEventType type = galaxy_schema::WatchEventType::WATCH_ALL;
+            std::string path;
+            // Previous path of a renamed entry.
+            std::string old_path;
+            bool is_dir = false;
+            // Attributes after the change, as returned by GetAttr. Empty if the entry is already gone.
+            std::string attr;
+            // Resumes a later watch right after this change.
+            std::string resume_token;
+        };
+
+        // Changes of a directory, or of the whole tree under it if recursive, streamed from its cell as they happen.
+        // The stream reconnects and resumes on its own after failures. Changes that cannot be resumed are reported
+        // as a WATCH_OVERFLOW event, after which the directory should be listed again. event_mask is a bitmask of
+        // galaxy_schema::WatchEventType values, every kind of change if 0.
+        class Watcher {
+        public:
+            Watcher(const std::string& path, bool recursive=false, uint32_t event_mask=0, const std::string& resume_token="");
+            Watcher(const Watcher&) = delete;
+            ~Watcher();
+
+            // Waits up to timeout_ms, or forever if negative, for the next change. Returns false on timeout, and
+            // once done.
+            bool Next(WatchEvent* event, int timeout_ms=-1);
+            void Cancel();
+            // Whether no change is left to return, as the watch was cancelled or failed, e.g. on a missing directory.
+            bool done() const;
+            absl::Status status() const;
+            // Resumes a later watch after the last change returned by Next.
+            std::string resume_token() const;
+
+        private:
+            void Run();
+            void RunRemote(const galaxy_schema::FileAnalyzerResult& result);
+            void RunLocal(const galaxy_schema::FileAnalyzerResult& result);
+            // Queues a change, waiting for room. Returns false once cancelled.
+            bool Push(WatchEvent event);
+            void Finish(const absl::Status& status);
+
+            const std::string path_;
+            const bool recursive_;
+            const uint32_t event_mask_;
+            mutable std::mutex mu_;
+            std::condition_variable cv_;
+            std::deque<WatchEvent> events_;
+            // Tokens after the last change received from the cell, and after the last one returned by Next.
+            std::string received_token_;
+            std::string returned_token_;
+            bool cancelled_ = false;
+            bool finished_ = false;
+            absl::Status status_;
+            // Call in flight, cancelled along with the watch.
+            grpc::ClientContext* context_ = nullptr;
+            std::thread thread_;
+        };
+
+        using WatchCallback = std::function<bool(const WatchEvent&)>;
+        // Calls callback with every change of path until it returns false, see Watcher. Returns the token to resume
+        // after the last change, or an empty one if the watch failed.
+        std::string Watch(const std::string& path, bool recursive, uint32_t event_mask, WatchCallback callback, const std::string& resume_token="");
+
+        // Data appended to a followed file.
+        struct TailChunk {
+            // Cell and path the data was read from, one of several for a /SHARED path.
+            std::string cell;
+            std::string path;
+            std::string data;
+            // Offset of data in the file.
+            int64_t offset = 0;
+            // The file was truncated or replaced, e.g. rotated, and data starts over from its beginning.
+            bool reset = false;
+        };
+
+        // Content of a file, e.g. a log, from from_offset (counted from its end if negative) or from its last
+        // last_n_lines lines if positive, and with follow whatever is appended to it later on, streamed from its
+        // cell as it is written. A /SHARED path is followed on every cell at once. Streams resume at the offset
+        // they stopped at after failures.
+        class TailReader {
+        public:
+            TailReader(const std::string& path, int64_t from_offset=0, int64_t last_n_lines=0, bool follow=true);
+            TailReader(const TailReader&) = delete;
+            ~TailReader();
+
+            // Waits up to timeout_ms, or forever if negative, for the next chunk. Returns false on timeout, and
+            // once done.
+            bool Next(TailChunk* chunk, int timeout_ms=-1);
+            void Cancel();
+            // Whether no chunk is left to return, as every file was read to its end without follow, or the reader
+            // was cancelled or failed.
+            bool done() const;
+            // First failure of the files read, e.g. a missing file.
+            absl::Status status() const;
+
+        private:
+            // Reads the file at path, one of the cells of a /SHARED path.
+            void Run(const std::string& path);
+            void RunRemote(const std::string& path, const galaxy_schema::FileAnalyzerResult& result);
+            void RunLocal(const std::string& path, const galaxy_schema::FileAnalyzerResult& result);
+            // Queues a chunk, waiting for room. Returns false once cancelled.
+            bool Push(TailChunk chunk);
+            void Finish(const absl::Status& status);
+
+            const int64_t from_offset_;
+            const int64_t last_n_lines_;
+            const bool follow_;
+            mutable std::mutex mu_;
+            std::condition_variable cv_;
+            std::deque<TailChunk> chunks_;
+            bool cancelled_ = false;
+            int num_running_ = 0;
+            absl::Status status_;
+            // Calls in flight, cancelled along with the reader.
+            std::set<grpc::ClientContext*> contexts_;
+            std::vector<std::thread> threads_;
+        };
+
+        using TailCallback = std::function<bool(const TailChunk&)>;
+        // Calls callback with every chunk of path until it returns false, or the end of the file without follow,
+        // see TailReader. Returns false if reading failed.
+        bool Tail(const std::string& path, int64_t from_offset, int64_t last_n_lines, bool follow, TailCallback callback);
+
+        // Operator run by Scan next to the files, see galaxy_schema::ScanRequest.
+        struct ScanOptions {
+            galaxy_schema::ScanOperator op = galaxy_schema::ScanOperator::SCAN_GREP;
+            // Substring to look for with SCAN_GREP, or RE2 regular expression with regex.
+            std::string pattern;
+            bool regex = false;
+            // Lines and bytes of output kept per file, 0 for the defaults of the cell.
+            int64_t max_lines = 0;
+            int64_t max_bytes = 0;
+        };
+
+        struct ScanResult {
+            // Matching lines, first or last lines, or hash.
+            std::string data;
+            int64_t count = 0;
+            bool truncated = false;
+            // Why the file could not be scanned, empty on success.
+            std::string error;
+        };
+
+        // Runs an operator, e.g. a grep or a line count, over files on the cells holding them, so that only the results
+        // are sent back. Files are grouped per cell, the cells are called concurrently and each scans its files in parallel.
+        std::map<std::string, ScanResult> Scan(const std::vector<std::string>& paths, const ScanOptions& options);
+        // Same over the files directly under path, or under the whole tree with recursive.
+        std::map<std::string, ScanResult> ScanDir(const std::string& path, bool recursive, const ScanOptions& options);
+
+        // Non-blocking variants of the calls above, for callers with many independent files in flight. Remote calls
+        // are multiplexed over the pooled channels and completed by a single completion queue thread, which also runs
+        // the callbacks, so callbacks must not block. Local and /SHARED paths, and copies that stream a local file,
+        // are served inline on the calling thread before the call returns.
+        namespace async {
+            using ListCallback = std::function<void(absl::StatusOr<std::map<std::string, std::string>>)>;
+            using StatusCallback = std::function<void(absl::Status)>;
+            using StringCallback = std::function<void(absl::StatusOr<std::string>)>;
+
+            void Read(const std::string& path, StringCallback callback);
+            std::future<absl::StatusOr<std::string>> Read(const std::string& path);
+            void Write(const std::string& path, const std::string& data, const std::string& mode, StatusCallback callback);
+            std::future<absl::Status> Write(const std::string& path, const std::string& data, const std::string& mode="w");
+            void ListDirsInDir(const std::string& path, ListCallback callback);
+            std::future<absl::StatusOr<std::map<std::string, std::string>>> ListDirsInDir(const std::string& path);
+            void ListFilesInDir(const std::string& path, bool include_hidden, ListCallback callback);
+            std::future<absl::StatusOr<std::map<std::string, std::string>>> ListFilesInDir(const std::string& path, bool include_hidden=false);
+            void GetAttr(const std::string& path, StringCallback callback);
+            std::future<absl::StatusOr<std::string>> GetAttr(const std::string& path);
+            void CopyFile(const std::string& from_path, const std::string& to_path, StatusCallback callback);
+            std::future<absl::Status> CopyFile(const std::string& from_path, const std::string& to_path);
+        }  // namespace async
     }  // namespace client
 } // namespace galaxy
 
@@ -0,0 +1,97 @@
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include "absl/flags/flag.h"
+#include "cpp/client.h"
+#include "cpp/core/galaxy_flag.h"
+#include "cpp/core/galaxy_test_cells.h"
+
+namespace {
+    using galaxy::TestCells;
+    using galaxy::TestCellsOptions;
+
+    const std::vector<std::string> kCells = {"aa", "bb", "cc", "dd"};
+
+    void WriteFile(const std::string& path, const std::string& data) {
+        std::ofstream file(path);
+        file << data;
+    }
+
+    std::string ReadFile(const std::string& path) {
+        std::ifstream file(path);
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        return buffer.str();
+    }
+
+    // Payloads of at least chain_min_kb go through a chain of the cells, or a tree of the given fanout.
+    void SetReplication(int chain_min_kb, int fanout) {
+        absl::SetFlag(&FLAGS_fs_shared_chain_min_kb, chain_min_kb);
+        absl::SetFlag(&FLAGS_fs_shared_fanout, fanout);
+    }
+
+    void ExpectReplicated(const TestCells& cells, const std::map<std::string, bool>& cell_status,
+                          const std::string& name, const std::string& data, const std::set<std::string>& down = {}) {
+        ASSERT_EQ(cell_status.size(), kCells.size());
+        for (const auto& cell : kCells) {
+            bool up = down.count(cell) == 0;
+            EXPECT_EQ(cell_status.at(cell), up) << cell;
+            if (up) {
+                EXPECT_EQ(ReadFile(cells.Root(cell) + name), data) << cell;
+            }
+        }
+    }
+
+    TEST(BroadcastTest, WriteThroughChain) {
+        TestCells cells("broadcast_chain", kCells);
+        SetReplication(1, 1);
+        std::string data(100 << 10, 'c');
+        ExpectReplicated(cells, galaxy::client::BroadcastWrite("/SHARED/chain", data), "/chain", data);
+    }
+
+    TEST(BroadcastTest, WriteThroughTree) {
+        TestCells cells("broadcast_tree", kCells);
+        SetReplication(1, 2);
+        std::string data(100 << 10, 't');
+        ExpectReplicated(cells, galaxy::client::BroadcastWrite("/SHARED/tree", data), "/tree", data);
+    }
+
+    TEST(BroadcastTest, SmallWriteFansOut) {
+        TestCells cells("broadcast_small", kCells);
+        SetReplication(1024, 1);
+        ExpectReplicated(cells, galaxy::client::BroadcastWrite("/SHARED/small", "small"), "/small", "small");
+    }
+
+    TEST(BroadcastTest, CopyFileThroughChain) {
+        TestCells cells("broadcast_copy", kCells);
+        SetReplication(1, 1);
+        std::string from_path = testing::TempDir() + "/broadcast_copy_" + std::to_string(getpid());
+        // Several chunks of the copy stream, each forwarded down the chain.
+        std::string data;
+        for (int i = 0; i < (3 << 20) + 100; i++) {
+            data.push_back('a' + i % 26);
+        }
+        WriteFile(from_path, data);
+        ExpectReplicated(cells, galaxy::client::BroadcastCopyFile(from_path, "/SHARED/copy"), "/copy", data);
+    }
+
+    TEST(BroadcastTest, DownCellFailsAlone) {
+        // The last cell of the chain, so that no other cell is behind it.
+        TestCellsOptions options;
+        options.down = {"dd"};
+        TestCells cells("broadcast_down", kCells, options);
+        std::string data(100 << 10, 'd');
+        for (int fanout : {1, 2}) {
+            SetReplication(1, fanout);
+            ExpectReplicated(cells, galaxy::client::BroadcastWrite("/SHARED/down", data), "/down", data, options.down);
+        }
+        SetReplication(1024, 1);
+        ExpectReplicated(cells, galaxy::client::BroadcastWrite("/SHARED/down_small", "small"), "/down_small", "small",
+                         options.down);
+    }
+}  // namespace
@@ -0,0 +1,113 @@
+#include <algorithm>
+#include "cpp/co_client.h"
+#include "cpp/client.h"
+#include "cpp/internal/galaxy_client_internal.h"
+
+using galaxy::client::co::CallAwaiter;
+using galaxy::client::co::CancellationSource;
+using galaxy::client::co::CancellationToken;
+using galaxy::client::co::Executor;
+
+Executor::Executor(int num_threads) {
+    for (int i = 0; i < std::max(num_threads, 1); ++i) {
+        threads_.emplace_back(&Executor::WorkerLoop, this);
+    }
+}
+
+Executor::~Executor() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stopped_ = true;
+    }
+    cv_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+Executor* Executor::Default() {
+    static Executor* executor = new Executor(static_cast<int>(std::thread::hardware_concurrency()));
+    return executor;
+}
+
+void Executor::Schedule(std::coroutine_handle<> handle) {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        queue_.push_back(handle);
+    }
+    cv_.notify_one();
+}
+
+void Executor::WorkerLoop() {
+    while (true) {
+        std::coroutine_handle<> handle;
+        {
+            std::unique_lock<std::mutex> lock(mu_);
+            cv_.wait(lock, [this]() { return stopped_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            handle = queue_.front();
+            queue_.pop_front();
+        }
+        handle.resume();
+    }
+}
+
+bool CancellationToken::IsCancelled() const {
+    return group_ && group_->IsCancelled();
+}
+
+CancellationSource::CancellationSource() : group_(std::make_shared<galaxy::AsyncCallGroup>()) {}
+
+void CancellationSource::Cancel() {
+    group_->Cancel();
+}
+
+bool CancellationSource::IsCancelled() const {
+    return group_->IsCancelled();
+}
+
+void galaxy::client::co::internal::StartInGroup(const CancellationToken& token, const std::function<void()>& start) {
+    galaxy::ScopedAsyncCallGroup scope(token.group_);
+    start();
+}
+
+CallAwaiter<absl::StatusOr<std::string>> galaxy::client::co::Read(const std::string& path, CancellationToken token) {
+    return CallAwaiter<absl::StatusOr<std::string>>([path](galaxy::client::async::StringCallback callback) {
+        galaxy::client::async::Read(path, std::move(callback));
+    }, std::move(token));
+}
+
+CallAwaiter<absl::Status> galaxy::client::co::Write(const std::string& path, const std::string& data, const std::string& mode,
+                                                   CancellationToken token) {
+    return CallAwaiter<absl::Status>([path, data, mode](galaxy::client::async::StatusCallback callback) {
+        galaxy::client::async::Write(path, data, mode, std::move(callback));
+    }, std::move(token));
+}
+
+CallAwaiter<absl::StatusOr<std::map<std::string, std::string>>> galaxy::client::co::ListDirsInDir(const std::string& path,
+                                                                                                  CancellationToken token) {
+    return CallAwaiter<absl::StatusOr<std::map<std::string, std::string>>>([path](galaxy::client::async::ListCallback callback) {
+        galaxy::client::async::ListDirsInDir(path, std::move(callback));
+    }, std::move(token));
+}
+
+CallAwaiter<absl::StatusOr<std::map<std::string, std::string>>> galaxy::client::co::ListFilesInDir(const std::string& path, bool include_hidden,
+                                                                                                   CancellationToken token) {
+    return CallAwaiter<absl::StatusOr<std::map<std::string, std::string>>>([path, include_hidden](galaxy::client::async::ListCallback callback) {
+        galaxy::client::async::ListFilesInDir(path, include_hidden, std::move(callback));
+    }, std::move(token));
+}
+
+CallAwaiter<absl::StatusOr<std::string>> galaxy::client::co::GetAttr(const std::string& path, CancellationToken token) {
+    return CallAwaiter<absl::StatusOr<std::string>>([path](galaxy::client::async::StringCallback callback) {
+        galaxy::client::async::GetAttr(path, std::move(callback));
+    }, std::move(token));
+}
+
+CallAwaiter<absl::Status> galaxy::client::co::CopyFile(const std::string& from_path, const std::string& to_path, CancellationToken token) {
+    return CallAwaiter<absl::Status>([from_path, to_path](galaxy::client::async::StatusCallback callback) {
+        galaxy::client::async::CopyFile(from_path, to_path, std::move(callback));
+    }, std::move(token));
+}
@@ -0,0 +1,294 @@
+#ifndef CPP_GALAXY_CO_CLIENT_H
+#define CPP_GALAXY_CO_CLIENT_H
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+
+// Coroutine interface of the client, built on galaxy::client::async. Requires C++20.
+//
+//     co::Task<absl::Status> Pipeline(std::string path) {
+//         absl::StatusOr<std::string> data = co_await co::Read(path);
+//         if (!data.ok()) co_return data.status();
+//         co_return co_await co::Write(path + ".out", Transform(*data));
+//     }
+//     std::vector<co::Task<absl::Status>> tasks;
+//     for (const auto& path : paths) tasks.push_back(Pipeline(path));
+//     std::vector<absl::Status> statuses = co::SyncWait(co::WhenAll(std::move(tasks)));
+namespace galaxy {
+    class AsyncCallGroup;
+
+    namespace client {
+        namespace co {
+            // Fixed pool of threads resuming coroutines. Completions of remote calls are handed over to it, so that
+            // coroutine bodies never run on the completion queue thread of the async client.
+            class Executor {
+            public:
+                explicit Executor(int num_threads);
+                Executor(const Executor&) = delete;
+                ~Executor();
+
+                // Executor shared by the whole process, with one thread per core. It is never destroyed.
+                static Executor* Default();
+
+                void Schedule(std::coroutine_handle<> handle);
+
+                // co_await executor->Resume() continues the current coroutine on a thread of the executor.
+                auto Resume() {
+                    struct Awaiter {
+                        Executor* executor;
+                        bool await_ready() const noexcept { return false; }
+                        void await_suspend(std::coroutine_handle<> handle) { executor->Schedule(handle); }
+                        void await_resume() const noexcept {}
+                    };
+                    return Awaiter{this};
+                }
+
+            private:
+                void WorkerLoop();
+
+                std::mutex mu_;
+                std::condition_variable cv_;
+                std::deque<std::coroutine_handle<>> queue_;
+                bool stopped_ = false;
+                std::vector<std::thread> threads_;
+            };
+
+            class CancellationToken;
+
+            namespace internal {
+                // Runs start, which sends a call of galaxy::client::async, so that the call is cancelled with token.
+                void StartInGroup(const CancellationToken& token, const std::function<void()>& start);
+            }  // namespace internal
+
+            // A default constructed token is never cancelled.
+            class CancellationToken {
+            public:
+                CancellationToken() = default;
+                bool IsCancelled() const;
+
+            private:
+                friend class CancellationSource;
+                friend void internal::StartInGroup(const CancellationToken& token, const std::function<void()>& start);
+                explicit CancellationToken(std::shared_ptr<AsyncCallGroup> group) : group_(std::move(group)) {}
+
+                std::shared_ptr<AsyncCallGroup> group_;
+            };
+
+            // Cancels the calls made with its tokens. Calls not sent yet fail right away with a cancelled status. Calls
+            // in flight are cancelled on their channel and resume with a cancelled status, but the cell may still have
+            // applied them. Copies streamed through this client and writes to /SHARED run to their end on the
+            // awaiting thread, and are only cancelled before they start.
+            class CancellationSource {
+            public:
+                CancellationSource();
+                CancellationToken Token() const { return CancellationToken(group_); }
+                void Cancel();
+                bool IsCancelled() const;
+
+            private:
+                std::shared_ptr<AsyncCallGroup> group_;
+            };
+
+            // Coroutine returning a T. It is started lazily when awaited, and resumes its awaiter once it returns.
+            template <typename T>
+            class Task {
+            public:
+                struct promise_type {
+                    std::optional<T> value;
+                    std::exception_ptr exception;
+                    std::coroutine_handle<> continuation;
+
+                    Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+                    std::suspend_always initial_suspend() noexcept { return {}; }
+                    auto final_suspend() noexcept {
+                        struct FinalAwaiter {
+                            bool await_ready() const noexcept { return false; }
+                            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                                std::coroutine_handle<> continuation = handle.promise().continuation;
+                                return continuation ? continuation : std::noop_coroutine();
+                            }
+                            void await_resume() const noexcept {}
+                        };
+                        return FinalAwaiter{};
+                    }
+                    void return_value(T result) { value.emplace(std::move(result)); }
+                    void unhandled_exception() { exception = std::current_exception(); }
+                };
+
+                Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+                Task& operator=(Task&& other) noexcept {
+                    if (this != &other) {
+                        if (handle_) {
+                            handle_.destroy();
+                        }
+                        handle_ = std::exchange(other.handle_, {});
+                    }
+                    return *this;
+                }
+                Task(const Task&) = delete;
+                ~Task() {
+                    if (handle_) {
+                        handle_.destroy();
+                    }
+                }
+
+                auto operator co_await() noexcept {
+                    struct Awaiter {
+                        std::coroutine_handle<promise_type> handle;
+                        bool await_ready() const noexcept { return false; }
+                        std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept {
+                            handle.promise().continuation = continuation;
+                            return handle;
+                        }
+                        T await_resume() {
+                            if (handle.promise().exception) {
+                                std::rethrow_exception(handle.promise().exception);
+                            }
+                            return std::move(*handle.promise().value);
+                        }
+                    };
+                    return Awaiter{handle_};
+                }
+
+            private:
+                explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+                std::coroutine_handle<promise_type> handle_;
+            };
+
+            // Awaitable call of galaxy::client::async. The call is sent when awaited, and the awaiting coroutine is
+            // resumed on the default executor. T is absl::Status or an absl::StatusOr.
+            template <typename T>
+            class CallAwaiter {
+            public:
+                using Start = std::function<void(std::function<void(T)>)>;
+
+                CallAwaiter(Start start, CancellationToken token) : start_(std::move(start)), token_(std::move(token)) {}
+
+                bool await_ready() const noexcept { return token_.IsCancelled(); }
+                void await_suspend(std::coroutine_handle<> handle) {
+                    // The call may complete inline, and resume the coroutine before start returns, so nothing of this
+                    // awaiter is touched after starting the call.
+                    Start start = std::move(start_);
+                    internal::StartInGroup(token_, [&start, this, handle]() {
+                        start([this, handle](T result) {
+                            result_.emplace(std::move(result));
+                            Executor::Default()->Schedule(handle);
+                        });
+                    });
+                }
+                T await_resume() {
+                    if (token_.IsCancelled()) {
+                        return absl::CancelledError("Call cancelled.");
+                    }
+                    return std::move(*result_);
+                }
+
+            private:
+                Start start_;
+                CancellationToken token_;
+                std::optional<T> result_;
+            };
+
+            CallAwaiter<absl::StatusOr<std::string>> Read(const std::string& path, CancellationToken token = {});
+            CallAwaiter<absl::Status> Write(const std::string& path, const std::string& data, const std::string& mode = "w",
+                                            CancellationToken token = {});
+            CallAwaiter<absl::StatusOr<std::map<std::string, std::string>>> ListDirsInDir(const std::string& path,
+                                                                                          CancellationToken token = {});
+            CallAwaiter<absl::StatusOr<std::map<std::string, std::string>>> ListFilesInDir(const std::string& path, bool include_hidden = false,
+                                                                                           CancellationToken token = {});
+            CallAwaiter<absl::StatusOr<std::string>> GetAttr(const std::string& path, CancellationToken token = {});
+            CallAwaiter<absl::Status> CopyFile(const std::string& from_path, const std::string& to_path, CancellationToken token = {});
+
+            namespace internal {
+                // Eagerly started coroutine that destroys itself when it returns, used to drive tasks from plain code.
+                struct DetachedTask {
+                    struct promise_type {
+                        DetachedTask get_return_object() noexcept { return {}; }
+                        std::suspend_never initial_suspend() noexcept { return {}; }
+                        std::suspend_never final_suspend() noexcept { return {}; }
+                        void return_void() noexcept {}
+                        void unhandled_exception() noexcept { std::terminate(); }
+                    };
+                };
+
+                template <typename T, typename OnDone>
+                DetachedTask Drive(Task<T> task, OnDone on_done) {
+                    on_done(co_await task);
+                }
+
+                template <typename T>
+                class WhenAllAwaiter {
+                public:
+                    explicit WhenAllAwaiter(std::vector<Task<T>> tasks)
+                        : tasks_(std::move(tasks)), results_(tasks_.size()), remaining_(tasks_.size()) {}
+
+                    bool await_ready() const noexcept { return tasks_.empty(); }
+                    void await_suspend(std::coroutine_handle<> handle) {
+                        // The last task to finish may resume the awaiting coroutine, and destroy this awaiter, while
+                        // the loop is still running, so the loop only uses locals.
+                        size_t num_tasks = tasks_.size();
+                        Task<T>* tasks = tasks_.data();
+                        std::optional<T>* results = results_.data();
+                        std::atomic<size_t>* remaining = &remaining_;
+                        for (size_t i = 0; i < num_tasks; ++i) {
+                            Drive(std::move(tasks[i]), [results, remaining, handle, i](T result) {
+                                results[i].emplace(std::move(result));
+                                if (remaining->fetch_sub(1) == 1) {
+                                    Executor::Default()->Schedule(handle);
+                                }
+                            });
+                        }
+                    }
+                    std::vector<T> await_resume() {
+                        std::vector<T> results;
+                        results.reserve(results_.size());
+                        for (auto& result : results_) {
+                            results.push_back(std::move(*result));
+                        }
+                        return results;
+                    }
+
+                private:
+                    std::vector<Task<T>> tasks_;
+                    std::vector<std::optional<T>> results_;
+                    std::atomic<size_t> remaining_;
+                };
+            }  // namespace internal
+
+            // Runs the tasks concurrently and returns their results in order, once all of them are done.
+            template <typename T>
+            Task<std::vector<T>> WhenAll(std::vector<Task<T>> tasks) {
+                co_return co_await internal::WhenAllAwaiter<T>(std::move(tasks));
+            }
+
+            // Blocks the calling thread until the task is done. Entry point from plain code, never call it from a
+            // coroutine.
+            template <typename T>
+            T SyncWait(Task<T> task) {
+                auto promise = std::make_shared<std::promise<T>>();
+                std::future<T> future = promise->get_future();
+                internal::Drive(std::move(task), [promise](T result) { promise->set_value(std::move(result)); });
+                return future.get();
+            }
+        }  // namespace co
+    }  // namespace client
+} // namespace galaxy
+
+#endif // CPP_GALAXY_CO_CLIENT_H
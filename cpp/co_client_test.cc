@@ -0,0 +1,80 @@
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include "absl/flags/flag.h"
+#include "cpp/co_client.h"
+#include "cpp/core/galaxy_flag.h"
+
+namespace {
+    using galaxy::client::co::CancellationSource;
+    using galaxy::client::co::CancellationToken;
+    using galaxy::client::co::Task;
+
+    // Port on which connections are accepted by the kernel but never answered, so that calls stay in flight.
+    int ListenSilently() {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        EXPECT_EQ(bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+        EXPECT_EQ(listen(fd, 16), 0);
+        return fd;
+    }
+
+    int Port(int fd) {
+        sockaddr_in addr = {};
+        socklen_t len = sizeof(addr);
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+        return ntohs(addr.sin_port);
+    }
+
+    void WriteConfig(int port) {
+        std::string path = testing::TempDir() + "/galaxy_co_client_test_" + std::to_string(getpid()) + ".json";
+        std::ofstream file(path);
+        file << "{\"aa\": {\"fs_root\": \"" << testing::TempDir() << "\", \"fs_ip\": \"127.0.0.1\", \"fs_port\": " << port
+             << ", \"fs_stats_port\": 0, \"fs_password\": \"test\", \"fs_max_msg_size\": 64}}";
+        file.close();
+        absl::SetFlag(&FLAGS_fs_global_config, path);
+    }
+
+    Task<absl::StatusOr<std::string>> ReadWith(std::string path, CancellationToken token) {
+        co_return co_await galaxy::client::co::Read(path, token);
+    }
+
+    TEST(CoClientTest, CancelledBeforeSent) {
+        CancellationSource source;
+        source.Cancel();
+        EXPECT_TRUE(source.IsCancelled());
+        EXPECT_TRUE(source.Token().IsCancelled());
+        EXPECT_FALSE(CancellationToken().IsCancelled());
+        // Never sent, so the path does not need to resolve.
+        absl::StatusOr<std::string> result = galaxy::client::co::SyncWait(ReadWith("/galaxy/none-d/file", source.Token()));
+        EXPECT_TRUE(absl::IsCancelled(result.status())) << result.status();
+    }
+
+    TEST(CoClientTest, CancelsCallsInFlight) {
+        int fd = ListenSilently();
+        WriteConfig(Port(fd));
+        absl::SetFlag(&FLAGS_fs_rpc_ddl, 600);
+
+        CancellationSource source;
+        absl::StatusOr<std::string> result;
+        std::thread reader([&]() {
+            result = galaxy::client::co::SyncWait(ReadWith("/galaxy/aa-d/file", source.Token()));
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        // The call resumes once its channel cancels it, long before its deadline or a failed handshake.
+        auto start = std::chrono::steady_clock::now();
+        source.Cancel();
+        reader.join();
+        EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+        EXPECT_TRUE(absl::IsCancelled(result.status())) << result.status();
+        close(fd);
+    }
+}  // namespace
@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "cpp/core/galaxy_append.h"
+#include "cpp/internal/galaxy_const.h"
+#include "cpp/internal/galaxy_fs_internal.h"
+#include "glog/logging.h"
+
+namespace galaxy
+{
+    namespace
+    {
+        // Writes all the buffers, resuming after short writes.
+        absl::Status WriteAll(int fd, std::vector<struct iovec> &iov)
+        {
+            size_t next = 0;
+            while (next < iov.size())
+            {
+                int count = static_cast<int>(std::min<size_t>(iov.size() - next, IOV_MAX));
+                ssize_t written = writev(fd, &iov[next], count);
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    return absl::InternalError(std::string("writev failed with error ") + std::strerror(errno) + ".");
+                }
+                while (next < iov.size() && static_cast<size_t>(written) >= iov[next].iov_len)
+                {
+                    written -= iov[next].iov_len;
+                    ++next;
+                }
+                if (written > 0)
+                {
+                    iov[next].iov_base = static_cast<char *>(iov[next].iov_base) + written;
+                    iov[next].iov_len -= written;
+                }
+            }
+            return absl::OkStatus();
+        }
+    } // namespace
+
+    AppendCoalescer::Target::~Target()
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+
+    AppendCoalescer::AppendCoalescer(int sync_ms) : sync_ms_(sync_ms) {}
+
+    AppendCoalescer::~AppendCoalescer() = default;
+
+    absl::Status AppendCoalescer::Append(const std::string &path, const std::string &data)
+    {
+        std::shared_ptr<Target> target = GetTarget(path);
+        PendingAppend pending;
+        pending.data = &data;
+        std::unique_lock<std::mutex> lock(target->mu);
+        target->queue.push_back(&pending);
+        while (!pending.done)
+        {
+            if (target->writing)
+            {
+                target->cv.wait(lock);
+                continue;
+            }
+            // No batch is being written, so this call writes the appends queued so far, its own included.
+            target->writing = true;
+            if (sync_ms_ > 0)
+            {
+                lock.unlock();
+                absl::SleepFor(absl::Milliseconds(sync_ms_));
+                lock.lock();
+            }
+            std::vector<PendingAppend *> batch;
+            batch.swap(target->queue);
+            lock.unlock();
+            absl::Status status = WriteBatch(path, *target, batch);
+            lock.lock();
+            for (PendingAppend *append : batch)
+            {
+                append->status = status;
+                append->done = true;
+            }
+            target->writing = false;
+            target->cv.notify_all();
+        }
+        return pending.status;
+    }
+
+    std::shared_ptr<AppendCoalescer::Target> AppendCoalescer::GetTarget(const std::string &path)
+    {
+        int64_t now_sec = absl::ToUnixSeconds(absl::Now());
+        std::lock_guard<std::mutex> lock(mu_);
+        if (now_sec != last_evict_sec_ || targets_.size() > static_cast<size_t>(galaxy::constant::kAppendMaxOpenFiles))
+        {
+            EvictTargets(now_sec);
+            last_evict_sec_ = now_sec;
+        }
+        std::shared_ptr<Target> &target = targets_[path];
+        if (!target)
+        {
+            target = std::make_shared<Target>();
+        }
+        target->last_used_sec = now_sec;
+        return target;
+    }
+
+    void AppendCoalescer::EvictTargets(int64_t now_sec)
+    {
+        // Targets held by a call have a use count above one, and are never evicted, so that the appends to a file
+        // always meet in the same queue.
+        std::vector<std::pair<int64_t, std::string>> unused;
+        for (const auto &val : targets_)
+        {
+            if (val.second.use_count() == 1)
+            {
+                unused.emplace_back(val.second->last_used_sec, val.first);
+            }
+        }
+        std::sort(unused.begin(), unused.end());
+        size_t num_targets = targets_.size();
+        for (const auto &val : unused)
+        {
+            if (now_sec - val.first < galaxy::constant::kAppendFdIdleSec &&
+                num_targets <= static_cast<size_t>(galaxy::constant::kAppendMaxOpenFiles))
+            {
+                break;
+            }
+            targets_.erase(val.second);
+            --num_targets;
+        }
+    }
+
+    absl::Status AppendCoalescer::WriteBatch(const std::string &path, Target &target, const std::vector<PendingAppend *> &batch)
+    {
+        impl::Lock(path);
+        absl::Status status;
+        struct stat path_stat;
+        struct stat fd_stat;
+        if (internal::UnshareFile(path, true) != 0)
+        {
+            status = absl::InternalError("Unsharing file " + path + " failed.");
+        }
+        else if (!internal::ExistFile(path) && !impl::CreateFileIfNotExist(path, 0777).ok())
+        {
+            status = absl::InternalError("Creating file " + path + " failed.");
+        }
+        else if (target.fd < 0 || stat(path.c_str(), &path_stat) != 0 || fstat(target.fd, &fd_stat) != 0 ||
+                 path_stat.st_ino != fd_stat.st_ino || path_stat.st_dev != fd_stat.st_dev)
+        {
+            // The file was removed, renamed over or unshared since the descriptor was opened.
+            if (target.fd >= 0)
+            {
+                close(target.fd);
+            }
+            target.fd = open(path.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+            if (target.fd < 0)
+            {
+                status = absl::InternalError("Opening file " + path + " failed with error " + std::strerror(errno) + ".");
+            }
+        }
+        if (status.ok())
+        {
+            std::vector<struct iovec> iov;
+            iov.reserve(batch.size());
+            for (const PendingAppend *append : batch)
+            {
+                if (!append->data->empty())
+                {
+                    iov.push_back({const_cast<char *>(append->data->data()), append->data->size()});
+                }
+            }
+            status = WriteAll(target.fd, iov);
+            if (status.ok() && sync_ms_ >= 0 && fdatasync(target.fd) != 0)
+            {
+                status = absl::InternalError("Syncing file " + path + " failed with error " + std::strerror(errno) + ".");
+            }
+        }
+        impl::Unlock(path);
+        if (!status.ok())
+        {
+            LOG(ERROR) << "Fail to append " << batch.size() << " writes to " << path << " with error " << status;
+        }
+        else
+        {
+            VLOG(2) << "Appended " << batch.size() << " writes to " << path << ".";
+        }
+        return status;
+    }
+} //  namespace galaxy.
@@ -0,0 +1,63 @@
+#ifndef CPP_CORE_GALAXY_APPEND_H_
+#define CPP_CORE_GALAXY_APPEND_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+
+namespace galaxy
+{
+    // Write path of the appends of a cell. Concurrent appends to the same file are merged into a single writev under
+    // a single cycle of its lock file, and the descriptors of recent append targets are kept open for
+    // kAppendFdIdleSec. Each append is still acknowledged with its own status, once its data is written.
+    class AppendCoalescer
+    {
+    public:
+        // With a non-negative sync_ms, appends are acknowledged only once fdatasync'ed, and a batch waits sync_ms for
+        // more appends to join it so that they share one fdatasync. A negative sync_ms never syncs.
+        explicit AppendCoalescer(int sync_ms);
+        AppendCoalescer(const AppendCoalescer&) = delete;
+        ~AppendCoalescer();
+
+        // Appends data to path, creating it if needed. Blocks until data is written.
+        absl::Status Append(const std::string &path, const std::string &data);
+
+    private:
+        struct PendingAppend
+        {
+            const std::string *data;
+            absl::Status status;
+            bool done = false;
+        };
+
+        // An append target. The descriptor is only used by the thread writing the current batch.
+        struct Target
+        {
+            ~Target();
+
+            std::mutex mu;
+            std::condition_variable cv;
+            std::vector<PendingAppend *> queue;
+            bool writing = false;
+            int fd = -1;
+            int64_t last_used_sec = 0;
+        };
+
+        std::shared_ptr<Target> GetTarget(const std::string &path);
+        // Writes the batch to path under its lock file, reopening the descriptor if path was replaced since.
+        absl::Status WriteBatch(const std::string &path, Target &target, const std::vector<PendingAppend *> &batch);
+        // Drops the targets that are idle, or the least recently used ones when there are too many. Requires mu_.
+        void EvictTargets(int64_t now_sec);
+
+        const int sync_ms_;
+        std::mutex mu_;
+        absl::flat_hash_map<std::string, std::shared_ptr<Target>> targets_;
+        int64_t last_evict_sec_ = 0;
+    };
+} //  namespace galaxy.
+#endif   //  CPP_CORE_GALAXY_APPEND_H_
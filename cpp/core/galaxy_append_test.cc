@@ -0,0 +1,99 @@
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "cpp/core/galaxy_append.h"
+#include "cpp/internal/galaxy_fs_internal.h"
+
+namespace {
+    using galaxy::AppendCoalescer;
+    using galaxy::internal::JoinPath;
+
+    std::string NewRoot(const std::string& name) {
+        std::string root = JoinPath(testing::TempDir(), absl::StrCat("galaxy_append_test_", getpid(), "_", name));
+        EXPECT_TRUE(galaxy::impl::CreateDirIfNotExist(root, 0777).ok());
+        return root;
+    }
+
+    std::string ReadFile(const std::string& path) {
+        std::stringstream data;
+        data << std::ifstream(path).rdbuf();
+        return data.str();
+    }
+
+    // Appends lines from several threads at once, and checks that each one landed whole and in order per thread.
+    void AppendConcurrently(int sync_ms, const std::string& path) {
+        AppendCoalescer coalescer(sync_ms);
+        const int num_threads = 8;
+        const int num_lines = 50;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([&coalescer, &path, t]() {
+                for (int i = 0; i < num_lines; i++) {
+                    // Long enough that interleaved writes would split them.
+                    std::string line = absl::StrCat(t, " ", i, " ", std::string(1000 + t, 'x'), "\n");
+                    EXPECT_TRUE(coalescer.Append(path, line).ok());
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        std::map<int, int> next;
+        int num_found = 0;
+        for (absl::string_view line : absl::StrSplit(ReadFile(path), '\n', absl::SkipEmpty())) {
+            std::vector<std::string> fields = absl::StrSplit(line, ' ');
+            ASSERT_EQ(fields.size(), 3);
+            int t = std::stoi(fields[0]);
+            EXPECT_EQ(std::stoi(fields[1]), next[t]++);
+            EXPECT_EQ(fields[2], std::string(1000 + t, 'x'));
+            num_found++;
+        }
+        EXPECT_EQ(num_found, num_threads * num_lines);
+    }
+
+    TEST(AppendCoalescerTest, ConcurrentAppends) {
+        AppendConcurrently(-1, JoinPath(NewRoot("concurrent"), "log"));
+    }
+
+    TEST(AppendCoalescerTest, ConcurrentSyncedAppends) {
+        AppendConcurrently(1, JoinPath(NewRoot("synced"), "log"));
+    }
+
+    TEST(AppendCoalescerTest, CreatesAndFollowsReplacedFile) {
+        std::string root = NewRoot("replaced");
+        std::string path = JoinPath(root, "log");
+        AppendCoalescer coalescer(-1);
+        ASSERT_TRUE(coalescer.Append(path, "a\n").ok());
+        EXPECT_EQ(ReadFile(path), "a\n");
+
+        // Rotated, so the next append goes to the file now at path rather than through the cached descriptor.
+        std::string rotated = JoinPath(root, "log.1");
+        ASSERT_EQ(rename(path.c_str(), rotated.c_str()), 0);
+        ASSERT_TRUE(coalescer.Append(path, "b\n").ok());
+        EXPECT_EQ(ReadFile(path), "b\n");
+        EXPECT_EQ(ReadFile(rotated), "a\n");
+
+        ASSERT_EQ(unlink(path.c_str()), 0);
+        ASSERT_TRUE(coalescer.Append(path, "").ok());
+        ASSERT_TRUE(coalescer.Append(path, "c\n").ok());
+        EXPECT_EQ(ReadFile(path), "c\n");
+    }
+
+    TEST(AppendCoalescerTest, Failure) {
+        std::string root = NewRoot("failure");
+        std::string file = JoinPath(root, "file");
+        std::ofstream(file) << "x";
+        AppendCoalescer coalescer(-1);
+        // Under a file, so neither it nor its lock can be created.
+        EXPECT_FALSE(coalescer.Append(JoinPath(file, "log"), "a").ok());
+        EXPECT_TRUE(coalescer.Append(JoinPath(root, "log"), "a").ok());
+    }
+}  // namespace
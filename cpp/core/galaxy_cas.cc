@@ -0,0 +1,191 @@
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <linux/fs.h>
+
+#include "cpp/core/galaxy_cas.h"
+#include "cpp/internal/galaxy_const.h"
+#include "cpp/internal/galaxy_fs_internal.h"
+#include "cpp/util/galaxy_hash.h"
+#include "glog/logging.h"
+
+namespace galaxy
+{
+    namespace
+    {
+        // Hidden sibling of path, so that listings skip it and the final rename stays within one filesystem.
+        std::string TempPath(const std::string &path)
+        {
+            absl::StatusOr<std::string> dir = internal::GetFileAbsDir(path);
+            absl::StatusOr<std::string> name = internal::GetFileName(path);
+            return internal::JoinPath(*dir, "." + *name + ".cas_tmp");
+        }
+
+        // Creates tmp_path sharing the data of blob_path: a reflink if the filesystem supports it, a hardlink otherwise.
+        bool CloneOrLink(const std::string &blob_path, const std::string &tmp_path)
+        {
+#ifdef FICLONE
+            int src = open(blob_path.c_str(), O_RDONLY);
+            if (src >= 0)
+            {
+                struct stat statbuf;
+                fstat(src, &statbuf);
+                int dst = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL, statbuf.st_mode & 0777);
+                bool cloned = dst >= 0 && ioctl(dst, FICLONE, src) == 0;
+                if (dst >= 0)
+                {
+                    close(dst);
+                }
+                close(src);
+                if (cloned)
+                {
+                    return true;
+                }
+                unlink(tmp_path.c_str());
+            }
+#endif
+            return link(blob_path.c_str(), tmp_path.c_str()) == 0;
+        }
+    } // namespace
+
+    GalaxyCas::GalaxyCas(const std::string &fs_root) : root_(internal::JoinPath(fs_root, galaxy::constant::kCasDir)) {}
+
+    std::string GalaxyCas::BlobPath(const std::string &hash) const
+    {
+        return internal::JoinPath(internal::JoinPath(root_, hash.substr(0, 2)), hash);
+    }
+
+    bool GalaxyCas::HasBlob(const std::string &hash) const
+    {
+        return util::IsValidHash(hash) && internal::ExistFile(BlobPath(hash));
+    }
+
+    absl::Status GalaxyCas::LinkBlob(const std::string &hash, const std::string &path)
+    {
+        if (!util::IsValidHash(hash))
+        {
+            return absl::InvalidArgumentError("Invalid content hash " + hash + ".");
+        }
+        std::string blob_path = BlobPath(hash);
+        if (!internal::ExistFile(blob_path))
+        {
+            return absl::NotFoundError("Blob " + hash + " does not exist.");
+        }
+        absl::StatusOr<std::string> dir = internal::GetFileAbsDir(path);
+        if (!dir.ok() || !impl::CreateDirIfNotExist(*dir, 0777).ok())
+        {
+            return absl::InternalError("LinkBlob failed for " + path + " because dir creation failed.");
+        }
+        std::string tmp_path = TempPath(path);
+        unlink(tmp_path.c_str());
+        if (!CloneOrLink(blob_path, tmp_path))
+        {
+            return absl::InternalError("Linking blob " + hash + " to " + path + " failed with error " + strerror(errno) + ".");
+        }
+        if (rename(tmp_path.c_str(), path.c_str()) != 0)
+        {
+            unlink(tmp_path.c_str());
+            return absl::InternalError("Renaming " + tmp_path + " to " + path + " failed with error " + strerror(errno) + ".");
+        }
+        // Only refresh the access time, the modification time is shared by every hardlink of the blob.
+        struct timespec times[2] = {{0, UTIME_NOW}, {0, UTIME_OMIT}};
+        utimensat(AT_FDCWD, blob_path.c_str(), times, 0);
+        VLOG(1) << "Linked blob " << hash << " to " << path << ".";
+        return absl::OkStatus();
+    }
+
+    absl::Status GalaxyCas::Adopt(const std::string &path, const std::string &hash)
+    {
+        if (!util::IsValidHash(hash))
+        {
+            return absl::InvalidArgumentError("Invalid content hash " + hash + ".");
+        }
+        struct stat file_stat;
+        if (stat(path.c_str(), &file_stat) != 0)
+        {
+            return absl::NotFoundError("Path " + path + " does not exist for Adopt.");
+        }
+        std::string blob_path = BlobPath(hash);
+        struct stat blob_stat;
+        if (stat(blob_path.c_str(), &blob_stat) == 0)
+        {
+            if (blob_stat.st_dev == file_stat.st_dev && blob_stat.st_ino == file_stat.st_ino)
+            {
+                return absl::OkStatus();
+            }
+            if (blob_stat.st_size != file_stat.st_size)
+            {
+                LOG(ERROR) << "Blob " << hash << " does not match the size of " << path << ".";
+                return absl::DataLossError("Blob " + hash + " does not match the size of " + path + ".");
+            }
+            // Drop the duplicated content of path in favor of the existing blob.
+            return LinkBlob(hash, path);
+        }
+
+        absl::StatusOr<std::string> blob_dir = internal::GetFileAbsDir(blob_path);
+        if (!blob_dir.ok() || !impl::CreateDirIfNotExist(*blob_dir, 0777).ok())
+        {
+            return absl::InternalError("Creating the blob directory for " + hash + " failed.");
+        }
+        if (link(path.c_str(), blob_path.c_str()) == 0)
+        {
+            VLOG(1) << "Stored " << path << " as blob " << hash << ".";
+            return absl::OkStatus();
+        }
+        if (errno == EEXIST)
+        {
+            // Another writer stored the same content in the meantime.
+            return LinkBlob(hash, path);
+        }
+        return absl::InternalError("Storing blob " + hash + " failed with error " + strerror(errno) + ".");
+    }
+
+    int GalaxyCas::CollectGarbage()
+    {
+        int num_removed = 0;
+        time_t now = time(nullptr);
+        DIR *root_dirp = opendir(root_.c_str());
+        if (root_dirp == NULL)
+        {
+            return 0;
+        }
+        struct dirent *root_dp;
+        while ((root_dp = readdir(root_dirp)) != NULL)
+        {
+            if (root_dp->d_name[0] == '.')
+            {
+                continue;
+            }
+            std::string prefix_dir = internal::JoinPath(root_, root_dp->d_name);
+            DIR *dirp = opendir(prefix_dir.c_str());
+            if (dirp == NULL)
+            {
+                continue;
+            }
+            struct dirent *dp;
+            while ((dp = readdir(dirp)) != NULL)
+            {
+                std::string blob_path = internal::JoinPath(prefix_dir, dp->d_name);
+                struct stat statbuf;
+                if (dp->d_name[0] == '.' || stat(blob_path.c_str(), &statbuf) != 0 || !S_ISREG(statbuf.st_mode))
+                {
+                    continue;
+                }
+                if (statbuf.st_nlink == 1 && now - statbuf.st_atime > galaxy::constant::kCasGcAgeSec &&
+                    unlink(blob_path.c_str()) == 0)
+                {
+                    num_removed++;
+                }
+            }
+            closedir(dirp);
+        }
+        closedir(root_dirp);
+        return num_removed;
+    }
+} // namespace galaxy
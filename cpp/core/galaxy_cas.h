@@ -0,0 +1,32 @@
+#ifndef CPP_CORE_GALAXY_CAS_H_
+#define CPP_CORE_GALAXY_CAS_H_
+
+#include <string>
+#include "absl/status/status.h"
+
+namespace galaxy
+{
+    // Content-addressed blob store of a cell, under <fs_root>/.galaxy_cas/<hash[0:2]>/<hash>. Files with the same
+    // content share one blob through a reflink (FICLONE) when the filesystem supports it, or a hardlink otherwise.
+    // Hardlinked files are never modified in place (see impl::Write), so a write to one path does not leak to the others.
+    class GalaxyCas
+    {
+    public:
+        explicit GalaxyCas(const std::string& fs_root);
+        GalaxyCas(const GalaxyCas&) = delete;
+
+        std::string BlobPath(const std::string& hash) const;
+        bool HasBlob(const std::string& hash) const;
+
+        // Replaces path with the content of the blob of hash.
+        absl::Status LinkBlob(const std::string& hash, const std::string& path);
+        // Deduplicates a file that was just written with content hashing to hash. Callers must hold the lock of path.
+        absl::Status Adopt(const std::string& path, const std::string& hash);
+        // Removes blobs that no file links to anymore and that were not used in the last kCasGcAgeSec.
+        int CollectGarbage();
+
+    private:
+        std::string root_;
+    };
+} //  namespace galaxy.
+#endif   //  CPP_CORE_GALAXY_CAS_H_
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "cpp/core/galaxy_exec.h"
+#include "glog/logging.h"
+
+extern char **environ;
+
+namespace galaxy
+{
+    namespace
+    {
+        // Interval of the checks for the exit of a command that closed its output early.
+        constexpr int kExitPollMs = 50;
+        constexpr size_t kReadSize = 65536;
+
+        absl::Status ErrnoStatus(const std::string &message, int error_number)
+        {
+            return absl::InternalError(absl::StrCat(message, " with error ", std::strerror(error_number), "."));
+        }
+
+        void ClosePipe(int fds[2])
+        {
+            for (int i = 0; i < 2; ++i)
+            {
+                if (fds[i] >= 0)
+                {
+                    close(fds[i]);
+                }
+            }
+        }
+    } // namespace
+
+    Subprocess::~Subprocess()
+    {
+        if (pid_ > 0 && !exited_)
+        {
+            Terminate(absl::ZeroDuration());
+        }
+        if (out_fd_ >= 0)
+        {
+            close(out_fd_);
+        }
+        if (err_fd_ >= 0)
+        {
+            close(err_fd_);
+        }
+    }
+
+    absl::Status Subprocess::Start(const std::string &cmd)
+    {
+        int out_pipe[2] = {-1, -1};
+        int err_pipe[2] = {-1, -1};
+        if (pipe2(out_pipe, O_CLOEXEC) != 0 || pipe2(err_pipe, O_CLOEXEC) != 0)
+        {
+            int error_number = errno;
+            ClosePipe(out_pipe);
+            ClosePipe(err_pipe);
+            return ErrnoStatus("Fail to create pipes for " + cmd, error_number);
+        }
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+        posix_spawn_file_actions_adddup2(&actions, out_pipe[1], STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, err_pipe[1], STDERR_FILENO);
+        // Its own process group, so that Terminate also reaches whatever the command starts, and without the signal
+        // mask and dispositions of the server threads, e.g. SIGPIPE ignored by gRPC.
+        posix_spawnattr_t attr;
+        posix_spawnattr_init(&attr);
+        posix_spawnattr_setpgroup(&attr, 0);
+        sigset_t mask;
+        sigemptyset(&mask);
+        posix_spawnattr_setsigmask(&attr, &mask);
+        sigset_t defaults;
+        sigemptyset(&defaults);
+        for (int sig : {SIGPIPE, SIGHUP, SIGINT, SIGQUIT, SIGTERM, SIGCHLD})
+        {
+            sigaddset(&defaults, sig);
+        }
+        posix_spawnattr_setsigdefault(&attr, &defaults);
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+        const char *argv[] = {"/bin/sh", "-c", cmd.c_str(), nullptr};
+        int error_number = posix_spawn(&pid_, "/bin/sh", &actions, &attr, const_cast<char *const *>(argv), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        posix_spawnattr_destroy(&attr);
+        close(out_pipe[1]);
+        close(err_pipe[1]);
+        if (error_number != 0)
+        {
+            pid_ = -1;
+            close(out_pipe[0]);
+            close(err_pipe[0]);
+            return ErrnoStatus("Fail to spawn " + cmd, error_number);
+        }
+        start_time_ = absl::Now();
+        out_fd_ = out_pipe[0];
+        err_fd_ = err_pipe[0];
+        fcntl(out_fd_, F_SETFL, fcntl(out_fd_, F_GETFL) | O_NONBLOCK);
+        fcntl(err_fd_, F_SETFL, fcntl(err_fd_, F_GETFL) | O_NONBLOCK);
+        return absl::OkStatus();
+    }
+
+    bool Subprocess::Poll(absl::Duration timeout, size_t max_bytes, std::string *out, std::string *err)
+    {
+        size_t budget = max_bytes;
+        if (!exited_)
+        {
+            int wait_ms = static_cast<int>(std::min<int64_t>(absl::ToInt64Milliseconds(timeout), 60000));
+            struct pollfd fds[2];
+            int num_fds = 0;
+            for (int fd : {out_fd_, err_fd_})
+            {
+                if (fd >= 0)
+                {
+                    fds[num_fds++] = {fd, POLLIN, 0};
+                }
+            }
+            if (num_fds == 0)
+            {
+                usleep(std::min(wait_ms, kExitPollMs) * 1000);
+            }
+            else
+            {
+                poll(fds, num_fds, wait_ms);
+            }
+            if (!Drain(&out_fd_, out, &budget) || !Drain(&err_fd_, err, &budget) || !Reap(false))
+            {
+                return false;
+            }
+        }
+        // What was written right before the exit. Processes left behind by the command may still hold the pipes
+        // open, so only what is already there is read.
+        return Drain(&out_fd_, out, &budget) && Drain(&err_fd_, err, &budget);
+    }
+
+    void Subprocess::Terminate(absl::Duration grace)
+    {
+        if (pid_ <= 0 || exited_)
+        {
+            return;
+        }
+        kill(-pid_, SIGTERM);
+        absl::Time deadline = absl::Now() + grace;
+        while (!Reap(false))
+        {
+            if (absl::Now() >= deadline)
+            {
+                LOG(WARNING) << "Command " << pid_ << " was killed after not stopping within " << grace << ".";
+                kill(-pid_, SIGKILL);
+                Reap(true);
+                break;
+            }
+            usleep(kExitPollMs * 1000);
+        }
+    }
+
+    bool Subprocess::Reap(bool block)
+    {
+        int status = 0;
+        struct rusage usage;
+        while (true)
+        {
+            pid_t pid = wait4(pid_, &status, block ? 0 : WNOHANG, &usage);
+            if (pid == 0)
+            {
+                return false;
+            }
+            if (pid < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (pid < 0)
+            {
+                // Reaped elsewhere, e.g. by a SIGCHLD handler, so its status is lost.
+                LOG(ERROR) << "Fail to wait for command " << pid_ << " with error " << std::strerror(errno) << ".";
+            }
+            else
+            {
+                exit_.usage = usage;
+                if (WIFEXITED(status))
+                {
+                    exit_.exit_code = WEXITSTATUS(status);
+                }
+                else if (WIFSIGNALED(status))
+                {
+                    exit_.term_signal = WTERMSIG(status);
+                }
+            }
+            exit_.wall_time = absl::Now() - start_time_;
+            exited_ = true;
+            return true;
+        }
+    }
+
+    bool Subprocess::Drain(int *fd, std::string *data, size_t *budget)
+    {
+        while (*fd >= 0)
+        {
+            if (*budget == 0)
+            {
+                return false;
+            }
+            size_t size = data->size();
+            size_t to_read = std::min(*budget, kReadSize);
+            data->resize(size + to_read);
+            ssize_t num_read = read(*fd, &(*data)[size], to_read);
+            data->resize(size + std::max<ssize_t>(num_read, 0));
+            if (num_read > 0)
+            {
+                *budget -= num_read;
+                continue;
+            }
+            if (num_read < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (num_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                return true;
+            }
+            close(*fd);
+            *fd = -1;
+        }
+        return true;
+    }
+} // namespace galaxy
@@ -0,0 +1,58 @@
+#ifndef CPP_CORE_GALAXY_EXEC_H_
+#define CPP_CORE_GALAXY_EXEC_H_
+
+#include <string>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include "absl/status/status.h"
+#include "absl/time/time.h"
+
+namespace galaxy
+{
+    // Runs a shell command in a process group of its own, with its stdout and stderr piped back to be read while it
+    // runs, e.g. by the server for RemoteExecutionStream. The process is spawned with posix_spawn rather than fork,
+    // so that the pages of a large multi-threaded server are not copied or locked for it.
+    class Subprocess
+    {
+    public:
+        struct Exit
+        {
+            // Exit code of the command, -1 if it was killed by a signal.
+            int exit_code = -1;
+            // Signal that killed the command, 0 if it exited.
+            int term_signal = 0;
+            // Resources used by the command and the children it waited for.
+            struct rusage usage = {};
+            absl::Duration wall_time;
+        };
+
+        Subprocess() = default;
+        // Kills the process group if the command is still running.
+        ~Subprocess();
+        Subprocess(const Subprocess&) = delete;
+
+        // Runs cmd with /bin/sh -c, with stdin from /dev/null.
+        absl::Status Start(const std::string &cmd);
+        // Appends the output produced so far to out and err, up to max_bytes in total, waiting up to timeout for
+        // some. Returns true once the command exited and all of its output was read.
+        bool Poll(absl::Duration timeout, size_t max_bytes, std::string *out, std::string *err);
+        // Stops the command and the processes it started with SIGTERM, then with SIGKILL after grace.
+        void Terminate(absl::Duration grace);
+        // Valid once Poll returned true, or after Terminate.
+        const Exit &exit() const { return exit_; }
+
+    private:
+        // Reaps the command if it exited, without waiting unless block is set.
+        bool Reap(bool block);
+        // Reads what is available on *fd, closing it at its end. Returns false if max_bytes were read.
+        bool Drain(int *fd, std::string *data, size_t *budget);
+
+        pid_t pid_ = -1;
+        int out_fd_ = -1;
+        int err_fd_ = -1;
+        bool exited_ = false;
+        absl::Time start_time_;
+        Exit exit_;
+    };
+} //  namespace galaxy.
+#endif   //  CPP_CORE_GALAXY_EXEC_H_
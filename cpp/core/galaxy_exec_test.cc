@@ -0,0 +1,85 @@
+#include <csignal>
+#include <string>
+#include <gtest/gtest.h>
+#include "absl/time/clock.h"
+#include "cpp/core/galaxy_exec.h"
+
+namespace {
+    using galaxy::Subprocess;
+
+    // Polls cmd to its end, with its output.
+    const Subprocess::Exit& RunToEnd(Subprocess& process, const std::string& cmd, std::string* out, std::string* err) {
+        EXPECT_TRUE(process.Start(cmd).ok());
+        absl::Time deadline = absl::Now() + absl::Seconds(30);
+        while (!process.Poll(absl::Milliseconds(100), 1 << 20, out, err) && absl::Now() < deadline) {
+        }
+        return process.exit();
+    }
+
+    TEST(SubprocessTest, CollectsOutputAndExitCode) {
+        Subprocess process;
+        std::string out;
+        std::string err;
+        const Subprocess::Exit& exit = RunToEnd(process, "echo out; echo err >&2; exit 3", &out, &err);
+        EXPECT_EQ(out, "out\n");
+        EXPECT_EQ(err, "err\n");
+        EXPECT_EQ(exit.exit_code, 3);
+        EXPECT_EQ(exit.term_signal, 0);
+        EXPECT_GT(exit.wall_time, absl::ZeroDuration());
+    }
+
+    TEST(SubprocessTest, StdinIsEmpty) {
+        Subprocess process;
+        std::string out;
+        std::string err;
+        EXPECT_EQ(RunToEnd(process, "cat; echo done", &out, &err).exit_code, 0);
+        EXPECT_EQ(out, "done\n");
+    }
+
+    TEST(SubprocessTest, OutputLargerThanPipe) {
+        Subprocess process;
+        std::string out;
+        std::string err;
+        EXPECT_EQ(RunToEnd(process, "head -c 1000000 /dev/zero", &out, &err).exit_code, 0);
+        EXPECT_EQ(out.size(), 1000000);
+    }
+
+    TEST(SubprocessTest, PollRespectsMaxBytes) {
+        Subprocess process;
+        ASSERT_TRUE(process.Start("head -c 1000 /dev/zero").ok());
+        std::string out;
+        std::string err;
+        absl::Time deadline = absl::Now() + absl::Seconds(30);
+        bool done = false;
+        while (!done && absl::Now() < deadline) {
+            size_t before = out.size();
+            done = process.Poll(absl::Milliseconds(100), 100, &out, &err);
+            EXPECT_LE(out.size() - before, 100);
+        }
+        EXPECT_TRUE(done);
+        EXPECT_EQ(out.size(), 1000);
+    }
+
+    TEST(SubprocessTest, TerminateKillsProcessGroup) {
+        Subprocess process;
+        // The trap keeps the shell alive after SIGTERM, so SIGKILL is needed, and the sleep is a child of its own.
+        ASSERT_TRUE(process.Start("trap '' TERM; sleep 60 & wait").ok());
+        std::string out;
+        std::string err;
+        EXPECT_FALSE(process.Poll(absl::Milliseconds(100), 1024, &out, &err));
+        absl::Time start = absl::Now();
+        process.Terminate(absl::Milliseconds(200));
+        EXPECT_LT(absl::Now() - start, absl::Seconds(30));
+        EXPECT_EQ(process.exit().exit_code, -1);
+        EXPECT_EQ(process.exit().term_signal, SIGKILL);
+    }
+
+    TEST(SubprocessTest, TerminatedBySignal) {
+        Subprocess process;
+        std::string out;
+        std::string err;
+        const Subprocess::Exit& exit = RunToEnd(process, "kill -USR1 $$", &out, &err);
+        EXPECT_EQ(exit.exit_code, -1);
+        EXPECT_EQ(exit.term_signal, SIGUSR1);
+    }
+}  // namespace
@@ -0,0 +1,317 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "absl/strings/match.h"
+#include "absl/time/clock.h"
+#include "cpp/core/galaxy_fd_cache.h"
+#include "cpp/internal/galaxy_const.h"
+#include "cpp/internal/galaxy_fs_internal.h"
+#include "glog/logging.h"
+
+namespace galaxy
+{
+    namespace
+    {
+        // Negative entries are only recorded in directories left unmodified for this long, so that a name created
+        // within the granularity of the modification time cannot hide behind an unchanged one.
+        constexpr absl::Duration kMissingMinAge = absl::Seconds(1);
+        constexpr size_t kMaxMissingPerDir = 64;
+
+        std::string ParentDir(const std::string &dir)
+        {
+            size_t pos = dir.find_last_of('/');
+            if (pos == std::string::npos)
+            {
+                return ".";
+            }
+            return pos == 0 ? "/" : dir.substr(0, pos);
+        }
+
+        absl::Status OpenError(const std::string &path)
+        {
+            std::string message = "Opening directory " + path + " failed with error " + std::strerror(errno) + ".";
+            return errno == ENOENT || errno == ENOTDIR ? absl::NotFoundError(message) : absl::InternalError(message);
+        }
+    } // namespace
+
+    CachedFd::~CachedFd()
+    {
+        close(fd_);
+    }
+
+    FdCache::FdCache(size_t capacity) : capacity_(capacity) {}
+
+    absl::StatusOr<std::shared_ptr<CachedFd>> FdCache::Get(const std::string &path, struct stat *statbuf, int dir_fd,
+                                                           const std::string &name)
+    {
+        const char *at_name = dir_fd == AT_FDCWD ? path.c_str() : name.c_str();
+        if (fstatat(dir_fd, at_name, statbuf, 0) != 0 || !S_ISREG(statbuf->st_mode))
+        {
+            Invalidate(path);
+            return absl::NotFoundError("Path " + path + " is not a file.");
+        }
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            auto entry = entries_.find(path);
+            if (entry != entries_.end())
+            {
+                if (entry->second->second->Matches(*statbuf))
+                {
+                    lru_.splice(lru_.begin(), lru_, entry->second);
+                    return entry->second->second;
+                }
+                // The path was replaced since it was cached.
+                lru_.erase(entry->second);
+                entries_.erase(entry);
+            }
+        }
+        bool writable = true;
+        int fd = openat(dir_fd, at_name, O_RDWR | O_CLOEXEC);
+        if (fd < 0 && errno == EACCES)
+        {
+            writable = false;
+            fd = openat(dir_fd, at_name, O_RDONLY | O_CLOEXEC);
+        }
+        if (fd < 0)
+        {
+            return absl::InternalError("Opening " + path + " failed with error " + std::strerror(errno) + ".");
+        }
+        // The descriptor is what gets cached, so its own stat is the one kept, in case the path changed since.
+        if (fstat(fd, statbuf) != 0)
+        {
+            close(fd);
+            return absl::InternalError("Stating " + path + " failed with error " + std::strerror(errno) + ".");
+        }
+        auto cached_fd = std::make_shared<CachedFd>(fd, writable, statbuf->st_dev, statbuf->st_ino);
+        std::lock_guard<std::mutex> lock(mu_);
+        auto entry = entries_.find(path);
+        if (entry != entries_.end())
+        {
+            lru_.erase(entry->second);
+            entries_.erase(entry);
+        }
+        lru_.emplace_front(path, cached_fd);
+        entries_[path] = lru_.begin();
+        while (lru_.size() > capacity_)
+        {
+            // Callers still using the evicted descriptor keep it open until they are done.
+            entries_.erase(lru_.back().first);
+            lru_.pop_back();
+        }
+        return cached_fd;
+    }
+
+    void FdCache::Invalidate(const std::string &path, bool is_dir)
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (!is_dir)
+        {
+            auto entry = entries_.find(path);
+            if (entry != entries_.end())
+            {
+                lru_.erase(entry->second);
+                entries_.erase(entry);
+            }
+            return;
+        }
+        std::string prefix = absl::EndsWith(path, "/") ? path : path + "/";
+        for (auto it = lru_.begin(); it != lru_.end();)
+        {
+            if (absl::StartsWith(it->first, prefix))
+            {
+                entries_.erase(it->first);
+                it = lru_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    DirCache::DirCache(size_t capacity) : capacity_(capacity) {}
+
+    absl::StatusOr<std::shared_ptr<CachedFd>> DirCache::Get(const std::string &dir, bool create, mode_t mode)
+    {
+        std::string key = dir;
+        while (key.size() > 1 && key.back() == '/')
+        {
+            key.pop_back();
+        }
+        if (key.empty())
+        {
+            key = ".";
+        }
+        std::shared_ptr<CachedFd> cached;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            auto entry = entries_.find(key);
+            if (entry != entries_.end())
+            {
+                lru_.splice(lru_.begin(), lru_, entry->second);
+                if (absl::Now() - entry->second->second.validated < absl::Milliseconds(galaxy::constant::kDirCacheRevalidateMs))
+                {
+                    return entry->second->second.fd;
+                }
+                cached = entry->second->second.fd;
+            }
+        }
+        if (cached)
+        {
+            struct stat statbuf;
+            if (stat(key.c_str(), &statbuf) == 0 && cached->Matches(statbuf))
+            {
+                std::lock_guard<std::mutex> lock(mu_);
+                auto entry = entries_.find(key);
+                if (entry != entries_.end())
+                {
+                    entry->second->second.validated = absl::Now();
+                }
+                return cached;
+            }
+            // Removed or renamed behind our back, and so is everything cached under it.
+            Invalidate(key);
+        }
+
+        int fd = open(key.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0 && errno == ENOENT && create && key != "/" && key != ".")
+        {
+            absl::StatusOr<std::shared_ptr<CachedFd>> parent = Get(ParentDir(key), true, mode);
+            if (!parent.ok())
+            {
+                return parent.status();
+            }
+            std::string name = key.substr(key.find_last_of('/') + 1);
+            VLOG(1) << "Making directory " << key << ".";
+            if (mkdirat((*parent)->fd(), name.c_str(), mode) != 0 && errno != EEXIST)
+            {
+                return absl::InternalError("Making directory " + key + " failed with error " + std::strerror(errno) + ".");
+            }
+            fd = openat((*parent)->fd(), name.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        }
+        if (fd < 0)
+        {
+            return OpenError(key);
+        }
+        struct stat statbuf;
+        if (fstat(fd, &statbuf) != 0)
+        {
+            close(fd);
+            return OpenError(key);
+        }
+        auto dir_fd = std::make_shared<CachedFd>(fd, false, statbuf.st_dev, statbuf.st_ino);
+        std::lock_guard<std::mutex> lock(mu_);
+        auto entry = entries_.find(key);
+        if (entry != entries_.end())
+        {
+            lru_.erase(entry->second);
+            entries_.erase(entry);
+        }
+        lru_.emplace_front(key, Entry{dir_fd, absl::Now(), {}});
+        entries_[key] = lru_.begin();
+        while (lru_.size() > capacity_)
+        {
+            entries_.erase(lru_.back().first);
+            lru_.pop_back();
+        }
+        return dir_fd;
+    }
+
+    ResolvedPath DirCache::Resolve(const std::string &path, bool create_dir, mode_t mode)
+    {
+        ResolvedPath resolved;
+        resolved.path = path;
+        absl::StatusOr<std::string> dir = internal::GetFileAbsDir(path);
+        absl::StatusOr<std::string> name = internal::GetFileName(path);
+        if (!dir.ok() || !name.ok())
+        {
+            return resolved;
+        }
+        resolved.dir = dir->empty() ? (path[0] == '/' ? "/" : ".") : *dir;
+        resolved.name = *name;
+        absl::StatusOr<std::shared_ptr<CachedFd>> dir_fd = Get(resolved.dir, create_dir, mode);
+        if (dir_fd.ok())
+        {
+            resolved.dir_fd = *dir_fd;
+        }
+        return resolved;
+    }
+
+    bool DirCache::KnownMissing(const ResolvedPath &path)
+    {
+        if (!path.dir_fd)
+        {
+            return false;
+        }
+        struct timespec mtime;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            auto entry = entries_.find(path.dir);
+            if (entry == entries_.end() || entry->second->second.fd != path.dir_fd)
+            {
+                return false;
+            }
+            auto missing = entry->second->second.missing.find(path.name);
+            if (missing == entry->second->second.missing.end())
+            {
+                return false;
+            }
+            mtime = missing->second;
+        }
+        struct stat statbuf;
+        if (fstat(path.dir_fd->fd(), &statbuf) == 0 && statbuf.st_nlink > 0 && statbuf.st_mtim.tv_sec == mtime.tv_sec &&
+            statbuf.st_mtim.tv_nsec == mtime.tv_nsec)
+        {
+            return true;
+        }
+        std::lock_guard<std::mutex> lock(mu_);
+        auto entry = entries_.find(path.dir);
+        if (entry != entries_.end())
+        {
+            entry->second->second.missing.clear();
+        }
+        return false;
+    }
+
+    void DirCache::AddMissing(const ResolvedPath &path)
+    {
+        struct stat statbuf;
+        if (!path.dir_fd || fstat(path.dir_fd->fd(), &statbuf) != 0 ||
+            absl::Now() - absl::TimeFromTimespec(statbuf.st_mtim) < kMissingMinAge)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mu_);
+        auto entry = entries_.find(path.dir);
+        if (entry == entries_.end() || entry->second->second.fd != path.dir_fd)
+        {
+            return;
+        }
+        auto &missing = entry->second->second.missing;
+        if (missing.size() >= kMaxMissingPerDir)
+        {
+            missing.clear();
+        }
+        missing[path.name] = statbuf.st_mtim;
+    }
+
+    void DirCache::Invalidate(const std::string &dir)
+    {
+        std::string prefix = absl::EndsWith(dir, "/") ? dir : dir + "/";
+        std::lock_guard<std::mutex> lock(mu_);
+        for (auto it = lru_.begin(); it != lru_.end();)
+        {
+            if (it->first == dir || absl::StartsWith(it->first, prefix))
+            {
+                entries_.erase(it->first);
+                it = lru_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+} //  namespace galaxy.
@@ -0,0 +1,121 @@
+#ifndef CPP_CORE_GALAXY_FD_CACHE_H_
+#define CPP_CORE_GALAXY_FD_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+
+namespace galaxy
+{
+    // Open descriptor of a cached file, closed once it is evicted and no caller uses it anymore.
+    class CachedFd
+    {
+    public:
+        CachedFd(int fd, bool writable, dev_t dev, ino_t ino) : fd_(fd), writable_(writable), dev_(dev), ino_(ino) {}
+        CachedFd(const CachedFd&) = delete;
+        ~CachedFd();
+
+        int fd() const { return fd_; }
+        // Files without write permission are cached read-only.
+        bool writable() const { return writable_; }
+        // Whether the descriptor is still the file at a path of this stat.
+        bool Matches(const struct stat &statbuf) const { return statbuf.st_dev == dev_ && statbuf.st_ino == ino_; }
+
+    private:
+        const int fd_;
+        const bool writable_;
+        const dev_t dev_;
+        const ino_t ino_;
+    };
+
+    // Bounded cache of open file descriptors by path, so that repeated reads and writes of small files skip the open
+    // and close calls. Each lookup stats the path and reopens it if it no longer points to the cached inode, e.g.
+    // after a rename over it, so callers always get the file currently at the path. Least recently used descriptors
+    // are evicted beyond capacity.
+    class FdCache
+    {
+    public:
+        explicit FdCache(size_t capacity);
+        FdCache(const FdCache&) = delete;
+
+        // Descriptor of the regular file at path, opened for reading and writing where permitted. statbuf is set to
+        // the stat of the path, taken by the lookup. The file is looked up as name relative to dir_fd, or as path
+        // itself by default.
+        absl::StatusOr<std::shared_ptr<CachedFd>> Get(const std::string &path, struct stat *statbuf, int dir_fd = AT_FDCWD,
+                                                      const std::string &name = "");
+        // Drops path, or every path under it if is_dir is set.
+        void Invalidate(const std::string &path, bool is_dir = false);
+
+    private:
+        using LruList = std::list<std::pair<std::string, std::shared_ptr<CachedFd>>>;
+
+        const size_t capacity_;
+        std::mutex mu_;
+        // Most recently used first.
+        LruList lru_;
+        absl::flat_hash_map<std::string, LruList::iterator> entries_;
+    };
+
+    // A path split into the descriptor of its directory and its name in it, for the *at calls. Without a
+    // descriptor, e.g. when the directory does not exist, fd() and at_name() resolve the whole path as usual.
+    struct ResolvedPath
+    {
+        std::string path;
+        std::string dir;
+        std::string name;
+        std::shared_ptr<CachedFd> dir_fd;
+
+        int fd() const { return dir_fd ? dir_fd->fd() : AT_FDCWD; }
+        const std::string &at_name() const { return dir_fd ? name : path; }
+    };
+
+    // Bounded cache of open directory descriptors by path, so that files in hot directories are resolved relative
+    // to them instead of walking their whole path, and missing directories are created relative to their closest
+    // cached ancestor rather than with a stat of every path component. Entries older than kDirCacheRevalidateMs are
+    // checked against their path again on use, so directories removed or renamed outside of galaxy are picked up.
+    //
+    // Names found missing in a cached directory are also kept, as negative entries along with the modification time
+    // of the directory. They hold as long as that time does not change, which one fstat of the directory tells.
+    class DirCache
+    {
+    public:
+        explicit DirCache(size_t capacity);
+        DirCache(const DirCache&) = delete;
+
+        // Descriptor of the directory dir, which is created along with its missing ancestors if create is set.
+        absl::StatusOr<std::shared_ptr<CachedFd>> Get(const std::string &dir, bool create, mode_t mode = 0777);
+        // path relative to its directory, which is created if create_dir is set. The descriptor is left unset if the
+        // directory cannot be opened.
+        ResolvedPath Resolve(const std::string &path, bool create_dir, mode_t mode = 0777);
+        // Whether path is known to be missing, without any path lookup.
+        bool KnownMissing(const ResolvedPath &path);
+        // Records that path was just found missing.
+        void AddMissing(const ResolvedPath &path);
+        // Drops dir and every directory under it.
+        void Invalidate(const std::string &dir);
+
+    private:
+        struct Entry
+        {
+            std::shared_ptr<CachedFd> fd;
+            absl::Time validated;
+            // Modification time of the directory when each missing name was recorded.
+            absl::flat_hash_map<std::string, struct timespec> missing;
+        };
+        using LruList = std::list<std::pair<std::string, Entry>>;
+
+        const size_t capacity_;
+        std::mutex mu_;
+        // Most recently used first.
+        LruList lru_;
+        absl::flat_hash_map<std::string, LruList::iterator> entries_;
+    };
+} //  namespace galaxy.
+#endif   //  CPP_CORE_GALAXY_FD_CACHE_H_
@@ -0,0 +1,205 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "cpp/core/galaxy_fd_cache.h"
+#include "cpp/internal/galaxy_fs_internal.h"
+
+namespace {
+    using galaxy::CachedFd;
+    using galaxy::DirCache;
+    using galaxy::FdCache;
+    using galaxy::ResolvedPath;
+    using galaxy::internal::JoinPath;
+
+    std::string NewRoot(const std::string& name) {
+        std::string root = JoinPath(testing::TempDir(), absl::StrCat("galaxy_fd_cache_test_", getpid(), "_", name));
+        EXPECT_TRUE(galaxy::impl::CreateDirIfNotExist(root, 0777).ok());
+        return root;
+    }
+
+    void WriteFile(const std::string& path, const std::string& data) {
+        std::ofstream(path) << data;
+    }
+
+    std::string ReadFd(const CachedFd& fd) {
+        char buffer[64];
+        ssize_t size = pread(fd.fd(), buffer, sizeof(buffer), 0);
+        return size < 0 ? "" : std::string(buffer, size);
+    }
+
+    // Moves the modification time of dir back, as if it was left untouched for a while.
+    void AgeDir(const std::string& dir) {
+        struct timespec times[2];
+        clock_gettime(CLOCK_REALTIME, &times[0]);
+        times[0].tv_sec -= 10;
+        times[1] = times[0];
+        EXPECT_EQ(utimensat(AT_FDCWD, dir.c_str(), times, 0), 0);
+    }
+
+    TEST(FdCacheTest, ReusesDescriptor) {
+        std::string path = JoinPath(NewRoot("reuse"), "a");
+        WriteFile(path, "a");
+        FdCache cache(4);
+        struct stat statbuf;
+        auto first = cache.Get(path, &statbuf);
+        ASSERT_TRUE(first.ok());
+        EXPECT_TRUE((*first)->writable());
+        EXPECT_EQ(statbuf.st_size, 1);
+        auto second = cache.Get(path, &statbuf);
+        ASSERT_TRUE(second.ok());
+        EXPECT_EQ(first->get(), second->get());
+
+        cache.Invalidate(path);
+        auto third = cache.Get(path, &statbuf);
+        ASSERT_TRUE(third.ok());
+        EXPECT_NE(first->get(), third->get());
+    }
+
+    TEST(FdCacheTest, ReopensReplacedFile) {
+        std::string root = NewRoot("replaced");
+        std::string path = JoinPath(root, "a");
+        WriteFile(path, "old");
+        FdCache cache(4);
+        struct stat statbuf;
+        auto old_fd = cache.Get(path, &statbuf);
+        ASSERT_TRUE(old_fd.ok());
+
+        std::string tmp_path = JoinPath(root, ".a.tmp");
+        WriteFile(tmp_path, "new");
+        ASSERT_EQ(rename(tmp_path.c_str(), path.c_str()), 0);
+        auto new_fd = cache.Get(path, &statbuf);
+        ASSERT_TRUE(new_fd.ok());
+        EXPECT_NE(old_fd->get(), new_fd->get());
+        EXPECT_EQ(ReadFd(**new_fd), "new");
+        // Callers still holding the replaced descriptor keep reading the file they opened.
+        EXPECT_EQ(ReadFd(**old_fd), "old");
+    }
+
+    TEST(FdCacheTest, MissingAndNonRegular) {
+        std::string root = NewRoot("missing");
+        FdCache cache(4);
+        struct stat statbuf;
+        EXPECT_TRUE(absl::IsNotFound(cache.Get(JoinPath(root, "none"), &statbuf).status()));
+        EXPECT_TRUE(absl::IsNotFound(cache.Get(root, &statbuf).status()));
+    }
+
+    TEST(FdCacheTest, ReadOnlyFile) {
+        if (geteuid() == 0) {
+            GTEST_SKIP() << "Permissions are not enforced for root.";
+        }
+        std::string path = JoinPath(NewRoot("read_only"), "a");
+        WriteFile(path, "a");
+        ASSERT_EQ(chmod(path.c_str(), 0444), 0);
+        FdCache cache(4);
+        struct stat statbuf;
+        auto fd = cache.Get(path, &statbuf);
+        ASSERT_TRUE(fd.ok());
+        EXPECT_FALSE((*fd)->writable());
+        EXPECT_EQ(ReadFd(**fd), "a");
+    }
+
+    TEST(FdCacheTest, EvictsLeastRecentlyUsed) {
+        std::string root = NewRoot("evict");
+        FdCache cache(2);
+        struct stat statbuf;
+        std::shared_ptr<CachedFd> fds[3];
+        for (int i = 0; i < 3; i++) {
+            std::string path = JoinPath(root, absl::StrCat(i));
+            WriteFile(path, absl::StrCat(i));
+            auto fd = cache.Get(path, &statbuf);
+            ASSERT_TRUE(fd.ok());
+            fds[i] = *fd;
+        }
+        // The evicted descriptor stays open for its holder.
+        EXPECT_EQ(ReadFd(*fds[0]), "0");
+        EXPECT_NE(cache.Get(JoinPath(root, "0"), &statbuf)->get(), fds[0].get());
+        EXPECT_EQ(cache.Get(JoinPath(root, "2"), &statbuf)->get(), fds[2].get());
+    }
+
+    TEST(FdCacheTest, InvalidateDir) {
+        std::string root = NewRoot("invalidate_dir");
+        ASSERT_TRUE(galaxy::impl::CreateDirIfNotExist(JoinPath(root, "sub"), 0777).ok());
+        std::string inside = JoinPath(root, "sub/a");
+        std::string outside = JoinPath(root, "suba");
+        WriteFile(inside, "a");
+        WriteFile(outside, "a");
+        FdCache cache(4);
+        struct stat statbuf;
+        auto inside_fd = cache.Get(inside, &statbuf);
+        auto outside_fd = cache.Get(outside, &statbuf);
+        ASSERT_TRUE(inside_fd.ok() && outside_fd.ok());
+        cache.Invalidate(JoinPath(root, "sub"), true);
+        EXPECT_NE(cache.Get(inside, &statbuf)->get(), inside_fd->get());
+        EXPECT_EQ(cache.Get(outside, &statbuf)->get(), outside_fd->get());
+    }
+
+    TEST(DirCacheTest, CreatesMissingDirs) {
+        std::string root = NewRoot("create");
+        std::string dir = JoinPath(root, "a/b/c");
+        DirCache cache(8);
+        EXPECT_TRUE(absl::IsNotFound(cache.Get(dir, false).status()));
+        auto fd = cache.Get(dir, true);
+        ASSERT_TRUE(fd.ok());
+        EXPECT_TRUE(galaxy::internal::ExistDir(dir));
+        EXPECT_EQ(cache.Get(dir + "/", false)->get(), fd->get());
+    }
+
+    TEST(DirCacheTest, Resolve) {
+        std::string root = NewRoot("resolve");
+        DirCache cache(8);
+        ResolvedPath resolved = cache.Resolve(JoinPath(root, "sub/a"), true);
+        ASSERT_TRUE(resolved.dir_fd);
+        EXPECT_EQ(resolved.dir, JoinPath(root, "sub"));
+        EXPECT_EQ(resolved.at_name(), "a");
+        int fd = openat(resolved.fd(), resolved.at_name().c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0666);
+        ASSERT_GE(fd, 0);
+        close(fd);
+        EXPECT_TRUE(galaxy::internal::ExistFile(JoinPath(root, "sub/a")));
+
+        resolved = cache.Resolve(JoinPath(root, "none/a"), false);
+        EXPECT_FALSE(resolved.dir_fd);
+        EXPECT_EQ(resolved.fd(), AT_FDCWD);
+        EXPECT_EQ(resolved.at_name(), JoinPath(root, "none/a"));
+    }
+
+    TEST(DirCacheTest, RevalidatesRemovedDir) {
+        std::string root = NewRoot("removed");
+        std::string dir = JoinPath(root, "a");
+        DirCache cache(8);
+        auto fd = cache.Get(dir, true);
+        ASSERT_TRUE(fd.ok());
+        ASSERT_EQ(rmdir(dir.c_str()), 0);
+        ASSERT_EQ(mkdir(dir.c_str(), 0777), 0);
+        cache.Invalidate(dir);
+        auto new_fd = cache.Get(dir, false);
+        ASSERT_TRUE(new_fd.ok());
+        EXPECT_NE(fd->get(), new_fd->get());
+        struct stat statbuf;
+        ASSERT_EQ(stat(dir.c_str(), &statbuf), 0);
+        EXPECT_TRUE((*new_fd)->Matches(statbuf));
+    }
+
+    TEST(DirCacheTest, KnownMissingUntilDirChanges) {
+        std::string root = NewRoot("known_missing");
+        std::string dir = JoinPath(root, "a");
+        ASSERT_TRUE(galaxy::impl::CreateDirIfNotExist(dir, 0777).ok());
+        DirCache cache(8);
+        ResolvedPath resolved = cache.Resolve(JoinPath(dir, "x"), false);
+        ASSERT_TRUE(resolved.dir_fd);
+
+        // Not recorded while the directory was just modified.
+        cache.AddMissing(resolved);
+        EXPECT_FALSE(cache.KnownMissing(resolved));
+
+        AgeDir(dir);
+        cache.AddMissing(resolved);
+        EXPECT_TRUE(cache.KnownMissing(resolved));
+
+        WriteFile(JoinPath(dir, "x"), "x");
+        EXPECT_FALSE(cache.KnownMissing(resolved));
+    }
+}  // namespace
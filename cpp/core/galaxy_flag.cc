@@ -24,3 +24,24 @@ GALAXY_DEFINE_int(fs_rpc_ddl, 10, "The deadline for grpc in seconds.");
 // Global configurations
 GALAXY_DEFINE_string(fs_global_config, "", "The global configuration (json file) for galaxy filesystems.");
 GALAXY_DEFINE_string(fs_cell, "", "Current cell of the galaxy filesystems.");
+// Transfer engine configurations
+GALAXY_DEFINE_int(fs_transfer_num_worker, 16, "Number of worker threads used by the transfer engine.");
+GALAXY_DEFINE_int(fs_transfer_cell_concurrency, 8, "Maximum number of in-flight transfers per remote cell.");
+GALAXY_DEFINE_int(fs_transfer_small_file_kb, 1024, "Files smaller than this size (in KB) are batched into ReadMultiple/WriteMultiple calls.");
+GALAXY_DEFINE_int(fs_transfer_batch_kb, 16384, "Maximum total size (in KB) of a single batch of small files.");
+// Shared path replication configurations
+GALAXY_DEFINE_int(fs_shared_chain_min_kb, 1024, "Copies to /SHARED at least this size (in KB) are replicated through a chain of cells, smaller ones are fanned out concurrently.");
+GALAXY_DEFINE_int(fs_shared_fanout, 1, "Number of cells each cell forwards a replicated copy to. 1 means a chain.");
+// Data integrity configurations
+GALAXY_DEFINE_bool(fs_verify_checksum, true, "Whether to checksum (CRC32C) the data of Read, Write and CopyFile calls and verify it on the other end.");
+GALAXY_DEFINE_string(fs_write_durability, "", "Durability asked for the Write, WriteAt, Truncate and CopyFile calls of the client: no_sync, sync_data or sync_data_and_dir. Empty follows the durability rules of the target cell.");
+// Buffered writer configurations
+GALAXY_DEFINE_int(fs_buffered_flush_kb, 256, "Pending appends to a file of at least this size (in KB) are flushed right away by the buffered writer.");
+GALAXY_DEFINE_int(fs_buffered_flush_interval_ms, 1000, "Maximum time (in milliseconds) an append stays in the buffered writer before being flushed.");
+GALAXY_DEFINE_int(fs_buffered_max_kb, 65536, "Maximum size (in KB) of the appends held by the buffered writer, including those being flushed.");
+GALAXY_DEFINE_bool(fs_buffered_drop_when_full, false, "Whether the buffered writer drops appends when it is full, instead of blocking the caller until it drains.");
+// Append coalescing configurations
+GALAXY_DEFINE_int(fs_append_sync_ms, -1, "Appends are fdatasync'ed before being acknowledged, in groups collected over this window (in milliseconds). 0 syncs without waiting, negative never syncs.");
+// Remote execution configurations
+GALAXY_DEFINE_int(fs_execute_parallelism, 32, "Maximum number of cells RemoteExecuteAll runs a command on at once.");
+GALAXY_DEFINE_int(fs_execute_timeout_sec, 0, "Time (in seconds) RemoteExecuteAll gives a command on each cell before killing it. 0 means no limit.");
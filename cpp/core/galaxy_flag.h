@@ -8,4 +8,31 @@ ABSL_DECLARE_FLAG(int, fs_rpc_ddl);
 ABSL_DECLARE_FLAG(std::string, fs_global_config);
 ABSL_DECLARE_FLAG(std::string, fs_cell);
 
+// Transfer engine configurations
+ABSL_DECLARE_FLAG(int, fs_transfer_num_worker);
+ABSL_DECLARE_FLAG(int, fs_transfer_cell_concurrency);
+ABSL_DECLARE_FLAG(int, fs_transfer_small_file_kb);
+ABSL_DECLARE_FLAG(int, fs_transfer_batch_kb);
+
+// Shared path replication configurations
+ABSL_DECLARE_FLAG(int, fs_shared_chain_min_kb);
+ABSL_DECLARE_FLAG(int, fs_shared_fanout);
+
+// Data integrity configurations
+ABSL_DECLARE_FLAG(bool, fs_verify_checksum);
+ABSL_DECLARE_FLAG(std::string, fs_write_durability);
+
+// Buffered writer configurations
+ABSL_DECLARE_FLAG(int, fs_buffered_flush_kb);
+ABSL_DECLARE_FLAG(int, fs_buffered_flush_interval_ms);
+ABSL_DECLARE_FLAG(int, fs_buffered_max_kb);
+ABSL_DECLARE_FLAG(bool, fs_buffered_drop_when_full);
+
+// Append coalescing configurations
+ABSL_DECLARE_FLAG(int, fs_append_sync_ms);
+
+// Remote execution configurations
+ABSL_DECLARE_FLAG(int, fs_execute_parallelism);
+ABSL_DECLARE_FLAG(int, fs_execute_timeout_sec);
+
 #endif  // CPP_CORE_GALAXY_FLAG_H_
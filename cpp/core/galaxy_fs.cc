@@ -1,17 +1,127 @@
 
 #include "cpp/internal/galaxy_fs_internal.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <unistd.h>
+#include <sys/uio.h>
+
 #include "absl/flags/flag.h"
+#include "absl/strings/substitute.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "cpp/core/galaxy_flag.h"
 #include "cpp/core/galaxy_fs.h"
+#include "cpp/internal/galaxy_const.h"
+#include "glog/logging.h"
 
 namespace galaxy {
 
-    GalaxyFs::GalaxyFs(const std::string& root) : root_(root){};
+    namespace {
+        std::shared_ptr<IoBackend> io_backend;
+
+        std::mutex instances_mu;
+        absl::flat_hash_map<std::string, std::unique_ptr<GalaxyFs>>* instances = nullptr;
+
+        std::shared_ptr<IoBackend> GetIoBackend() {
+            return std::atomic_load(&io_backend);
+        }
+
+        // Stats paths as one batch of io into stats.
+        void StatAll(IoBackend& io, const std::vector<std::string>& paths, absl::flat_hash_map<std::string, struct stat>& stats) {
+            std::vector<absl::StatusOr<struct stat>> results = io.StatFiles(paths);
+            for (size_t i = 0; i < paths.size(); ++i) {
+                struct stat statbuf;
+                std::memset(&statbuf, 0, sizeof(statbuf));
+                if (results[i].ok()) {
+                    statbuf = *results[i];
+                } else {
+                    LOG(ERROR) << "File " << paths[i] << " failed to get stats.";
+                }
+                stats.insert({paths[i], statbuf});
+            }
+        }
+
+        // Reads the whole file from the start with pread, so that the shared offset of the descriptor is left alone.
+        absl::Status PReadAll(int fd, off_t size, std::string& data) {
+            // One byte more than the size, to see the end of file without a second call when it did not grow.
+            data.resize(size + 1);
+            size_t offset = 0;
+            while (true) {
+                ssize_t ret = pread(fd, &data[offset], data.size() - offset, offset);
+                if (ret < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (ret < 0) {
+                    return absl::InternalError(std::string("pread failed with error ") + std::strerror(errno) + ".");
+                }
+                if (ret == 0) {
+                    break;
+                }
+                offset += ret;
+                if (offset == data.size()) {
+                    data.resize(data.size() + galaxy::constant::kChunkSize);
+                }
+            }
+            data.resize(offset);
+            return absl::OkStatus();
+        }
+
+        // Whether a file can be read without its lock. Only files left unchanged for a while are: a write racing with
+        // the read then moves their ctime, which the coarse clock of the filesystem could otherwise miss.
+        bool Settled(const struct stat& statbuf) {
+            return absl::Now() - absl::TimeFromTimespec(statbuf.st_ctim) >= absl::Seconds(galaxy::constant::kUnlockedReadMinAgeSec);
+        }
+
+        // Whether a file stat'ed before and after a read was left alone by writers in between.
+        bool SameVersion(const struct stat& before, const struct stat& after) {
+            return before.st_dev == after.st_dev && before.st_ino == after.st_ino && before.st_size == after.st_size &&
+                   before.st_ctim.tv_sec == after.st_ctim.tv_sec && before.st_ctim.tv_nsec == after.st_ctim.tv_nsec;
+        }
+
+        // Appends data at the end of the file as O_APPEND does, although the descriptor was not opened with it.
+        absl::Status AppendAll(int fd, const std::string& data) {
+            size_t written = 0;
+            while (written < data.size()) {
+                struct iovec iov = {const_cast<char*>(data.data()) + written, data.size() - written};
+                ssize_t ret = pwritev2(fd, &iov, 1, -1, RWF_APPEND);
+                if (ret < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (ret < 0 && (errno == EOPNOTSUPP || errno == EINVAL || errno == ENOSYS)) {
+                    // Kernels before 4.16 do not know RWF_APPEND.
+                    return absl::UnimplementedError("RWF_APPEND is not supported.");
+                }
+                if (ret < 0) {
+                    return absl::InternalError(std::string("pwritev2 failed with error ") + std::strerror(errno) + ".");
+                }
+                written += ret;
+            }
+            return absl::OkStatus();
+        }
+    }
+
+    GalaxyFs::GalaxyFs(const std::string& root)
+        : root_(root), fd_cache_(galaxy::constant::kFdCacheSize), dir_cache_(galaxy::constant::kDirCacheSize){};
     GalaxyFs::~GalaxyFs(){};
 
-    std::unique_ptr<GalaxyFs> GalaxyFs::Instance(std::string root) {
-        return std::unique_ptr<GalaxyFs>(new GalaxyFs(root));
+    GalaxyFs* GalaxyFs::Instance(const std::string& root) {
+        std::lock_guard<std::mutex> lock(instances_mu);
+        if (instances == nullptr) {
+            // Never destroyed, so that instances stay valid for threads still running at exit.
+            instances = new absl::flat_hash_map<std::string, std::unique_ptr<GalaxyFs>>();
+        }
+        std::unique_ptr<GalaxyFs>& instance = (*instances)[root];
+        if (!instance) {
+            instance = std::make_unique<GalaxyFs>(root);
+        }
+        return instance.get();
+    }
+
+    void GalaxyFs::SetIoBackend(std::shared_ptr<IoBackend> io) {
+        std::atomic_store(&io_backend, std::move(io));
     }
 
     void GalaxyFs::SetRootDir(const std::string& path) {
@@ -21,7 +131,10 @@ namespace galaxy {
 
     absl::Status GalaxyFs::CreateDirIfNotExist(const std::string& path, mode_t mode) {
         std::string abs_path = internal::JoinPath(root_, path);
-        return impl::CreateDirIfNotExist(abs_path, mode);
+        if (!dir_cache_.Get(abs_path, true, mode).ok()) {
+            return absl::InvalidArgumentError("Invalid argument for CreateDirIfNotExist: " + abs_path + ".");
+        }
+        return absl::OkStatus();
     }
 
     absl::Status GalaxyFs::CopyFile(const std::string& from_path, const std::string& to_path) {
@@ -33,6 +146,8 @@ namespace galaxy {
     absl::Status GalaxyFs::MoveFile(const std::string& from_path, const std::string& to_path) {
         std::string abs_from_path = internal::JoinPath(root_, from_path);
         std::string abs_to_path = internal::JoinPath(root_, to_path);
+        fd_cache_.Invalidate(abs_from_path);
+        fd_cache_.Invalidate(abs_to_path);
         return impl::MoveFile(abs_from_path, abs_to_path);
     }
 
@@ -43,12 +158,24 @@ namespace galaxy {
 
     absl::Status GalaxyFs::CreateFileIfNotExist(const std::string& path, mode_t mode) {
         std::string abs_path = internal::JoinPath(root_, path);
-        return impl::CreateFileIfNotExist(abs_path, mode);
+        ResolvedPath resolved = dir_cache_.Resolve(abs_path, true, mode);
+        if (!resolved.dir_fd) {
+            return impl::CreateFileIfNotExist(abs_path, mode);
+        }
+        return CreateFileAt(resolved);
 
     }
     absl::Status GalaxyFs::DieFileIfNotExist(const std::string& path, std::string& out_path) {
         std::string abs_path = internal::JoinPath(root_, path);
-        return impl::DieFileIfNotExist(abs_path, out_path);
+        ResolvedPath resolved = dir_cache_.Resolve(abs_path, false);
+        if (dir_cache_.KnownMissing(resolved)) {
+            return absl::NotFoundError("Path " + abs_path + " does not exist for DieFileIfNotExist.");
+        }
+        absl::Status status = impl::DieFileIfNotExist(abs_path, out_path);
+        if (absl::IsNotFound(status)) {
+            dir_cache_.AddMissing(resolved);
+        }
+        return status;
 
     }
 
@@ -59,48 +186,233 @@ namespace galaxy {
 
     absl::Status GalaxyFs::ListFilesInDir(const std::string& path, absl::flat_hash_map<std::string, struct stat>& sub_files, bool include_hidden) {
         std::string abs_path = internal::JoinPath(root_, path);
-        return impl::ListFilesInDir(abs_path, sub_files, include_hidden);
+        std::shared_ptr<IoBackend> io = GetIoBackend();
+        if (!io) {
+            return impl::ListFilesInDir(abs_path, sub_files, include_hidden);
+        }
+        if (!internal::ExistDir(abs_path)) {
+            return absl::NotFoundError("Path " + abs_path + " does not exist for ListFilesInDir.");
+        }
+        absl::StatusOr<std::vector<std::string>> files = internal::ListFilesInDir(abs_path, include_hidden);
+        if (!files.ok()) {
+            return absl::NotFoundError("Input path is not directory or does not exist.");
+        }
+        StatAll(*io, *files, sub_files);
+        return absl::OkStatus();
     }
 
     absl::Status GalaxyFs::ListAllInDirRecursive(const std::string& path, absl::flat_hash_map<std::string, struct stat>& sub_dirs,
             absl::flat_hash_map<std::string, struct stat>& sub_files, bool include_hidden) {
         std::string abs_path = internal::JoinPath(root_, path);
-        return impl::ListAllInDirRecursive(abs_path, sub_dirs, sub_files, include_hidden);
+        std::shared_ptr<IoBackend> io = GetIoBackend();
+        if (!io) {
+            return impl::ListAllInDirRecursive(abs_path, sub_dirs, sub_files, include_hidden);
+        }
+        if (!internal::ExistDir(abs_path)) {
+            return absl::NotFoundError("Path " + abs_path + " does not exist for ListAllInDirRecursive.");
+        }
+        absl::StatusOr<std::vector<std::string>> dirs = internal::ListDirsInDirRecursive(abs_path);
+        absl::StatusOr<std::vector<std::string>> files = internal::ListFilesInDirRecursive(abs_path, include_hidden);
+        if (!dirs.ok() || !files.ok()) {
+            return absl::NotFoundError("Input path is not directory or does not exist.");
+        }
+        StatAll(*io, *dirs, sub_dirs);
+        StatAll(*io, *files, sub_files);
+        return absl::OkStatus();
     }
 
     absl::Status GalaxyFs::RmDir(const std::string& path, bool include_hidden) {
         std::string abs_path = internal::JoinPath(root_, path);
+        fd_cache_.Invalidate(abs_path, true);
+        dir_cache_.Invalidate(abs_path);
         return impl::RmDir(abs_path, include_hidden);
 
     }
 
     absl::Status GalaxyFs::RmDirRecursive(const std::string& path, bool include_hidden) {
         std::string abs_path = internal::JoinPath(root_, path);
+        fd_cache_.Invalidate(abs_path, true);
+        dir_cache_.Invalidate(abs_path);
         return impl::RmDirRecursive(abs_path, include_hidden);
 
     }
 
     absl::Status GalaxyFs::RmFile(const std::string& path, bool require_lock){
         std::string abs_path = internal::JoinPath(root_, path);
-        return impl::RmFile(abs_path, require_lock);
+        absl::Status status = impl::RmFile(abs_path, require_lock);
+        // Dropped after the unlink, so that a Read or Write in between cannot cache the removed file again. Its space
+        // is freed once the cached descriptor is closed.
+        fd_cache_.Invalidate(abs_path);
+        return status;
 
     }
 
     absl::Status GalaxyFs::RenameFile(const std::string& old_path, const std::string& new_path) {
         std::string abs_old_path = internal::JoinPath(root_, old_path);
         std::string abs_new_path = internal::JoinPath(root_, new_path);
+        fd_cache_.Invalidate(abs_old_path);
+        fd_cache_.Invalidate(abs_new_path);
         return impl::RenameFile(abs_old_path, abs_new_path);
 
     }
 
-    absl::Status GalaxyFs::Read(const std::string& path, std::string& data) {
+    absl::Status GalaxyFs::Read(const std::string& path, std::string& data, bool require_lock) {
         std::string abs_path = internal::JoinPath(root_, path);
-        return impl::Read(abs_path, data);
+        ResolvedPath resolved = dir_cache_.Resolve(abs_path, false);
+        struct stat statbuf;
+        if (dir_cache_.KnownMissing(resolved) || fstatat(resolved.fd(), resolved.at_name().c_str(), &statbuf, 0) != 0 ||
+                !S_ISREG(statbuf.st_mode)) {
+            dir_cache_.AddMissing(resolved);
+            return absl::NotFoundError("Path " + abs_path + " does not exist for Read.");
+        }
+        if (!require_lock) {
+            // Files changed in place, e.g. appended to, are read under their lock while they change, and so are
+            // files that changed during the read.
+            absl::StatusOr<std::shared_ptr<CachedFd>> fd = fd_cache_.Get(abs_path, &statbuf, resolved.fd(), resolved.at_name());
+            struct stat after;
+            if (fd.ok() && Settled(statbuf)) {
+                absl::Status status = PReadAll((*fd)->fd(), statbuf.st_size, data);
+                if (!status.ok() || (fstat((*fd)->fd(), &after) == 0 && SameVersion(statbuf, after))) {
+                    return status;
+                }
+            }
+            data.clear();
+        }
+        absl::Status status = LockAt(&resolved);
+        if (!status.ok()) {
+            return status;
+        }
+        absl::StatusOr<std::shared_ptr<CachedFd>> fd = fd_cache_.Get(abs_path, &statbuf, resolved.fd(), resolved.at_name());
+        if (fd.ok()) {
+            status = PReadAll((*fd)->fd(), statbuf.st_size, data);
+        } else {
+            status = impl::Read(abs_path, data, false);
+        }
+        UnlockAt(resolved);
+        return status;
     }
 
     absl::Status GalaxyFs::Write(const std::string& path, const std::string& data, const std::string& mode, bool require_lock) {
         std::string abs_path = internal::JoinPath(root_, path);
-        return impl::Write(abs_path, data, mode, require_lock);
+        ResolvedPath resolved = dir_cache_.Resolve(abs_path, true);
+        absl::Status status;
+        if (require_lock) {
+            status = LockAt(&resolved);
+            if (!status.ok()) {
+                return status;
+            }
+        }
+        if (internal::UnshareFile(abs_path, mode == "a") != 0) {
+            status = absl::InternalError("Unsharing file " + abs_path + " failed.");
+        } else {
+            struct stat statbuf;
+            absl::StatusOr<std::shared_ptr<CachedFd>> fd = fd_cache_.Get(abs_path, &statbuf, resolved.fd(), resolved.at_name());
+            if (absl::IsNotFound(fd.status()) && CreateFileAt(resolved).ok()) {
+                fd = fd_cache_.Get(abs_path, &statbuf, resolved.fd(), resolved.at_name());
+            }
+            if (!fd.ok() || !(*fd)->writable()) {
+                // Files that cannot be created or opened for writing are left to impl, which reports them as before.
+                status = impl::Write(abs_path, data, mode, false);
+            } else if (mode == "a") {
+                status = AppendAll((*fd)->fd(), data);
+                if (absl::IsUnimplemented(status)) {
+                    status = impl::Write(abs_path, data, mode, false);
+                }
+            } else if (ftruncate((*fd)->fd(), 0) != 0) {
+                status = absl::InternalError("Truncating file " + abs_path + " failed with error " + std::strerror(errno) + ".");
+            } else {
+                status = internal::PWriteAll((*fd)->fd(), data, 0);
+            }
+        }
+        if (require_lock) {
+            UnlockAt(resolved);
+        }
+        return status;
+    }
+
+    std::vector<absl::StatusOr<std::string>> GalaxyFs::ReadFiles(const std::vector<std::string>& paths, bool require_lock) {
+        std::vector<std::string> abs_paths;
+        for (const auto& path : paths) {
+            abs_paths.push_back(internal::JoinPath(root_, path));
+        }
+        // Locks are taken in path order, so that concurrent batches never deadlock.
+        std::vector<std::string> lock_order(abs_paths);
+        std::sort(lock_order.begin(), lock_order.end());
+        if (require_lock) {
+            for (size_t i = 0; i < lock_order.size(); ++i) {
+                ResolvedPath resolved = dir_cache_.Resolve(lock_order[i], true);
+                absl::Status status = LockAt(&resolved);
+                if (!status.ok()) {
+                    for (size_t j = 0; j < i; ++j) {
+                        UnlockAt(dir_cache_.Resolve(lock_order[j], false));
+                    }
+                    return std::vector<absl::StatusOr<std::string>>(paths.size(), status);
+                }
+            }
+        }
+        // Without the locks, files that are not settled or change during the batch are read again one by one.
+        std::vector<struct stat> before(paths.size());
+        std::vector<bool> unsettled(paths.size(), false);
+        if (!require_lock) {
+            for (size_t i = 0; i < abs_paths.size(); ++i) {
+                unsettled[i] = stat(abs_paths[i].c_str(), &before[i]) == 0 && !Settled(before[i]);
+            }
+        }
+        std::vector<absl::StatusOr<std::string>> results;
+        std::shared_ptr<IoBackend> io = GetIoBackend();
+        if (io) {
+            results = io->ReadFiles(abs_paths);
+        } else {
+            for (const auto& path : abs_paths) {
+                std::string data;
+                absl::Status status = impl::Read(path, data, false);
+                if (status.ok()) {
+                    results.push_back(std::move(data));
+                } else {
+                    results.push_back(status);
+                }
+            }
+        }
+        if (require_lock) {
+            for (const auto& path : lock_order) {
+                UnlockAt(dir_cache_.Resolve(path, false));
+            }
+            return results;
+        }
+        for (size_t i = 0; i < abs_paths.size(); ++i) {
+            struct stat after;
+            if (results[i].ok() && (unsettled[i] || stat(abs_paths[i].c_str(), &after) != 0 || !SameVersion(before[i], after))) {
+                std::string data;
+                absl::Status status = Read(paths[i], data, true);
+                results[i] = status.ok() ? absl::StatusOr<std::string>(std::move(data)) : absl::StatusOr<std::string>(status);
+            }
+        }
+        return results;
+    }
+
+    absl::Status GalaxyFs::WriteAtomic(const std::string& path, const std::string& data, bool require_lock) {
+        std::string abs_path = internal::JoinPath(root_, path);
+        fd_cache_.Invalidate(abs_path);
+        return impl::WriteAtomic(abs_path, data, require_lock);
+    }
+
+    std::unique_ptr<internal::AtomicFile> GalaxyFs::NewAtomicFile(const std::string& path) {
+        return std::make_unique<internal::AtomicFile>(internal::JoinPath(root_, path));
+    }
+
+    absl::Status GalaxyFs::WriteAt(const std::string& path, off_t offset, const std::string& data, bool require_lock) {
+        std::string abs_path = internal::JoinPath(root_, path);
+        return impl::WriteAt(abs_path, offset, data, require_lock);
+    }
+
+    absl::Status GalaxyFs::Truncate(const std::string& path, off_t size, bool require_lock) {
+        std::string abs_path = internal::JoinPath(root_, path);
+        return impl::Truncate(abs_path, size, require_lock);
+    }
+
+    absl::Status GalaxyFs::Preallocate(const std::string& path, off_t size, bool require_lock) {
+        std::string abs_path = internal::JoinPath(root_, path);
+        return impl::Preallocate(abs_path, size, require_lock);
     }
 
     absl::Status GalaxyFs::GetAttr(const std::string& path, struct stat *statbuf) {
@@ -108,14 +420,65 @@ namespace galaxy {
         return impl::GetAttr(abs_path, statbuf);
     }
 
-    void GalaxyFs::Lock(const std::string& path) {
+    absl::Status GalaxyFs::Lock(const std::string& path) {
         std::string abs_path = internal::JoinPath(root_, path);
-        return impl::Lock(abs_path);
+        ResolvedPath resolved = dir_cache_.Resolve(abs_path, true);
+        return LockAt(&resolved);
     }
 
     void GalaxyFs::Unlock(const std::string& path) {
         std::string abs_path = internal::JoinPath(root_, path);
-        return impl::Unlock(abs_path);
+        return UnlockAt(dir_cache_.Resolve(abs_path, false));
+    }
+
+    absl::Status GalaxyFs::LockAt(ResolvedPath* path) {
+        if (path->dir_fd) {
+            std::string lock_name = absl::Substitute(galaxy::constant::kLockNameTemplate, path->name);
+            struct stat statbuf;
+            while (fstatat(path->fd(), lock_name.c_str(), &statbuf, 0) == 0 && S_ISREG(statbuf.st_mode)) {
+                absl::SleepFor(absl::Milliseconds(galaxy::constant::kLockRetrySec));
+            }
+            int fd = openat(path->fd(), lock_name.c_str(), O_RDONLY | O_CREAT | O_CLOEXEC, 0666);
+            if (fd >= 0) {
+                close(fd);
+                return absl::OkStatus();
+            }
+            // The cached directory was removed or replaced, so it is dropped and the lock is taken once more by path.
+            LOG(WARNING) << "Creating lock for " << path->path << " in its cached directory failed with error "
+                         << std::strerror(errno) << ", retrying by path.";
+            dir_cache_.Invalidate(path->dir);
+            path->dir_fd.reset();
+        }
+        absl::StatusOr<std::string> lock_name = internal::GetFileLockName(path->path);
+        if (!lock_name.ok()) {
+            return absl::InternalError("Fail to create lock file.");
+        }
+        while (internal::ExistFile(*lock_name)) {
+            absl::SleepFor(absl::Milliseconds(galaxy::constant::kLockRetrySec));
+        }
+        if (!impl::CreateFileIfNotExist(*lock_name, 0777).ok()) {
+            return absl::InternalError("Creating lock for " + path->path + " failed.");
+        }
+        return absl::OkStatus();
+    }
+
+    void GalaxyFs::UnlockAt(const ResolvedPath& path) {
+        if (!path.dir_fd) {
+            return impl::Unlock(path.path);
+        }
+        std::string lock_name = absl::Substitute(galaxy::constant::kLockNameTemplate, path.name);
+        int ret = unlinkat(path.fd(), lock_name.c_str(), 0);
+        CHECK(ret == 0 || errno == ENOENT) << "Removing lock for " + path.path + " failed.";
+    }
+
+    absl::Status GalaxyFs::CreateFileAt(const ResolvedPath& path) {
+        int fd = openat(path.fd(), path.at_name().c_str(), O_RDONLY | O_CREAT | O_CLOEXEC, 0666);
+        if (fd < 0) {
+            return absl::InternalError("Creating file " + path.path + " failed with error " + std::strerror(errno) + ".");
+        }
+        VLOG(1) << "Creating file " << path.path << ".";
+        close(fd);
+        return absl::OkStatus();
     }
 
     absl::Status GalaxyFs::GetDiskUsage(struct statvfs *statvfsbuf) {
@@ -3,8 +3,13 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/container/flat_hash_map.h"
+#include "cpp/core/galaxy_fd_cache.h"
+#include "cpp/core/galaxy_io.h"
+#include "cpp/internal/galaxy_fs_internal.h"
 #include <sys/stat.h>
 #include <sys/statvfs.h>
 #include <sys/types.h>
@@ -19,11 +24,16 @@ namespace galaxy
         ~GalaxyFs();
         GalaxyFs(const GalaxyFs&) = delete;
 
-        static std::unique_ptr<GalaxyFs> Instance(std::string root="");
+        // Long-lived instance of the cell rooted at root, so that its open descriptors are kept across calls.
+        static GalaxyFs* Instance(const std::string& root="");
+        // Backend of the batched operations of every instance: the reads of ReadFiles and the stats of the listings.
+        // They are issued one by one until a backend is set.
+        static void SetIoBackend(std::shared_ptr<IoBackend> io);
 
         void SetRootDir(const std::string& path);
 
-        void Lock(const std::string& path);
+        // Fails rather than aborting on a path that cannot hold a lock file, e.g. one ending in "/".
+        absl::Status Lock(const std::string& path);
         void Unlock(const std::string& path);
         absl::Status CreateDirIfNotExist(const std::string& path, mode_t mode=0777);
         absl::Status CopyFile(const std::string& from_path, const std::string& to_path);
@@ -44,14 +54,37 @@ namespace galaxy
         absl::Status RmFile(const std::string& path, bool require_lock=true);
         absl::Status RenameFile(const std::string& old_path, const std::string& new_path);
 
-        absl::Status Read(const std::string& path, std::string& data);
+        // Without require_lock, only files left unchanged for kUnlockedReadMinAgeSec are read without their lock, and
+        // read again under it if they changed during the read, so that writes in place are never seen half done.
+        absl::Status Read(const std::string& path, std::string& data, bool require_lock=true);
+        // Reads paths as one batch, all under their locks if require_lock is set, and otherwise as Read does. paths
+        // must not repeat.
+        std::vector<absl::StatusOr<std::string>> ReadFiles(const std::vector<std::string>& paths, bool require_lock=true);
         absl::Status Write(const std::string& path, const std::string& data, const std::string& mode="w", bool require_lock=true);
+        // Overwrites path with data such that readers never see a partial file.
+        absl::Status WriteAtomic(const std::string& path, const std::string& data, bool require_lock=true);
+        // For content streamed in chunks, see internal::AtomicFile. The caller takes care of the lock.
+        std::unique_ptr<internal::AtomicFile> NewAtomicFile(const std::string& path);
+        // Positional writes, in place like appends. See the functions of the same name in impl.
+        absl::Status WriteAt(const std::string& path, off_t offset, const std::string& data, bool require_lock=true);
+        absl::Status Truncate(const std::string& path, off_t size, bool require_lock=true);
+        absl::Status Preallocate(const std::string& path, off_t size, bool require_lock=true);
         absl::Status GetAttr(const std::string& path, struct stat *statbuf);
         absl::Status GetDiskUsage(struct statvfs *statvfsbuf);
         absl::Status GetRamUsage(struct sysinfo *sysinfobuf);
 
     private:
+        // The lock files of impl::Lock, taken relative to the descriptor of their directory. If that directory is
+        // gone, the lock is taken by path instead and path no longer refers to the descriptor.
+        absl::Status LockAt(ResolvedPath* path);
+        void UnlockAt(const ResolvedPath& path);
+        absl::Status CreateFileAt(const ResolvedPath& path);
+
         std::string root_;
+        // Descriptors of the files read and written through Read and Write, by absolute path.
+        FdCache fd_cache_;
+        // Descriptors of the directories files are resolved in.
+        DirCache dir_cache_;
     };
 } //  namespace galaxy.
 #endif   //  CPP_CORE_GALAXY_FS_H_
@@ -0,0 +1,68 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "cpp/core/galaxy_fs.h"
+#include "cpp/internal/galaxy_const.h"
+#include "cpp/internal/galaxy_fs_internal.h"
+
+namespace {
+    using galaxy::GalaxyFs;
+
+    std::string NewRoot(const std::string& name) {
+        std::string root = galaxy::internal::JoinPath(testing::TempDir(), absl::StrCat("galaxy_fs_test_", getpid(), "_", name));
+        EXPECT_TRUE(galaxy::impl::CreateDirIfNotExist(root, 0777).ok());
+        return root;
+    }
+
+    TEST(GalaxyFsTest, UnlockedReadsSeeWholeAppends) {
+        GalaxyFs fs(NewRoot("appends"));
+        std::string record(4096, 'r');
+        record.back() = '\n';
+        ASSERT_TRUE(fs.Write("f", record, "w").ok());
+        std::atomic<bool> done{false};
+        std::thread writer([&]() {
+            for (int i = 0; i < 1000; i++) {
+                EXPECT_TRUE(fs.Write("f", record, "a").ok());
+            }
+            done = true;
+        });
+        // Reads of a file being appended to go through its lock, so they never see a record cut short.
+        int num_partial = 0;
+        int num_reads = 0;
+        while (!done || num_reads == 0) {
+            std::string data;
+            EXPECT_TRUE(fs.Read("f", data, false).ok());
+            num_partial += data.size() % record.size() != 0;
+            num_reads++;
+        }
+        writer.join();
+        EXPECT_EQ(num_partial, 0);
+    }
+
+    TEST(GalaxyFsTest, UnlockedReadsOfSettledFiles) {
+        GalaxyFs fs(NewRoot("settled"));
+        ASSERT_TRUE(fs.Write("a", "a", "w").ok());
+        ASSERT_TRUE(fs.Write("b", "bb", "w").ok());
+        absl::SleepFor(absl::Seconds(galaxy::constant::kUnlockedReadMinAgeSec) + absl::Milliseconds(100));
+
+        std::string data;
+        ASSERT_TRUE(fs.Read("a", data, false).ok());
+        EXPECT_EQ(data, "a");
+        // Changed since, so read under its lock again.
+        ASSERT_TRUE(fs.Write("a", "changed", "w").ok());
+        ASSERT_TRUE(fs.Read("a", data, false).ok());
+        EXPECT_EQ(data, "changed");
+
+        auto results = fs.ReadFiles({"a", "b", "missing"}, false);
+        ASSERT_EQ(results.size(), 3);
+        ASSERT_TRUE(results[0].ok());
+        EXPECT_EQ(*results[0], "changed");
+        ASSERT_TRUE(results[1].ok());
+        EXPECT_EQ(*results[1], "bb");
+        EXPECT_FALSE(results[2].ok());
+    }
+}  // namespace
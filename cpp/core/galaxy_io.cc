@@ -0,0 +1,750 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+
+#include "cpp/core/galaxy_io.h"
+#include "glog/logging.h"
+
+namespace galaxy
+{
+    namespace
+    {
+        // Largest transfer of a single read, see read(2).
+        constexpr size_t kMaxReadSize = 0x7ffff000;
+
+        absl::Status ErrnoError(const std::string &action, const std::string &path, int error)
+        {
+            std::string message = action + " " + path + " failed with error " + std::strerror(error) + ".";
+            return error == ENOENT ? absl::NotFoundError(message) : absl::InternalError(message);
+        }
+
+        // Reads fd from the current size of data up to its end.
+        absl::Status ReadRest(int fd, const std::string &path, std::string &data)
+        {
+            char buffer[65536];
+            while (true)
+            {
+                ssize_t num_read = pread(fd, buffer, sizeof(buffer), data.size());
+                if (num_read < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (num_read < 0)
+                {
+                    return ErrnoError("Reading", path, errno);
+                }
+                if (num_read == 0)
+                {
+                    return absl::OkStatus();
+                }
+                data.append(buffer, num_read);
+            }
+        }
+
+        absl::StatusOr<std::string> ReadFile(const std::string &path)
+        {
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+            {
+                return ErrnoError("Opening", path, errno);
+            }
+            struct stat statbuf;
+            if (fstat(fd, &statbuf) != 0 || !S_ISREG(statbuf.st_mode))
+            {
+                close(fd);
+                return absl::NotFoundError("Path " + path + " is not a file.");
+            }
+            std::string data;
+            data.reserve(statbuf.st_size);
+            absl::Status status = ReadRest(fd, path, data);
+            close(fd);
+            if (!status.ok())
+            {
+                return status;
+            }
+            return data;
+        }
+
+        absl::StatusOr<struct stat> StatFile(const std::string &path)
+        {
+            struct stat statbuf;
+            if (lstat(path.c_str(), &statbuf) != 0)
+            {
+                return ErrnoError("Stating", path, errno);
+            }
+            return statbuf;
+        }
+
+        absl::Status SyncFile(const std::string &path, bool is_dir)
+        {
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC | (is_dir ? O_DIRECTORY : 0));
+            if (fd < 0)
+            {
+                return ErrnoError("Opening", path, errno);
+            }
+            // Directories need a full fsync, as their entries are metadata.
+            int ret = is_dir ? fsync(fd) : fdatasync(fd);
+            int sync_errno = errno;
+            close(fd);
+            if (ret != 0)
+            {
+                return ErrnoError("Syncing", path, sync_errno);
+            }
+            return absl::OkStatus();
+        }
+
+        struct stat StatxToStat(const struct statx &stx)
+        {
+            struct stat statbuf;
+            std::memset(&statbuf, 0, sizeof(statbuf));
+            statbuf.st_dev = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+            statbuf.st_ino = stx.stx_ino;
+            statbuf.st_mode = stx.stx_mode;
+            statbuf.st_nlink = stx.stx_nlink;
+            statbuf.st_uid = stx.stx_uid;
+            statbuf.st_gid = stx.stx_gid;
+            statbuf.st_rdev = makedev(stx.stx_rdev_major, stx.stx_rdev_minor);
+            statbuf.st_size = stx.stx_size;
+            statbuf.st_blksize = stx.stx_blksize;
+            statbuf.st_blocks = stx.stx_blocks;
+            statbuf.st_atim = {stx.stx_atime.tv_sec, stx.stx_atime.tv_nsec};
+            statbuf.st_mtim = {stx.stx_mtime.tv_sec, stx.stx_mtime.tv_nsec};
+            statbuf.st_ctim = {stx.stx_ctime.tv_sec, stx.stx_ctime.tv_nsec};
+            return statbuf;
+        }
+
+        int IoUringSetup(unsigned entries, struct io_uring_params *params)
+        {
+            return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+        }
+
+        int IoUringEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+        {
+            return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+        }
+
+        int IoUringRegister(int fd, unsigned opcode, void *arg, unsigned nr_args)
+        {
+            return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+        }
+
+        // Fills a submission entry, which is zeroed beforehand.
+        using Prep = std::function<void(struct io_uring_sqe *)>;
+
+        Prep PrepOpen(const std::string &path, int flags)
+        {
+            return [&path, flags](struct io_uring_sqe *sqe) {
+                sqe->opcode = IORING_OP_OPENAT;
+                sqe->fd = AT_FDCWD;
+                sqe->addr = reinterpret_cast<uint64_t>(path.c_str());
+                sqe->open_flags = flags;
+            };
+        }
+
+        Prep PrepStatx(const std::string &path, struct statx *stx)
+        {
+            return [&path, stx](struct io_uring_sqe *sqe) {
+                sqe->opcode = IORING_OP_STATX;
+                sqe->fd = AT_FDCWD;
+                sqe->addr = reinterpret_cast<uint64_t>(path.c_str());
+                sqe->len = STATX_BASIC_STATS;
+                sqe->off = reinterpret_cast<uint64_t>(stx);
+                sqe->statx_flags = AT_SYMLINK_NOFOLLOW;
+            };
+        }
+
+        Prep PrepRead(int fd, char *buffer, size_t size)
+        {
+            return [fd, buffer, size](struct io_uring_sqe *sqe) {
+                sqe->opcode = IORING_OP_READ;
+                sqe->fd = fd;
+                sqe->addr = reinterpret_cast<uint64_t>(buffer);
+                sqe->len = static_cast<uint32_t>(size);
+                sqe->off = 0;
+            };
+        }
+
+        Prep PrepSync(int fd, bool datasync)
+        {
+            return [fd, datasync](struct io_uring_sqe *sqe) {
+                sqe->opcode = IORING_OP_FSYNC;
+                sqe->fd = fd;
+                sqe->fsync_flags = datasync ? IORING_FSYNC_DATASYNC : 0;
+            };
+        }
+
+        Prep PrepClose(int fd)
+        {
+            return [fd](struct io_uring_sqe *sqe) {
+                sqe->opcode = IORING_OP_CLOSE;
+                sqe->fd = fd;
+            };
+        }
+    } // namespace
+
+    std::vector<absl::StatusOr<std::string>> PosixIoBackend::ReadFiles(const std::vector<std::string> &paths)
+    {
+        std::vector<absl::StatusOr<std::string>> results;
+        results.reserve(paths.size());
+        for (const auto &path : paths)
+        {
+            results.push_back(ReadFile(path));
+        }
+        return results;
+    }
+
+    std::vector<absl::StatusOr<struct stat>> PosixIoBackend::StatFiles(const std::vector<std::string> &paths)
+    {
+        std::vector<absl::StatusOr<struct stat>> results;
+        results.reserve(paths.size());
+        for (const auto &path : paths)
+        {
+            results.push_back(StatFile(path));
+        }
+        return results;
+    }
+
+    std::vector<absl::Status> PosixIoBackend::SyncFiles(const std::vector<std::string> &paths, bool is_dir)
+    {
+        std::vector<absl::Status> results;
+        results.reserve(paths.size());
+        for (const auto &path : paths)
+        {
+            results.push_back(SyncFile(path, is_dir));
+        }
+        return results;
+    }
+
+    ThreadPoolIoBackend::ThreadPoolIoBackend(int num_threads)
+    {
+        for (int i = 0; i < std::max(num_threads, 1); ++i)
+        {
+            threads_.emplace_back(&ThreadPoolIoBackend::Work, this);
+        }
+    }
+
+    ThreadPoolIoBackend::~ThreadPoolIoBackend()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto &thread : threads_)
+        {
+            thread.join();
+        }
+    }
+
+    void ThreadPoolIoBackend::Work()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mu_);
+                cv_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty())
+                {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    void ThreadPoolIoBackend::ParallelFor(size_t n, const std::function<void(size_t)> &fn)
+    {
+        if (n <= 1)
+        {
+            // Not worth a round trip through the pool.
+            for (size_t i = 0; i < n; ++i)
+            {
+                fn(i);
+            }
+            return;
+        }
+        std::mutex done_mu;
+        std::condition_variable done_cv;
+        size_t num_done = 0;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            for (size_t i = 0; i < n; ++i)
+            {
+                tasks_.emplace_back([&, i]() {
+                    fn(i);
+                    std::lock_guard<std::mutex> done_lock(done_mu);
+                    if (++num_done == n)
+                    {
+                        done_cv.notify_one();
+                    }
+                });
+            }
+        }
+        cv_.notify_all();
+        std::unique_lock<std::mutex> done_lock(done_mu);
+        done_cv.wait(done_lock, [&]() { return num_done == n; });
+    }
+
+    std::vector<absl::StatusOr<std::string>> ThreadPoolIoBackend::ReadFiles(const std::vector<std::string> &paths)
+    {
+        std::vector<absl::StatusOr<std::string>> results(paths.size());
+        ParallelFor(paths.size(), [&](size_t i) { results[i] = ReadFile(paths[i]); });
+        return results;
+    }
+
+    std::vector<absl::StatusOr<struct stat>> ThreadPoolIoBackend::StatFiles(const std::vector<std::string> &paths)
+    {
+        std::vector<absl::StatusOr<struct stat>> results(paths.size());
+        ParallelFor(paths.size(), [&](size_t i) { results[i] = StatFile(paths[i]); });
+        return results;
+    }
+
+    std::vector<absl::Status> ThreadPoolIoBackend::SyncFiles(const std::vector<std::string> &paths, bool is_dir)
+    {
+        std::vector<absl::Status> results(paths.size());
+        ParallelFor(paths.size(), [&](size_t i) { results[i] = SyncFile(paths[i], is_dir); });
+        return results;
+    }
+
+    struct UringIoBackend::Ring
+    {
+        ~Ring()
+        {
+            if (sqes)
+            {
+                munmap(sqes, sqes_size);
+            }
+            if (cq_ptr && cq_ptr != sq_ptr)
+            {
+                munmap(cq_ptr, cq_size);
+            }
+            if (sq_ptr)
+            {
+                munmap(sq_ptr, sq_size);
+            }
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+
+        bool Init(unsigned queue_depth)
+        {
+            struct io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            fd = IoUringSetup(queue_depth, &params);
+            if (fd < 0)
+            {
+                return false;
+            }
+            entries = params.sq_entries;
+            sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+            bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (single_mmap)
+            {
+                sq_size = cq_size = std::max(sq_size, cq_size);
+            }
+            sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            if (sq_ptr == MAP_FAILED)
+            {
+                sq_ptr = nullptr;
+                return false;
+            }
+            cq_ptr = single_mmap ? sq_ptr
+                                 : mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (cq_ptr == MAP_FAILED)
+            {
+                cq_ptr = nullptr;
+                return false;
+            }
+            sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+            void *sqes_ptr = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+            if (sqes_ptr == MAP_FAILED)
+            {
+                return false;
+            }
+            sqes = static_cast<struct io_uring_sqe *>(sqes_ptr);
+            char *sq = static_cast<char *>(sq_ptr);
+            char *cq = static_cast<char *>(cq_ptr);
+            sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+            sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+            sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+            sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+            cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+            cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+            cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+            return true;
+        }
+
+        // Submits all the operations, at most a ring's worth at a time, and returns the result of each of them: the
+        // value the system call would return, or minus its errno. If the ring fails, the operations the kernel already
+        // took are waited for, as they still point to the buffers of the caller, and the others fail with its error.
+        std::vector<int> Run(const std::vector<Prep> &preps)
+        {
+            std::vector<int> results(preps.size(), -ECANCELED);
+            if (broken)
+            {
+                // Callers still close what the earlier operations opened, without the ring.
+                return results;
+            }
+            std::vector<bool> completed(preps.size(), false);
+            size_t num_queued = 0;
+            size_t num_done = 0;
+            unsigned num_in_flight = 0;
+            unsigned num_unsubmitted = 0;
+            while (num_done < preps.size())
+            {
+                unsigned tail = *sq_tail;
+                while (num_queued < preps.size() && num_in_flight < entries)
+                {
+                    unsigned index = tail & *sq_mask;
+                    struct io_uring_sqe *sqe = &sqes[index];
+                    std::memset(sqe, 0, sizeof(*sqe));
+                    preps[num_queued](sqe);
+                    sqe->user_data = num_queued;
+                    sq_array[index] = index;
+                    ++tail;
+                    ++num_queued;
+                    ++num_in_flight;
+                    ++num_unsubmitted;
+                }
+                __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+                int ret = IoUringEnter(fd, num_unsubmitted, 1, IORING_ENTER_GETEVENTS);
+                if (ret < 0 && errno != EINTR)
+                {
+                    int error_number = errno;
+                    LOG(ERROR) << "io_uring_enter failed with error " << std::strerror(error_number);
+                    broken = true;
+                    // Without SQPOLL the kernel only takes entries in io_uring_enter, so the ones it did not take
+                    // are dropped from the ring.
+                    __atomic_store_n(sq_tail, tail - num_unsubmitted, __ATOMIC_RELEASE);
+                    num_in_flight -= num_unsubmitted;
+                    num_in_flight -= ReapCompletions(results, completed);
+                    while (num_in_flight > 0)
+                    {
+                        if (IoUringEnter(fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+                        {
+                            LOG(ERROR) << "Waiting for " << num_in_flight << " io_uring operations failed with error "
+                                       << std::strerror(errno);
+                            break;
+                        }
+                        num_in_flight -= ReapCompletions(results, completed);
+                    }
+                    for (size_t i = 0; i < preps.size(); ++i)
+                    {
+                        if (!completed[i])
+                        {
+                            results[i] = -error_number;
+                        }
+                    }
+                    return results;
+                }
+                if (ret > 0)
+                {
+                    num_unsubmitted -= std::min<unsigned>(ret, num_unsubmitted);
+                }
+                unsigned num_reaped = ReapCompletions(results, completed);
+                num_done += num_reaped;
+                num_in_flight -= num_reaped;
+            }
+            return results;
+        }
+
+        // Stores the results of the completed operations, by the index they were submitted with. Returns how many
+        // there were.
+        unsigned ReapCompletions(std::vector<int> &results, std::vector<bool> &completed)
+        {
+            unsigned head = *cq_head;
+            unsigned cq_tail_now = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+            unsigned num_reaped = 0;
+            while (head != cq_tail_now)
+            {
+                const struct io_uring_cqe &cqe = cqes[head & *cq_mask];
+                results[cqe.user_data] = cqe.res;
+                completed[cqe.user_data] = true;
+                ++head;
+                ++num_reaped;
+            }
+            __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+            return num_reaped;
+        }
+
+        void CloseAll(const std::vector<int> &fds)
+        {
+            std::vector<int> open_fds;
+            std::vector<Prep> preps;
+            for (int fd : fds)
+            {
+                if (fd >= 0)
+                {
+                    open_fds.push_back(fd);
+                    preps.push_back(PrepClose(fd));
+                }
+            }
+            std::vector<int> closed = Run(preps);
+            for (size_t j = 0; j < open_fds.size(); ++j)
+            {
+                // Left open by a ring that failed. The ones it did close are not closed again, as their numbers may
+                // already be reused by another thread.
+                if (closed[j] != 0)
+                {
+                    close(open_fds[j]);
+                }
+            }
+        }
+
+        int fd = -1;
+        unsigned entries = 0;
+        // Set once a submission failed, the ring is then dropped instead of reused.
+        bool broken = false;
+        void *sq_ptr = nullptr;
+        size_t sq_size = 0;
+        void *cq_ptr = nullptr;
+        size_t cq_size = 0;
+        struct io_uring_sqe *sqes = nullptr;
+        size_t sqes_size = 0;
+        unsigned *sq_head = nullptr;
+        unsigned *sq_tail = nullptr;
+        unsigned *sq_mask = nullptr;
+        unsigned *sq_array = nullptr;
+        unsigned *cq_head = nullptr;
+        unsigned *cq_tail = nullptr;
+        unsigned *cq_mask = nullptr;
+        struct io_uring_cqe *cqes = nullptr;
+    };
+
+    UringIoBackend::UringIoBackend(int queue_depth) : queue_depth_(std::max(queue_depth, 1)) {}
+
+    UringIoBackend::~UringIoBackend() = default;
+
+    bool UringIoBackend::IsSupported()
+    {
+        Ring ring;
+        if (!ring.Init(1))
+        {
+            return false;
+        }
+        size_t probe_size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+        std::vector<char> buffer(probe_size, 0);
+        struct io_uring_probe *probe = reinterpret_cast<struct io_uring_probe *>(buffer.data());
+        if (IoUringRegister(ring.fd, IORING_REGISTER_PROBE, probe, 256) < 0)
+        {
+            return false;
+        }
+        for (int op : {IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_FSYNC, IORING_OP_CLOSE})
+        {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::unique_ptr<UringIoBackend::Ring> UringIoBackend::AcquireRing()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (!free_rings_.empty())
+            {
+                std::unique_ptr<Ring> ring = std::move(free_rings_.back());
+                free_rings_.pop_back();
+                return ring;
+            }
+        }
+        auto ring = std::make_unique<Ring>();
+        if (!ring->Init(queue_depth_))
+        {
+            LOG(WARNING) << "Cannot set up an io_uring ring: " << std::strerror(errno);
+            return nullptr;
+        }
+        return ring;
+    }
+
+    void UringIoBackend::ReleaseRing(std::unique_ptr<Ring> ring)
+    {
+        if (ring->broken)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mu_);
+        free_rings_.push_back(std::move(ring));
+    }
+
+    std::vector<absl::StatusOr<std::string>> UringIoBackend::ReadFiles(const std::vector<std::string> &paths)
+    {
+        std::unique_ptr<Ring> ring = AcquireRing();
+        if (!ring)
+        {
+            return fallback_.ReadFiles(paths);
+        }
+        std::vector<absl::StatusOr<std::string>> results(paths.size());
+        // Opens and sizes all the files at once.
+        std::vector<struct statx> stx(paths.size());
+        std::vector<Prep> preps;
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            preps.push_back(PrepOpen(paths[i], O_RDONLY | O_CLOEXEC));
+            preps.push_back(PrepStatx(paths[i], &stx[i]));
+        }
+        std::vector<int> opened = ring->Run(preps);
+        std::vector<int> fds(paths.size(), -1);
+        std::vector<size_t> to_read;
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            fds[i] = opened[2 * i];
+            int stat_ret = opened[2 * i + 1];
+            if (fds[i] < 0)
+            {
+                results[i] = ErrnoError("Opening", paths[i], -fds[i]);
+            }
+            else if (stat_ret < 0 || !S_ISREG(stx[i].stx_mode))
+            {
+                results[i] = absl::NotFoundError("Path " + paths[i] + " is not a file.");
+            }
+            else
+            {
+                to_read.push_back(i);
+            }
+        }
+        // Then reads them whole. One more byte than their size is asked for, so that a full read tells a file that
+        // grew in the meantime.
+        preps.clear();
+        std::vector<std::string> data(paths.size());
+        for (size_t i : to_read)
+        {
+            data[i].resize(std::min<size_t>(stx[i].stx_size + 1, kMaxReadSize));
+            preps.push_back(PrepRead(fds[i], &data[i][0], data[i].size()));
+        }
+        std::vector<int> read = ring->Run(preps);
+        for (size_t j = 0; j < to_read.size(); ++j)
+        {
+            size_t i = to_read[j];
+            if (read[j] < 0)
+            {
+                results[i] = ErrnoError("Reading", paths[i], -read[j]);
+                continue;
+            }
+            bool is_full = static_cast<size_t>(read[j]) == data[i].size();
+            data[i].resize(read[j]);
+            absl::Status status = is_full ? ReadRest(fds[i], paths[i], data[i]) : absl::OkStatus();
+            if (status.ok())
+            {
+                results[i] = std::move(data[i]);
+            }
+            else
+            {
+                results[i] = status;
+            }
+        }
+        ring->CloseAll(fds);
+        ReleaseRing(std::move(ring));
+        return results;
+    }
+
+    std::vector<absl::StatusOr<struct stat>> UringIoBackend::StatFiles(const std::vector<std::string> &paths)
+    {
+        std::unique_ptr<Ring> ring = AcquireRing();
+        if (!ring)
+        {
+            return fallback_.StatFiles(paths);
+        }
+        std::vector<struct statx> stx(paths.size());
+        std::vector<Prep> preps;
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            preps.push_back(PrepStatx(paths[i], &stx[i]));
+        }
+        std::vector<int> stated = ring->Run(preps);
+        ReleaseRing(std::move(ring));
+        std::vector<absl::StatusOr<struct stat>> results(paths.size());
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            if (stated[i] < 0)
+            {
+                results[i] = ErrnoError("Stating", paths[i], -stated[i]);
+            }
+            else
+            {
+                results[i] = StatxToStat(stx[i]);
+            }
+        }
+        return results;
+    }
+
+    std::vector<absl::Status> UringIoBackend::SyncFiles(const std::vector<std::string> &paths, bool is_dir)
+    {
+        std::unique_ptr<Ring> ring = AcquireRing();
+        if (!ring)
+        {
+            return fallback_.SyncFiles(paths, is_dir);
+        }
+        std::vector<absl::Status> results(paths.size());
+        std::vector<Prep> preps;
+        for (const auto &path : paths)
+        {
+            preps.push_back(PrepOpen(path, O_RDONLY | O_CLOEXEC | (is_dir ? O_DIRECTORY : 0)));
+        }
+        std::vector<int> fds = ring->Run(preps);
+        preps.clear();
+        std::vector<size_t> opened;
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            if (fds[i] < 0)
+            {
+                results[i] = ErrnoError("Opening", paths[i], -fds[i]);
+            }
+            else
+            {
+                // Directories need a full fsync, as their entries are metadata.
+                preps.push_back(PrepSync(fds[i], !is_dir));
+                opened.push_back(i);
+            }
+        }
+        std::vector<int> synced = ring->Run(preps);
+        for (size_t j = 0; j < opened.size(); ++j)
+        {
+            size_t i = opened[j];
+            if (synced[j] < 0)
+            {
+                results[i] = ErrnoError("Syncing", paths[i], -synced[j]);
+            }
+        }
+        ring->CloseAll(fds);
+        ReleaseRing(std::move(ring));
+        return results;
+    }
+
+    std::unique_ptr<IoBackend> NewIoBackend(const std::string &name, int queue_depth)
+    {
+        if (name == "io_uring")
+        {
+            if (UringIoBackend::IsSupported())
+            {
+                return std::make_unique<UringIoBackend>(queue_depth);
+            }
+            LOG(WARNING) << "io_uring is not supported by this kernel, falling back to the threadpool I/O backend.";
+            return std::make_unique<ThreadPoolIoBackend>(queue_depth);
+        }
+        if (name == "threadpool")
+        {
+            return std::make_unique<ThreadPoolIoBackend>(queue_depth);
+        }
+        if (!name.empty() && name != "posix")
+        {
+            LOG(WARNING) << "Unknown I/O backend " << name << ", using posix.";
+        }
+        return std::make_unique<PosixIoBackend>();
+    }
+} //  namespace galaxy.
@@ -0,0 +1,103 @@
+#ifndef CPP_CORE_GALAXY_IO_H_
+#define CPP_CORE_GALAXY_IO_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+namespace galaxy
+{
+    // Batched file operations of a cell. Every call takes independent paths and returns one result per path, in the
+    // same order, so that a backend can keep the whole batch in flight instead of issuing one blocking call at a time.
+    class IoBackend
+    {
+    public:
+        virtual ~IoBackend() = default;
+
+        virtual std::string Name() const = 0;
+        // Whole content of each regular file.
+        virtual std::vector<absl::StatusOr<std::string>> ReadFiles(const std::vector<std::string> &paths) = 0;
+        // lstat of each path.
+        virtual std::vector<absl::StatusOr<struct stat>> StatFiles(const std::vector<std::string> &paths) = 0;
+        // fdatasync of each file, or fsync of each directory if is_dir is set.
+        virtual std::vector<absl::Status> SyncFiles(const std::vector<std::string> &paths, bool is_dir) = 0;
+    };
+
+    // One blocking call after the other, as the rest of GalaxyFs does.
+    class PosixIoBackend : public IoBackend
+    {
+    public:
+        std::string Name() const override { return "posix"; }
+        std::vector<absl::StatusOr<std::string>> ReadFiles(const std::vector<std::string> &paths) override;
+        std::vector<absl::StatusOr<struct stat>> StatFiles(const std::vector<std::string> &paths) override;
+        std::vector<absl::Status> SyncFiles(const std::vector<std::string> &paths, bool is_dir) override;
+    };
+
+    // Blocking calls spread over a fixed pool of threads.
+    class ThreadPoolIoBackend : public IoBackend
+    {
+    public:
+        explicit ThreadPoolIoBackend(int num_threads);
+        ThreadPoolIoBackend(const ThreadPoolIoBackend&) = delete;
+        ~ThreadPoolIoBackend() override;
+
+        std::string Name() const override { return "threadpool"; }
+        std::vector<absl::StatusOr<std::string>> ReadFiles(const std::vector<std::string> &paths) override;
+        std::vector<absl::StatusOr<struct stat>> StatFiles(const std::vector<std::string> &paths) override;
+        std::vector<absl::Status> SyncFiles(const std::vector<std::string> &paths, bool is_dir) override;
+
+    private:
+        // Runs fn(i) for every i below n on the pool, and returns once they are all done.
+        void ParallelFor(size_t n, const std::function<void(size_t)> &fn);
+        void Work();
+
+        std::mutex mu_;
+        std::condition_variable cv_;
+        std::deque<std::function<void()>> tasks_;
+        bool stopping_ = false;
+        std::vector<std::thread> threads_;
+    };
+
+    // io_uring submission and completion rings, driven through the raw system calls. Each batch goes through a ring
+    // of its own, so that concurrent callers do not wait for each other, and rings are reused across batches.
+    class UringIoBackend : public IoBackend
+    {
+    public:
+        explicit UringIoBackend(int queue_depth);
+        UringIoBackend(const UringIoBackend&) = delete;
+        ~UringIoBackend() override;
+
+        // Whether the kernel supports io_uring and all the operations used here.
+        static bool IsSupported();
+
+        std::string Name() const override { return "io_uring"; }
+        std::vector<absl::StatusOr<std::string>> ReadFiles(const std::vector<std::string> &paths) override;
+        std::vector<absl::StatusOr<struct stat>> StatFiles(const std::vector<std::string> &paths) override;
+        std::vector<absl::Status> SyncFiles(const std::vector<std::string> &paths, bool is_dir) override;
+
+    private:
+        struct Ring;
+
+        std::unique_ptr<Ring> AcquireRing();
+        void ReleaseRing(std::unique_ptr<Ring> ring);
+
+        const unsigned queue_depth_;
+        std::mutex mu_;
+        std::vector<std::unique_ptr<Ring>> free_rings_;
+        // Serves the batches for which no ring can be set up.
+        PosixIoBackend fallback_;
+    };
+
+    // Backend by name: "posix", "threadpool" or "io_uring". queue_depth is the number of operations kept in flight,
+    // the size of the rings or of the pool. io_uring falls back to threadpool on kernels without it.
+    std::unique_ptr<IoBackend> NewIoBackend(const std::string &name, int queue_depth);
+} //  namespace galaxy.
+#endif   //  CPP_CORE_GALAXY_IO_H_
@@ -0,0 +1,138 @@
+#include <dirent.h>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "cpp/core/galaxy_io.h"
+#include "cpp/internal/galaxy_fs_internal.h"
+
+namespace {
+    using galaxy::IoBackend;
+    using galaxy::UringIoBackend;
+
+    std::string NewRoot(const std::string& name) {
+        std::string root = galaxy::internal::JoinPath(testing::TempDir(), absl::StrCat("galaxy_io_test_", getpid(), "_", name));
+        EXPECT_TRUE(galaxy::impl::CreateDirIfNotExist(root, 0777).ok());
+        return root;
+    }
+
+    void WriteFile(const std::string& path, const std::string& data) {
+        std::ofstream file(path);
+        file << data;
+    }
+
+    int NumOpenFds() {
+        int num_fds = 0;
+        DIR* dir = opendir("/proc/self/fd");
+        while (readdir(dir) != nullptr) {
+            num_fds++;
+        }
+        closedir(dir);
+        return num_fds;
+    }
+
+    // Files of different sizes, with a missing path and a directory among them, more than a small ring holds.
+    std::vector<std::string> MakeFiles(const std::string& root, std::vector<std::string>* contents) {
+        std::vector<std::string> paths;
+        for (int i = 0; i < 50; i++) {
+            paths.push_back(galaxy::internal::JoinPath(root, absl::StrCat("f", i)));
+            contents->push_back(std::string(i * 1000, 'a' + i % 26));
+            WriteFile(paths.back(), contents->back());
+        }
+        paths.push_back(galaxy::internal::JoinPath(root, "missing"));
+        contents->push_back("");
+        paths.push_back(root);
+        contents->push_back("");
+        return paths;
+    }
+
+    void ExpectBatches(IoBackend& io, const std::string& root) {
+        std::vector<std::string> contents;
+        std::vector<std::string> paths = MakeFiles(root, &contents);
+        size_t num_files = paths.size() - 2;
+
+        auto read = io.ReadFiles(paths);
+        ASSERT_EQ(read.size(), paths.size());
+        for (size_t i = 0; i < num_files; i++) {
+            ASSERT_TRUE(read[i].ok()) << read[i].status();
+            EXPECT_EQ(*read[i], contents[i]);
+        }
+        EXPECT_TRUE(absl::IsNotFound(read[num_files].status()));
+        EXPECT_FALSE(read[num_files + 1].ok());
+
+        auto stated = io.StatFiles(paths);
+        ASSERT_EQ(stated.size(), paths.size());
+        for (size_t i = 0; i < num_files; i++) {
+            ASSERT_TRUE(stated[i].ok());
+            EXPECT_EQ(stated[i]->st_size, contents[i].size());
+        }
+        EXPECT_FALSE(stated[num_files].ok());
+        ASSERT_TRUE(stated[num_files + 1].ok());
+        EXPECT_TRUE(S_ISDIR(stated[num_files + 1]->st_mode));
+
+        auto synced = io.SyncFiles(std::vector<std::string>(paths.begin(), paths.begin() + num_files + 1), false);
+        ASSERT_EQ(synced.size(), num_files + 1);
+        for (size_t i = 0; i < num_files; i++) {
+            EXPECT_TRUE(synced[i].ok()) << synced[i];
+        }
+        EXPECT_FALSE(synced[num_files].ok());
+        auto synced_dirs = io.SyncFiles({root, paths[0]}, true);
+        EXPECT_TRUE(synced_dirs[0].ok());
+        EXPECT_FALSE(synced_dirs[1].ok());
+
+        EXPECT_TRUE(io.ReadFiles({}).empty());
+    }
+
+    TEST(IoBackendTest, Posix) {
+        auto io = galaxy::NewIoBackend("posix", 4);
+        EXPECT_EQ(io->Name(), "posix");
+        ExpectBatches(*io, NewRoot("posix"));
+    }
+
+    TEST(IoBackendTest, ThreadPool) {
+        auto io = galaxy::NewIoBackend("threadpool", 4);
+        EXPECT_EQ(io->Name(), "threadpool");
+        ExpectBatches(*io, NewRoot("threadpool"));
+    }
+
+    TEST(IoBackendTest, UnknownNameIsPosix) {
+        EXPECT_EQ(galaxy::NewIoBackend("unknown", 4)->Name(), "posix");
+        // Falls back to the pool on kernels without io_uring.
+        EXPECT_EQ(galaxy::NewIoBackend("io_uring", 4)->Name(), UringIoBackend::IsSupported() ? "io_uring" : "threadpool");
+    }
+
+    TEST(IoBackendTest, Uring) {
+        if (!UringIoBackend::IsSupported()) {
+            GTEST_SKIP() << "io_uring is not supported by this kernel.";
+        }
+        // A ring smaller than the batches, which then go through it in several rounds.
+        UringIoBackend io(4);
+        std::string root = NewRoot("uring");
+        ExpectBatches(io, root);
+        // Every file opened through the rings is closed, and rings are reused across batches.
+        int num_fds = NumOpenFds();
+        for (int i = 0; i < 10; i++) {
+            ExpectBatches(io, root);
+        }
+        EXPECT_EQ(NumOpenFds(), num_fds);
+    }
+
+    TEST(IoBackendTest, UringConcurrentBatches) {
+        if (!UringIoBackend::IsSupported()) {
+            GTEST_SKIP() << "io_uring is not supported by this kernel.";
+        }
+        UringIoBackend io(8);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; t++) {
+            std::string root = NewRoot(absl::StrCat("uring_", t));
+            threads.emplace_back([&io, root]() { ExpectBatches(io, root); });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+}  // namespace
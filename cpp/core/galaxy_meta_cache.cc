@@ -0,0 +1,582 @@
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+#include <sys/inotify.h>
+
+#include "absl/strings/str_split.h"
+#include "cpp/core/galaxy_fs.h"
+#include "cpp/core/galaxy_meta_cache.h"
+#include "cpp/internal/galaxy_fs_internal.h"
+#include "glog/logging.h"
+
+namespace galaxy
+{
+    namespace
+    {
+        constexpr uint32_t kWatchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | IN_ATTRIB |
+                                        IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+        // Rough memory taken by a directory and by one of its entries, besides their names.
+        constexpr size_t kDirOverhead = 256;
+        constexpr size_t kEntryOverhead = sizeof(struct stat) + 32;
+
+        std::string ParentKey(const std::string &key)
+        {
+            size_t pos = key.find_last_of('/');
+            return pos == 0 ? "/" : key.substr(0, pos);
+        }
+
+        std::string BaseName(const std::string &key)
+        {
+            return key.substr(key.find_last_of('/') + 1);
+        }
+
+        // Whether key is root or a path under it without empty, "." or ".." components, so that one directory
+        // always has the same key.
+        bool IsCanonicalUnder(const std::string &root, const std::string &key)
+        {
+            if (key == root)
+            {
+                return true;
+            }
+            std::string prefix = root == "/" ? "/" : root + "/";
+            if (key.compare(0, prefix.size(), prefix) != 0)
+            {
+                return false;
+            }
+            for (absl::string_view component : absl::StrSplit(key.substr(prefix.size()), '/'))
+            {
+                if (component.empty() || component == "." || component == "..")
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Mode of what path points to, as internal::ExistFile and ExistDir see it.
+        mode_t TargetMode(const std::string &path, const struct stat &attr)
+        {
+            if (!S_ISLNK(attr.st_mode))
+            {
+                return attr.st_mode;
+            }
+            struct stat target;
+            return stat(path.c_str(), &target) == 0 ? target.st_mode : 0;
+        }
+
+        // Attributes of the entry at path, cached as attr. Files with several links can change through a name in
+        // another directory without any event here.
+        struct stat FreshAttr(const std::string &path, const struct stat &attr)
+        {
+            struct stat statbuf = attr;
+            if (!S_ISDIR(attr.st_mode) && attr.st_nlink > 1)
+            {
+                lstat(path.c_str(), &statbuf);
+            }
+            return statbuf;
+        }
+    } // namespace
+
+    MetaCache::MetaCache(const std::string &root, size_t budget_bytes)
+        : root_(root.size() > 1 && root.back() == '/' ? root.substr(0, root.size() - 1) : root), budget_bytes_(budget_bytes)
+    {
+        if (root_.empty() || root_[0] != '/')
+        {
+            LOG(ERROR) << "Metadata cache disabled, the root " << root_ << " is not an absolute path.";
+            return;
+        }
+        inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd_ < 0)
+        {
+            LOG(ERROR) << "Metadata cache disabled, inotify failed with error " << std::strerror(errno) << ".";
+        }
+    }
+
+    MetaCache::~MetaCache()
+    {
+        if (inotify_fd_ >= 0)
+        {
+            close(inotify_fd_);
+        }
+    }
+
+    void MetaCache::Invalidate(const std::string &path)
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        Drain();
+        ParentChanged(path);
+    }
+
+    size_t MetaCache::bytes()
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        return bytes_;
+    }
+
+    absl::Status MetaCache::ListDirsInDir(const std::string &path, absl::flat_hash_map<std::string, struct stat> &sub_dirs,
+                                          bool *hit)
+    {
+        absl::flat_hash_map<std::string, struct stat> children;
+        *hit = false;
+        if (!Listing(path, children, hit).ok())
+        {
+            return GalaxyFs::Instance()->ListDirsInDir(path, sub_dirs);
+        }
+        for (const auto &child : children)
+        {
+            std::string child_path = internal::JoinPath(path, child.first);
+            if (child.first[0] != '.' && (TargetMode(child_path, child.second) & S_IFDIR))
+            {
+                sub_dirs.insert({child_path, child.second});
+            }
+        }
+        return absl::OkStatus();
+    }
+
+    absl::Status MetaCache::ListFilesInDir(const std::string &path, absl::flat_hash_map<std::string, struct stat> &sub_files,
+                                           bool include_hidden, bool *hit)
+    {
+        absl::flat_hash_map<std::string, struct stat> children;
+        *hit = false;
+        if (!Listing(path, children, hit).ok())
+        {
+            return GalaxyFs::Instance()->ListFilesInDir(path, sub_files, include_hidden);
+        }
+        for (const auto &child : children)
+        {
+            std::string child_path = internal::JoinPath(path, child.first);
+            if ((include_hidden || child.first[0] != '.') && (TargetMode(child_path, child.second) & S_IFREG))
+            {
+                sub_files.insert({child_path, FreshAttr(child_path, child.second)});
+            }
+        }
+        return absl::OkStatus();
+    }
+
+    absl::Status MetaCache::ListAllInDirRecursive(const std::string &path, absl::flat_hash_map<std::string, struct stat> &sub_dirs,
+                                                  absl::flat_hash_map<std::string, struct stat> &sub_files, bool include_hidden,
+                                                  bool *hit)
+    {
+        *hit = true;
+        absl::flat_hash_map<std::string, struct stat> dirs;
+        absl::flat_hash_map<std::string, struct stat> files;
+        std::string key = path.size() > 1 && path.back() == '/' ? path.substr(0, path.size() - 1) : path;
+        if (!ListRecursive(path, key, dirs, files, include_hidden, hit).ok())
+        {
+            *hit = false;
+            return GalaxyFs::Instance()->ListAllInDirRecursive(path, sub_dirs, sub_files, include_hidden);
+        }
+        sub_dirs.insert(dirs.begin(), dirs.end());
+        sub_files.insert(files.begin(), files.end());
+        return absl::OkStatus();
+    }
+
+    absl::Status MetaCache::ListRecursive(const std::string &path, const std::string &key,
+                                          absl::flat_hash_map<std::string, struct stat> &sub_dirs,
+                                          absl::flat_hash_map<std::string, struct stat> &sub_files, bool include_hidden, bool *hit)
+    {
+        absl::flat_hash_map<std::string, struct stat> children;
+        bool listing_hit = false;
+        absl::Status status = Listing(key, children, &listing_hit);
+        if (!status.ok())
+        {
+            return status;
+        }
+        *hit = *hit && listing_hit;
+        for (const auto &child : children)
+        {
+            std::string child_path = internal::JoinPath(path, child.first);
+            mode_t mode = TargetMode(child_path, child.second);
+            if (child.first[0] != '.' && (mode & S_IFDIR))
+            {
+                sub_dirs.insert({child_path, child.second});
+                // Keys are canonical, so the one of a child is the same whatever path it was reached by.
+                std::string child_key = (key == "/" ? "" : key) + "/" + child.first;
+                if (!ListRecursive(child_path, child_key, sub_dirs, sub_files, include_hidden, hit).ok())
+                {
+                    // E.g. a directory reached through a symlink, which watches do not follow.
+                    *hit = false;
+                    status = GalaxyFs::Instance()->ListAllInDirRecursive(child_path, sub_dirs, sub_files, include_hidden);
+                    if (!status.ok())
+                    {
+                        LOG(ERROR) << "Directory " << child_path << " failed to be listed with error " << status;
+                    }
+                }
+            }
+            if ((include_hidden || child.first[0] != '.') && (mode & S_IFREG))
+            {
+                sub_files.insert({child_path, FreshAttr(child_path, child.second)});
+            }
+        }
+        return absl::OkStatus();
+    }
+
+    absl::Status MetaCache::GetAttr(const std::string &path, struct stat *statbuf, bool *hit)
+    {
+        *hit = false;
+        std::unique_lock<std::mutex> lock(mu_);
+        Drain();
+        std::string name = BaseName(path);
+        // A trailing slash or a dot component asks the kernel for more than the entry itself.
+        Dir *dir = path == root_ || name.empty() || name == "." || name == ".." ? nullptr : Watch(ParentKey(path));
+        if (dir == nullptr)
+        {
+            lock.unlock();
+            return GalaxyFs::Instance()->GetAttr(path, statbuf);
+        }
+        if (!dir->stale.contains(name))
+        {
+            auto child = dir->children.find(name);
+            if (child != dir->children.end())
+            {
+                *hit = true;
+                *statbuf = child->second;
+                lock.unlock();
+                *statbuf = FreshAttr(path, *statbuf);
+                return absl::OkStatus();
+            }
+            if (dir->listed)
+            {
+                *hit = true;
+                return absl::InvalidArgumentError("GetAttr failed for " + path + ".");
+            }
+        }
+        uint64_t version = dir->version;
+        lock.unlock();
+        absl::Status status = GalaxyFs::Instance()->GetAttr(path, statbuf);
+        lock.lock();
+        Drain();
+        dir = Find(ParentKey(path));
+        if (status.ok() && dir != nullptr && dir->version == version)
+        {
+            if (S_ISDIR(statbuf->st_mode) && Find(path) == nullptr)
+            {
+                // Cached from the next lookup on, once changes to its content are watched.
+                Watch(path);
+            }
+            else
+            {
+                SetChild(dir, name, *statbuf);
+            }
+            Evict();
+        }
+        return status;
+    }
+
+    absl::Status MetaCache::Listing(const std::string &path, absl::flat_hash_map<std::string, struct stat> &children, bool *hit)
+    {
+        std::string key = path.size() > 1 && path.back() == '/' ? path.substr(0, path.size() - 1) : path;
+        std::unique_lock<std::mutex> lock(mu_);
+        Drain();
+        Dir *dir = Watch(key);
+        if (dir == nullptr)
+        {
+            return absl::FailedPreconditionError("Directory " + path + " cannot be cached.");
+        }
+        uint64_t version = dir->version;
+        if (dir->listed)
+        {
+            children = dir->children;
+            if (dir->stale.empty())
+            {
+                *hit = true;
+                return absl::OkStatus();
+            }
+            std::vector<std::string> stale(dir->stale.begin(), dir->stale.end());
+            lock.unlock();
+            for (const auto &name : stale)
+            {
+                struct stat statbuf;
+                if (lstat(internal::JoinPath(key, name).c_str(), &statbuf) == 0)
+                {
+                    children[name] = statbuf;
+                }
+                else
+                {
+                    children.erase(name);
+                }
+            }
+        }
+        else
+        {
+            lock.unlock();
+            DIR *dirp = opendir(key.c_str());
+            if (dirp == nullptr)
+            {
+                return absl::NotFoundError("Opening directory " + path + " failed.");
+            }
+            struct dirent *dp;
+            while ((dp = readdir(dirp)) != nullptr)
+            {
+                std::string name = dp->d_name;
+                struct stat statbuf;
+                // Entries removed since the readdir are left out, as they are by a listing without the cache.
+                if (name != "." && name != ".." && fstatat(dirfd(dirp), dp->d_name, &statbuf, AT_SYMLINK_NOFOLLOW) == 0)
+                {
+                    children[name] = statbuf;
+                }
+            }
+            closedir(dirp);
+        }
+        lock.lock();
+        Drain();
+        dir = Find(key);
+        if (dir != nullptr && dir->version == version)
+        {
+            Install(dir, children);
+            Evict();
+        }
+        return absl::OkStatus();
+    }
+
+    void MetaCache::Drain()
+    {
+        if (inotify_fd_ < 0)
+        {
+            return;
+        }
+        alignas(struct inotify_event) char buffer[65536];
+        while (true)
+        {
+            ssize_t length = read(inotify_fd_, buffer, sizeof(buffer));
+            if (length <= 0)
+            {
+                return;
+            }
+            for (char *p = buffer; p < buffer + length;)
+            {
+                const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(p);
+                p += sizeof(struct inotify_event) + event->len;
+                if (event->mask & IN_Q_OVERFLOW)
+                {
+                    LOG(WARNING) << "Metadata cache cleared after an inotify queue overflow.";
+                    for (auto &cached : lru_)
+                    {
+                        ++cached.version;
+                        cached.listed = false;
+                        cached.stale.clear();
+                        SetChildren(&cached, {});
+                    }
+                    continue;
+                }
+                auto watch = watches_.find(event->wd);
+                if (watch == watches_.end())
+                {
+                    continue;
+                }
+                std::string key = watch->second;
+                if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT))
+                {
+                    Drop(key);
+                    continue;
+                }
+                Dir *dir = Find(key);
+                ++dir->version;
+                if (event->len == 0)
+                {
+                    ParentChanged(key);
+                    continue;
+                }
+                std::string name = event->name;
+                if (event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO))
+                {
+                    // Whatever was cached under the name was replaced or moved away.
+                    Drop((key == "/" ? "" : key) + "/" + name);
+                    ParentChanged(key);
+                }
+                if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+                {
+                    EraseChild(dir, name);
+                }
+                else if (dir->listed)
+                {
+                    dir->stale.insert(name);
+                }
+                else
+                {
+                    EraseChild(dir, name);
+                }
+            }
+        }
+    }
+
+    MetaCache::Dir *MetaCache::Watch(const std::string &key)
+    {
+        Dir *dir = Find(key);
+        if (dir == nullptr)
+        {
+            if (inotify_fd_ < 0 || !IsCanonicalUnder(root_, key) || (key != root_ && Watch(ParentKey(key)) == nullptr))
+            {
+                return nullptr;
+            }
+            int wd = inotify_add_watch(inotify_fd_, key.c_str(), kWatchMask);
+            if (wd < 0)
+            {
+                VLOG(1) << "Not caching " << key << ", watching it failed with error " << std::strerror(errno) << ".";
+                return nullptr;
+            }
+            auto watch = watches_.find(wd);
+            if (watch != watches_.end() && watch->second != key)
+            {
+                // The same directory under another path, e.g. through a bind mount.
+                return nullptr;
+            }
+            lru_.emplace_front();
+            dir = &lru_.front();
+            dir->path = key;
+            dir->wd = wd;
+            dir->bytes = kDirOverhead + key.size();
+            bytes_ += dir->bytes;
+            dirs_[key] = lru_.begin();
+            watches_[wd] = key;
+        }
+        // Ancestors are kept more recent than their descendants, so that eviction starts with the leaves.
+        for (std::string ancestor = key;; ancestor = ParentKey(ancestor))
+        {
+            lru_.splice(lru_.begin(), lru_, dirs_[ancestor]);
+            if (ancestor == root_ || ancestor == "/")
+            {
+                break;
+            }
+        }
+        return dir;
+    }
+
+    void MetaCache::Install(Dir *dir, absl::flat_hash_map<std::string, struct stat> children)
+    {
+        SetChildren(dir, std::move(children));
+        dir->listed = true;
+        dir->stale.clear();
+        for (const auto &child : dir->children)
+        {
+            if (!S_ISDIR(child.second.st_mode))
+            {
+                continue;
+            }
+            std::string child_key = (dir->path == "/" ? "" : dir->path) + "/" + child.first;
+            if (Find(child_key) != nullptr)
+            {
+                continue;
+            }
+            if (Watch(child_key) == nullptr)
+            {
+                dir->listed = false;
+                dir->stale.clear();
+                SetChildren(dir, {});
+                return;
+            }
+            // It may have changed between the listing and its watch.
+            dir->stale.insert(child.first);
+        }
+    }
+
+    MetaCache::Dir *MetaCache::Find(const std::string &key)
+    {
+        auto entry = dirs_.find(key);
+        return entry == dirs_.end() ? nullptr : &*entry->second;
+    }
+
+    void MetaCache::SetChildren(Dir *dir, absl::flat_hash_map<std::string, struct stat> children)
+    {
+        bytes_ -= dir->bytes;
+        dir->children = std::move(children);
+        dir->bytes = kDirOverhead + dir->path.size();
+        for (const auto &child : dir->children)
+        {
+            dir->bytes += kEntryOverhead + child.first.size();
+        }
+        bytes_ += dir->bytes;
+    }
+
+    void MetaCache::SetChild(Dir *dir, const std::string &name, const struct stat &statbuf)
+    {
+        if (dir->children.insert_or_assign(name, statbuf).second)
+        {
+            dir->bytes += kEntryOverhead + name.size();
+            bytes_ += kEntryOverhead + name.size();
+        }
+        dir->stale.erase(name);
+    }
+
+    void MetaCache::EraseChild(Dir *dir, const std::string &name)
+    {
+        if (dir->children.erase(name) > 0)
+        {
+            dir->bytes -= kEntryOverhead + name.size();
+            bytes_ -= kEntryOverhead + name.size();
+        }
+        dir->stale.erase(name);
+    }
+
+    void MetaCache::ParentChanged(const std::string &key)
+    {
+        if (key == root_ || key == "/")
+        {
+            return;
+        }
+        Dir *parent = Find(ParentKey(key));
+        if (parent == nullptr)
+        {
+            return;
+        }
+        ++parent->version;
+        if (parent->listed)
+        {
+            parent->stale.insert(BaseName(key));
+        }
+        else
+        {
+            EraseChild(parent, BaseName(key));
+        }
+    }
+
+    void MetaCache::Drop(const std::string &key)
+    {
+        // Cached directories always have their ancestors cached, so nothing is cached under a key that is not.
+        if (dirs_.find(key) == dirs_.end())
+        {
+            return;
+        }
+        std::string prefix = key == "/" ? "/" : key + "/";
+        for (auto it = lru_.begin(); it != lru_.end();)
+        {
+            if (it->path == key || it->path.compare(0, prefix.size(), prefix) == 0)
+            {
+                inotify_rm_watch(inotify_fd_, it->wd);
+                watches_.erase(it->wd);
+                bytes_ -= it->bytes;
+                dirs_.erase(it->path);
+                it = lru_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    void MetaCache::Evict()
+    {
+        while (bytes_ > budget_bytes_ && !lru_.empty())
+        {
+            std::string key = lru_.back().path;
+            // The attributes of a directory are only kept while it is watched.
+            Dir *parent = key == root_ ? nullptr : Find(ParentKey(key));
+            if (parent != nullptr && parent->listed)
+            {
+                ++parent->version;
+                parent->listed = false;
+                parent->stale.clear();
+                SetChildren(parent, {});
+            }
+            else if (parent != nullptr)
+            {
+                EraseChild(parent, BaseName(key));
+            }
+            Drop(key);
+        }
+    }
+} //  namespace galaxy.
@@ -0,0 +1,104 @@
+#ifndef CPP_CORE_GALAXY_META_CACHE_H_
+#define CPP_CORE_GALAXY_META_CACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+
+namespace galaxy
+{
+    // Directory entries and attributes of the directories under a cell root, so that the listings and stats polled
+    // by clients do not go through a readdir and a stat per entry every time. Each cached directory and its
+    // ancestors are watched with inotify, and the events queued by the kernel are applied before every lookup.
+    // Since the kernel queues them within the call that changes the directory, lookups see every change made
+    // before them, by the server or by anyone else. Least recently used directories are dropped once the entries
+    // take more than the budget.
+    //
+    // Symlinks, and files with several links whose other names may be in directories that are not watched, are
+    // stat'ed again on every lookup. A file that gains a link elsewhere is only reported on the directory of the
+    // new name, so whoever links it calls Invalidate on the old one. Paths outside the root, paths that are not canonical and directories that
+    // cannot be watched are served by GalaxyFs directly, as are all calls if inotify is not available.
+    class MetaCache
+    {
+    public:
+        MetaCache(const std::string &root, size_t budget_bytes);
+        ~MetaCache();
+        MetaCache(const MetaCache&) = delete;
+
+        // Same results as the functions of the same name in GalaxyFs, for absolute paths. hit is set if they were
+        // served from the cache.
+        absl::Status ListDirsInDir(const std::string &path, absl::flat_hash_map<std::string, struct stat> &sub_dirs, bool *hit);
+        absl::Status ListFilesInDir(const std::string &path, absl::flat_hash_map<std::string, struct stat> &sub_files,
+                                    bool include_hidden, bool *hit);
+        absl::Status ListAllInDirRecursive(const std::string &path, absl::flat_hash_map<std::string, struct stat> &sub_dirs,
+                                           absl::flat_hash_map<std::string, struct stat> &sub_files, bool include_hidden,
+                                           bool *hit);
+        absl::Status GetAttr(const std::string &path, struct stat *statbuf, bool *hit);
+
+        // Drops the attributes of path, for changes that are not reported on its directory, e.g. a hard link to it
+        // made in another directory.
+        void Invalidate(const std::string &path);
+
+        // Memory taken by the cached entries.
+        size_t bytes();
+
+    private:
+        struct Dir
+        {
+            std::string path;
+            int wd = -1;
+            // Whether children holds every entry of the directory, or only the ones looked up by GetAttr.
+            bool listed = false;
+            // Incremented by every event on the directory, so that results read while it changed are not kept.
+            uint64_t version = 0;
+            // lstat of the entries by name.
+            absl::flat_hash_map<std::string, struct stat> children;
+            // Entries of a listed directory created or modified since, to be stat'ed again.
+            absl::flat_hash_set<std::string> stale;
+            size_t bytes = 0;
+        };
+        using LruList = std::list<Dir>;
+
+        // Entries of the directory at key, from the cache or read into it. Fails if the directory cannot be cached.
+        absl::Status Listing(const std::string &key, absl::flat_hash_map<std::string, struct stat> &children, bool *hit);
+        absl::Status ListRecursive(const std::string &path, const std::string &key,
+                                   absl::flat_hash_map<std::string, struct stat> &sub_dirs,
+                                   absl::flat_hash_map<std::string, struct stat> &sub_files, bool include_hidden, bool *hit);
+
+        // The functions below are called with mu_ held.
+
+        // Applies the events queued by the kernel so far.
+        void Drain();
+        // Entry of the directory at key, watched along with its ancestors up to the root. Null if it cannot be.
+        Dir *Watch(const std::string &key);
+        Dir *Find(const std::string &key);
+        // Keeps children as the whole content of dir. Its subdirectories are watched as well, since their own
+        // attributes change with their content.
+        void Install(Dir *dir, absl::flat_hash_map<std::string, struct stat> children);
+        void SetChildren(Dir *dir, absl::flat_hash_map<std::string, struct stat> children);
+        void SetChild(Dir *dir, const std::string &name, const struct stat &statbuf);
+        void EraseChild(Dir *dir, const std::string &name);
+        // The attributes of the directory at key changed, so its entry in its parent is no longer valid.
+        void ParentChanged(const std::string &key);
+        // Forgets the directory at key and every directory under it.
+        void Drop(const std::string &key);
+        void Evict();
+
+        const std::string root_;
+        const size_t budget_bytes_;
+        int inotify_fd_ = -1;
+        std::mutex mu_;
+        // Most recently used first, ancestors before their descendants.
+        LruList lru_;
+        absl::flat_hash_map<std::string, LruList::iterator> dirs_;
+        absl::flat_hash_map<int, std::string> watches_;
+        size_t bytes_ = 0;
+    };
+} //  namespace galaxy.
+#endif   //  CPP_CORE_GALAXY_META_CACHE_H_
@@ -0,0 +1,168 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <gtest/gtest.h>
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "cpp/core/galaxy_meta_cache.h"
+#include "cpp/internal/galaxy_fs_internal.h"
+
+namespace {
+    using galaxy::MetaCache;
+    using galaxy::internal::JoinPath;
+    using Entries = absl::flat_hash_map<std::string, struct stat>;
+
+    std::string NewRoot(const std::string& name) {
+        std::string root = JoinPath(testing::TempDir(), absl::StrCat("galaxy_meta_cache_test_", getpid(), "_", name));
+        EXPECT_TRUE(galaxy::impl::CreateDirIfNotExist(root, 0777).ok());
+        return root;
+    }
+
+    void WriteFile(const std::string& path, const std::string& data) {
+        std::ofstream(path) << data;
+    }
+
+    Entries ListFiles(MetaCache& cache, const std::string& path, bool* hit) {
+        Entries files;
+        EXPECT_TRUE(cache.ListFilesInDir(path, files, false, hit).ok());
+        return files;
+    }
+
+    TEST(MetaCacheTest, ListingServedFromCache) {
+        std::string root = NewRoot("listing");
+        WriteFile(JoinPath(root, "a"), "a");
+        WriteFile(JoinPath(root, ".hidden"), "");
+        MetaCache cache(root, 1 << 20);
+        bool hit = true;
+        Entries files = ListFiles(cache, root, &hit);
+        EXPECT_FALSE(hit);
+        ASSERT_EQ(files.size(), 1);
+        EXPECT_EQ(files[JoinPath(root, "a")].st_size, 1);
+
+        files = ListFiles(cache, root, &hit);
+        EXPECT_TRUE(hit);
+        EXPECT_EQ(files.size(), 1);
+        EXPECT_GT(cache.bytes(), 0);
+
+        Entries all;
+        EXPECT_TRUE(cache.ListFilesInDir(root, all, true, &hit).ok());
+        EXPECT_TRUE(hit);
+        EXPECT_EQ(all.size(), 2);
+    }
+
+    TEST(MetaCacheTest, SeesChangesMadeOutside) {
+        std::string root = NewRoot("changes");
+        std::string a = JoinPath(root, "a");
+        WriteFile(a, "a");
+        MetaCache cache(root, 1 << 20);
+        bool hit;
+        ListFiles(cache, root, &hit);
+        ListFiles(cache, root, &hit);
+        ASSERT_TRUE(hit);
+
+        WriteFile(a, "longer");
+        WriteFile(JoinPath(root, "b"), "b");
+        Entries files = ListFiles(cache, root, &hit);
+        EXPECT_FALSE(hit);
+        ASSERT_EQ(files.size(), 2);
+        EXPECT_EQ(files[a].st_size, 6);
+
+        ASSERT_EQ(unlink(a.c_str()), 0);
+        files = ListFiles(cache, root, &hit);
+        EXPECT_EQ(files.size(), 1);
+        EXPECT_EQ(files.count(a), 0);
+
+        ASSERT_EQ(rename(JoinPath(root, "b").c_str(), a.c_str()), 0);
+        files = ListFiles(cache, root, &hit);
+        ASSERT_EQ(files.size(), 1);
+        EXPECT_EQ(files[a].st_size, 1);
+    }
+
+    TEST(MetaCacheTest, GetAttr) {
+        std::string root = NewRoot("attr");
+        std::string a = JoinPath(root, "a");
+        WriteFile(a, "a");
+        MetaCache cache(root, 1 << 20);
+        struct stat statbuf;
+        bool hit;
+        EXPECT_TRUE(cache.GetAttr(a, &statbuf, &hit).ok());
+        EXPECT_FALSE(hit);
+        EXPECT_TRUE(cache.GetAttr(a, &statbuf, &hit).ok());
+        EXPECT_TRUE(hit);
+        EXPECT_EQ(statbuf.st_size, 1);
+
+        WriteFile(a, "ab");
+        EXPECT_TRUE(cache.GetAttr(a, &statbuf, &hit).ok());
+        EXPECT_FALSE(hit);
+        EXPECT_EQ(statbuf.st_size, 2);
+
+        // Names missing from a listed directory fail without a lookup.
+        ListFiles(cache, root, &hit);
+        EXPECT_FALSE(cache.GetAttr(JoinPath(root, "none"), &statbuf, &hit).ok());
+        EXPECT_TRUE(hit);
+    }
+
+    TEST(MetaCacheTest, SubdirsAndRecursiveListing) {
+        std::string root = NewRoot("recursive");
+        ASSERT_TRUE(galaxy::impl::CreateDirIfNotExist(JoinPath(root, "d/e"), 0777).ok());
+        WriteFile(JoinPath(root, "d/e/f"), "f");
+        MetaCache cache(root, 1 << 20);
+        Entries dirs;
+        Entries files;
+        bool hit;
+        EXPECT_TRUE(cache.ListAllInDirRecursive(root, dirs, files, false, &hit).ok());
+        EXPECT_FALSE(hit);
+        EXPECT_EQ(dirs.size(), 2);
+        ASSERT_EQ(files.size(), 1);
+        EXPECT_EQ(files.begin()->first, JoinPath(root, "d/e/f"));
+
+        // A file created deep down shows up on the next listing.
+        WriteFile(JoinPath(root, "d/e/g"), "g");
+        dirs.clear();
+        files.clear();
+        EXPECT_TRUE(cache.ListAllInDirRecursive(root, dirs, files, false, &hit).ok());
+        EXPECT_EQ(files.size(), 2);
+
+        Entries sub_dirs;
+        EXPECT_TRUE(cache.ListDirsInDir(JoinPath(root, "d"), sub_dirs, &hit).ok());
+        ASSERT_EQ(sub_dirs.size(), 1);
+        EXPECT_EQ(sub_dirs.begin()->first, JoinPath(root, "d/e"));
+    }
+
+    TEST(MetaCacheTest, PathsOutsideRootAreNotCached) {
+        std::string root = NewRoot("outside");
+        std::string other = NewRoot("outside_other");
+        WriteFile(JoinPath(other, "a"), "a");
+        MetaCache cache(root, 1 << 20);
+        bool hit;
+        for (int i = 0; i < 2; i++) {
+            Entries files = ListFiles(cache, other, &hit);
+            EXPECT_FALSE(hit);
+            EXPECT_EQ(files.size(), 1);
+        }
+        // Not canonical, so served directly as well.
+        ListFiles(cache, root + "/./", &hit);
+        ListFiles(cache, root + "/./", &hit);
+        EXPECT_FALSE(hit);
+    }
+
+    TEST(MetaCacheTest, StaysWithinBudget) {
+        std::string root = NewRoot("budget");
+        for (int i = 0; i < 4; i++) {
+            std::string dir = JoinPath(root, absl::StrCat("d", i));
+            ASSERT_TRUE(galaxy::impl::CreateDirIfNotExist(dir, 0777).ok());
+            for (int j = 0; j < 16; j++) {
+                WriteFile(JoinPath(dir, absl::StrCat("f", j)), "");
+            }
+        }
+        const size_t budget = 4096;
+        MetaCache cache(root, budget);
+        bool hit;
+        for (int i = 0; i < 4; i++) {
+            EXPECT_EQ(ListFiles(cache, JoinPath(root, absl::StrCat("d", i)), &hit).size(), 16);
+            EXPECT_LE(cache.bytes(), budget);
+        }
+    }
+}  // namespace
@@ -0,0 +1,457 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <thread>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "cpp/core/galaxy_scan.h"
+#include "cpp/core/galaxy_tail.h"
+#include "cpp/internal/galaxy_const.h"
+#include "cpp/util/galaxy_hash.h"
+#include "glog/logging.h"
+#include "re2/re2.h"
+
+namespace galaxy
+{
+    namespace
+    {
+        absl::Status ErrnoStatus(const std::string &message)
+        {
+            std::string error = absl::StrCat(message, " with error ", std::strerror(errno), ".");
+            return errno == ENOENT ? absl::NotFoundError(error) : absl::InternalError(error);
+        }
+
+        // Reads the next chunk of fd into buffer, after what it already holds. Returns 0 at the end of the file.
+        absl::StatusOr<size_t> ReadChunk(int fd, std::string *buffer)
+        {
+            size_t size = buffer->size();
+            buffer->resize(size + galaxy::constant::kChunkSize);
+            while (true)
+            {
+                ssize_t num_read = read(fd, &(*buffer)[size], galaxy::constant::kChunkSize);
+                if (num_read >= 0)
+                {
+                    buffer->resize(size + num_read);
+                    return num_read;
+                }
+                if (errno != EINTR)
+                {
+                    buffer->resize(size);
+                    return ErrnoStatus("Fail to read for Scan");
+                }
+            }
+        }
+
+        // Takes up to size bytes from budget, and returns how many it got. All of them if there is no budget.
+        int64_t Take(std::atomic<int64_t> *budget, int64_t size)
+        {
+            if (budget == nullptr)
+            {
+                return size;
+            }
+            int64_t left = budget->load(std::memory_order_relaxed);
+            while (true)
+            {
+                int64_t taken = std::max<int64_t>(std::min(size, left), 0);
+                if (taken == 0 || budget->compare_exchange_weak(left, left - taken, std::memory_order_relaxed))
+                {
+                    return taken;
+                }
+            }
+        }
+
+        // Takes size bytes from budget if that many are left, and nothing otherwise.
+        bool TakeAll(std::atomic<int64_t> *budget, int64_t size)
+        {
+            int64_t taken = Take(budget, size);
+            if (taken < size)
+            {
+                budget->fetch_add(taken, std::memory_order_relaxed);
+                return false;
+            }
+            return true;
+        }
+
+        int64_t NumLines(absl::string_view data)
+        {
+            int64_t count = 0;
+            const char *end = data.data() + data.size();
+            for (const char *p = data.data(); (p = static_cast<const char *>(memchr(p, '\n', end - p))) != nullptr; ++p)
+            {
+                ++count;
+            }
+            return count + (!data.empty() && data.back() != '\n' ? 1 : 0);
+        }
+    } // namespace
+
+    Scanner::Scanner(const Options &options) : options_(options)
+    {
+    }
+
+    Scanner::~Scanner() = default;
+
+    absl::Status Scanner::Init()
+    {
+        if (options_.op > kHash)
+        {
+            return absl::InvalidArgumentError(absl::StrCat("Unknown scan operator ", options_.op, "."));
+        }
+        if (options_.max_lines < 0 || options_.max_bytes < 0)
+        {
+            return absl::InvalidArgumentError("Negative limits for Scan.");
+        }
+        if ((options_.op == kHead || options_.op == kTail) && options_.max_lines == 0 && options_.max_bytes == 0)
+        {
+            options_.max_lines = galaxy::constant::kScanDefaultLines;
+        }
+        if (options_.op == kGrep && options_.pattern.find('\n') != std::string::npos)
+        {
+            return absl::InvalidArgumentError("Patterns of Scan match within lines, and cannot hold a newline.");
+        }
+        if (options_.op == kGrep && options_.regex)
+        {
+            RE2::Options re2_options;
+            re2_options.set_log_errors(false);
+            regex_ = std::make_unique<RE2>(options_.pattern, re2_options);
+            if (!regex_->ok())
+            {
+                return absl::InvalidArgumentError("Invalid regular expression " + options_.pattern + ": " + regex_->error());
+            }
+        }
+        return absl::OkStatus();
+    }
+
+    absl::Status Scanner::ScanFile(const std::string &path, Output *output) const
+    {
+        // Operators whose output is their data are not worth running once the budget is spent. Grep and CountLines
+        // still count.
+        if (options_.budget && options_.budget->load(std::memory_order_relaxed) <= 0 &&
+            (options_.op == kHead || options_.op == kTail || options_.op == kHash))
+        {
+            output->truncated = true;
+            output->over_budget = true;
+            return absl::OkStatus();
+        }
+        if (options_.op == kHash)
+        {
+            absl::StatusOr<std::string> hash = galaxy::util::HashFile(path);
+            if (!hash.ok())
+            {
+                return hash.status();
+            }
+            if (TakeAll(options_.budget.get(), hash->size()))
+            {
+                output->data = *hash;
+            }
+            else
+            {
+                output->truncated = true;
+                output->over_budget = true;
+            }
+            return absl::OkStatus();
+        }
+        if (options_.op == kTail)
+        {
+            return Tail(path, output);
+        }
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return ErrnoStatus("Fail to open " + path + " for Scan");
+        }
+        struct stat statbuf;
+        absl::Status status;
+        if (fstat(fd, &statbuf) != 0)
+        {
+            status = ErrnoStatus("Fail to stat " + path + " for Scan");
+        }
+        else if (!S_ISREG(statbuf.st_mode))
+        {
+            status = absl::InvalidArgumentError("Path " + path + " is not a file for Scan.");
+        }
+        else
+        {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            status = options_.op == kGrep ? Grep(fd, output) : options_.op == kCountLines ? CountLines(fd, output)
+                                                                                          : Head(fd, output);
+        }
+        close(fd);
+        return status;
+    }
+
+    std::vector<absl::StatusOr<Scanner::Output>> Scanner::ScanFiles(const std::vector<std::string> &paths) const
+    {
+        std::vector<absl::StatusOr<Output>> results(paths.size());
+        std::atomic<size_t> next{0};
+        auto work = [&]() {
+            for (size_t i = next++; i < paths.size(); i = next++)
+            {
+                Output output;
+                absl::Status status = ScanFile(paths[i], &output);
+                if (status.ok())
+                {
+                    results[i] = std::move(output);
+                }
+                else
+                {
+                    // Errors are sent along with the data, so they count as well, even past the budget.
+                    if (options_.budget)
+                    {
+                        options_.budget->fetch_sub(status.ToString().size(), std::memory_order_relaxed);
+                    }
+                    results[i] = status;
+                }
+            }
+        };
+        size_t num_threads = std::min<size_t>(galaxy::constant::kScanNumThreads, paths.size());
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < num_threads; ++i)
+        {
+            threads.emplace_back(work);
+        }
+        work();
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        return results;
+    }
+
+    absl::Status Scanner::Grep(int fd, Output *output) const
+    {
+        // Lines are matched once complete, so that the partial last line of a chunk waits for the next one. A line
+        // that outgrows kScanMaxLineSize is matched on what was read of it, and its rest is skipped.
+        const size_t max_line_size = galaxy::constant::kScanMaxLineSize;
+        std::string buffer;
+        bool skipping = false;
+        while (true)
+        {
+            absl::StatusOr<size_t> num_read = ReadChunk(fd, &buffer);
+            if (!num_read.ok())
+            {
+                return num_read.status();
+            }
+            if (skipping)
+            {
+                const char *newline = static_cast<const char *>(memchr(buffer.data(), '\n', buffer.size()));
+                buffer.erase(0, newline == nullptr ? buffer.size() : newline - buffer.data() + 1);
+                skipping = newline == nullptr;
+            }
+            if (*num_read == 0)
+            {
+                GrepLines(buffer, output);
+                return absl::OkStatus();
+            }
+            const char *last = static_cast<const char *>(memrchr(buffer.data(), '\n', buffer.size()));
+            if (last != nullptr)
+            {
+                size_t end = last - buffer.data() + 1;
+                GrepLines(absl::string_view(buffer.data(), end), output);
+                buffer.erase(0, end);
+            }
+            if (buffer.size() >= max_line_size)
+            {
+                GrepLines(absl::string_view(buffer.data(), max_line_size), output);
+                buffer.clear();
+                skipping = true;
+            }
+        }
+    }
+
+    void Scanner::GrepLines(absl::string_view data, Output *output) const
+    {
+        const char *begin = data.data();
+        const char *end = begin + data.size();
+        const char *pos = begin;
+        while (pos < end)
+        {
+            const char *line_begin = pos;
+            const char *line_end = nullptr;
+            if (regex_)
+            {
+                line_end = static_cast<const char *>(memchr(pos, '\n', end - pos));
+                line_end = line_end == nullptr ? end : line_end;
+                absl::string_view line(line_begin, line_end - line_begin);
+                if (RE2::PartialMatch(re2::StringPiece(line.data(), line.size()), *regex_))
+                {
+                    AddLine(line, output);
+                }
+            }
+            else
+            {
+                // Jumps straight to the next occurrence, skipping the lines in between without looking at them.
+                const char *match = static_cast<const char *>(
+                    memmem(pos, end - pos, options_.pattern.data(), options_.pattern.size()));
+                if (match == nullptr)
+                {
+                    return;
+                }
+                const char *newline = static_cast<const char *>(memrchr(pos, '\n', match - pos));
+                line_begin = newline == nullptr ? pos : newline + 1;
+                line_end = static_cast<const char *>(memchr(match, '\n', end - match));
+                line_end = line_end == nullptr ? end : line_end;
+                AddLine(absl::string_view(line_begin, line_end - line_begin), output);
+            }
+            pos = line_end + 1;
+        }
+    }
+
+    void Scanner::AddLine(absl::string_view line, Output *output) const
+    {
+        ++output->count;
+        if (output->truncated)
+        {
+            return;
+        }
+        if ((options_.max_lines > 0 && output->count > options_.max_lines) ||
+            (options_.max_bytes > 0 && output->data.size() + line.size() + 1 > static_cast<size_t>(options_.max_bytes)))
+        {
+            output->truncated = true;
+            return;
+        }
+        if (!TakeAll(options_.budget.get(), line.size() + 1))
+        {
+            output->truncated = true;
+            output->over_budget = true;
+            return;
+        }
+        output->data.append(line.data(), line.size());
+        output->data.push_back('\n');
+    }
+
+    absl::Status Scanner::CountLines(int fd, Output *output) const
+    {
+        std::string buffer;
+        char last = '\n';
+        while (true)
+        {
+            buffer.clear();
+            absl::StatusOr<size_t> num_read = ReadChunk(fd, &buffer);
+            if (!num_read.ok())
+            {
+                return num_read.status();
+            }
+            if (*num_read == 0)
+            {
+                // An unterminated last line counts as well.
+                output->count += last != '\n' ? 1 : 0;
+                return absl::OkStatus();
+            }
+            const char *end = buffer.data() + buffer.size();
+            for (const char *p = buffer.data(); (p = static_cast<const char *>(memchr(p, '\n', end - p))) != nullptr; ++p)
+            {
+                ++output->count;
+            }
+            last = buffer.back();
+        }
+    }
+
+    absl::Status Scanner::Head(int fd, Output *output) const
+    {
+        std::string &data = output->data;
+        int64_t num_lines = 0;
+        // End of the last line kept so far.
+        size_t end = 0;
+        while (true)
+        {
+            absl::StatusOr<size_t> num_read = ReadChunk(fd, &data);
+            if (!num_read.ok())
+            {
+                return num_read.status();
+            }
+            while (options_.max_lines > 0 && num_lines < options_.max_lines)
+            {
+                const char *newline = static_cast<const char *>(memchr(data.data() + end, '\n', data.size() - end));
+                if (newline == nullptr)
+                {
+                    break;
+                }
+                end = newline - data.data() + 1;
+                ++num_lines;
+            }
+            if (options_.max_lines > 0 && num_lines >= options_.max_lines)
+            {
+                data.resize(end);
+            }
+            if (options_.max_bytes > 0 && data.size() > static_cast<size_t>(options_.max_bytes))
+            {
+                data.resize(options_.max_bytes);
+            }
+            if (*num_read == 0 || (options_.max_lines > 0 && num_lines >= options_.max_lines) ||
+                (options_.max_bytes > 0 && data.size() >= static_cast<size_t>(options_.max_bytes)))
+            {
+                break;
+            }
+        }
+        struct stat statbuf;
+        output->truncated = fstat(fd, &statbuf) == 0 && static_cast<size_t>(statbuf.st_size) > data.size();
+        FitBudget(false, output);
+        output->count = NumLines(data);
+        return absl::OkStatus();
+    }
+
+    absl::Status Scanner::Tail(const std::string &path, Output *output) const
+    {
+        // Starts at the last max_lines lines, but no earlier than the last max_bytes, so that long lines are not read
+        // only to be dropped.
+        Tailer tailer(path);
+        absl::Status status = tailer.Open(-options_.max_bytes, options_.max_lines, false);
+        if (!status.ok())
+        {
+            return status;
+        }
+        output->truncated = tailer.offset() > 0;
+        while (options_.max_bytes == 0 || output->data.size() < static_cast<size_t>(options_.max_bytes))
+        {
+            std::string data;
+            status = tailer.Read(galaxy::constant::kChunkSize, absl::ZeroDuration(), &data);
+            if (!status.ok())
+            {
+                return status;
+            }
+            if (data.empty())
+            {
+                break;
+            }
+            output->data.append(data);
+        }
+        if (options_.max_bytes > 0 && output->data.size() > static_cast<size_t>(options_.max_bytes))
+        {
+            output->truncated = true;
+            output->data.erase(0, output->data.size() - options_.max_bytes);
+        }
+        FitBudget(true, output);
+        output->count = NumLines(output->data);
+        return absl::OkStatus();
+    }
+
+    void Scanner::FitBudget(bool keep_end, Output *output) const
+    {
+        std::string &data = output->data;
+        int64_t size = Take(options_.budget.get(), data.size());
+        if (size == static_cast<int64_t>(data.size()))
+        {
+            return;
+        }
+        if (keep_end)
+        {
+            // The kept end starts at a line if the byte before it is a newline.
+            size_t newline = size > 0 ? data.find('\n', data.size() - size - 1) : std::string::npos;
+            data.erase(0, newline == std::string::npos ? data.size() : newline + 1);
+        }
+        else
+        {
+            size_t newline = size > 0 ? data.rfind('\n', size - 1) : std::string::npos;
+            data.resize(newline == std::string::npos ? 0 : newline + 1);
+        }
+        // What the cut at a line left over is given back.
+        options_.budget->fetch_add(size - static_cast<int64_t>(data.size()), std::memory_order_relaxed);
+        output->truncated = true;
+        output->over_budget = true;
+    }
+} // namespace galaxy
@@ -0,0 +1,89 @@
+#ifndef CPP_CORE_GALAXY_SCAN_H_
+#define CPP_CORE_GALAXY_SCAN_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+namespace re2
+{
+    class RE2;
+} // namespace re2
+
+namespace galaxy
+{
+    // Small operators run over whole files next to them, e.g. by the server for Scan, so that only their results
+    // are sent instead of the files. Files are read sequentially in chunks, and substrings are looked for with
+    // memchr and memmem, which glibc runs with SIMD instructions.
+    class Scanner
+    {
+    public:
+        // Operators, same values as galaxy_schema::ScanOperator.
+        // Lines holding a substring, or matching a regular expression, and their count. Lines longer than
+        // galaxy::constant::kScanMaxLineSize are matched on their first kScanMaxLineSize bytes only.
+        static constexpr uint32_t kGrep = 0;
+        static constexpr uint32_t kCountLines = 1;
+        static constexpr uint32_t kHead = 2;
+        static constexpr uint32_t kTail = 3;
+        // Hex digest of the xxh3-128 hash of the content.
+        static constexpr uint32_t kHash = 4;
+
+        struct Options
+        {
+            uint32_t op = kGrep;
+            // Substring, or RE2 regular expression if regex is set, for kGrep.
+            std::string pattern;
+            bool regex = false;
+            // Lines and bytes of output kept per file, unlimited if 0. kHead and kTail keep
+            // galaxy::constant::kScanDefaultLines lines if both are 0.
+            int64_t max_lines = 0;
+            int64_t max_bytes = 0;
+            // Bytes of output left for all the files scanned with these options, drawn from as output is kept and by
+            // the errors of ScanFiles, so that files stop keeping data once it is spent. Unlimited if null.
+            std::shared_ptr<std::atomic<int64_t>> budget;
+        };
+
+        struct Output
+        {
+            std::string data;
+            // Matching lines for kGrep, lines of the file for kCountLines, and lines of data for kHead and kTail.
+            int64_t count = 0;
+            // Whether data was cut at max_lines or max_bytes, or to what was left of the budget.
+            bool truncated = false;
+            // Whether data was cut, or left empty, as the budget was spent.
+            bool over_budget = false;
+        };
+
+        explicit Scanner(const Options &options);
+        ~Scanner();
+        Scanner(const Scanner&) = delete;
+
+        // Checks the options, e.g. compiles the regular expression. Must succeed before any scan.
+        absl::Status Init();
+        absl::Status ScanFile(const std::string &path, Output *output) const;
+        // Scans the files concurrently, on up to galaxy::constant::kScanNumThreads threads.
+        std::vector<absl::StatusOr<Output>> ScanFiles(const std::vector<std::string> &paths) const;
+
+    private:
+        absl::Status Grep(int fd, Output *output) const;
+        // Matches the complete lines of data.
+        void GrepLines(absl::string_view data, Output *output) const;
+        // Adds a matching line to output, within the limits.
+        void AddLine(absl::string_view line, Output *output) const;
+        absl::Status CountLines(int fd, Output *output) const;
+        absl::Status Head(int fd, Output *output) const;
+        absl::Status Tail(const std::string &path, Output *output) const;
+        // Cuts the data of output to what is left of the budget, at a line where there is one, keeping the end of
+        // the data if keep_end and its start otherwise, and takes what is kept from the budget.
+        void FitBudget(bool keep_end, Output *output) const;
+
+        Options options_;
+        std::unique_ptr<re2::RE2> regex_;
+    };
+} //  namespace galaxy.
+#endif   //  CPP_CORE_GALAXY_SCAN_H_
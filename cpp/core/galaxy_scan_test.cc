@@ -0,0 +1,202 @@
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "cpp/core/galaxy_scan.h"
+#include "cpp/internal/galaxy_const.h"
+#include "cpp/internal/galaxy_fs_internal.h"
+
+namespace {
+    using galaxy::Scanner;
+
+    std::string WriteFile(const std::string& name, const std::string& data) {
+        std::string path = galaxy::internal::JoinPath(testing::TempDir(), absl::StrCat("galaxy_scan_test_", getpid(), "_", name));
+        std::ofstream(path) << data;
+        return path;
+    }
+
+    Scanner::Output Scan(Scanner::Options options, const std::string& path) {
+        Scanner scanner(options);
+        EXPECT_TRUE(scanner.Init().ok());
+        Scanner::Output output;
+        EXPECT_TRUE(scanner.ScanFile(path, &output).ok());
+        return output;
+    }
+
+    TEST(ScannerTest, GrepSubstring) {
+        std::string path = WriteFile("grep", "error: a\nok\nerror: b\nlast error");
+        Scanner::Options options;
+        options.pattern = "error";
+        Scanner::Output output = Scan(options, path);
+        EXPECT_EQ(output.data, "error: a\nerror: b\nlast error\n");
+        EXPECT_EQ(output.count, 3);
+        EXPECT_FALSE(output.truncated);
+
+        options.max_lines = 1;
+        output = Scan(options, path);
+        EXPECT_EQ(output.data, "error: a\n");
+        EXPECT_EQ(output.count, 3);
+        EXPECT_TRUE(output.truncated);
+    }
+
+    TEST(ScannerTest, GrepRegex) {
+        std::string path = WriteFile("regex", "a1\nb2\na3\n");
+        Scanner::Options options;
+        options.pattern = "^a[0-9]$";
+        options.regex = true;
+        Scanner::Output output = Scan(options, path);
+        EXPECT_EQ(output.data, "a1\na3\n");
+        EXPECT_EQ(output.count, 2);
+
+        options.pattern = "(";
+        EXPECT_FALSE(Scanner(options).Init().ok());
+    }
+
+    TEST(ScannerTest, GrepCapsLongLines) {
+        // A line without any newline, longer than a chunk and than the line limit.
+        std::string long_line(galaxy::constant::kScanMaxLineSize + galaxy::constant::kChunkSize, 'x');
+        std::string path = WriteFile("long", "match\n" + long_line + "match\nend match\n");
+        Scanner::Options options;
+        options.pattern = "match";
+        Scanner::Output output = Scan(options, path);
+        // The match at the end of the long line is past the part of it that is matched.
+        EXPECT_EQ(output.data, "match\nend match\n");
+        EXPECT_EQ(output.count, 2);
+    }
+
+    TEST(ScannerTest, CountLines) {
+        Scanner::Options options;
+        options.op = Scanner::kCountLines;
+        EXPECT_EQ(Scan(options, WriteFile("count", "a\nb\nc")).count, 3);
+        EXPECT_EQ(Scan(options, WriteFile("count_empty", "")).count, 0);
+    }
+
+    TEST(ScannerTest, Head) {
+        std::string path = WriteFile("head", "1\n2\n3\n4\n");
+        Scanner::Options options;
+        options.op = Scanner::kHead;
+        options.max_lines = 2;
+        Scanner::Output output = Scan(options, path);
+        EXPECT_EQ(output.data, "1\n2\n");
+        EXPECT_EQ(output.count, 2);
+        EXPECT_TRUE(output.truncated);
+    }
+
+    TEST(ScannerTest, Tail) {
+        std::string path = WriteFile("tail", "1\n2\n3\n4\n");
+        Scanner::Options options;
+        options.op = Scanner::kTail;
+        options.max_lines = 2;
+        Scanner::Output output = Scan(options, path);
+        EXPECT_EQ(output.data, "3\n4\n");
+        EXPECT_EQ(output.count, 2);
+        EXPECT_TRUE(output.truncated);
+
+        // The byte limit wins over lines that do not fit.
+        options.max_bytes = 3;
+        output = Scan(options, path);
+        EXPECT_EQ(output.data, "\n4\n");
+        EXPECT_TRUE(output.truncated);
+
+        options.max_lines = 10;
+        options.max_bytes = 0;
+        output = Scan(options, path);
+        EXPECT_EQ(output.data, "1\n2\n3\n4\n");
+        EXPECT_FALSE(output.truncated);
+    }
+
+    TEST(ScannerTest, ScanFilesReportsErrors) {
+        Scanner::Options options;
+        options.op = Scanner::kCountLines;
+        Scanner scanner(options);
+        ASSERT_TRUE(scanner.Init().ok());
+        auto results = scanner.ScanFiles({WriteFile("files", "a\n"), "/nonexistent/galaxy_scan_test"});
+        ASSERT_EQ(results.size(), 2);
+        ASSERT_TRUE(results[0].ok());
+        EXPECT_EQ(results[0]->count, 1);
+        EXPECT_TRUE(absl::IsNotFound(results[1].status()));
+    }
+
+    TEST(ScannerTest, ScanFilesShareBudget) {
+        std::string lines;
+        for (int i = 0; i < 100; i++) {
+            lines += "line\n";
+        }
+        std::vector<std::string> paths;
+        for (int i = 0; i < 20; i++) {
+            paths.push_back(WriteFile(absl::StrCat("budget_", i), lines));
+        }
+        Scanner::Options options;
+        options.op = Scanner::kHead;
+        options.max_bytes = 1000;
+        options.budget = std::make_shared<std::atomic<int64_t>>(1202);
+        Scanner scanner(options);
+        ASSERT_TRUE(scanner.Init().ok());
+        auto results = scanner.ScanFiles(paths);
+        int64_t total = 0;
+        int num_over_budget = 0;
+        for (const auto& result : results) {
+            ASSERT_TRUE(result.ok());
+            total += result->data.size();
+            num_over_budget += result->over_budget ? 1 : 0;
+            EXPECT_EQ(result->truncated, result->over_budget);
+            // Cut at lines.
+            EXPECT_EQ(result->data.size() % 5, 0);
+            EXPECT_EQ(result->count, result->data.size() / 5);
+        }
+        // Two whole heads and a cut one, the rest is empty.
+        EXPECT_EQ(total, 1200);
+        EXPECT_EQ(*options.budget, 2);
+        EXPECT_EQ(num_over_budget, 18);
+    }
+
+    TEST(ScannerTest, BudgetOfEachOperator) {
+        std::string path = WriteFile("budget_ops", "error 1\nerror 2\nerror 3\n");
+        Scanner::Options options;
+        options.pattern = "error";
+        options.budget = std::make_shared<std::atomic<int64_t>>(20);
+        Scanner::Output output = Scan(options, path);
+        // Whole lines only, while the matches are still counted.
+        EXPECT_EQ(output.data, "error 1\nerror 2\n");
+        EXPECT_EQ(output.count, 3);
+        EXPECT_TRUE(output.over_budget);
+        EXPECT_EQ(*options.budget, 4);
+
+        options.op = Scanner::kTail;
+        options.max_lines = 10;
+        options.budget = std::make_shared<std::atomic<int64_t>>(12);
+        output = Scan(options, path);
+        EXPECT_EQ(output.data, "error 3\n");
+        EXPECT_EQ(output.count, 1);
+        EXPECT_TRUE(output.truncated);
+        EXPECT_EQ(*options.budget, 4);
+
+        options.op = Scanner::kHash;
+        output = Scan(options, path);
+        EXPECT_TRUE(output.data.empty());
+        EXPECT_TRUE(output.over_budget);
+        EXPECT_EQ(*options.budget, 4);
+
+        // Not even read once spent.
+        options.op = Scanner::kHead;
+        options.budget = std::make_shared<std::atomic<int64_t>>(0);
+        output = Scan(options, path);
+        EXPECT_TRUE(output.data.empty());
+        EXPECT_TRUE(output.over_budget);
+    }
+
+    TEST(ScannerTest, ErrorsCountAgainstBudget) {
+        Scanner::Options options;
+        options.op = Scanner::kCountLines;
+        options.budget = std::make_shared<std::atomic<int64_t>>(1000);
+        Scanner scanner(options);
+        ASSERT_TRUE(scanner.Init().ok());
+        auto results = scanner.ScanFiles({"/nonexistent/galaxy_scan_test"});
+        ASSERT_FALSE(results[0].ok());
+        EXPECT_EQ(*options.budget, 1000 - static_cast<int64_t>(results[0].status().ToString().size()));
+    }
+}  // namespace
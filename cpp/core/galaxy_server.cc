@@ -3,6 +3,9 @@
 #include <string>
 #include <chrono>
 #include <array>
+#include <algorithm>
+#include <memory>
+#include <set>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
@@ -12,30 +15,43 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/time/clock.h"
 #include "absl/flags/flag.h"
+#include "absl/strings/match.h"
 #include "glog/logging.h"
 #include "cpp/client.h"
 #include "cpp/core/galaxy_fs.h"
+#include "cpp/core/galaxy_exec.h"
 #include "cpp/core/galaxy_server.h"
 #include "cpp/core/galaxy_flag.h"
+#include "cpp/core/galaxy_scan.h"
+#include "cpp/core/galaxy_tail.h"
+#include "cpp/internal/galaxy_client_internal.h"
 #include "cpp/internal/galaxy_const.h"
 #include "cpp/internal/galaxy_stats_internal.h"
+#include "cpp/util/galaxy_compress.h"
+#include "cpp/util/galaxy_hash.h"
+#include "cpp/util/galaxy_util.h"
 #include "include/rapidjson/istreamwrapper.h"
 #include "include/rapidjson/document.h"
 #include "include/rapidjson/prettywriter.h"
 #include "include/rapidjson/stringbuffer.h"
 
+using grpc::ClientContext;
+using grpc::ClientWriter;
 using grpc::ServerContext;
 using grpc::ServerReader;
+using grpc::ServerWriter;
 using grpc::Status;
 using grpc::StatusCode;
 
 using galaxy_schema::Attribute;
+using galaxy_schema::CellConfig;
 using galaxy_schema::Credential;
 using galaxy_schema::FileSystemStatus;
 using galaxy_schema::FileSystemUsage;
 using galaxy_schema::Owner;
 using galaxy_schema::WriteMode;
 using galaxy_schema::CrossCellCallType;
+using galaxy_schema::Durability;
 
 using galaxy_schema::CreateDirRequest;
 using galaxy_schema::CreateDirResponse;
@@ -51,6 +67,13 @@ using galaxy_schema::FileOrDieRequest;
 using galaxy_schema::FileOrDieResponse;
 using galaxy_schema::GetAttrRequest;
 using galaxy_schema::GetAttrResponse;
+using galaxy_schema::ChecksumRequest;
+using galaxy_schema::ChecksumResponse;
+using galaxy_schema::ChunkChecksum;
+using galaxy_schema::ChunkEncoding;
+using galaxy_schema::CompressionType;
+using galaxy_schema::LinkBlobRequest;
+using galaxy_schema::LinkBlobResponse;
 using galaxy_schema::ListAllInDirRecursiveRequest;
 using galaxy_schema::ListAllInDirRecursiveResponse;
 using galaxy_schema::ListDirsInDirRequest;
@@ -73,12 +96,29 @@ using galaxy_schema::WriteRequest;
 using galaxy_schema::WriteResponse;
 using galaxy_schema::WriteMultipleRequest;
 using galaxy_schema::WriteMultipleResponse;
+using galaxy_schema::WriteAtRequest;
+using galaxy_schema::WriteAtResponse;
+using galaxy_schema::TruncateRequest;
+using galaxy_schema::TruncateResponse;
+using galaxy_schema::PreallocateRequest;
+using galaxy_schema::PreallocateResponse;
+using galaxy_schema::ScanFileResult;
+using galaxy_schema::ScanRequest;
+using galaxy_schema::ScanResponse;
+using galaxy_schema::TailRequest;
+using galaxy_schema::TailResponse;
+using galaxy_schema::WatchEvent;
+using galaxy_schema::WatchEventType;
+using galaxy_schema::WatchRequest;
+using galaxy_schema::WatchResponse;
 using galaxy_schema::HealthCheckRequest;
 using galaxy_schema::HealthCheckResponse;
 using galaxy_schema::ModifyCellAvailabilityRequest;
 using galaxy_schema::ModifyCellAvailabilityResponse;
 using galaxy_schema::RemoteExecutionRequest;
 using galaxy_schema::RemoteExecutionResponse;
+using galaxy_schema::RemoteExecutionStreamResponse;
+using galaxy_schema::ResourceUsage;
 
 namespace galaxy
 {
@@ -103,11 +143,299 @@ namespace galaxy
         return attribute;
     }
 
+    // Downstream stream of a replicated CopyFile. The stream is connected to the head of a subtree of cells,
+    // and the head forwards the chunks further to the rest of the subtree.
+    class ReplicaStream
+    {
+    public:
+        explicit ReplicaStream(const std::vector<std::string> &cells) : cells_(cells) {}
+
+        ~ReplicaStream()
+        {
+            if (writer_ && !finished_)
+            {
+                context_.TryCancel();
+            }
+        }
+
+        bool Open(const CopyRequest &first_chunk)
+        {
+            std::string shared_prefix(galaxy::constant::kSharedPrefix);
+            if (first_chunk.shared_name().find(shared_prefix) != 0)
+            {
+                LOG(ERROR) << "Replicated path " << first_chunk.shared_name() << " is not a shared path.";
+                return false;
+            }
+            absl::StatusOr<CellConfig> config = galaxy::util::ParseCellConfig(cells_.at(0));
+            if (!config.ok() || config->disabled())
+            {
+                LOG(ERROR) << "Cannot replicate to cell [" << cells_.at(0) << "].";
+                return false;
+            }
+            to_name_ = config->fs_root() + first_chunk.shared_name().substr(shared_prefix.length());
+            password_ = config->fs_password();
+            // Same channel arguments as the clients, so that replies are not held to the default message size.
+            grpc::ChannelArguments ch_args;
+            ch_args.SetMaxReceiveMessageSize(-1);
+            client_ = std::make_unique<GalaxyClientInternal>(grpc::CreateCustomChannel(
+                config->fs_ip() + ":" + std::to_string(config->fs_port()), grpc::InsecureChannelCredentials(), ch_args));
+            context_.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(absl::GetFlag(FLAGS_fs_rpc_ddl)));
+            writer_ = client_->CopyFileStream(&context_, &reply_);
+            healthy_ = true;
+            return true;
+        }
+
+        void Forward(const CopyRequest &chunk, bool is_first_chunk)
+        {
+            if (!healthy_)
+            {
+                return;
+            }
+            CopyRequest sub_request;
+            sub_request.set_from_name(chunk.from_name());
+            sub_request.set_to_name(to_name_);
+            sub_request.mutable_cred()->set_password(password_);
+            sub_request.set_from_cell(absl::GetFlag(FLAGS_fs_cell));
+            sub_request.set_data(chunk.data());
+            sub_request.set_offset(chunk.offset());
+            if (chunk.has_checksum())
+            {
+                sub_request.mutable_checksum()->CopyFrom(chunk.checksum());
+            }
+            // Compressed chunks are forwarded as received.
+            if (chunk.has_encoding())
+            {
+                sub_request.mutable_encoding()->CopyFrom(chunk.encoding());
+            }
+            if (is_first_chunk)
+            {
+                *sub_request.mutable_replicate_cells() = {cells_.begin() + 1, cells_.end()};
+                sub_request.set_shared_name(chunk.shared_name());
+                sub_request.set_replicate_fanout(chunk.replicate_fanout());
+                sub_request.set_durability(chunk.durability());
+                sub_request.set_sparse(chunk.sparse());
+                sub_request.set_file_size(chunk.file_size());
+            }
+            if (!writer_->Write(sub_request))
+            {
+                LOG(ERROR) << "Replication stream to cell [" << cells_.at(0) << "] is broken.";
+                healthy_ = false;
+            }
+        }
+
+        // Waits for the subtree and merges its per-cell status into reply. Cells that did not report are failed.
+        void Finish(CopyResponse *reply)
+        {
+            if (writer_)
+            {
+                writer_->WritesDone();
+                Status status = writer_->Finish();
+                finished_ = true;
+                if (!status.ok())
+                {
+                    LOG(ERROR) << "Replication to cell [" << cells_.at(0) << "] failed with error " << status.error_message();
+                }
+                else if (healthy_)
+                {
+                    reply->mutable_cell_status()->insert(reply_.cell_status().begin(), reply_.cell_status().end());
+                }
+            }
+            for (const auto &cell : cells_)
+            {
+                if (reply->cell_status().find(cell) == reply->cell_status().end())
+                {
+                    FileSystemStatus status;
+                    status.set_return_code(0);
+                    (*reply->mutable_cell_status())[cell] = status;
+                }
+            }
+        }
+
+    private:
+        std::vector<std::string> cells_;
+        std::string to_name_;
+        std::string password_;
+        std::unique_ptr<GalaxyClientInternal> client_;
+        ClientContext context_;
+        CopyResponse reply_;
+        std::unique_ptr<ClientWriter<CopyRequest>> writer_;
+        bool healthy_ = false;
+        bool finished_ = false;
+    };
+
+    // Splits the downstream cells into at most fanout contiguous subtrees. A fanout of 1 gives a chain.
+    std::vector<std::unique_ptr<ReplicaStream>> OpenReplicaStreams(const CopyRequest &first_chunk)
+    {
+        std::vector<std::string> cells(first_chunk.replicate_cells().begin(), first_chunk.replicate_cells().end());
+        std::vector<std::unique_ptr<ReplicaStream>> replicas;
+        size_t num_subtrees = std::min<size_t>(std::max(first_chunk.replicate_fanout(), 1), cells.size());
+        size_t begin = 0;
+        for (size_t i = 0; i < num_subtrees; i++)
+        {
+            size_t size = cells.size() / num_subtrees + (i < cells.size() % num_subtrees ? 1 : 0);
+            auto replica = std::make_unique<ReplicaStream>(std::vector<std::string>(cells.begin() + begin, cells.begin() + begin + size));
+            replica->Open(first_chunk);
+            replicas.push_back(std::move(replica));
+            begin += size;
+        }
+        return replicas;
+    }
+
+    // Whether data matches the checksum sent along with it. Data sent without a checksum is accepted as is.
+    static bool VerifyChecksum(const std::string &data, bool has_checksum, const ChunkChecksum &checksum)
+    {
+        return !has_checksum || checksum.crc32c() == util::Crc32c(data);
+    }
+
+    static void RecordCompression(const std::string &method, int64_t raw_bytes, int64_t wire_bytes)
+    {
+        opencensus::stats::Record({{stats::internal::RawBytesMeasure(), raw_bytes},
+                                   {stats::internal::WireBytesMeasure(), wire_bytes}},
+                                  {{stats::internal::MethodKey(), method}});
+    }
+
+    static void RecordMetaCache(const std::string &method, bool hit, int64_t cache_bytes)
+    {
+        opencensus::stats::Record({{stats::internal::MetaCacheHitsMeasure(), hit ? 1 : 0},
+                                   {stats::internal::MetaCacheMissesMeasure(), hit ? 0 : 1},
+                                   {stats::internal::MetaCacheBytesMeasure(), cache_bytes}},
+                                  {{stats::internal::MethodKey(), method}});
+    }
+
+    // Adds a change to a Watch response, along with the attributes of the entry if it is still there.
+    static void AddWatchEvent(const WatchHub &hub, const WatchHub::Event &event, WatchResponse *response)
+    {
+        WatchEvent *watch_event = response->add_events();
+        watch_event->set_type(static_cast<WatchEventType>(event.type));
+        watch_event->set_name(event.path);
+        watch_event->set_old_name(event.old_path);
+        watch_event->set_is_dir(event.is_dir);
+        watch_event->set_resume_token(hub.Token(event.seq));
+        struct stat statbuf;
+        if (event.type != WatchHub::kDelete && lstat(event.path.c_str(), &statbuf) == 0)
+        {
+            watch_event->mutable_attr()->CopyFrom(StatbufToAttribute(statbuf));
+        }
+    }
+
+    // Points data to the decoded payload, which is either the received payload or decoded_data.
+    static absl::Status DecodePayload(const std::string &method, const std::string &payload, bool has_encoding,
+                                      const ChunkEncoding &encoding, int64_t max_size, std::string &decoded_data,
+                                      const std::string **data)
+    {
+        *data = &payload;
+        if (!has_encoding)
+        {
+            return absl::OkStatus();
+        }
+        absl::Status status = util::DecompressPayload(payload, encoding, max_size, &decoded_data);
+        if (status.ok())
+        {
+            RecordCompression(method, decoded_data.size(), payload.size());
+            *data = &decoded_data;
+        }
+        return status;
+    }
+
+    // Listings are made of many small entries, so they are compressed by gRPC as a whole instead of per payload.
+    static void CompressListing(ServerContext *context, CompressionType compression)
+    {
+        if (compression != CompressionType::UNCOMPRESSED)
+        {
+            context->set_compression_algorithm(GRPC_COMPRESS_GZIP);
+        }
+    }
+
     void GalaxyServerImpl::SetPassword(const std::string &password)
     {
         password_ = password;
     }
 
+    void GalaxyServerImpl::SetCellConfig(const CellConfig &config)
+    {
+        compression_ = config.fs_compression();
+        compression_min_bytes_ = static_cast<int64_t>(config.fs_compression_min_kb()) * 1024;
+        max_payload_bytes_ = static_cast<int64_t>(config.fs_max_msg_size()) * 1024 * 1024;
+        atomic_write_ = config.fs_atomic_write();
+        io_ = NewIoBackend(config.fs_io_backend(), config.fs_io_queue_depth());
+        GalaxyFs::SetIoBackend(io_);
+        LOG(INFO) << "Using the " << io_->Name() << " I/O backend.";
+        appender_ = std::make_unique<AppendCoalescer>(absl::GetFlag(FLAGS_fs_append_sync_ms));
+        group_sync_ = std::make_unique<GroupSync>(config.fs_sync_window_ms(), io_);
+        txn_ = std::make_unique<GalaxyTxn>(config.fs_root());
+        int num_recovered = txn_->Recover();
+        if (num_recovered > 0)
+        {
+            LOG(INFO) << num_recovered << " interrupted transactions recovered.";
+        }
+        if (atomic_write_)
+        {
+            int num_removed = internal::RemoveStaleTempFiles(config.fs_root());
+            if (num_removed > 0)
+            {
+                LOG(INFO) << num_removed << " temporary files of interrupted atomic writes removed.";
+            }
+        }
+        durability_rules_.clear();
+        for (const auto &rule : config.fs_durability_rules())
+        {
+            durability_rules_.emplace_back(rule.prefix(), rule.durability());
+        }
+        std::sort(durability_rules_.begin(), durability_rules_.end(), [](const auto &a, const auto &b) {
+            return a.first.size() > b.first.size();
+        });
+        if (config.fs_enable_cas())
+        {
+            cas_ = std::make_unique<GalaxyCas>(config.fs_root());
+            int num_removed = cas_->CollectGarbage();
+            LOG(INFO) << "Content-addressed store enabled, " << num_removed << " unreferenced blobs removed.";
+        }
+        if (config.fs_meta_cache_mb() > 0)
+        {
+            meta_cache_ = std::make_unique<MetaCache>(config.fs_root(),
+                                                      static_cast<size_t>(config.fs_meta_cache_mb()) * 1024 * 1024);
+        }
+        watch_hub_ = std::make_unique<WatchHub>(galaxy::constant::kWatchHistorySize);
+        max_executions_ = config.fs_max_executions();
+    }
+
+    void GalaxyServerImpl::AdoptBlob(const std::string &path, const std::string &hash)
+    {
+        absl::Status cas_status = cas_->Adopt(path, hash);
+        if (meta_cache_)
+        {
+            // The link into the blob store changes the attributes of path, but not its directory.
+            meta_cache_->Invalidate(path);
+        }
+        if (!cas_status.ok())
+        {
+            // The file itself is written, only the deduplication is lost.
+            LOG(WARNING) << "Fail to adopt " << path << " into the blob store with error " << cas_status;
+        }
+    }
+
+    absl::Status GalaxyServerImpl::Persist(const std::string &path, Durability requested)
+    {
+        Durability durability = requested;
+        if (durability == Durability::DURABILITY_DEFAULT)
+        {
+            durability = Durability::NO_SYNC;
+            for (const auto &rule : durability_rules_)
+            {
+                if (absl::StartsWith(path, rule.first))
+                {
+                    durability = rule.second;
+                    break;
+                }
+            }
+        }
+        if (!group_sync_ || durability == Durability::NO_SYNC || durability == Durability::DURABILITY_DEFAULT)
+        {
+            return absl::OkStatus();
+        }
+        return group_sync_->Sync(path, durability == Durability::SYNC_DATA_AND_DIR);
+    }
+
     absl::Status GalaxyServerImpl::VerifyPassword(const Credential &cred)
     {
         if (cred.password() != password_)
@@ -130,7 +458,17 @@ namespace galaxy
         }
         struct stat statbuf;
         std::string path = request->name();
-        absl::Status fs_status = GalaxyFs::Instance()->GetAttr(path, &statbuf);
+        absl::Status fs_status;
+        if (meta_cache_)
+        {
+            bool hit = false;
+            fs_status = meta_cache_->GetAttr(path, &statbuf, &hit);
+            RecordMetaCache("GetAttr", hit, meta_cache_->bytes());
+        }
+        else
+        {
+            fs_status = GalaxyFs::Instance()->GetAttr(path, &statbuf);
+        }
         if (!fs_status.ok())
         {
             LOG(ERROR) << "GetAttr failed during function call GetAttr with error " << fs_status;
@@ -247,8 +585,19 @@ namespace galaxy
             LOG(ERROR) << "Wrong password from client during function call ListDirsInDir.";
             return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call ListDirsInDir.");
         }
+        CompressListing(context, compression_);
         absl::flat_hash_map<std::string, struct stat> dirs;
-        absl::Status fs_status = GalaxyFs::Instance()->ListDirsInDir(request->name(), dirs);
+        absl::Status fs_status;
+        if (meta_cache_)
+        {
+            bool hit = false;
+            fs_status = meta_cache_->ListDirsInDir(request->name(), dirs, &hit);
+            RecordMetaCache("ListDirsInDir", hit, meta_cache_->bytes());
+        }
+        else
+        {
+            fs_status = GalaxyFs::Instance()->ListDirsInDir(request->name(), dirs);
+        }
         if (!fs_status.ok())
         {
             LOG(ERROR) << "ListDirsInDir failed during function call ListDirsInDir with error " << fs_status;
@@ -274,8 +623,19 @@ namespace galaxy
             LOG(ERROR) << "Wrong password from client during function call ListFilesInDir.";
             return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call ListFilesInDir.");
         }
+        CompressListing(context, compression_);
         absl::flat_hash_map<std::string, struct stat> files;
-        absl::Status fs_status = GalaxyFs::Instance()->ListFilesInDir(request->name(), files, request->include_hidden());
+        absl::Status fs_status;
+        if (meta_cache_)
+        {
+            bool hit = false;
+            fs_status = meta_cache_->ListFilesInDir(request->name(), files, request->include_hidden(), &hit);
+            RecordMetaCache("ListFilesInDir", hit, meta_cache_->bytes());
+        }
+        else
+        {
+            fs_status = GalaxyFs::Instance()->ListFilesInDir(request->name(), files, request->include_hidden());
+        }
         if (!fs_status.ok())
         {
             LOG(ERROR) << "ListFilesInDir failed during function call ListFilesInDir with error" << fs_status;
@@ -301,9 +661,20 @@ namespace galaxy
             LOG(ERROR) << "Wrong password from client during function call ListAllInDirRecursive.";
             return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call ListAllInDirRecursive.");
         }
+        CompressListing(context, compression_);
         absl::flat_hash_map<std::string, struct stat> files;
         absl::flat_hash_map<std::string, struct stat> dirs;
-        absl::Status fs_status = GalaxyFs::Instance()->ListAllInDirRecursive(request->name(), dirs, files, request->include_hidden());
+        absl::Status fs_status;
+        if (meta_cache_)
+        {
+            bool hit = false;
+            fs_status = meta_cache_->ListAllInDirRecursive(request->name(), dirs, files, request->include_hidden(), &hit);
+            RecordMetaCache("ListAllInDirRecursive", hit, meta_cache_->bytes());
+        }
+        else
+        {
+            fs_status = GalaxyFs::Instance()->ListAllInDirRecursive(request->name(), dirs, files, request->include_hidden());
+        }
         if (!fs_status.ok())
         {
             LOG(ERROR) << "ListFilesInDir failed during function call ListAllInDirRecursive with error " << fs_status;
@@ -419,6 +790,27 @@ namespace galaxy
         }
     }
 
+    void GalaxyServerImpl::EncodeReadResponse(const std::string &method, std::string &data, bool with_checksum,
+                                              bool accept_compression, ReadResponse *reply)
+    {
+        FileSystemStatus status;
+        status.set_return_code(1);
+        reply->mutable_status()->CopyFrom(status);
+        if (with_checksum)
+        {
+            reply->mutable_checksum()->set_crc32c(util::Crc32c(data));
+        }
+        std::string compressed;
+        ChunkEncoding encoding;
+        if (accept_compression && util::CompressPayload(data, compression_, compression_min_bytes_, &compressed, &encoding))
+        {
+            RecordCompression(method, data.size(), compressed.size());
+            reply->mutable_encoding()->CopyFrom(encoding);
+            data.swap(compressed);
+        }
+        reply->set_data(data);
+    }
+
     Status GalaxyServerImpl::ReadInternal(ServerContext *context, const ReadRequest *request,
                                           ReadResponse *reply)
     {
@@ -428,7 +820,8 @@ namespace galaxy
             return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call Read.");
         }
         std::string data;
-        absl::Status fs_status = GalaxyFs::Instance()->Read(request->name(), data);
+        // Atomic overwrites never leave a partial file behind, so reads only need the lock for files changed in place.
+        absl::Status fs_status = GalaxyFs::Instance()->Read(request->name(), data, !atomic_write_);
         if (!fs_status.ok())
         {
             LOG(ERROR) << "Read failed client during function call Read with error " << fs_status;
@@ -436,10 +829,7 @@ namespace galaxy
         }
         else
         {
-            FileSystemStatus status;
-            status.set_return_code(1);
-            reply->mutable_status()->CopyFrom(status);
-            reply->set_data(data);
+            EncodeReadResponse("Read", data, request->with_checksum(), request->accept_compression(), reply);
             return Status::OK;
         }
     }
@@ -452,23 +842,38 @@ namespace galaxy
             LOG(ERROR) << "Wrong password from client client during function call ReadMultiple.";
             return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call ReadMultiple.");
         }
+        // The existing files are read as one batch. Missing files get an empty response.
+        std::vector<std::string> paths;
+        std::set<std::string> visited_paths;
         for (const auto &path : request->names())
         {
-            ReadResponse read_response;
             std::string abs_path;
-            absl::Status absl_status = GalaxyFs::Instance()->DieFileIfNotExist(path, abs_path);
-            if (absl_status.ok())
+            if (GalaxyFs::Instance()->DieFileIfNotExist(path, abs_path).ok())
             {
-                ReadRequest read_request;
-                read_request.set_name(path);
-                read_request.mutable_cred()->CopyFrom(request->cred());
-                Status status = GalaxyServerImpl::ReadInternal(context, &read_request, &read_response);
-                if (!status.ok())
+                if (visited_paths.insert(path).second)
                 {
-                    LOG(ERROR) << "Fail to read " << path;
+                    paths.push_back(path);
                 }
             }
-            (*reply->mutable_data())[abs_path].CopyFrom(read_response);
+            else
+            {
+                (*reply->mutable_data())[abs_path].CopyFrom(ReadResponse());
+            }
+        }
+        // With consistent, the batch holds all the locks at once, so that none of the files is part of an ongoing
+        // atomic WriteMultiple.
+        std::vector<absl::StatusOr<std::string>> results =
+            GalaxyFs::Instance()->ReadFiles(paths, request->consistent() || !atomic_write_);
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            ReadResponse &read_response = (*reply->mutable_data())[paths[i]];
+            if (!results[i].ok())
+            {
+                LOG(ERROR) << "Fail to read " << paths[i] << " with error " << results[i].status();
+                continue;
+            }
+            EncodeReadResponse("ReadMultiple", *results[i], request->with_checksum(), request->accept_compression(),
+                               &read_response);
         }
         return Status::OK;
     }
@@ -481,12 +886,62 @@ namespace galaxy
             LOG(ERROR) << "Wrong password from client during function call Write.";
             return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call Write.");
         }
+        std::string decoded_data;
+        const std::string *data;
+        absl::Status decode_status = DecodePayload("Write", request->data(), request->has_encoding(), request->encoding(),
+                                                   max_payload_bytes_, decoded_data, &data);
+        if (!decode_status.ok())
+        {
+            LOG(ERROR) << "Decoding failed during function call Write with error " << decode_status;
+            return Status(StatusCode::DATA_LOSS, decode_status.ToString());
+        }
+        if (!VerifyChecksum(*data, request->has_checksum(), request->checksum()))
+        {
+            LOG(ERROR) << "Checksum mismatch during function call Write for " << request->name() << ".";
+            return Status(StatusCode::DATA_LOSS, "Checksum mismatch during function call Write for " + request->name() + ".");
+        }
         std::string mode = "w";
         if (request->mode() == WriteMode::APPEND)
         {
             mode = "a";
         }
-        absl::Status fs_status = GalaxyFs::Instance()->Write(request->name(), request->data(), mode);
+        absl::Status fs_status;
+        if (cas_ && mode == "w" && data->size() >= galaxy::constant::kCasMinBlobSize)
+        {
+            fs_status = GalaxyFs::Instance()->Lock(request->name());
+            if (fs_status.ok())
+            {
+                if (atomic_write_)
+                {
+                    fs_status = GalaxyFs::Instance()->WriteAtomic(request->name(), *data, false);
+                }
+                else
+                {
+                    fs_status = GalaxyFs::Instance()->Write(request->name(), *data, mode, false);
+                }
+                if (fs_status.ok())
+                {
+                    AdoptBlob(request->name(), util::HashData(*data));
+                }
+                GalaxyFs::Instance()->Unlock(request->name());
+            }
+        }
+        else if (appender_ && mode == "a")
+        {
+            fs_status = appender_->Append(request->name(), *data);
+        }
+        else if (atomic_write_ && mode == "w")
+        {
+            fs_status = GalaxyFs::Instance()->WriteAtomic(request->name(), *data);
+        }
+        else
+        {
+            fs_status = GalaxyFs::Instance()->Write(request->name(), *data, mode);
+        }
+        if (fs_status.ok())
+        {
+            fs_status = Persist(request->name(), request->durability());
+        }
         if (!fs_status.ok())
         {
             LOG(ERROR) << "Write failed during function call Write with error " << fs_status;
@@ -509,6 +964,10 @@ namespace galaxy
             LOG(ERROR) << "Wrong password from client during function call WriteMultiple.";
             return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call WriteMultiple.");
         }
+        if (request->atomic())
+        {
+            return WriteMultipleAtomic(request, reply);
+        }
         for (const auto& val : request->data()) {
             WriteResponse write_response;
             std::string path = val.first;
@@ -527,6 +986,16 @@ namespace galaxy
                 write_request.mutable_cred()->CopyFrom(request->cred());
                 write_request.set_data(val.second);
                 write_request.set_mode(request->mode());
+                auto checksum = request->checksums().find(path);
+                if (checksum != request->checksums().end())
+                {
+                    write_request.mutable_checksum()->CopyFrom(checksum->second);
+                }
+                auto encoding = request->encodings().find(path);
+                if (encoding != request->encodings().end())
+                {
+                    write_request.mutable_encoding()->CopyFrom(encoding->second);
+                }
                 Status status = GalaxyServerImpl::WriteInternal(context, &write_request, &write_response);
                 if (!status.ok())
                 {
@@ -538,82 +1007,437 @@ namespace galaxy
         return Status::OK;
     }
 
-    Status GalaxyServerImpl::CopyFileInternal(ServerContext *context, ServerReader<CopyRequest> *request,
-                                              CopyResponse *reply)
+    Status GalaxyServerImpl::WriteMultipleAtomic(const WriteMultipleRequest *request, WriteMultipleResponse *reply)
     {
-        CopyRequest copy_request;
-        bool is_locked = false;
-        while (request->Read(&copy_request))
+        if (request->mode() != WriteMode::OVERWRITE)
+        {
+            return Status(StatusCode::INVALID_ARGUMENT, "Atomic WriteMultiple only supports overwrites.");
+        }
+        if (!txn_)
+        {
+            return Status(StatusCode::FAILED_PRECONDITION, "Transactions are not set up on this cell.");
+        }
+        // Nothing is staged before every payload is decoded and verified.
+        std::vector<std::pair<std::string, std::string>> files;
+        for (const auto &val : request->data())
         {
-            if (!is_locked)
+            auto encoding = request->encodings().find(val.first);
+            bool has_encoding = encoding != request->encodings().end();
+            std::string decoded_data;
+            const std::string *data;
+            absl::Status decode_status = DecodePayload("WriteMultiple", val.second, has_encoding,
+                                                       has_encoding ? encoding->second : ChunkEncoding(), max_payload_bytes_,
+                                                       decoded_data, &data);
+            if (!decode_status.ok())
             {
-                GalaxyFs::Instance()->Lock(copy_request.to_name());
-                is_locked = true;
+                LOG(ERROR) << "Decoding failed during function call WriteMultiple with error " << decode_status;
+                return Status(StatusCode::DATA_LOSS, decode_status.ToString());
             }
-
-            if (!GalaxyServerImpl::VerifyPassword(copy_request.cred()).ok())
+            auto checksum = request->checksums().find(val.first);
+            bool has_checksum = checksum != request->checksums().end();
+            if (!VerifyChecksum(*data, has_checksum, has_checksum ? checksum->second : ChunkChecksum()))
             {
-                LOG(ERROR) << "Wrong password from client during function call Write.";
-                GalaxyFs::Instance()->Unlock(copy_request.to_name());
-                return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call Write.");
+                LOG(ERROR) << "Checksum mismatch during function call WriteMultiple for " << val.first << ".";
+                return Status(StatusCode::DATA_LOSS, "Checksum mismatch during function call WriteMultiple for " + val.first + ".");
             }
-
-            absl::Status fs_status = GalaxyFs::Instance()->Write(copy_request.to_name(), copy_request.data(), "w", false);
-            if (!fs_status.ok())
+            files.emplace_back(val.first, *data);
+        }
+        std::sort(files.begin(), files.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+        absl::Status txn_status;
+        size_t num_locked = 0;
+        while (num_locked < files.size())
+        {
+            txn_status = GalaxyFs::Instance()->Lock(files[num_locked].first);
+            if (!txn_status.ok())
             {
-                LOG(ERROR) << "Write failed during function call Write with error " << fs_status;
-                GalaxyFs::Instance()->Unlock(copy_request.to_name());
-                return Status(StatusCode::INTERNAL, fs_status.ToString());
+                break;
             }
+            ++num_locked;
+        }
+        if (txn_status.ok())
+        {
+            txn_status = txn_->Commit(files);
+        }
+        for (size_t i = 0; i < num_locked; ++i)
+        {
+            GalaxyFs::Instance()->Unlock(files[i].first);
+        }
+        if (!txn_status.ok())
+        {
+            LOG(ERROR) << "Transaction failed during function call WriteMultiple with error " << txn_status;
+            return Status(StatusCode::INTERNAL, txn_status.ToString());
+        }
+        for (const auto &file : files)
+        {
+            (*reply->mutable_data())[file.first].mutable_status()->set_return_code(1);
+        }
+        return Status::OK;
+    }
+
+    Status GalaxyServerImpl::WriteAtInternal(ServerContext *context, const WriteAtRequest *request,
+                                             WriteAtResponse *reply)
+    {
+        if (!GalaxyServerImpl::VerifyPassword(request->cred()).ok())
+        {
+            LOG(ERROR) << "Wrong password from client during function call WriteAt.";
+            return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call WriteAt.");
+        }
+        std::string decoded_data;
+        const std::string *data;
+        absl::Status decode_status = DecodePayload("WriteAt", request->data(), request->has_encoding(), request->encoding(),
+                                                   max_payload_bytes_, decoded_data, &data);
+        if (!decode_status.ok())
+        {
+            LOG(ERROR) << "Decoding failed during function call WriteAt with error " << decode_status;
+            return Status(StatusCode::DATA_LOSS, decode_status.ToString());
+        }
+        if (!VerifyChecksum(*data, request->has_checksum(), request->checksum()))
+        {
+            LOG(ERROR) << "Checksum mismatch during function call WriteAt for " << request->name() << ".";
+            return Status(StatusCode::DATA_LOSS, "Checksum mismatch during function call WriteAt for " + request->name() + ".");
+        }
+        absl::Status fs_status = GalaxyFs::Instance()->WriteAt(request->name(), request->offset(), *data);
+        if (fs_status.ok())
+        {
+            fs_status = Persist(request->name(), request->durability());
+        }
+        if (!fs_status.ok())
+        {
+            LOG(ERROR) << "Write failed during function call WriteAt with error " << fs_status;
+            return Status(StatusCode::INTERNAL, fs_status.ToString());
         }
-        GalaxyFs::Instance()->Unlock(copy_request.to_name());
         FileSystemStatus status;
         status.set_return_code(1);
         reply->mutable_status()->CopyFrom(status);
         return Status::OK;
     }
 
-    Status GalaxyServerImpl::CrossCellCallInternal(ServerContext *context, const CrossCellRequest *request,
-                                                   CrossCellResponse *reply)
+    Status GalaxyServerImpl::TruncateInternal(ServerContext *context, const TruncateRequest *request,
+                                              TruncateResponse *reply)
     {
         if (!GalaxyServerImpl::VerifyPassword(request->cred()).ok())
         {
-            LOG(ERROR) << "Wrong password from client during function call CrossCellCall.";
-            return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call CrossCellCall.");
+            LOG(ERROR) << "Wrong password from client during function call Truncate.";
+            return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call Truncate.");
         }
-        CopyRequest copy_request;
-        auto any_request = request->request();
-        any_request.UnpackTo(&copy_request);
-        galaxy::client::CopyFile(copy_request.from_name(), copy_request.to_name());
-        if (request->call_type() == CrossCellCallType::MOVEFILE) {
-            galaxy::client::RmFile(copy_request.from_name());
+        absl::Status fs_status = GalaxyFs::Instance()->Truncate(request->name(), request->size());
+        if (fs_status.ok())
+        {
+            fs_status = Persist(request->name(), request->durability());
+        }
+        if (!fs_status.ok())
+        {
+            LOG(ERROR) << "Truncate failed during function call Truncate with error " << fs_status;
+            return Status(StatusCode::INTERNAL, fs_status.ToString());
         }
-
         FileSystemStatus status;
-        CopyResponse response;
         status.set_return_code(1);
-        response.mutable_status()->CopyFrom(status);
-        reply->set_call_type(request->call_type());
-        reply->mutable_response()->PackFrom(response);
+        reply->mutable_status()->CopyFrom(status);
         return Status::OK;
     }
 
-    Status GalaxyServerImpl::CheckHealthInternal(ServerContext *context, const HealthCheckRequest *request,
-                                                 HealthCheckResponse *reply)
+    Status GalaxyServerImpl::PreallocateInternal(ServerContext *context, const PreallocateRequest *request,
+                                                 PreallocateResponse *reply)
     {
         if (!GalaxyServerImpl::VerifyPassword(request->cred()).ok())
         {
-            LOG(ERROR) << "Wrong password from client during function call CheckHealth.";
-            return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call CheckHealth.");
+            LOG(ERROR) << "Wrong password from client during function call Preallocate.";
+            return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call Preallocate.");
         }
-
-        struct statvfs statvfsbuf;
-        absl::Status disk_status = GalaxyFs::Instance()->GetDiskUsage(&statvfsbuf);
-
-        if (!disk_status.ok())
+        absl::Status fs_status = GalaxyFs::Instance()->Preallocate(request->name(), request->size());
+        if (!fs_status.ok())
         {
-            LOG(ERROR) << "CheckHealth failed during function call GetDiskUsage with error " << disk_status;
-            return Status(StatusCode::INTERNAL, disk_status.ToString());
+            LOG(ERROR) << "Preallocate failed during function call Preallocate with error " << fs_status;
+            return Status(StatusCode::INTERNAL, fs_status.ToString());
+        }
+        FileSystemStatus status;
+        status.set_return_code(1);
+        reply->mutable_status()->CopyFrom(status);
+        return Status::OK;
+    }
+
+    Status GalaxyServerImpl::CopyFileInternal(ServerContext *context, ServerReader<CopyRequest> *request,
+                                              CopyResponse *reply)
+    {
+        CopyRequest copy_request;
+        std::string to_name;
+        Durability durability = Durability::DURABILITY_DEFAULT;
+        bool sparse = false;
+        int64_t file_size = 0;
+        // With atomic writes, the chunks go to a temporary file that replaces to_name once the stream is complete.
+        std::unique_ptr<internal::AtomicFile> atomic_file;
+        bool is_replicated = false;
+        std::vector<std::unique_ptr<ReplicaStream>> replicas;
+        util::StreamingHash content_hash;
+        size_t num_bytes = 0;
+        while (request->Read(&copy_request))
+        {
+            // The first chunk truncates the file, the following chunks are appended to it, or written at their
+            // offset for sparse copies.
+            bool is_first_chunk = to_name.empty();
+            if (is_first_chunk)
+            {
+                to_name = copy_request.to_name();
+                durability = copy_request.durability();
+                sparse = copy_request.sparse();
+                file_size = copy_request.file_size();
+                absl::Status lock_status = GalaxyFs::Instance()->Lock(to_name);
+                if (!lock_status.ok())
+                {
+                    LOG(ERROR) << "Lock failed during function call CopyFile with error " << lock_status;
+                    return Status(StatusCode::INTERNAL, lock_status.ToString());
+                }
+            }
+
+            if (!GalaxyServerImpl::VerifyPassword(copy_request.cred()).ok())
+            {
+                LOG(ERROR) << "Wrong password from client during function call Write.";
+                GalaxyFs::Instance()->Unlock(to_name);
+                return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call Write.");
+            }
+            std::string decoded_data;
+            const std::string *data;
+            absl::Status decode_status = DecodePayload("CopyFile", copy_request.data(), copy_request.has_encoding(),
+                                                       copy_request.encoding(), max_payload_bytes_, decoded_data, &data);
+            if (!decode_status.ok())
+            {
+                LOG(ERROR) << "Decoding failed during function call CopyFile with error " << decode_status;
+                GalaxyFs::Instance()->Unlock(to_name);
+                return Status(StatusCode::DATA_LOSS, decode_status.ToString());
+            }
+            // Reject a corrupted chunk before it is forwarded or written.
+            if (!VerifyChecksum(*data, copy_request.has_checksum(), copy_request.checksum()))
+            {
+                LOG(ERROR) << "Checksum mismatch during function call CopyFile for " << to_name << ".";
+                GalaxyFs::Instance()->Unlock(to_name);
+                return Status(StatusCode::DATA_LOSS, "Checksum mismatch during function call CopyFile for " + to_name + ".");
+            }
+
+            // Forward the chunk down the replication chain before writing it locally.
+            if (is_first_chunk && !copy_request.shared_name().empty())
+            {
+                is_replicated = true;
+                replicas = OpenReplicaStreams(copy_request);
+            }
+            for (auto &replica : replicas)
+            {
+                replica->Forward(copy_request, is_first_chunk);
+            }
+
+            absl::Status fs_status;
+            if (atomic_write_)
+            {
+                if (is_first_chunk)
+                {
+                    atomic_file = GalaxyFs::Instance()->NewAtomicFile(to_name);
+                    fs_status = atomic_file->Open();
+                }
+                if (fs_status.ok())
+                {
+                    fs_status = sparse ? atomic_file->WriteAt(copy_request.offset(), *data) : atomic_file->Append(*data);
+                }
+            }
+            else if (sparse)
+            {
+                if (is_first_chunk)
+                {
+                    fs_status = GalaxyFs::Instance()->Write(to_name, "", "w", false);
+                }
+                if (fs_status.ok())
+                {
+                    fs_status = GalaxyFs::Instance()->WriteAt(to_name, copy_request.offset(), *data, false);
+                }
+            }
+            else
+            {
+                fs_status = GalaxyFs::Instance()->Write(to_name, *data, is_first_chunk ? "w" : "a", false);
+            }
+            if (!fs_status.ok())
+            {
+                LOG(ERROR) << "Write failed during function call Write with error " << fs_status;
+                GalaxyFs::Instance()->Unlock(to_name);
+                return Status(StatusCode::INTERNAL, fs_status.ToString());
+            }
+            // The chunks of a sparse copy do not hash to the content of the file.
+            if (cas_ && !sparse)
+            {
+                content_hash.Update(*data);
+                num_bytes += data->size();
+            }
+        }
+        if (!to_name.empty())
+        {
+            if (sparse)
+            {
+                // Sizes the file past a trailing hole.
+                absl::Status size_status = atomic_file ? atomic_file->Truncate(file_size)
+                                                       : GalaxyFs::Instance()->Truncate(to_name, file_size, false);
+                if (!size_status.ok())
+                {
+                    LOG(ERROR) << "Sizing failed during function call CopyFile with error " << size_status;
+                    GalaxyFs::Instance()->Unlock(to_name);
+                    return Status(StatusCode::INTERNAL, size_status.ToString());
+                }
+            }
+            if (atomic_file)
+            {
+                absl::Status commit_status = atomic_file->Commit();
+                if (!commit_status.ok())
+                {
+                    LOG(ERROR) << "Commit failed during function call CopyFile with error " << commit_status;
+                    GalaxyFs::Instance()->Unlock(to_name);
+                    return Status(StatusCode::INTERNAL, commit_status.ToString());
+                }
+            }
+            if (cas_ && num_bytes >= galaxy::constant::kCasMinBlobSize)
+            {
+                AdoptBlob(to_name, content_hash.HexDigest());
+            }
+            GalaxyFs::Instance()->Unlock(to_name);
+            absl::Status sync_status = Persist(to_name, durability);
+            if (!sync_status.ok())
+            {
+                LOG(ERROR) << "Sync failed during function call CopyFile with error " << sync_status;
+                return Status(StatusCode::INTERNAL, sync_status.ToString());
+            }
+        }
+        FileSystemStatus status;
+        status.set_return_code(1);
+        reply->mutable_status()->CopyFrom(status);
+        if (is_replicated)
+        {
+            (*reply->mutable_cell_status())[absl::GetFlag(FLAGS_fs_cell)] = status;
+            for (auto &replica : replicas)
+            {
+                replica->Finish(reply);
+            }
+        }
+        return Status::OK;
+    }
+
+    Status GalaxyServerImpl::ChecksumInternal(ServerContext *context, const ChecksumRequest *request,
+                                              ChecksumResponse *reply)
+    {
+        if (!GalaxyServerImpl::VerifyPassword(request->cred()).ok())
+        {
+            LOG(ERROR) << "Wrong password from client during function call Checksum.";
+            return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call Checksum.");
+        }
+        struct stat statbuf;
+        absl::Status fs_status = GalaxyFs::Instance()->GetAttr(request->name(), &statbuf);
+        if (!fs_status.ok())
+        {
+            LOG(ERROR) << "GetAttr failed during function call Checksum with error " << fs_status;
+            return Status(StatusCode::NOT_FOUND, fs_status.ToString());
+        }
+        fs_status = GalaxyFs::Instance()->Lock(request->name());
+        if (!fs_status.ok())
+        {
+            LOG(ERROR) << "Lock failed during function call Checksum with error " << fs_status;
+            return Status(StatusCode::INTERNAL, fs_status.ToString());
+        }
+        absl::StatusOr<uint32_t> crc = util::FileCrc32c(request->name());
+        GalaxyFs::Instance()->Unlock(request->name());
+        if (!crc.ok())
+        {
+            LOG(ERROR) << "Checksum failed during function call Checksum with error " << crc.status();
+            return Status(StatusCode::INTERNAL, crc.status().ToString());
+        }
+        FileSystemStatus status;
+        status.set_return_code(1);
+        reply->mutable_status()->CopyFrom(status);
+        reply->set_crc32c(*crc);
+        reply->set_size(statbuf.st_size);
+        return Status::OK;
+    }
+
+    Status GalaxyServerImpl::LinkBlobInternal(ServerContext *context, const LinkBlobRequest *request,
+                                              LinkBlobResponse *reply)
+    {
+        if (!GalaxyServerImpl::VerifyPassword(request->cred()).ok())
+        {
+            LOG(ERROR) << "Wrong password from client during function call LinkBlob.";
+            return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call LinkBlob.");
+        }
+        FileSystemStatus status;
+        status.set_return_code(1);
+        reply->mutable_status()->CopyFrom(status);
+        // A miss is not an error: the client falls back to sending the data.
+        if (!cas_ || !cas_->HasBlob(request->content_hash()))
+        {
+            reply->set_linked(false);
+            return Status::OK;
+        }
+        absl::Status cas_status = GalaxyFs::Instance()->Lock(request->name());
+        if (cas_status.ok())
+        {
+            cas_status = cas_->LinkBlob(request->content_hash(), request->name());
+            GalaxyFs::Instance()->Unlock(request->name());
+        }
+        if (!cas_status.ok())
+        {
+            LOG(WARNING) << "LinkBlob failed for " << request->name() << " with error " << cas_status;
+        }
+        reply->set_linked(cas_status.ok());
+        return Status::OK;
+    }
+
+    Status GalaxyServerImpl::CrossCellCallInternal(ServerContext *context, const CrossCellRequest *request,
+                                                   CrossCellResponse *reply)
+    {
+        if (!GalaxyServerImpl::VerifyPassword(request->cred()).ok())
+        {
+            LOG(ERROR) << "Wrong password from client during function call CrossCellCall.";
+            return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call CrossCellCall.");
+        }
+        CopyRequest copy_request;
+        auto any_request = request->request();
+        any_request.UnpackTo(&copy_request);
+        CopyResponse response;
+        bool all_copied = true;
+        if (copy_request.to_name().find(galaxy::constant::kSharedPrefix) == 0) {
+            // Replicate to a shared path on behalf of the client and report the status of every cell.
+            std::map<std::string, bool> cell_status = galaxy::client::BroadcastCopyFile(copy_request.from_name(), copy_request.to_name());
+            for (const auto& pair : cell_status) {
+                (*response.mutable_cell_status())[pair.first].set_return_code(pair.second ? 1 : 0);
+                all_copied = all_copied && pair.second;
+            }
+        } else {
+            galaxy::client::CopyFile(copy_request.from_name(), copy_request.to_name());
+        }
+        if (request->call_type() == CrossCellCallType::MOVEFILE) {
+            // The source can only be removed once every cell has a copy.
+            if (all_copied) {
+                galaxy::client::RmFile(copy_request.from_name());
+            } else {
+                LOG(ERROR) << "Keeping " << copy_request.from_name() << " since it failed to be copied to some cells.";
+            }
+        }
+
+        FileSystemStatus status;
+        status.set_return_code(all_copied ? 1 : 0);
+        response.mutable_status()->CopyFrom(status);
+        reply->set_call_type(request->call_type());
+        reply->mutable_response()->PackFrom(response);
+        return Status::OK;
+    }
+
+    Status GalaxyServerImpl::CheckHealthInternal(ServerContext *context, const HealthCheckRequest *request,
+                                                 HealthCheckResponse *reply)
+    {
+        if (!GalaxyServerImpl::VerifyPassword(request->cred()).ok())
+        {
+            LOG(ERROR) << "Wrong password from client during function call CheckHealth.";
+            return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call CheckHealth.");
+        }
+
+        struct statvfs statvfsbuf;
+        absl::Status disk_status = GalaxyFs::Instance()->GetDiskUsage(&statvfsbuf);
+
+        if (!disk_status.ok())
+        {
+            LOG(ERROR) << "CheckHealth failed during function call GetDiskUsage with error " << disk_status;
+            return Status(StatusCode::INTERNAL, disk_status.ToString());
         }
 
         struct sysinfo sysinfobuf;
@@ -707,6 +1531,54 @@ namespace galaxy
         return result;
     }
 
+    // The command line run by /bin/sh for a request: main and its arguments, in home_dir and with env_kargs set.
+    static std::string BuildCommand(const RemoteExecutionRequest &request)
+    {
+        std::string cmd = "";
+        if (!request.home_dir().empty()) {
+            cmd += "cd " + request.home_dir() + " &&";
+        }
+        for (const auto& pair : request.env_kargs()) {
+            cmd += " " + pair.first + "=" + pair.second;
+        }
+        cmd += " " + request.main();
+        for (const auto& val : request.program_args()) {
+            cmd += " " + val;
+        }
+        return cmd;
+    }
+
+    // Slot of a running command, held until it goes out of scope. Not acquired if max_executions are already running.
+    class ExecutionSlot
+    {
+    public:
+        ExecutionSlot(std::atomic<int> *num_executions, int max_executions) : num_executions_(num_executions)
+        {
+            acquired_ = num_executions_->fetch_add(1) < max_executions;
+            if (!acquired_)
+            {
+                num_executions_->fetch_sub(1);
+            }
+        }
+
+        ~ExecutionSlot()
+        {
+            if (acquired_)
+            {
+                num_executions_->fetch_sub(1);
+            }
+        }
+
+        ExecutionSlot(const ExecutionSlot &) = delete;
+        ExecutionSlot &operator=(const ExecutionSlot &) = delete;
+
+        bool acquired() const { return acquired_; }
+
+    private:
+        std::atomic<int> *num_executions_;
+        bool acquired_;
+    };
+
     Status GalaxyServerImpl::RemoteExecutionInternal(ServerContext *context, const RemoteExecutionRequest *request,
                                                      RemoteExecutionResponse *reply)
     {
@@ -715,18 +1587,14 @@ namespace galaxy
             LOG(ERROR) << "Wrong password from client during function call RemoteExecution.";
             return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call RemoteExecution.");
         }
-        std::string cmd = "";
-        if (!request->home_dir().empty()) {
-            cmd += "cd " + request->home_dir() + " &&";
-        }
-        for (const auto& pair : request->env_kargs()) {
-            cmd += " " + pair.first + "=" + pair.second;
-        }
-        cmd += request->main();
-        for (const auto& val : request->program_args()) {
-            cmd += " " + val;
-        }
+        std::string cmd = BuildCommand(*request);
         reply->set_raw_cmd(cmd);
+        ExecutionSlot slot(&num_executions_, max_executions_);
+        if (!slot.acquired())
+        {
+            LOG(ERROR) << "Refused to run cmd [" << cmd << "], " << max_executions_ << " commands are already running.";
+            return Status(StatusCode::RESOURCE_EXHAUSTED, "Too many commands running during function call RemoteExecution.");
+        }
         try {
             std::string result = ExecuteCommand(cmd);
             reply->set_data(result);
@@ -743,6 +1611,303 @@ namespace galaxy
 
     }
 
+    Status GalaxyServerImpl::RemoteExecutionStreamInternal(ServerContext *context, const RemoteExecutionRequest *request,
+                                                           ServerWriter<RemoteExecutionStreamResponse> *writer)
+    {
+        if (!GalaxyServerImpl::VerifyPassword(request->cred()).ok())
+        {
+            LOG(ERROR) << "Wrong password from client during function call RemoteExecutionStream.";
+            return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call RemoteExecutionStream.");
+        }
+        std::string cmd = BuildCommand(*request);
+        ExecutionSlot slot(&num_executions_, max_executions_);
+        if (!slot.acquired())
+        {
+            LOG(ERROR) << "Refused to run cmd [" << cmd << "], " << max_executions_ << " commands are already running.";
+            return Status(StatusCode::RESOURCE_EXHAUSTED, "Too many commands running during function call RemoteExecutionStream.");
+        }
+        Subprocess process;
+        absl::Status fs_status = process.Start(cmd);
+        if (!fs_status.ok())
+        {
+            LOG(ERROR) << "RemoteExecutionStream failed with error " << fs_status.message();
+            return Status(StatusCode::INTERNAL, std::string(fs_status.message()));
+        }
+        FileSystemStatus status;
+        status.set_return_code(1);
+        RemoteExecutionStreamResponse first;
+        first.mutable_status()->CopyFrom(status);
+        first.set_raw_cmd(cmd);
+        bool connected = writer->Write(first);
+        bool finished = false;
+        while (connected && !finished)
+        {
+            if (context->IsCancelled())
+            {
+                connected = false;
+                break;
+            }
+            RemoteExecutionStreamResponse response;
+            finished = process.Poll(absl::Milliseconds(galaxy::constant::kExecutionPollMs), galaxy::constant::kChunkSize,
+                                    response.mutable_out_data(), response.mutable_err_data());
+            if (!response.out_data().empty() || !response.err_data().empty())
+            {
+                response.mutable_status()->CopyFrom(status);
+                connected = writer->Write(response);
+            }
+        }
+        if (!connected)
+        {
+            process.Terminate(absl::Seconds(galaxy::constant::kExecutionGraceSec));
+            LOG(INFO) << "Cmd [" << cmd << "] stopped as its client went away.";
+            return Status(StatusCode::CANCELLED, "Client went away during function call RemoteExecutionStream.");
+        }
+        const Subprocess::Exit &exit = process.exit();
+        RemoteExecutionStreamResponse last;
+        last.mutable_status()->CopyFrom(status);
+        last.set_finished(true);
+        last.set_exit_code(exit.exit_code);
+        last.set_term_signal(exit.term_signal);
+        ResourceUsage *rusage = last.mutable_rusage();
+        rusage->set_wall_sec(absl::ToDoubleSeconds(exit.wall_time));
+        rusage->set_user_sec(exit.usage.ru_utime.tv_sec + exit.usage.ru_utime.tv_usec / 1e6);
+        rusage->set_system_sec(exit.usage.ru_stime.tv_sec + exit.usage.ru_stime.tv_usec / 1e6);
+        rusage->set_max_rss_kb(exit.usage.ru_maxrss);
+        rusage->set_minor_faults(exit.usage.ru_minflt);
+        rusage->set_major_faults(exit.usage.ru_majflt);
+        rusage->set_voluntary_switches(exit.usage.ru_nvcsw);
+        rusage->set_involuntary_switches(exit.usage.ru_nivcsw);
+        writer->Write(last);
+        return Status::OK;
+    }
+
+    Status GalaxyServerImpl::WatchInternal(ServerContext *context, const WatchRequest *request,
+                                           ServerWriter<WatchResponse> *writer)
+    {
+        if (!GalaxyServerImpl::VerifyPassword(request->cred()).ok())
+        {
+            LOG(ERROR) << "Wrong password from client during function call Watch.";
+            return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call Watch.");
+        }
+        if (!watch_hub_)
+        {
+            return Status(StatusCode::UNAVAILABLE, "Watches are not set up on this cell.");
+        }
+        absl::Status fs_status = watch_hub_->Subscribe(request->name(), request->recursive());
+        if (!fs_status.ok())
+        {
+            LOG(ERROR) << "Subscribe failed during function call Watch with error " << fs_status;
+            return Status(absl::IsNotFound(fs_status) ? StatusCode::NOT_FOUND : StatusCode::INTERNAL, fs_status.ToString());
+        }
+        uint64_t after = watch_hub_->last_seq();
+        bool complete = true;
+        if (!request->resume_token().empty())
+        {
+            uint64_t seq = 0;
+            if (watch_hub_->ParseToken(request->resume_token(), &seq) && seq <= after)
+            {
+                after = seq;
+            }
+            else
+            {
+                // E.g. a token from before a restart of the server.
+                complete = false;
+            }
+        }
+        FileSystemStatus status;
+        status.set_return_code(1);
+        absl::Time last_sent = absl::InfinitePast();
+        while (!context->IsCancelled())
+        {
+            WatchResponse response;
+            std::vector<WatchHub::Event> events;
+            if (last_sent != absl::InfinitePast())
+            {
+                complete = watch_hub_->Wait(request->name(), request->recursive(), &after, absl::Milliseconds(500), &events);
+            }
+            if (!complete)
+            {
+                WatchEvent *overflow = response.add_events();
+                overflow->set_type(WatchEventType::WATCH_OVERFLOW);
+                overflow->set_name(request->name());
+                overflow->set_resume_token(watch_hub_->Token(after));
+            }
+            for (const auto &event : events)
+            {
+                if (request->event_mask() == 0 || (request->event_mask() & event.type))
+                {
+                    AddWatchEvent(*watch_hub_, event, &response);
+                }
+            }
+            if (response.events_size() == 0 && last_sent != absl::InfinitePast() &&
+                absl::Now() - last_sent < absl::Seconds(galaxy::constant::kWatchHeartbeatSec))
+            {
+                continue;
+            }
+            response.mutable_status()->CopyFrom(status);
+            response.set_resume_token(watch_hub_->Token(after));
+            if (!writer->Write(response))
+            {
+                break;
+            }
+            last_sent = absl::Now();
+        }
+        watch_hub_->Unsubscribe(request->name(), request->recursive());
+        return Status::OK;
+    }
+
+    Status GalaxyServerImpl::TailInternal(ServerContext *context, const TailRequest *request,
+                                          ServerWriter<TailResponse> *writer)
+    {
+        if (!GalaxyServerImpl::VerifyPassword(request->cred()).ok())
+        {
+            LOG(ERROR) << "Wrong password from client during function call Tail.";
+            return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call Tail.");
+        }
+        std::string abs_path;
+        absl::Status fs_status = GalaxyFs::Instance()->DieFileIfNotExist(request->name(), abs_path);
+        Tailer tailer(abs_path);
+        if (fs_status.ok())
+        {
+            fs_status = tailer.Open(request->from_offset(), request->last_n_lines(), request->follow());
+        }
+        if (!fs_status.ok())
+        {
+            LOG(ERROR) << "Open failed during function call Tail with error " << fs_status;
+            StatusCode code = absl::IsNotFound(fs_status)          ? StatusCode::NOT_FOUND
+                              : absl::IsInvalidArgument(fs_status) ? StatusCode::INVALID_ARGUMENT
+                                                                   : StatusCode::INTERNAL;
+            return Status(code, fs_status.ToString());
+        }
+        FileSystemStatus status;
+        status.set_return_code(1);
+        bool first = true;
+        while (!context->IsCancelled())
+        {
+            std::string data;
+            // Short waits, so that a cancelled stream does not hold its thread for long.
+            fs_status = tailer.Read(galaxy::constant::kChunkSize,
+                                    request->follow() ? absl::Milliseconds(500) : absl::ZeroDuration(), &data);
+            if (!fs_status.ok())
+            {
+                LOG(ERROR) << "Read failed during function call Tail with error " << fs_status;
+                return Status(StatusCode::INTERNAL, fs_status.ToString());
+            }
+            bool reset = tailer.TakeReset();
+            if (data.empty() && !reset && !first)
+            {
+                if (!request->follow())
+                {
+                    break;
+                }
+                continue;
+            }
+            TailResponse response;
+            response.mutable_status()->CopyFrom(status);
+            response.set_offset(tailer.offset() - data.size());
+            response.set_reset(reset);
+            response.set_data(std::move(data));
+            if (!writer->Write(response))
+            {
+                break;
+            }
+            first = false;
+        }
+        return Status::OK;
+    }
+
+    Status GalaxyServerImpl::ScanInternal(ServerContext *context, const ScanRequest *request,
+                                          ScanResponse *reply)
+    {
+        if (!GalaxyServerImpl::VerifyPassword(request->cred()).ok())
+        {
+            LOG(ERROR) << "Wrong password from client during function call Scan.";
+            return Status(StatusCode::PERMISSION_DENIED, "Wrong password from client during function call Scan.");
+        }
+        // Results share one response, within the message size of the cell less room for the counts. The scanner draws
+        // their data and errors from the budget as it keeps them, after the names of the files, so that it stops
+        // keeping data once the response is full instead of holding every output until the end.
+        int64_t budget = std::max<int64_t>(max_payload_bytes_ - galaxy::constant::kChunkSize, galaxy::constant::kChunkSize);
+        Scanner::Options options;
+        options.op = request->op();
+        options.pattern = request->pattern();
+        options.regex = request->regex();
+        options.max_lines = request->max_lines();
+        options.max_bytes = std::min<int64_t>(request->max_bytes() > 0 ? request->max_bytes() : galaxy::constant::kChunkSize, budget);
+        options.budget = std::make_shared<std::atomic<int64_t>>(budget);
+        Scanner scanner(options);
+        absl::Status fs_status = scanner.Init();
+        if (!fs_status.ok())
+        {
+            LOG(ERROR) << "Invalid request during function call Scan with error " << fs_status;
+            return Status(StatusCode::INVALID_ARGUMENT, fs_status.ToString());
+        }
+        // Files by the key of their result.
+        std::vector<std::string> names, paths;
+        for (const auto &name : request->names())
+        {
+            std::string abs_path;
+            fs_status = GalaxyFs::Instance()->DieFileIfNotExist(name, abs_path);
+            if (!fs_status.ok())
+            {
+                std::string error = fs_status.ToString();
+                options.budget->fetch_sub(name.size() + error.size());
+                (*reply->mutable_results())[name].set_error(error);
+                continue;
+            }
+            names.push_back(name);
+            paths.push_back(abs_path);
+        }
+        if (!request->dir().empty())
+        {
+            absl::flat_hash_map<std::string, struct stat> dirs, files;
+            fs_status = request->recursive() ? GalaxyFs::Instance()->ListAllInDirRecursive(request->dir(), dirs, files)
+                                             : GalaxyFs::Instance()->ListFilesInDir(request->dir(), files);
+            if (!fs_status.ok())
+            {
+                LOG(ERROR) << "List failed during function call Scan with error " << fs_status;
+                return Status(absl::IsNotFound(fs_status) ? StatusCode::NOT_FOUND : StatusCode::INTERNAL, fs_status.ToString());
+            }
+            std::vector<std::string> dir_paths;
+            for (const auto &file : files)
+            {
+                dir_paths.push_back(file.first);
+            }
+            std::sort(dir_paths.begin(), dir_paths.end());
+            names.insert(names.end(), dir_paths.begin(), dir_paths.end());
+            paths.insert(paths.end(), dir_paths.begin(), dir_paths.end());
+        }
+        for (const auto &name : names)
+        {
+            options.budget->fetch_sub(name.size());
+        }
+        std::vector<absl::StatusOr<Scanner::Output>> outputs = scanner.ScanFiles(paths);
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            ScanFileResult &result = (*reply->mutable_results())[names[i]];
+            if (!outputs[i].ok())
+            {
+                result.set_error(outputs[i].status().ToString());
+                continue;
+            }
+            if (outputs[i]->over_budget)
+            {
+                reply->set_truncated(true);
+            }
+            result.set_data(std::move(outputs[i]->data));
+            result.set_count(outputs[i]->count);
+            result.set_truncated(outputs[i]->truncated);
+        }
+        if (reply->truncated())
+        {
+            LOG(WARNING) << "Scan results cut to fit the response of " << paths.size() << " files.";
+        }
+        FileSystemStatus status;
+        status.set_return_code(1);
+        reply->mutable_status()->CopyFrom(status);
+        return Status::OK;
+    }
+
     //***************************************************************************************//
     // external functions
     Status GalaxyServerImpl::GetAttr(ServerContext *context, const GetAttrRequest *request,
@@ -955,6 +2120,45 @@ namespace galaxy
         return status;
     }
 
+    Status GalaxyServerImpl::WriteAt(ServerContext *context, const WriteAtRequest *request,
+                                     WriteAtResponse *reply)
+    {
+        absl::Time start = absl::Now();
+        Status status = GalaxyServerImpl::WriteAtInternal(context, request, reply);
+        absl::Time end = absl::Now();
+        double latency_ms = absl::ToDoubleMilliseconds(end - start);
+        opencensus::stats::Record({{stats::internal::LatencyMsMeasure(), latency_ms},
+                                   {stats::internal::QueryCountMeasure(), 1}},
+                                  {{stats::internal::MethodKey(), "WriteAt"}});
+        return status;
+    }
+
+    Status GalaxyServerImpl::Truncate(ServerContext *context, const TruncateRequest *request,
+                                      TruncateResponse *reply)
+    {
+        absl::Time start = absl::Now();
+        Status status = GalaxyServerImpl::TruncateInternal(context, request, reply);
+        absl::Time end = absl::Now();
+        double latency_ms = absl::ToDoubleMilliseconds(end - start);
+        opencensus::stats::Record({{stats::internal::LatencyMsMeasure(), latency_ms},
+                                   {stats::internal::QueryCountMeasure(), 1}},
+                                  {{stats::internal::MethodKey(), "Truncate"}});
+        return status;
+    }
+
+    Status GalaxyServerImpl::Preallocate(ServerContext *context, const PreallocateRequest *request,
+                                         PreallocateResponse *reply)
+    {
+        absl::Time start = absl::Now();
+        Status status = GalaxyServerImpl::PreallocateInternal(context, request, reply);
+        absl::Time end = absl::Now();
+        double latency_ms = absl::ToDoubleMilliseconds(end - start);
+        opencensus::stats::Record({{stats::internal::LatencyMsMeasure(), latency_ms},
+                                   {stats::internal::QueryCountMeasure(), 1}},
+                                  {{stats::internal::MethodKey(), "Preallocate"}});
+        return status;
+    }
+
     Status GalaxyServerImpl::CopyFile(ServerContext *context, ServerReader<CopyRequest> *request,
                                       CopyResponse *reply)
     {
@@ -968,6 +2172,32 @@ namespace galaxy
         return status;
     }
 
+    Status GalaxyServerImpl::Checksum(ServerContext *context, const ChecksumRequest *request,
+                                      ChecksumResponse *reply)
+    {
+        absl::Time start = absl::Now();
+        Status status = GalaxyServerImpl::ChecksumInternal(context, request, reply);
+        absl::Time end = absl::Now();
+        double latency_ms = absl::ToDoubleMilliseconds(end - start);
+        opencensus::stats::Record({{stats::internal::LatencyMsMeasure(), latency_ms},
+                                   {stats::internal::QueryCountMeasure(), 1}},
+                                  {{stats::internal::MethodKey(), "Checksum"}});
+        return status;
+    }
+
+    Status GalaxyServerImpl::LinkBlob(ServerContext *context, const LinkBlobRequest *request,
+                                      LinkBlobResponse *reply)
+    {
+        absl::Time start = absl::Now();
+        Status status = GalaxyServerImpl::LinkBlobInternal(context, request, reply);
+        absl::Time end = absl::Now();
+        double latency_ms = absl::ToDoubleMilliseconds(end - start);
+        opencensus::stats::Record({{stats::internal::LatencyMsMeasure(), latency_ms},
+                                   {stats::internal::QueryCountMeasure(), 1}},
+                                  {{stats::internal::MethodKey(), "LinkBlob"}});
+        return status;
+    }
+
     Status GalaxyServerImpl::CrossCellCall(ServerContext *context, const CrossCellRequest *request,
                                            CrossCellResponse *reply)
     {
@@ -1026,4 +2256,56 @@ namespace galaxy
                                   {{stats::internal::MethodKey(), "RemoteExecution"}});
         return status;
     }
+
+    Status GalaxyServerImpl::RemoteExecutionStream(ServerContext *context, const RemoteExecutionRequest *request,
+                                                   ServerWriter<RemoteExecutionStreamResponse> *writer)
+    {
+        absl::Time start = absl::Now();
+        Status status = GalaxyServerImpl::RemoteExecutionStreamInternal(context, request, writer);
+        absl::Time end = absl::Now();
+        double latency_ms = absl::ToDoubleMilliseconds(end - start);
+        opencensus::stats::Record({{stats::internal::LatencyMsMeasure(), latency_ms},
+                                   {stats::internal::QueryCountMeasure(), 1}},
+                                  {{stats::internal::MethodKey(), "RemoteExecutionStream"}});
+        return status;
+    }
+
+    Status GalaxyServerImpl::Watch(ServerContext *context, const WatchRequest *request,
+                                   ServerWriter<WatchResponse> *writer)
+    {
+        absl::Time start = absl::Now();
+        Status status = GalaxyServerImpl::WatchInternal(context, request, writer);
+        absl::Time end = absl::Now();
+        double latency_ms = absl::ToDoubleMilliseconds(end - start);
+        opencensus::stats::Record({{stats::internal::LatencyMsMeasure(), latency_ms},
+                                   {stats::internal::QueryCountMeasure(), 1}},
+                                  {{stats::internal::MethodKey(), "Watch"}});
+        return status;
+    }
+
+    Status GalaxyServerImpl::Tail(ServerContext *context, const TailRequest *request,
+                                  ServerWriter<TailResponse> *writer)
+    {
+        absl::Time start = absl::Now();
+        Status status = GalaxyServerImpl::TailInternal(context, request, writer);
+        absl::Time end = absl::Now();
+        double latency_ms = absl::ToDoubleMilliseconds(end - start);
+        opencensus::stats::Record({{stats::internal::LatencyMsMeasure(), latency_ms},
+                                   {stats::internal::QueryCountMeasure(), 1}},
+                                  {{stats::internal::MethodKey(), "Tail"}});
+        return status;
+    }
+
+    Status GalaxyServerImpl::Scan(ServerContext *context, const ScanRequest *request,
+                                  ScanResponse *reply)
+    {
+        absl::Time start = absl::Now();
+        Status status = GalaxyServerImpl::ScanInternal(context, request, reply);
+        absl::Time end = absl::Now();
+        double latency_ms = absl::ToDoubleMilliseconds(end - start);
+        opencensus::stats::Record({{stats::internal::LatencyMsMeasure(), latency_ms},
+                                   {stats::internal::QueryCountMeasure(), 1}},
+                                  {{stats::internal::MethodKey(), "Scan"}});
+        return status;
+    }
 } // namespace galaxy
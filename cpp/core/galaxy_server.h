@@ -1,8 +1,21 @@
 #ifndef CPP_CORE_GALAXY_SERVER_H_
 #define CPP_CORE_GALAXY_SERVER_H_
 
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 #include <grpcpp/grpcpp.h>
 #include "absl/status/status.h"
+#include "cpp/core/galaxy_append.h"
+#include "cpp/core/galaxy_cas.h"
+#include "cpp/core/galaxy_io.h"
+#include "cpp/core/galaxy_meta_cache.h"
+#include "cpp/core/galaxy_sync.h"
+#include "cpp/core/galaxy_txn.h"
+#include "cpp/core/galaxy_watch.h"
+#include "cpp/internal/galaxy_const.h"
 #include "schema/fileserver.grpc.pb.h"
 
 namespace galaxy
@@ -58,9 +71,24 @@ namespace galaxy
         grpc::Status WriteMultiple(grpc::ServerContext *context, const galaxy_schema::WriteMultipleRequest *request,
                                    galaxy_schema::WriteMultipleResponse *reply) override;
 
+        grpc::Status WriteAt(grpc::ServerContext *context, const galaxy_schema::WriteAtRequest *request,
+                             galaxy_schema::WriteAtResponse *reply) override;
+
+        grpc::Status Truncate(grpc::ServerContext *context, const galaxy_schema::TruncateRequest *request,
+                              galaxy_schema::TruncateResponse *reply) override;
+
+        grpc::Status Preallocate(grpc::ServerContext *context, const galaxy_schema::PreallocateRequest *request,
+                                 galaxy_schema::PreallocateResponse *reply) override;
+
         grpc::Status CopyFile(grpc::ServerContext *context, grpc::ServerReader<galaxy_schema::CopyRequest> *request,
                               galaxy_schema::CopyResponse *reply) override;
 
+        grpc::Status Checksum(grpc::ServerContext *context, const galaxy_schema::ChecksumRequest *request,
+                              galaxy_schema::ChecksumResponse *reply) override;
+
+        grpc::Status LinkBlob(grpc::ServerContext *context, const galaxy_schema::LinkBlobRequest *request,
+                              galaxy_schema::LinkBlobResponse *reply) override;
+
         grpc::Status CrossCellCall(grpc::ServerContext *context, const galaxy_schema::CrossCellRequest *request,
                                    galaxy_schema::CrossCellResponse *reply) override;
 
@@ -72,12 +100,49 @@ namespace galaxy
 
         grpc::Status RemoteExecution(grpc::ServerContext *context, const galaxy_schema::RemoteExecutionRequest *request,
                                      galaxy_schema::RemoteExecutionResponse *reply) override;
+        grpc::Status RemoteExecutionStream(grpc::ServerContext *context, const galaxy_schema::RemoteExecutionRequest *request,
+                                           grpc::ServerWriter<galaxy_schema::RemoteExecutionStreamResponse> *writer) override;
+
+        grpc::Status Watch(grpc::ServerContext *context, const galaxy_schema::WatchRequest *request,
+                           grpc::ServerWriter<galaxy_schema::WatchResponse> *writer) override;
+        grpc::Status Tail(grpc::ServerContext *context, const galaxy_schema::TailRequest *request,
+                          grpc::ServerWriter<galaxy_schema::TailResponse> *writer) override;
+        grpc::Status Scan(grpc::ServerContext *context, const galaxy_schema::ScanRequest *request,
+                          galaxy_schema::ScanResponse *reply) override;
 
         void SetPassword(const std::string &password);
+        // Enables the content-addressed blob store and payload compression if the cell config asks for them, and the
+        // coalescing of appends, the group commit of durable writes and the metadata cache. Sets up the I/O backend
+        // of the cell and recovers the transactions of a previous run.
+        void SetCellConfig(const galaxy_schema::CellConfig &config);
 
     private:
         std::string password_;
+        std::unique_ptr<GalaxyCas> cas_;
+        std::shared_ptr<IoBackend> io_;
+        std::unique_ptr<AppendCoalescer> appender_;
+        std::unique_ptr<GroupSync> group_sync_;
+        std::unique_ptr<GalaxyTxn> txn_;
+        // Listings and attributes served to clients, if the cell config gives it a budget.
+        std::unique_ptr<MetaCache> meta_cache_;
+        // Changes of the directories watched by clients.
+        std::unique_ptr<WatchHub> watch_hub_;
+        // Durability rules of the cell, longest prefix first.
+        std::vector<std::pair<std::string, galaxy_schema::Durability>> durability_rules_;
+        galaxy_schema::CompressionType compression_ = galaxy_schema::CompressionType::UNCOMPRESSED;
+        int64_t compression_min_bytes_ = 0;
+        // Largest payload accepted once decompressed, the message size limit of the cell.
+        int64_t max_payload_bytes_ = galaxy::constant::kMaxPayloadSize;
+        // Whether overwrites are atomic, in which case reads do not need the file lock.
+        bool atomic_write_ = false;
+        // Commands running for RemoteExecution and RemoteExecutionStream, and how many may run at once.
+        std::atomic<int> num_executions_{0};
+        int max_executions_ = galaxy::constant::kMaxExecutions;
         absl::Status VerifyPassword(const galaxy_schema::Credential &cred);
+        // Stores a freshly written file as a blob, or links it to an existing blob with the same content.
+        void AdoptBlob(const std::string &path, const std::string &hash);
+        // Persists a file that was just written, as far as requested or, by default, as the rules of its path say.
+        absl::Status Persist(const std::string &path, galaxy_schema::Durability requested);
 
         grpc::Status GetAttrInternal(grpc::ServerContext *context, const galaxy_schema::GetAttrRequest *request,
                                      galaxy_schema::GetAttrResponse *reply);
@@ -118,6 +183,10 @@ namespace galaxy
         grpc::Status ReadInternal(grpc::ServerContext *context, const galaxy_schema::ReadRequest *request,
                                   galaxy_schema::ReadResponse *reply);
 
+        // Fills reply with the data of a successful read, checksummed and compressed as asked for.
+        void EncodeReadResponse(const std::string &method, std::string &data, bool with_checksum, bool accept_compression,
+                                galaxy_schema::ReadResponse *reply);
+
         grpc::Status ReadMultipleInternal(grpc::ServerContext *context, const galaxy_schema::ReadMultipleRequest *request,
                                           galaxy_schema::ReadMultipleResponse *reply);
 
@@ -127,9 +196,28 @@ namespace galaxy
         grpc::Status WriteMultipleInternal(grpc::ServerContext *context, const galaxy_schema::WriteMultipleRequest *request,
                                            galaxy_schema::WriteMultipleResponse *reply);
 
+        // WriteMultiple of a request asking for atomic, committed as a single transaction.
+        grpc::Status WriteMultipleAtomic(const galaxy_schema::WriteMultipleRequest *request,
+                                         galaxy_schema::WriteMultipleResponse *reply);
+
+        grpc::Status WriteAtInternal(grpc::ServerContext *context, const galaxy_schema::WriteAtRequest *request,
+                                     galaxy_schema::WriteAtResponse *reply);
+
+        grpc::Status TruncateInternal(grpc::ServerContext *context, const galaxy_schema::TruncateRequest *request,
+                                      galaxy_schema::TruncateResponse *reply);
+
+        grpc::Status PreallocateInternal(grpc::ServerContext *context, const galaxy_schema::PreallocateRequest *request,
+                                         galaxy_schema::PreallocateResponse *reply);
+
         grpc::Status CopyFileInternal(grpc::ServerContext *context, grpc::ServerReader<galaxy_schema::CopyRequest> *request,
                                       galaxy_schema::CopyResponse *reply);
 
+        grpc::Status ChecksumInternal(grpc::ServerContext *context, const galaxy_schema::ChecksumRequest *request,
+                                      galaxy_schema::ChecksumResponse *reply);
+
+        grpc::Status LinkBlobInternal(grpc::ServerContext *context, const galaxy_schema::LinkBlobRequest *request,
+                                      galaxy_schema::LinkBlobResponse *reply);
+
         grpc::Status CrossCellCallInternal(grpc::ServerContext *context, const galaxy_schema::CrossCellRequest *request,
                                            galaxy_schema::CrossCellResponse *reply);
 
@@ -141,6 +229,15 @@ namespace galaxy
 
         grpc::Status RemoteExecutionInternal(grpc::ServerContext *context, const galaxy_schema::RemoteExecutionRequest *request,
                                              galaxy_schema::RemoteExecutionResponse *reply);
+        grpc::Status RemoteExecutionStreamInternal(grpc::ServerContext *context, const galaxy_schema::RemoteExecutionRequest *request,
+                                                   grpc::ServerWriter<galaxy_schema::RemoteExecutionStreamResponse> *writer);
+
+        grpc::Status WatchInternal(grpc::ServerContext *context, const galaxy_schema::WatchRequest *request,
+                                   grpc::ServerWriter<galaxy_schema::WatchResponse> *writer);
+        grpc::Status TailInternal(grpc::ServerContext *context, const galaxy_schema::TailRequest *request,
+                                  grpc::ServerWriter<galaxy_schema::TailResponse> *writer);
+        grpc::Status ScanInternal(grpc::ServerContext *context, const galaxy_schema::ScanRequest *request,
+                                  galaxy_schema::ScanResponse *reply);
     };
 } // namespace galaxy
 
@@ -53,6 +53,61 @@ namespace galaxy {
             opencensus::stats::View ram_view(ram_usage_view);
             CHECK(ram_view.IsValid()) << "Failed to create RAM usage view.";
             ram_usage_view.RegisterForExport();
+
+            internal::RawBytesMeasure();
+            const opencensus::stats::ViewDescriptor raw_bytes_view = opencensus::stats::ViewDescriptor()
+                .set_name("galaxy_server/raw_bytes")
+                .set_description("The payload bytes before compression")
+                .set_measure(internal::kRawBytesMeasureName)
+                .set_aggregation(opencensus::stats::Aggregation::Sum())
+                .add_column(internal::MethodKey());
+            opencensus::stats::View raw_view(raw_bytes_view);
+            CHECK(raw_view.IsValid()) << "Failed to create raw bytes view.";
+            raw_bytes_view.RegisterForExport();
+
+            internal::WireBytesMeasure();
+            const opencensus::stats::ViewDescriptor wire_bytes_view = opencensus::stats::ViewDescriptor()
+                .set_name("galaxy_server/wire_bytes")
+                .set_description("The payload bytes after compression")
+                .set_measure(internal::kWireBytesMeasureName)
+                .set_aggregation(opencensus::stats::Aggregation::Sum())
+                .add_column(internal::MethodKey());
+            opencensus::stats::View wire_view(wire_bytes_view);
+            CHECK(wire_view.IsValid()) << "Failed to create wire bytes view.";
+            wire_bytes_view.RegisterForExport();
+
+            internal::MetaCacheHitsMeasure();
+            const opencensus::stats::ViewDescriptor meta_cache_hits_view = opencensus::stats::ViewDescriptor()
+                .set_name("galaxy_server/meta_cache_hits")
+                .set_description("The lookups served from the metadata cache")
+                .set_measure(internal::kMetaCacheHitsMeasureName)
+                .set_aggregation(opencensus::stats::Aggregation::Sum())
+                .add_column(internal::MethodKey());
+            opencensus::stats::View hits_view(meta_cache_hits_view);
+            CHECK(hits_view.IsValid()) << "Failed to create metadata cache hits view.";
+            meta_cache_hits_view.RegisterForExport();
+
+            internal::MetaCacheMissesMeasure();
+            const opencensus::stats::ViewDescriptor meta_cache_misses_view = opencensus::stats::ViewDescriptor()
+                .set_name("galaxy_server/meta_cache_misses")
+                .set_description("The lookups not served from the metadata cache")
+                .set_measure(internal::kMetaCacheMissesMeasureName)
+                .set_aggregation(opencensus::stats::Aggregation::Sum())
+                .add_column(internal::MethodKey());
+            opencensus::stats::View misses_view(meta_cache_misses_view);
+            CHECK(misses_view.IsValid()) << "Failed to create metadata cache misses view.";
+            meta_cache_misses_view.RegisterForExport();
+
+            internal::MetaCacheBytesMeasure();
+            const opencensus::stats::ViewDescriptor meta_cache_bytes_view = opencensus::stats::ViewDescriptor()
+                .set_name("galaxy_server/meta_cache_bytes")
+                .set_description("The memory taken by the metadata cache")
+                .set_measure(internal::kMetaCacheBytesMeasureName)
+                .set_aggregation(opencensus::stats::Aggregation::LastValue())
+                .add_column(internal::MethodKey());
+            opencensus::stats::View cache_bytes_view(meta_cache_bytes_view);
+            CHECK(cache_bytes_view.IsValid()) << "Failed to create metadata cache bytes view.";
+            meta_cache_bytes_view.RegisterForExport();
         }
     }
 }
@@ -0,0 +1,83 @@
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "cpp/core/galaxy_sync.h"
+#include "cpp/internal/galaxy_fs_internal.h"
+#include "glog/logging.h"
+
+namespace galaxy
+{
+    GroupSync::GroupSync(int window_ms, std::shared_ptr<IoBackend> io) : window_ms_(window_ms), io_(std::move(io)) {}
+
+    absl::Status GroupSync::Sync(const std::string &path, bool with_dir)
+    {
+        std::string dir;
+        if (with_dir)
+        {
+            absl::StatusOr<std::string> abs_dir = internal::GetFileAbsDir(path);
+            if (!abs_dir.ok())
+            {
+                return abs_dir.status();
+            }
+            dir = *abs_dir;
+        }
+        std::unique_lock<std::mutex> lock(mu_);
+        bool is_leader = !open_round_;
+        if (is_leader)
+        {
+            open_round_ = std::make_shared<Round>();
+        }
+        std::shared_ptr<Round> round = open_round_;
+        round->files.insert(path);
+        if (with_dir)
+        {
+            round->dirs.insert(dir);
+        }
+        if (is_leader)
+        {
+            // The first call of the window waits for the others to join, then syncs on behalf of all of them. Calls
+            // arriving while it syncs start the next round.
+            lock.unlock();
+            if (window_ms_ > 0)
+            {
+                absl::SleepFor(absl::Milliseconds(window_ms_));
+            }
+            lock.lock();
+            open_round_.reset();
+            lock.unlock();
+            RunRound(*round);
+            lock.lock();
+            round->done = true;
+            cv_.notify_all();
+        }
+        else
+        {
+            cv_.wait(lock, [&round]() { return round->done; });
+        }
+        absl::Status status = round->results[path];
+        if (status.ok() && with_dir)
+        {
+            status = round->results[dir];
+        }
+        return status;
+    }
+
+    void GroupSync::RunRound(Round &round)
+    {
+        // Files first, so that a directory entry never points to data that is not synced yet.
+        std::vector<std::string> files(round.files.begin(), round.files.end());
+        std::vector<absl::Status> file_results = io_->SyncFiles(files, false);
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            round.results[files[i]] = file_results[i];
+        }
+        std::vector<std::string> dirs(round.dirs.begin(), round.dirs.end());
+        std::vector<absl::Status> dir_results = io_->SyncFiles(dirs, true);
+        for (size_t i = 0; i < dirs.size(); ++i)
+        {
+            round.results[dirs[i]] = dir_results[i];
+        }
+        VLOG(2) << "Synced " << round.files.size() << " files and " << round.dirs.size() << " directories.";
+    }
+} //  namespace galaxy.
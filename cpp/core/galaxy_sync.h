@@ -0,0 +1,48 @@
+#ifndef CPP_CORE_GALAXY_SYNC_H_
+#define CPP_CORE_GALAXY_SYNC_H_
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include "absl/status/status.h"
+#include "cpp/core/galaxy_io.h"
+
+namespace galaxy
+{
+    // Group commit of the writes of a cell. The syncs requested within window_ms of each other are issued together
+    // once the window closes, with one fdatasync per file and one fsync per directory however many writers asked
+    // for them, so durable writes keep close to the throughput of buffered ones. The syncs of a round are issued as
+    // one batch of io.
+    class GroupSync
+    {
+    public:
+        GroupSync(int window_ms, std::shared_ptr<IoBackend> io);
+        GroupSync(const GroupSync&) = delete;
+
+        // Blocks until the data of path, and its directory entry if with_dir is set, are on stable storage.
+        absl::Status Sync(const std::string &path, bool with_dir);
+
+    private:
+        struct Round
+        {
+            std::set<std::string> files;
+            std::set<std::string> dirs;
+            std::map<std::string, absl::Status> results;
+            bool done = false;
+        };
+
+        // Syncs everything requested in the round and records the status of each file and directory.
+        void RunRound(Round &round);
+
+        const int window_ms_;
+        std::shared_ptr<IoBackend> io_;
+        std::mutex mu_;
+        std::condition_variable cv_;
+        // Round collecting syncs, created by the first call of its window.
+        std::shared_ptr<Round> open_round_;
+    };
+} //  namespace galaxy.
+#endif   //  CPP_CORE_GALAXY_SYNC_H_
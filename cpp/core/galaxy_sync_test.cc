@@ -0,0 +1,107 @@
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "cpp/core/galaxy_io.h"
+#include "cpp/core/galaxy_sync.h"
+
+namespace {
+    using galaxy::GroupSync;
+
+    // Records the syncs asked of it, and fails those of paths ending in "bad".
+    class FakeIoBackend : public galaxy::IoBackend {
+    public:
+        struct Call {
+            std::vector<std::string> paths;
+            bool is_dir;
+        };
+
+        std::string Name() const override { return "fake"; }
+        std::vector<absl::StatusOr<std::string>> ReadFiles(const std::vector<std::string>& paths) override {
+            return std::vector<absl::StatusOr<std::string>>(paths.size(), absl::UnimplementedError("Not faked."));
+        }
+        std::vector<absl::StatusOr<struct stat>> StatFiles(const std::vector<std::string>& paths) override {
+            return std::vector<absl::StatusOr<struct stat>>(paths.size(), absl::UnimplementedError("Not faked."));
+        }
+        std::vector<absl::Status> SyncFiles(const std::vector<std::string>& paths, bool is_dir) override {
+            std::lock_guard<std::mutex> lock(mu);
+            calls.push_back({paths, is_dir});
+            std::vector<absl::Status> results;
+            for (const auto& path : paths) {
+                bool bad = path.size() >= 3 && path.compare(path.size() - 3, 3, "bad") == 0;
+                results.push_back(bad ? absl::InternalError("Sync of " + path + " failed.") : absl::OkStatus());
+            }
+            return results;
+        }
+
+        std::mutex mu;
+        std::vector<Call> calls;
+    };
+
+    TEST(GroupSyncTest, GroupsConcurrentSyncs) {
+        auto io = std::make_shared<FakeIoBackend>();
+        GroupSync sync(200, io);
+        const int num_threads = 8;
+        std::vector<std::thread> threads;
+        std::atomic<int> num_ok{0};
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([&sync, &num_ok, t]() {
+                // Two files per directory, each asked for by several threads.
+                std::string path = absl::StrCat("/d", t % 2, "/f", t % 4);
+                if (sync.Sync(path, true).ok()) {
+                    num_ok++;
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        EXPECT_EQ(num_ok, num_threads);
+        // The threads start well within the window, so they mostly share rounds, with each path once per round.
+        size_t num_file_calls = 0;
+        for (const auto& call : io->calls) {
+            num_file_calls += call.is_dir ? 0 : 1;
+            std::set<std::string> unique(call.paths.begin(), call.paths.end());
+            EXPECT_EQ(unique.size(), call.paths.size());
+        }
+        EXPECT_LT(num_file_calls, num_threads);
+        // Files of a round are synced before their directories.
+        ASSERT_FALSE(io->calls.empty());
+        EXPECT_FALSE(io->calls.front().is_dir);
+        EXPECT_TRUE(io->calls.back().is_dir);
+    }
+
+    TEST(GroupSyncTest, ReportsErrorsPerPath) {
+        auto io = std::make_shared<FakeIoBackend>();
+        GroupSync sync(100, io);
+        absl::Status bad_file;
+        absl::Status bad_dir;
+        absl::Status good;
+        std::thread bad_file_thread([&]() { bad_file = sync.Sync("/d/bad", false); });
+        std::thread bad_dir_thread([&]() { bad_dir = sync.Sync("/bad/f", true); });
+        std::thread good_thread([&]() { good = sync.Sync("/d/f", true); });
+        bad_file_thread.join();
+        bad_dir_thread.join();
+        good_thread.join();
+        EXPECT_FALSE(bad_file.ok());
+        EXPECT_FALSE(bad_dir.ok());
+        EXPECT_TRUE(good.ok());
+    }
+
+    TEST(GroupSyncTest, WithoutWindow) {
+        auto io = std::make_shared<FakeIoBackend>();
+        GroupSync sync(0, io);
+        EXPECT_TRUE(sync.Sync("/d/f", false).ok());
+        EXPECT_TRUE(sync.Sync("/d/f", false).ok());
+        ASSERT_EQ(io->calls.size(), 4);
+        EXPECT_EQ(io->calls[0].paths, std::vector<std::string>{"/d/f"});
+        EXPECT_TRUE(io->calls[1].paths.empty());
+        // No directory to sync.
+        EXPECT_FALSE(sync.Sync("", true).ok());
+    }
+}  // namespace
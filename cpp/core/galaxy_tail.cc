@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "cpp/core/galaxy_tail.h"
+#include "glog/logging.h"
+
+namespace galaxy
+{
+    namespace
+    {
+        // Changes of any entry of the directory wake up a read, which then checks the file itself.
+        constexpr uint32_t kTailMask = IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                       IN_ONLYDIR;
+        // Interval of the checks if inotify is not available.
+        constexpr int kPollMs = 200;
+        constexpr off_t kScanBlockSize = 65536;
+
+        std::string ParentDir(const std::string &path)
+        {
+            size_t pos = path.find_last_of('/');
+            if (pos == std::string::npos)
+            {
+                return ".";
+            }
+            return pos == 0 ? "/" : path.substr(0, pos);
+        }
+
+        absl::Status ErrnoStatus(const std::string &message)
+        {
+            std::string error = absl::StrCat(message, " with error ", std::strerror(errno), ".");
+            return errno == ENOENT ? absl::NotFoundError(error) : absl::InternalError(error);
+        }
+    } // namespace
+
+    Tailer::Tailer(const std::string &path) : path_(path)
+    {
+    }
+
+    Tailer::~Tailer()
+    {
+        if (fd_ >= 0)
+        {
+            close(fd_);
+        }
+        if (inotify_fd_ >= 0)
+        {
+            close(inotify_fd_);
+        }
+    }
+
+    absl::Status Tailer::Open(int64_t from_offset, int64_t last_n_lines, bool follow)
+    {
+        fd_ = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd_ < 0)
+        {
+            return ErrnoStatus("Fail to open " + path_ + " for Tail");
+        }
+        struct stat statbuf;
+        if (fstat(fd_, &statbuf) != 0)
+        {
+            return ErrnoStatus("Fail to stat " + path_ + " for Tail");
+        }
+        if (!S_ISREG(statbuf.st_mode))
+        {
+            return absl::InvalidArgumentError("Path " + path_ + " is not a file for Tail.");
+        }
+        dev_ = statbuf.st_dev;
+        ino_ = statbuf.st_ino;
+        if (last_n_lines > 0)
+        {
+            absl::Status status = FindLastLines(last_n_lines, statbuf.st_size, &offset_);
+            if (!status.ok())
+            {
+                return status;
+            }
+            if (from_offset < 0)
+            {
+                offset_ = std::max<int64_t>(offset_, statbuf.st_size + from_offset);
+            }
+        }
+        else if (from_offset < 0)
+        {
+            offset_ = std::max<int64_t>(0, statbuf.st_size + from_offset);
+        }
+        else
+        {
+            offset_ = from_offset;
+        }
+        if (!follow)
+        {
+            return absl::OkStatus();
+        }
+        inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd_ < 0 || inotify_add_watch(inotify_fd_, ParentDir(path_).c_str(), kTailMask) < 0)
+        {
+            LOG(WARNING) << "Tail of " << path_ << " checks for appends every " << kPollMs
+                         << "ms, inotify failed with error " << std::strerror(errno) << ".";
+            if (inotify_fd_ >= 0)
+            {
+                close(inotify_fd_);
+                inotify_fd_ = -1;
+            }
+        }
+        return absl::OkStatus();
+    }
+
+    absl::Status Tailer::Read(size_t max_bytes, absl::Duration timeout, std::string *data)
+    {
+        data->clear();
+        absl::Time deadline = absl::Now() + timeout;
+        while (true)
+        {
+            struct stat statbuf;
+            if (fstat(fd_, &statbuf) != 0)
+            {
+                return ErrnoStatus("Fail to stat " + path_ + " for Tail");
+            }
+            if (statbuf.st_size < offset_)
+            {
+                // Truncated, e.g. rotated in place by copying it away first.
+                offset_ = 0;
+                reset_ = true;
+            }
+            if (statbuf.st_size > offset_)
+            {
+                data->resize(std::min<int64_t>(max_bytes, statbuf.st_size - offset_));
+                ssize_t num_read = pread(fd_, &(*data)[0], data->size(), offset_);
+                if (num_read < 0)
+                {
+                    data->clear();
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    return ErrnoStatus("Fail to read " + path_ + " for Tail");
+                }
+                data->resize(num_read);
+                offset_ += num_read;
+                return absl::OkStatus();
+            }
+            if (Reopen(statbuf.st_size))
+            {
+                continue;
+            }
+            absl::Duration left = deadline - absl::Now();
+            if (left <= absl::ZeroDuration())
+            {
+                return absl::OkStatus();
+            }
+            int wait_ms = static_cast<int>(std::min<int64_t>(absl::ToInt64Milliseconds(left) + 1, 60000));
+            if (inotify_fd_ < 0)
+            {
+                usleep(std::min(wait_ms, kPollMs) * 1000);
+                continue;
+            }
+            struct pollfd pfd = {inotify_fd_, POLLIN, 0};
+            if (poll(&pfd, 1, wait_ms) > 0)
+            {
+                // Only whether something changed matters, the file is checked again above.
+                char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+                while (read(inotify_fd_, buffer, sizeof(buffer)) > 0)
+                {
+                }
+            }
+        }
+    }
+
+    bool Tailer::TakeReset()
+    {
+        bool reset = reset_;
+        reset_ = false;
+        return reset;
+    }
+
+    absl::Status Tailer::FindLastLines(int64_t n, off_t size, int64_t *offset)
+    {
+        // A final newline ends the last line rather than starting a new one.
+        off_t end = size;
+        char last = 0;
+        if (size > 0 && pread(fd_, &last, 1, size - 1) == 1 && last == '\n')
+        {
+            end = size - 1;
+        }
+        std::string block;
+        int64_t num_found = 0;
+        while (end > 0)
+        {
+            off_t start = std::max<off_t>(0, end - kScanBlockSize);
+            block.resize(end - start);
+            ssize_t num_read = pread(fd_, &block[0], block.size(), start);
+            if (num_read < 0)
+            {
+                return ErrnoStatus("Fail to read " + path_ + " for Tail");
+            }
+            if (static_cast<size_t>(num_read) < block.size())
+            {
+                // Truncated while scanning, so whatever it holds now is recent enough.
+                break;
+            }
+            for (off_t i = block.size() - 1; i >= 0; --i)
+            {
+                if (block[i] == '\n' && ++num_found == n)
+                {
+                    *offset = start + i + 1;
+                    return absl::OkStatus();
+                }
+            }
+            end = start;
+        }
+        *offset = 0;
+        return absl::OkStatus();
+    }
+
+    bool Tailer::Reopen(off_t size)
+    {
+        struct stat statbuf;
+        if (stat(path_.c_str(), &statbuf) != 0 || (statbuf.st_dev == dev_ && statbuf.st_ino == ino_) ||
+            !S_ISREG(statbuf.st_mode) || offset_ < size)
+        {
+            return false;
+        }
+        int fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return false;
+        }
+        // The file opened may be newer than the one stat'ed above.
+        if (fstat(fd, &statbuf) != 0)
+        {
+            close(fd);
+            return false;
+        }
+        close(fd_);
+        fd_ = fd;
+        dev_ = statbuf.st_dev;
+        ino_ = statbuf.st_ino;
+        offset_ = 0;
+        reset_ = true;
+        return true;
+    }
+} // namespace galaxy
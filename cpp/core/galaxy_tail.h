@@ -0,0 +1,49 @@
+#ifndef CPP_CORE_GALAXY_TAIL_H_
+#define CPP_CORE_GALAXY_TAIL_H_
+
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include "absl/status/status.h"
+#include "absl/time/time.h"
+
+namespace galaxy
+{
+    // Reads what is appended to a file, e.g. a log, from a given offset or from its last lines on. Appends are
+    // waited for with inotify on the directory of the file, which also reports when the file is replaced under the
+    // same name, e.g. by log rotation, so that the new file is followed once the old one is read to its end.
+    class Tailer
+    {
+    public:
+        explicit Tailer(const std::string &path);
+        ~Tailer();
+        Tailer(const Tailer&) = delete;
+
+        // Opens the file at from_offset, counted from its end if negative, or at the start of its last
+        // last_n_lines lines if that is positive, but no earlier than a negative from_offset then. Without follow,
+        // appends are not watched for, for reads that do not wait.
+        absl::Status Open(int64_t from_offset, int64_t last_n_lines, bool follow = true);
+        // Reads up to max_bytes from offset(), waiting up to timeout for an append if there is nothing left to read.
+        // data is left empty on timeout.
+        absl::Status Read(size_t max_bytes, absl::Duration timeout, std::string *data);
+        // Offset of the next read.
+        int64_t offset() const { return offset_; }
+        // Whether the file was truncated or replaced since the last call, so that reading started over at 0.
+        bool TakeReset();
+
+    private:
+        // Offset of the start of the last n lines of the open file.
+        absl::Status FindLastLines(int64_t n, off_t size, int64_t *offset);
+        // Switches to a new file at path, if the open one was replaced and fully read.
+        bool Reopen(off_t size);
+
+        const std::string path_;
+        int fd_ = -1;
+        int inotify_fd_ = -1;
+        dev_t dev_ = 0;
+        ino_t ino_ = 0;
+        int64_t offset_ = 0;
+        bool reset_ = false;
+    };
+} //  namespace galaxy.
+#endif   //  CPP_CORE_GALAXY_TAIL_H_
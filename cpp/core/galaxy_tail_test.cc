@@ -0,0 +1,131 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "cpp/core/galaxy_tail.h"
+#include "cpp/internal/galaxy_fs_internal.h"
+
+namespace {
+    using galaxy::Tailer;
+    using galaxy::internal::JoinPath;
+
+    std::string NewRoot(const std::string& name) {
+        std::string root = JoinPath(testing::TempDir(), absl::StrCat("galaxy_tail_test_", getpid(), "_", name));
+        EXPECT_TRUE(galaxy::impl::CreateDirIfNotExist(root, 0777).ok());
+        return root;
+    }
+
+    void WriteFile(const std::string& path, const std::string& data) {
+        std::ofstream(path) << data;
+    }
+
+    void AppendFile(const std::string& path, const std::string& data) {
+        std::ofstream(path, std::ios::app) << data;
+    }
+
+    // What a tail opened with these arguments reads without waiting.
+    std::string TailFrom(const std::string& path, int64_t from_offset, int64_t last_n_lines) {
+        Tailer tailer(path);
+        EXPECT_TRUE(tailer.Open(from_offset, last_n_lines, false).ok());
+        std::string data;
+        EXPECT_TRUE(tailer.Read(1 << 20, absl::ZeroDuration(), &data).ok());
+        return data;
+    }
+
+    TEST(TailerTest, LastLines) {
+        std::string root = NewRoot("last_lines");
+        std::string path = JoinPath(root, "log");
+        WriteFile(path, "1\n2\n3\n");
+        EXPECT_EQ(TailFrom(path, 0, 2), "2\n3\n");
+        EXPECT_EQ(TailFrom(path, 0, 3), "1\n2\n3\n");
+        EXPECT_EQ(TailFrom(path, 0, 10), "1\n2\n3\n");
+
+        // The last line counts even without its newline.
+        WriteFile(path, "1\n2\n3");
+        EXPECT_EQ(TailFrom(path, 0, 1), "3");
+        EXPECT_EQ(TailFrom(path, 0, 2), "2\n3");
+
+        WriteFile(path, "");
+        EXPECT_EQ(TailFrom(path, 0, 1), "");
+    }
+
+    TEST(TailerTest, LastLinesAcrossBlocks) {
+        std::string path = JoinPath(NewRoot("blocks"), "log");
+        // Lines longer than the blocks the file is scanned by from its end.
+        std::string line(100000, 'x');
+        WriteFile(path, absl::StrCat("a\n", line, "\n", line, "\n"));
+        EXPECT_EQ(TailFrom(path, 0, 1), line + "\n");
+        EXPECT_EQ(TailFrom(path, 0, 2), absl::StrCat(line, "\n", line, "\n"));
+        EXPECT_EQ(TailFrom(path, 0, 3).size(), 2 + 2 * (line.size() + 1));
+    }
+
+    TEST(TailerTest, Offsets) {
+        std::string path = JoinPath(NewRoot("offsets"), "log");
+        WriteFile(path, "1\n2\n3\n");
+        EXPECT_EQ(TailFrom(path, 2, 0), "2\n3\n");
+        EXPECT_EQ(TailFrom(path, -2, 0), "3\n");
+        EXPECT_EQ(TailFrom(path, -100, 0), "1\n2\n3\n");
+        // A negative offset bounds how far back the last lines go.
+        EXPECT_EQ(TailFrom(path, -3, 3), "\n3\n");
+    }
+
+    TEST(TailerTest, FollowsAppends) {
+        std::string path = JoinPath(NewRoot("follow"), "log");
+        WriteFile(path, "1\n");
+        Tailer tailer(path);
+        ASSERT_TRUE(tailer.Open(-1, 0, true).ok());
+        std::string data;
+        ASSERT_TRUE(tailer.Read(1024, absl::ZeroDuration(), &data).ok());
+        EXPECT_EQ(data, "\n");
+        ASSERT_TRUE(tailer.Read(1024, absl::ZeroDuration(), &data).ok());
+        EXPECT_EQ(data, "");
+
+        std::thread writer([&path]() {
+            absl::SleepFor(absl::Milliseconds(50));
+            AppendFile(path, "2\n");
+        });
+        ASSERT_TRUE(tailer.Read(1024, absl::Seconds(10), &data).ok());
+        writer.join();
+        EXPECT_EQ(data, "2\n");
+        EXPECT_EQ(tailer.offset(), 4);
+        EXPECT_FALSE(tailer.TakeReset());
+    }
+
+    TEST(TailerTest, FollowsRotation) {
+        std::string root = NewRoot("rotation");
+        std::string path = JoinPath(root, "log");
+        WriteFile(path, "old\n");
+        Tailer tailer(path);
+        ASSERT_TRUE(tailer.Open(0, 0, true).ok());
+        std::string data;
+        ASSERT_TRUE(tailer.Read(1024, absl::ZeroDuration(), &data).ok());
+        EXPECT_EQ(data, "old\n");
+
+        // Rotated by rename, with a last line written to the old file.
+        ASSERT_EQ(rename(path.c_str(), JoinPath(root, "log.1").c_str()), 0);
+        AppendFile(JoinPath(root, "log.1"), "last\n");
+        WriteFile(path, "new\n");
+        ASSERT_TRUE(tailer.Read(1024, absl::Seconds(10), &data).ok());
+        EXPECT_EQ(data, "last\n");
+        ASSERT_TRUE(tailer.Read(1024, absl::Seconds(10), &data).ok());
+        EXPECT_EQ(data, "new\n");
+        EXPECT_TRUE(tailer.TakeReset());
+
+        // Truncated in place.
+        WriteFile(path, "");
+        AppendFile(path, "n\n");
+        ASSERT_TRUE(tailer.Read(1024, absl::Seconds(10), &data).ok());
+        EXPECT_EQ(data, "n\n");
+        EXPECT_TRUE(tailer.TakeReset());
+    }
+
+    TEST(TailerTest, OpenFailures) {
+        std::string root = NewRoot("failures");
+        EXPECT_TRUE(absl::IsNotFound(Tailer(JoinPath(root, "none")).Open(0, 0, false)));
+        EXPECT_TRUE(absl::IsInvalidArgument(Tailer(root).Open(0, 0, false)));
+    }
+}  // namespace
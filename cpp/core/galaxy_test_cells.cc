@@ -0,0 +1,90 @@
+#include <fstream>
+#include <unistd.h>
+
+#include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "cpp/core/galaxy_flag.h"
+#include "cpp/core/galaxy_test_cells.h"
+#include "cpp/internal/galaxy_fs_internal.h"
+#include "cpp/util/galaxy_util.h"
+#include "glog/logging.h"
+
+namespace galaxy
+{
+    namespace
+    {
+        constexpr char kTestPassword[] = "test";
+        // Port of the cells that are down, on which nothing listens.
+        constexpr int kDownPort = 1;
+    }
+
+    TestCells::TestCells(const std::string &name, const std::vector<std::string> &cells, const TestCellsOptions &options)
+    {
+        const char *tmp_dir = getenv("TEST_TMPDIR");
+        std::string dir = internal::JoinPath(tmp_dir != nullptr ? tmp_dir : "/tmp",
+                                             absl::StrCat("galaxy_cells_", getpid(), "_", name));
+        CHECK(impl::CreateDirIfNotExist(dir, 0777).ok());
+
+        // Servers are started first on any free port, and given their config once the ports are known. No client can
+        // reach them before, as the config naming them is not written yet.
+        std::map<std::string, int> ports;
+        std::vector<std::string> served;
+        for (const auto &cell : cells)
+        {
+            std::string root = options.shared_root ? internal::JoinPath(dir, "root") : internal::JoinPath(dir, cell);
+            CHECK(impl::CreateDirIfNotExist(root, 0777).ok());
+            roots_[cell] = root;
+            if (options.down.count(cell) > 0)
+            {
+                ports[cell] = kDownPort;
+                continue;
+            }
+            services_.push_back(std::make_unique<GalaxyServerImpl>());
+            grpc::ServerBuilder builder;
+            builder.SetMaxMessageSize(-1);
+            builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &ports[cell]);
+            builder.RegisterService(services_.back().get());
+            servers_.push_back(builder.BuildAndStart());
+            CHECK(servers_.back() != nullptr && ports[cell] > 0) << "Fail to serve cell [" << cell << "].";
+            served.push_back(cell);
+        }
+
+        std::vector<std::string> entries;
+        for (const auto &cell : cells)
+        {
+            std::vector<std::string> members = {
+                absl::StrCat("\"fs_root\": \"", roots_[cell], "\""),
+                "\"fs_ip\": \"127.0.0.1\"",
+                absl::StrCat("\"fs_port\": ", ports[cell]),
+                "\"fs_stats_port\": 0",
+                absl::StrCat("\"fs_password\": \"", kTestPassword, "\""),
+                "\"fs_max_msg_size\": 64",
+            };
+            members.insert(members.end(), options.extra_config.begin(), options.extra_config.end());
+            entries.push_back(absl::StrCat("\"", cell, "\": {", absl::StrJoin(members, ", "), "}"));
+        }
+        std::string config_path = internal::JoinPath(dir, "config.json");
+        std::ofstream config_file(config_path);
+        config_file << "{" << absl::StrJoin(entries, ", ") << "}";
+        config_file.close();
+        absl::SetFlag(&FLAGS_fs_global_config, config_path);
+
+        for (size_t i = 0; i < served.size(); i++)
+        {
+            absl::StatusOr<galaxy_schema::CellConfig> config = util::ParseCellConfig(served[i]);
+            CHECK(config.ok()) << config.status();
+            services_[i]->SetPassword(config->fs_password());
+            services_[i]->SetCellConfig(*config);
+        }
+    }
+
+    TestCells::~TestCells()
+    {
+        for (auto &server : servers_)
+        {
+            server->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(5));
+        }
+        absl::SetFlag(&FLAGS_fs_global_config, "");
+    }
+} //  namespace galaxy.
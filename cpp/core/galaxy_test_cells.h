@@ -0,0 +1,44 @@
+#ifndef CPP_CORE_GALAXY_TEST_CELLS_H_
+#define CPP_CORE_GALAXY_TEST_CELLS_H_
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include <grpcpp/grpcpp.h>
+#include "cpp/core/galaxy_server.h"
+
+namespace galaxy
+{
+    struct TestCellsOptions
+    {
+        // Cells of the config that are not served, standing for cells that are down.
+        std::set<std::string> down;
+        // Gives every cell the same root, like cells deployed with the same layout on different machines.
+        bool shared_root = false;
+        // Extra entries of the config of every cell, as json members, e.g. "\"fs_enable_cas\": true".
+        std::vector<std::string> extra_config;
+    };
+
+    // Cells served in-process on local ports for tests, and the global config naming them, which fs_global_config
+    // points to while they are alive. Each cell has its own root under the test temporary directory unless the
+    // options ask for a shared one. Clients of the test are not in a cell, as fs_cell is left empty.
+    class TestCells
+    {
+    public:
+        TestCells(const std::string &name, const std::vector<std::string> &cells,
+                  const TestCellsOptions &options = TestCellsOptions());
+        ~TestCells();
+        TestCells(const TestCells&) = delete;
+
+        // Directory on disk of the root of cell.
+        const std::string &Root(const std::string &cell) const { return roots_.at(cell); }
+
+    private:
+        std::map<std::string, std::string> roots_;
+        std::vector<std::unique_ptr<GalaxyServerImpl>> services_;
+        std::vector<std::unique_ptr<grpc::Server>> servers_;
+    };
+} //  namespace galaxy.
+#endif   //  CPP_CORE_GALAXY_TEST_CELLS_H_
@@ -0,0 +1,323 @@
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "cpp/core/galaxy_txn.h"
+#include "cpp/internal/galaxy_const.h"
+#include "cpp/internal/galaxy_fs_internal.h"
+#include "glog/logging.h"
+
+namespace galaxy
+{
+    namespace
+    {
+        constexpr char kJournalSuffix[] = ".journal";
+        constexpr char kPrepared[] = "PREPARE";
+        constexpr char kCommitted[] = "COMMIT";
+        // Directories of the journals of other processes, followed by their pid.
+        constexpr char kOwnerPrefix[] = "pid_";
+
+        // Staged file, the path it is renamed to and its size.
+        struct Rename
+        {
+            std::string staged;
+            std::string path;
+            int64_t size = 0;
+        };
+
+        absl::Status SyncDir(const std::string &dir)
+        {
+            int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd < 0 || fsync(fd) != 0)
+            {
+                std::string error = std::strerror(errno);
+                if (fd >= 0)
+                {
+                    close(fd);
+                }
+                return absl::InternalError("Syncing directory " + dir + " failed with error " + error + ".");
+            }
+            close(fd);
+            return absl::OkStatus();
+        }
+
+        // Writes data to path and syncs it, with the permissions of like_path if it exists.
+        absl::Status WriteSynced(const std::string &path, const std::string &data, const std::string &like_path)
+        {
+            int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+            if (fd < 0)
+            {
+                return absl::InternalError("Creating " + path + " failed with error " + std::strerror(errno) + ".");
+            }
+            struct stat statbuf;
+            if (stat(like_path.c_str(), &statbuf) == 0)
+            {
+                fchmod(fd, statbuf.st_mode & 07777);
+            }
+            size_t offset = 0;
+            while (offset < data.size())
+            {
+                ssize_t written = write(fd, data.data() + offset, data.size() - offset);
+                if (written < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (written < 0)
+                {
+                    std::string error = std::strerror(errno);
+                    close(fd);
+                    return absl::InternalError("Writing " + path + " failed with error " + error + ".");
+                }
+                offset += written;
+            }
+            if (fdatasync(fd) != 0)
+            {
+                std::string error = std::strerror(errno);
+                close(fd);
+                return absl::InternalError("Syncing " + path + " failed with error " + error + ".");
+            }
+            close(fd);
+            return absl::OkStatus();
+        }
+
+        // Replaces the journal with its new state. Once this returns, the state survives a crash.
+        absl::Status WriteJournal(const std::string &journal_path, const std::string &state, const std::vector<Rename> &renames)
+        {
+            std::string content = state + "\n";
+            for (const auto &rename : renames)
+            {
+                absl::StrAppend(&content, rename.staged, "\n", rename.path, "\n", rename.size, "\n");
+            }
+            std::string tmp_path = journal_path + ".tmp";
+            absl::Status status = WriteSynced(tmp_path, content, tmp_path);
+            if (status.ok() && rename(tmp_path.c_str(), journal_path.c_str()) != 0)
+            {
+                status = absl::InternalError("Renaming journal " + journal_path + " failed with error " + std::strerror(errno) + ".");
+            }
+            if (!status.ok())
+            {
+                unlink(tmp_path.c_str());
+                return status;
+            }
+            return SyncDir(*internal::GetFileAbsDir(journal_path));
+        }
+
+        // Publishes the staged files. A staged file that is gone was renamed by an earlier attempt only if its target
+        // has its size, anything else means the transaction cannot be completed.
+        absl::Status ApplyRenames(const std::vector<Rename> &renames)
+        {
+            std::set<std::string> dirs;
+            for (const auto &rename : renames)
+            {
+                if (!internal::ExistFile(rename.staged))
+                {
+                    struct stat statbuf;
+                    if (stat(rename.path.c_str(), &statbuf) == 0 && statbuf.st_size == rename.size)
+                    {
+                        continue;
+                    }
+                    return absl::DataLossError(absl::StrCat("Staged file ", rename.staged, " is gone and ", rename.path,
+                                                            " does not hold its ", rename.size, " bytes."));
+                }
+                if (::rename(rename.staged.c_str(), rename.path.c_str()) != 0)
+                {
+                    return absl::InternalError("Renaming " + rename.staged + " to " + rename.path + " failed with error " +
+                                               std::strerror(errno) + ".");
+                }
+                dirs.insert(*internal::GetFileAbsDir(rename.path));
+            }
+            for (const auto &dir : dirs)
+            {
+                absl::Status status = SyncDir(dir);
+                if (!status.ok())
+                {
+                    return status;
+                }
+            }
+            return absl::OkStatus();
+        }
+
+        void DiscardStaged(const std::vector<Rename> &renames)
+        {
+            for (const auto &rename : renames)
+            {
+                unlink(rename.staged.c_str());
+            }
+        }
+    } // namespace
+
+    GalaxyTxn::GalaxyTxn(const std::string &fs_root, pid_t owner_pid)
+        : root_(internal::JoinPath(fs_root, galaxy::constant::kTxnDir)), owned_(owner_pid != 0)
+    {
+        if (owned_)
+        {
+            root_ = internal::JoinPath(root_, absl::StrCat(kOwnerPrefix, owner_pid));
+        }
+    }
+
+    absl::Status GalaxyTxn::Commit(const std::vector<std::pair<std::string, std::string>> &files)
+    {
+        static std::atomic<uint64_t> counter{0};
+        if (!impl::CreateDirIfNotExist(*internal::GetFileAbsDir(root_), 0777).ok() ||
+            !impl::CreateDirIfNotExist(root_, 0777).ok())
+        {
+            return absl::InternalError("Creating transaction journal directory " + root_ + " failed.");
+        }
+        std::string txn_id = absl::StrCat(absl::ToUnixMicros(absl::Now()), "_", getpid(), "_", counter++);
+        std::string journal_path = internal::JoinPath(root_, txn_id + kJournalSuffix);
+        std::vector<Rename> renames;
+        for (const auto &file : files)
+        {
+            absl::StatusOr<std::string> dir = internal::GetFileAbsDir(file.first);
+            absl::StatusOr<std::string> name = internal::GetFileName(file.first);
+            if (!dir.ok() || !name.ok() || name->empty())
+            {
+                return absl::InvalidArgumentError("Invalid path " + file.first + " in transaction.");
+            }
+            renames.push_back({internal::JoinPath(*dir, absl::StrCat(".", *name, ".txn_", txn_id)), file.first,
+                               static_cast<int64_t>(file.second.size())});
+        }
+
+        // The journal is written before any staged file, so that Recover can find and remove them all.
+        absl::Status status = WriteJournal(journal_path, kPrepared, renames);
+        for (size_t i = 0; status.ok() && i < files.size(); ++i)
+        {
+            absl::StatusOr<std::string> dir = internal::GetFileAbsDir(files[i].first);
+            status = impl::CreateDirIfNotExist(*dir, 0777);
+            if (status.ok())
+            {
+                status = WriteSynced(renames[i].staged, files[i].second, files[i].first);
+            }
+        }
+        // The staged files must be durable in their directories before the commit point, or a crash right after it
+        // could leave a committed journal whose files are gone.
+        std::set<std::string> dirs = {root_};
+        for (const auto &rename : renames)
+        {
+            dirs.insert(*internal::GetFileAbsDir(rename.staged));
+        }
+        for (auto it = dirs.begin(); status.ok() && it != dirs.end(); ++it)
+        {
+            status = SyncDir(*it);
+        }
+        if (status.ok())
+        {
+            // Commit point: from here on, the transaction is completed even if the server crashes.
+            status = WriteJournal(journal_path, kCommitted, renames);
+        }
+        if (!status.ok())
+        {
+            LOG(ERROR) << "Transaction " << txn_id << " rolled back with error " << status;
+            DiscardStaged(renames);
+            unlink(journal_path.c_str());
+            return status;
+        }
+        status = ApplyRenames(renames);
+        if (!status.ok())
+        {
+            // The journal is kept, so that the next Recover completes the transaction.
+            LOG(ERROR) << "Transaction " << txn_id << " committed but not fully applied with error " << status;
+            return status;
+        }
+        unlink(journal_path.c_str());
+        VLOG(1) << "Transaction " << txn_id << " committed " << files.size() << " files.";
+        return absl::OkStatus();
+    }
+
+    int GalaxyTxn::Recover()
+    {
+        int num_recovered = RecoverDir(root_);
+        if (owned_)
+        {
+            return num_recovered;
+        }
+        absl::StatusOr<std::vector<std::string>> owner_dirs = internal::ListDirsInDir(root_);
+        if (!owner_dirs.ok())
+        {
+            return num_recovered;
+        }
+        for (const auto &dir : *owner_dirs)
+        {
+            absl::StatusOr<std::string> name = internal::GetFileName(dir);
+            pid_t pid = 0;
+            if (!name.ok() || !absl::StartsWith(*name, kOwnerPrefix) ||
+                !absl::SimpleAtoi(name->substr(strlen(kOwnerPrefix)), &pid) || pid <= 0)
+            {
+                continue;
+            }
+            if (kill(pid, 0) == 0 || errno != ESRCH)
+            {
+                VLOG(1) << "Transactions of live process " << pid << " are left to it.";
+                continue;
+            }
+            num_recovered += RecoverDir(dir);
+            rmdir(dir.c_str());
+        }
+        return num_recovered;
+    }
+
+    int GalaxyTxn::RecoverDir(const std::string &dir)
+    {
+        absl::StatusOr<std::vector<std::string>> journals = internal::ListFilesInDir(dir, true);
+        if (!journals.ok())
+        {
+            return 0;
+        }
+        int num_recovered = 0;
+        for (const auto &journal_path : *journals)
+        {
+            if (!absl::EndsWith(journal_path, kJournalSuffix))
+            {
+                // Journal updates interrupted before their rename, the previous state of the journal still holds.
+                unlink(journal_path.c_str());
+                continue;
+            }
+            std::ifstream journal(journal_path);
+            std::string state;
+            std::getline(journal, state);
+            std::vector<Rename> renames;
+            Rename rename;
+            std::string size;
+            while (std::getline(journal, rename.staged) && std::getline(journal, rename.path) && std::getline(journal, size))
+            {
+                if (!absl::SimpleAtoi(size, &rename.size))
+                {
+                    break;
+                }
+                renames.push_back(rename);
+            }
+            if (state == kCommitted)
+            {
+                absl::Status status = ApplyRenames(renames);
+                if (!status.ok())
+                {
+                    // Kept for a manual repair, the transaction is neither complete nor rolled back.
+                    LOG(ERROR) << "Fail to complete committed transaction " << journal_path << " with error " << status
+                               << ", its journal is kept and the files it lists need to be checked.";
+                    continue;
+                }
+                LOG(INFO) << "Completed transaction " << journal_path << ".";
+            }
+            else
+            {
+                DiscardStaged(renames);
+                LOG(INFO) << "Rolled back transaction " << journal_path << ".";
+            }
+            unlink(journal_path.c_str());
+            ++num_recovered;
+        }
+        return num_recovered;
+    }
+} //  namespace galaxy.
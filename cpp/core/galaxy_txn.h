@@ -0,0 +1,39 @@
+#ifndef CPP_CORE_GALAXY_TXN_H_
+#define CPP_CORE_GALAXY_TXN_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
+#include "absl/status/status.h"
+
+namespace galaxy
+{
+    // All-or-nothing commits of several files of a cell, journaled under <fs_root>/.galaxy_txn. A transaction journals
+    // its plan, stages every file as a hidden sibling, marks its journal committed and only then renames the staged
+    // files into place. After a crash, Recover finishes the committed transactions and discards the others.
+    class GalaxyTxn
+    {
+    public:
+        // With owner_pid, e.g. for a client writing to its own cell, the journals live in a directory of that process,
+        // which the server only recovers once the process is gone.
+        explicit GalaxyTxn(const std::string& fs_root, pid_t owner_pid = 0);
+        GalaxyTxn(const GalaxyTxn&) = delete;
+
+        // Overwrites every path of files with its data, or none of them. Callers hold the locks of all the paths, so
+        // that readers holding them too see either all the old or all the new contents.
+        absl::Status Commit(const std::vector<std::pair<std::string, std::string>>& files);
+        // Completes or rolls back the transactions left by a previous run, and without owner_pid those of owner
+        // processes that are gone. Returns how many were found.
+        int Recover();
+
+    private:
+        // Recovers the journals directly under dir.
+        static int RecoverDir(const std::string& dir);
+
+        std::string root_;
+        bool owned_;
+    };
+} //  namespace galaxy.
+#endif   //  CPP_CORE_GALAXY_TXN_H_
@@ -0,0 +1,143 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "cpp/core/galaxy_txn.h"
+#include "cpp/internal/galaxy_const.h"
+#include "cpp/internal/galaxy_fs_internal.h"
+
+namespace {
+    using galaxy::GalaxyTxn;
+    using galaxy::internal::JoinPath;
+
+    std::string NewRoot(const std::string& name) {
+        std::string root = JoinPath(testing::TempDir(), absl::StrCat("galaxy_txn_test_", getpid(), "_", name));
+        EXPECT_TRUE(galaxy::impl::CreateDirIfNotExist(root, 0777).ok());
+        return root;
+    }
+
+    void WriteFile(const std::string& path, const std::string& data) {
+        std::ofstream(path) << data;
+    }
+
+    std::string ReadFile(const std::string& path) {
+        std::stringstream data;
+        data << std::ifstream(path).rdbuf();
+        return data.str();
+    }
+
+    // Journal as a transaction leaves it when the process crashes in state, with one staged file for path.
+    std::string WriteJournal(const std::string& dir, const std::string& state, const std::string& staged,
+                             const std::string& path, size_t size) {
+        EXPECT_TRUE(galaxy::impl::CreateDirIfNotExist(dir, 0777).ok());
+        std::string journal_path = JoinPath(dir, "1_1_0.journal");
+        WriteFile(journal_path, absl::StrCat(state, "\n", staged, "\n", path, "\n", size, "\n"));
+        return journal_path;
+    }
+
+    std::string TxnDir(const std::string& root) {
+        return JoinPath(root, galaxy::constant::kTxnDir);
+    }
+
+    TEST(GalaxyTxnTest, CommitWritesAllFiles) {
+        std::string root = NewRoot("commit");
+        WriteFile(JoinPath(root, "a"), "old");
+        GalaxyTxn txn(root);
+        EXPECT_TRUE(txn.Commit({{JoinPath(root, "a"), "new a"}, {JoinPath(root, "sub/b"), "new b"}}).ok());
+        EXPECT_EQ(ReadFile(JoinPath(root, "a")), "new a");
+        EXPECT_EQ(ReadFile(JoinPath(root, "sub/b")), "new b");
+        auto journals = galaxy::internal::ListFilesInDir(TxnDir(root), true);
+        ASSERT_TRUE(journals.ok());
+        EXPECT_TRUE(journals->empty());
+        auto staged = galaxy::internal::ListFilesInDir(root, true);
+        ASSERT_TRUE(staged.ok());
+        EXPECT_EQ(staged->size(), 1);
+    }
+
+    TEST(GalaxyTxnTest, RecoverRollsBackPrepared) {
+        std::string root = NewRoot("prepared");
+        std::string path = JoinPath(root, "a");
+        std::string staged = JoinPath(root, ".a.txn_1");
+        WriteFile(path, "old");
+        WriteFile(staged, "new");
+        std::string journal_path = WriteJournal(TxnDir(root), "PREPARE", staged, path, 3);
+        // Journal update interrupted before its rename.
+        WriteFile(journal_path + ".tmp", "COMMIT\n");
+        EXPECT_EQ(GalaxyTxn(root).Recover(), 1);
+        EXPECT_EQ(ReadFile(path), "old");
+        EXPECT_FALSE(galaxy::internal::ExistFile(staged));
+        EXPECT_FALSE(galaxy::internal::ExistFile(journal_path));
+        EXPECT_FALSE(galaxy::internal::ExistFile(journal_path + ".tmp"));
+    }
+
+    TEST(GalaxyTxnTest, RecoverCompletesCommitted) {
+        std::string root = NewRoot("committed");
+        std::string path = JoinPath(root, "a");
+        std::string staged = JoinPath(root, ".a.txn_1");
+        WriteFile(path, "old");
+        WriteFile(staged, "new");
+        std::string journal_path = WriteJournal(TxnDir(root), "COMMIT", staged, path, 3);
+        EXPECT_EQ(GalaxyTxn(root).Recover(), 1);
+        EXPECT_EQ(ReadFile(path), "new");
+        EXPECT_FALSE(galaxy::internal::ExistFile(staged));
+        EXPECT_FALSE(galaxy::internal::ExistFile(journal_path));
+    }
+
+    TEST(GalaxyTxnTest, RecoverSkipsAlreadyRenamed) {
+        // Crash between the renames and the removal of the journal.
+        std::string root = NewRoot("renamed");
+        std::string path = JoinPath(root, "a");
+        WriteFile(path, "new");
+        std::string journal_path = WriteJournal(TxnDir(root), "COMMIT", JoinPath(root, ".a.txn_1"), path, 3);
+        EXPECT_EQ(GalaxyTxn(root).Recover(), 1);
+        EXPECT_EQ(ReadFile(path), "new");
+        EXPECT_FALSE(galaxy::internal::ExistFile(journal_path));
+    }
+
+    TEST(GalaxyTxnTest, RecoverKeepsJournalOfLostFiles) {
+        // Committed, but the staged file is gone and the target never received it.
+        std::string root = NewRoot("lost");
+        std::string path = JoinPath(root, "a");
+        WriteFile(path, "old data");
+        std::string journal_path = WriteJournal(TxnDir(root), "COMMIT", JoinPath(root, ".a.txn_1"), path, 3);
+        EXPECT_EQ(GalaxyTxn(root).Recover(), 0);
+        EXPECT_EQ(ReadFile(path), "old data");
+        EXPECT_TRUE(galaxy::internal::ExistFile(journal_path));
+    }
+
+    TEST(GalaxyTxnTest, RecoverLeavesLiveOwners) {
+        std::string root = NewRoot("owners");
+        pid_t dead_pid = fork();
+        if (dead_pid == 0) {
+            _exit(0);
+        }
+        ASSERT_GT(dead_pid, 0);
+        waitpid(dead_pid, nullptr, 0);
+
+        std::string dead_path = JoinPath(root, "dead");
+        std::string dead_staged = JoinPath(root, ".dead.txn_1");
+        WriteFile(dead_staged, "dead");
+        std::string dead_dir = JoinPath(TxnDir(root), absl::StrCat("pid_", dead_pid));
+        WriteJournal(dead_dir, "COMMIT", dead_staged, dead_path, 4);
+
+        std::string live_path = JoinPath(root, "live");
+        std::string live_staged = JoinPath(root, ".live.txn_1");
+        WriteFile(live_staged, "live");
+        std::string live_journal = WriteJournal(JoinPath(TxnDir(root), absl::StrCat("pid_", getpid())), "PREPARE",
+                                                live_staged, live_path, 4);
+
+        EXPECT_EQ(GalaxyTxn(root).Recover(), 1);
+        EXPECT_EQ(ReadFile(dead_path), "dead");
+        EXPECT_FALSE(galaxy::internal::ExistDir(dead_dir));
+        EXPECT_TRUE(galaxy::internal::ExistFile(live_journal));
+        EXPECT_TRUE(galaxy::internal::ExistFile(live_staged));
+
+        // The owner itself commits in its own directory.
+        GalaxyTxn owned(root, getpid());
+        EXPECT_TRUE(owned.Commit({{live_path, "committed"}}).ok());
+        EXPECT_EQ(ReadFile(live_path), "committed");
+    }
+}  // namespace
@@ -0,0 +1,445 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/time/clock.h"
+#include "cpp/core/galaxy_watch.h"
+#include "cpp/internal/galaxy_const.h"
+#include "glog/logging.h"
+
+namespace galaxy
+{
+    namespace
+    {
+        constexpr uint32_t kWatchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | IN_ATTRIB |
+                                        IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+        // A move away is paired with a move into a watched directory if that one is read within this time.
+        constexpr int kMovePairMs = 10;
+        constexpr int kPollMs = 200;
+
+        std::string Trimmed(const std::string &path)
+        {
+            return path.size() > 1 && path.back() == '/' ? path.substr(0, path.size() - 1) : path;
+        }
+
+        std::string Join(const std::string &dir, const std::string &name)
+        {
+            return dir == "/" ? "/" + name : dir + "/" + name;
+        }
+
+        std::string ParentDir(const std::string &path)
+        {
+            size_t pos = path.find_last_of('/');
+            return pos == 0 || pos == std::string::npos ? "/" : path.substr(0, pos);
+        }
+
+        bool IsUnder(const std::string &path, const std::string &dir)
+        {
+            return path == dir || absl::StartsWith(path, dir == "/" ? "/" : dir + "/");
+        }
+
+        // Whether an event on path is one of a subscription to dir.
+        bool Matches(const std::string &path, const std::string &dir, bool recursive)
+        {
+            return recursive ? IsUnder(path, dir) : path == dir || ParentDir(path) == dir;
+        }
+    } // namespace
+
+    WatchHub::WatchHub(size_t history)
+        : history_size_(history), epoch_(absl::StrCat(absl::Hex(absl::ToUnixMicros(absl::Now())), absl::Hex(getpid())))
+    {
+        inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd_ < 0)
+        {
+            LOG(ERROR) << "Watches disabled, inotify failed with error " << std::strerror(errno) << ".";
+            return;
+        }
+        reader_ = std::thread(&WatchHub::ReadLoop, this);
+    }
+
+    WatchHub::~WatchHub()
+    {
+        stopped_ = true;
+        if (reader_.joinable())
+        {
+            reader_.join();
+        }
+        if (inotify_fd_ >= 0)
+        {
+            close(inotify_fd_);
+        }
+    }
+
+    absl::Status WatchHub::Subscribe(const std::string &path, bool recursive)
+    {
+        if (inotify_fd_ < 0)
+        {
+            return absl::UnavailableError("Watches are not available.");
+        }
+        std::string dir = Trimmed(path);
+        struct stat statbuf;
+        if (dir.empty() || dir[0] != '/' || lstat(dir.c_str(), &statbuf) != 0 || !S_ISDIR(statbuf.st_mode))
+        {
+            return absl::NotFoundError("Path " + path + " is not a directory.");
+        }
+        std::lock_guard<std::mutex> lock(mu_);
+        bool created = subscriptions_.find({dir, recursive}) == subscriptions_.end();
+        Subscription &subscription = subscriptions_[{dir, recursive}];
+        ++subscription.num_subscribers;
+        if (created || !dirs_.contains(dir))
+        {
+            // New, or its directory was removed since, so nothing before now can be resumed.
+            subscription.since = last_seq_;
+            if (recursive)
+            {
+                AddTree(dir, false);
+            }
+            else
+            {
+                AddWatch(dir);
+            }
+        }
+        if (!dirs_.contains(dir))
+        {
+            --subscription.num_subscribers;
+            subscription.released = absl::Now();
+            return absl::InternalError("Watching " + path + " failed.");
+        }
+        return absl::OkStatus();
+    }
+
+    void WatchHub::Unsubscribe(const std::string &path, bool recursive)
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto subscription = subscriptions_.find({Trimmed(path), recursive});
+        if (subscription != subscriptions_.end() && subscription->second.num_subscribers > 0 &&
+            --subscription->second.num_subscribers == 0)
+        {
+            subscription->second.released = absl::Now();
+        }
+    }
+
+    bool WatchHub::Wait(const std::string &path, bool recursive, uint64_t *after, absl::Duration timeout,
+                        std::vector<Event> *events)
+    {
+        std::string dir = Trimmed(path);
+        std::unique_lock<std::mutex> lock(mu_);
+        cv_.wait_for(lock, absl::ToChronoMilliseconds(timeout), [&] { return last_seq_ > *after || stopped_; });
+        auto subscription = subscriptions_.find({dir, recursive});
+        if (*after < dropped_seq_ || *after < lost_seq_ || subscription == subscriptions_.end() ||
+            *after < subscription->second.since)
+        {
+            *after = last_seq_;
+            return false;
+        }
+        auto first = std::upper_bound(history_.begin(), history_.end(), *after,
+                                      [](uint64_t seq, const Event &event) { return seq < event.seq; });
+        for (auto event = first; event != history_.end(); ++event)
+        {
+            if (Matches(event->path, dir, recursive) ||
+                (event->type == kRename && Matches(event->old_path, dir, recursive)))
+            {
+                events->push_back(*event);
+            }
+        }
+        *after = last_seq_;
+        return true;
+    }
+
+    uint64_t WatchHub::last_seq()
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        return last_seq_;
+    }
+
+    std::string WatchHub::Token(uint64_t seq) const
+    {
+        return absl::StrCat(epoch_, ":", seq);
+    }
+
+    bool WatchHub::ParseToken(const std::string &token, uint64_t *seq) const
+    {
+        std::vector<std::string> parts = absl::StrSplit(token, ':');
+        return parts.size() == 2 && parts[0] == epoch_ && absl::SimpleAtoi(parts[1], seq);
+    }
+
+    void WatchHub::ReadLoop()
+    {
+        alignas(struct inotify_event) char buffer[65536];
+        while (!stopped_)
+        {
+            struct pollfd pfd = {inotify_fd_, POLLIN, 0};
+            int ready = poll(&pfd, 1, move_pending_ ? kMovePairMs : kPollMs);
+            std::lock_guard<std::mutex> lock(mu_);
+            uint64_t seq = last_seq_;
+            if (ready <= 0)
+            {
+                FlushMove();
+            }
+            while (ready > 0)
+            {
+                ssize_t length = read(inotify_fd_, buffer, sizeof(buffer));
+                if (length <= 0)
+                {
+                    break;
+                }
+                for (char *p = buffer; p < buffer + length;)
+                {
+                    const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(p);
+                    p += sizeof(struct inotify_event) + event->len;
+                    if (event->mask & IN_Q_OVERFLOW)
+                    {
+                        LOG(WARNING) << "Watched changes lost after an inotify queue overflow.";
+                        FlushMove();
+                        lost_seq_ = ++last_seq_;
+                        continue;
+                    }
+                    auto watch = watches_.find(event->wd);
+                    if (watch == watches_.end())
+                    {
+                        continue;
+                    }
+                    if (event->mask & IN_IGNORED)
+                    {
+                        dirs_.erase(watch->second);
+                        watches_.erase(watch);
+                        continue;
+                    }
+                    // Copied, as the event may remove the watch.
+                    std::string dir = watch->second;
+                    HandleEvent(dir, event->mask, event->cookie, event->len > 0 ? event->name : "");
+                }
+            }
+            Expire();
+            if (last_seq_ != seq)
+            {
+                cv_.notify_all();
+            }
+        }
+        cv_.notify_all();
+    }
+
+    void WatchHub::HandleEvent(const std::string &dir, uint32_t mask, uint32_t cookie, const std::string &name)
+    {
+        if (name.empty())
+        {
+            if (mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+            {
+                // Reported by the parent instead if it is watched too.
+                if (!dirs_.contains(ParentDir(dir)))
+                {
+                    Append(kDelete, dir, true);
+                }
+                RemoveWatches(dir);
+            }
+            return;
+        }
+        std::string path = Join(dir, name);
+        bool is_dir = mask & IN_ISDIR;
+        if ((mask & IN_MOVED_TO) && move_pending_ && move_cookie_ == cookie)
+        {
+            move_pending_ = false;
+            Append(kRename, path, is_dir, move_path_);
+            if (is_dir && Covered(path))
+            {
+                AddTree(path, false);
+            }
+            return;
+        }
+        FlushMove();
+        if (mask & IN_MOVED_FROM)
+        {
+            move_pending_ = true;
+            move_cookie_ = cookie;
+            move_path_ = path;
+            move_is_dir_ = is_dir;
+            if (is_dir)
+            {
+                // Its watches would report it under its old path.
+                RemoveWatches(path);
+            }
+        }
+        else if (mask & (IN_CREATE | IN_MOVED_TO))
+        {
+            Append(kCreate, path, is_dir);
+            if (is_dir && Covered(path))
+            {
+                // What was put in it before its watch would not be reported otherwise.
+                AddTree(path, true);
+            }
+        }
+        else if (mask & IN_DELETE)
+        {
+            Append(kDelete, path, is_dir);
+        }
+        else if (mask & (IN_MODIFY | IN_ATTRIB))
+        {
+            Append(kModify, path, is_dir);
+        }
+    }
+
+    void WatchHub::Append(uint32_t type, const std::string &path, bool is_dir, const std::string &old_path)
+    {
+        if (type == kModify && !history_.empty() && history_.back().type == kModify && history_.back().path == path)
+        {
+            // Consecutive modifications of a file, e.g. appends, are coalesced into the latest one.
+            history_.pop_back();
+        }
+        Event event;
+        event.seq = ++last_seq_;
+        event.type = type;
+        event.path = path;
+        event.old_path = old_path;
+        event.is_dir = is_dir;
+        history_.push_back(std::move(event));
+        while (history_.size() > history_size_)
+        {
+            dropped_seq_ = history_.front().seq;
+            history_.pop_front();
+        }
+    }
+
+    void WatchHub::AddTree(const std::string &dir, bool report)
+    {
+        if (!AddWatch(dir))
+        {
+            return;
+        }
+        DIR *dirp = opendir(dir.c_str());
+        if (dirp == nullptr)
+        {
+            return;
+        }
+        std::vector<std::string> sub_dirs;
+        struct dirent *dp;
+        while ((dp = readdir(dirp)) != nullptr)
+        {
+            std::string name = dp->d_name;
+            struct stat statbuf;
+            if (name == "." || name == ".." || fstatat(dirfd(dirp), dp->d_name, &statbuf, AT_SYMLINK_NOFOLLOW) != 0)
+            {
+                continue;
+            }
+            if (report)
+            {
+                Append(kCreate, Join(dir, name), S_ISDIR(statbuf.st_mode));
+            }
+            if (S_ISDIR(statbuf.st_mode))
+            {
+                sub_dirs.push_back(Join(dir, name));
+            }
+        }
+        closedir(dirp);
+        for (const auto &sub_dir : sub_dirs)
+        {
+            AddTree(sub_dir, report);
+        }
+    }
+
+    bool WatchHub::AddWatch(const std::string &dir)
+    {
+        if (dirs_.contains(dir))
+        {
+            return true;
+        }
+        int wd = inotify_add_watch(inotify_fd_, dir.c_str(), kWatchMask);
+        if (wd < 0)
+        {
+            LOG(ERROR) << "Watching " << dir << " failed with error " << std::strerror(errno) << ".";
+            return false;
+        }
+        auto watch = watches_.find(wd);
+        if (watch != watches_.end())
+        {
+            // The same directory under another path, e.g. a bind mount, is only reported under its first one.
+            return false;
+        }
+        watches_[wd] = dir;
+        dirs_[dir] = wd;
+        return true;
+    }
+
+    void WatchHub::RemoveWatches(const std::string &dir)
+    {
+        for (auto it = dirs_.begin(); it != dirs_.end();)
+        {
+            if (IsUnder(it->first, dir))
+            {
+                inotify_rm_watch(inotify_fd_, it->second);
+                watches_.erase(it->second);
+                dirs_.erase(it++);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    bool WatchHub::Covered(const std::string &dir)
+    {
+        for (const auto &subscription : subscriptions_)
+        {
+            if (subscription.first.first == dir || (subscription.first.second && IsUnder(dir, subscription.first.first)))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void WatchHub::FlushMove()
+    {
+        if (move_pending_)
+        {
+            move_pending_ = false;
+            Append(kDelete, move_path_, move_is_dir_);
+        }
+    }
+
+    void WatchHub::Expire()
+    {
+        absl::Time now = absl::Now();
+        bool expired = false;
+        for (auto it = subscriptions_.begin(); it != subscriptions_.end();)
+        {
+            if (it->second.num_subscribers == 0 &&
+                now - it->second.released > absl::Seconds(galaxy::constant::kWatchRetainSec))
+            {
+                subscriptions_.erase(it++);
+                expired = true;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        if (!expired)
+        {
+            return;
+        }
+        for (auto it = dirs_.begin(); it != dirs_.end();)
+        {
+            if (!Covered(it->first))
+            {
+                inotify_rm_watch(inotify_fd_, it->second);
+                watches_.erase(it->second);
+                dirs_.erase(it++);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+} //  namespace galaxy.
@@ -0,0 +1,113 @@
+#ifndef CPP_CORE_GALAXY_WATCH_H_
+#define CPP_CORE_GALAXY_WATCH_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/time/time.h"
+
+namespace galaxy
+{
+    // Changes under the subscribed directories, read from inotify by a background thread and kept in a bounded
+    // history numbered by a sequence, so that subscribers pick up where they left off, e.g. after a reconnect.
+    // Subscriptions stay watched for kWatchRetainSec after their last subscriber leaves, so that a subscriber
+    // resuming within that time does not miss the changes made in between.
+    class WatchHub
+    {
+    public:
+        // Kinds of changes, as bits of an event mask. Same values as galaxy_schema::WatchEventType.
+        static constexpr uint32_t kCreate = 1;
+        // Content or attributes changed.
+        static constexpr uint32_t kModify = 2;
+        static constexpr uint32_t kDelete = 4;
+        static constexpr uint32_t kRename = 8;
+        // Changes were lost, so subscribers list the path again.
+        static constexpr uint32_t kOverflow = 16;
+
+        struct Event
+        {
+            uint64_t seq = 0;
+            uint32_t type = 0;
+            std::string path;
+            // Previous path of a renamed entry.
+            std::string old_path;
+            bool is_dir = false;
+        };
+
+        explicit WatchHub(size_t history);
+        WatchHub(const WatchHub&) = delete;
+        ~WatchHub();
+
+        // Watches the directory at path, or every directory under it if recursive, until the matching Unsubscribe.
+        absl::Status Subscribe(const std::string &path, bool recursive);
+        void Unsubscribe(const std::string &path, bool recursive);
+        // Appends the changes of a subscription that come after *after to events, waiting up to timeout for one,
+        // and moves *after past them. Returns false if some of them were lost, e.g. dropped from the history or
+        // made while the path was not watched, in which case *after is moved to the latest change.
+        bool Wait(const std::string &path, bool recursive, uint64_t *after, absl::Duration timeout, std::vector<Event> *events);
+        // Sequence of the latest change, where new subscribers start from.
+        uint64_t last_seq();
+
+        // Opaque token to resume after seq, only valid for this hub.
+        std::string Token(uint64_t seq) const;
+        // Sequence of a token made by this hub. Tokens of another hub, e.g. of a previous run of the server, fail.
+        bool ParseToken(const std::string &token, uint64_t *seq) const;
+
+    private:
+        struct Subscription
+        {
+            int num_subscribers = 0;
+            // Sequence since which the path has been watched.
+            uint64_t since = 0;
+            absl::Time released;
+        };
+        using SubscriptionKey = std::pair<std::string, bool>;
+
+        void ReadLoop();
+
+        // The functions below are called with mu_ held.
+
+        void HandleEvent(const std::string &dir, uint32_t mask, uint32_t cookie, const std::string &name);
+        void Append(uint32_t type, const std::string &path, bool is_dir, const std::string &old_path = "");
+        // Watches dir and the directories under it, and reports what they hold as created if report is set.
+        void AddTree(const std::string &dir, bool report);
+        bool AddWatch(const std::string &dir);
+        void RemoveWatches(const std::string &dir);
+        // Whether dir is under a recursive subscription, or is the path of any subscription.
+        bool Covered(const std::string &dir);
+        // A move away not paired with a move back into a watched directory, so it is reported as a deletion.
+        void FlushMove();
+        void Expire();
+
+        const size_t history_size_;
+        const std::string epoch_;
+        int inotify_fd_ = -1;
+        std::mutex mu_;
+        std::condition_variable cv_;
+        std::deque<Event> history_;
+        uint64_t last_seq_ = 0;
+        // Changes up to these sequences are lost, dropped from the history or after an inotify queue overflow.
+        uint64_t dropped_seq_ = 0;
+        uint64_t lost_seq_ = 0;
+        std::map<SubscriptionKey, Subscription> subscriptions_;
+        absl::flat_hash_map<int, std::string> watches_;
+        absl::flat_hash_map<std::string, int> dirs_;
+        // First half of a rename, waiting for the second one.
+        bool move_pending_ = false;
+        uint32_t move_cookie_ = 0;
+        std::string move_path_;
+        bool move_is_dir_ = false;
+        std::atomic<bool> stopped_{false};
+        std::thread reader_;
+    };
+} //  namespace galaxy.
+#endif   //  CPP_CORE_GALAXY_WATCH_H_
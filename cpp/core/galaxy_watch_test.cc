@@ -0,0 +1,146 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "cpp/core/galaxy_watch.h"
+#include "cpp/internal/galaxy_fs_internal.h"
+
+namespace {
+    using galaxy::WatchHub;
+    using galaxy::internal::JoinPath;
+
+    std::string NewRoot(const std::string& name) {
+        std::string root = JoinPath(testing::TempDir(), absl::StrCat("galaxy_watch_test_", getpid(), "_", name));
+        EXPECT_TRUE(galaxy::impl::CreateDirIfNotExist(root, 0777).ok());
+        return root;
+    }
+
+    void WriteFile(const std::string& path, const std::string& data) {
+        std::ofstream(path) << data;
+    }
+
+    // Waits for a change of type on path, collecting the events of the subscription in the meantime.
+    bool WaitFor(WatchHub& hub, const std::string& dir, bool recursive, uint64_t* after, uint32_t type,
+                 const std::string& path, std::vector<WatchHub::Event>* events) {
+        absl::Time deadline = absl::Now() + absl::Seconds(10);
+        size_t checked = 0;
+        while (absl::Now() < deadline) {
+            if (!hub.Wait(dir, recursive, after, absl::Milliseconds(100), events)) {
+                return false;
+            }
+            for (; checked < events->size(); checked++) {
+                if ((*events)[checked].type == type && (*events)[checked].path == path) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    TEST(WatchHubTest, ReportsChanges) {
+        std::string root = NewRoot("changes");
+        WatchHub hub(1024);
+        ASSERT_TRUE(hub.Subscribe(root, false).ok());
+        uint64_t after = hub.last_seq();
+        std::vector<WatchHub::Event> events;
+        std::string a = JoinPath(root, "a");
+
+        WriteFile(a, "a");
+        EXPECT_TRUE(WaitFor(hub, root, false, &after, WatchHub::kCreate, a, &events));
+        EXPECT_FALSE(events[0].is_dir);
+        std::ofstream(a, std::ios::app) << "b";
+        EXPECT_TRUE(WaitFor(hub, root, false, &after, WatchHub::kModify, a, &events));
+
+        std::string b = JoinPath(root, "b");
+        ASSERT_EQ(rename(a.c_str(), b.c_str()), 0);
+        EXPECT_TRUE(WaitFor(hub, root, false, &after, WatchHub::kRename, b, &events));
+        EXPECT_EQ(events.back().old_path, a);
+
+        ASSERT_EQ(unlink(b.c_str()), 0);
+        EXPECT_TRUE(WaitFor(hub, root, false, &after, WatchHub::kDelete, b, &events));
+        for (size_t i = 1; i < events.size(); i++) {
+            EXPECT_LT(events[i - 1].seq, events[i].seq);
+        }
+        hub.Unsubscribe(root, false);
+    }
+
+    TEST(WatchHubTest, Recursive) {
+        std::string root = NewRoot("recursive");
+        WatchHub hub(1024);
+        ASSERT_TRUE(hub.Subscribe(root, true).ok());
+        uint64_t after = hub.last_seq();
+        std::vector<WatchHub::Event> events;
+        std::string sub = JoinPath(root, "sub");
+        ASSERT_EQ(mkdir(sub.c_str(), 0777), 0);
+        EXPECT_TRUE(WaitFor(hub, root, true, &after, WatchHub::kCreate, sub, &events));
+        EXPECT_TRUE(events.back().is_dir);
+        WriteFile(JoinPath(sub, "a"), "a");
+        EXPECT_TRUE(WaitFor(hub, root, true, &after, WatchHub::kCreate, JoinPath(sub, "a"), &events));
+    }
+
+    TEST(WatchHubTest, Tokens) {
+        WatchHub hub(16);
+        uint64_t seq = 0;
+        EXPECT_TRUE(hub.ParseToken(hub.Token(42), &seq));
+        EXPECT_EQ(seq, 42);
+        EXPECT_FALSE(hub.ParseToken("42", &seq));
+        // A hub made later, e.g. by a restarted server, has tokens of its own.
+        absl::SleepFor(absl::Milliseconds(1));
+        WatchHub other(16);
+        EXPECT_FALSE(other.ParseToken(hub.Token(42), &seq));
+    }
+
+    TEST(WatchHubTest, ResumesWithinRetention) {
+        std::string root = NewRoot("resume");
+        WatchHub hub(1024);
+        ASSERT_TRUE(hub.Subscribe(root, false).ok());
+        uint64_t after = hub.last_seq();
+        hub.Unsubscribe(root, false);
+
+        // Changed while nobody was subscribed, and still reported on resume.
+        std::string a = JoinPath(root, "a");
+        WriteFile(a, "a");
+        ASSERT_TRUE(hub.Subscribe(root, false).ok());
+        std::vector<WatchHub::Event> events;
+        EXPECT_TRUE(WaitFor(hub, root, false, &after, WatchHub::kCreate, a, &events));
+
+        // Never subscribed, so there is nothing to resume.
+        uint64_t other_after = 0;
+        std::vector<WatchHub::Event> other_events;
+        EXPECT_FALSE(hub.Wait(NewRoot("resume_other"), false, &other_after, absl::ZeroDuration(), &other_events));
+        EXPECT_EQ(other_after, hub.last_seq());
+    }
+
+    TEST(WatchHubTest, LostHistory) {
+        std::string root = NewRoot("lost");
+        WatchHub hub(2);
+        ASSERT_TRUE(hub.Subscribe(root, false).ok());
+        uint64_t after = hub.last_seq();
+        uint64_t latest = after;
+        std::vector<WatchHub::Event> events;
+        for (int i = 0; i < 4; i++) {
+            std::string path = JoinPath(root, absl::StrCat(i));
+            ASSERT_EQ(mkdir(path.c_str(), 0777), 0);
+            ASSERT_TRUE(WaitFor(hub, root, false, &latest, WatchHub::kCreate, path, &events));
+        }
+        // The first changes were dropped from the history, so the subscriber lists the directory again.
+        std::vector<WatchHub::Event> missed;
+        EXPECT_FALSE(hub.Wait(root, false, &after, absl::ZeroDuration(), &missed));
+        EXPECT_TRUE(missed.empty());
+        EXPECT_EQ(after, hub.last_seq());
+    }
+
+    TEST(WatchHubTest, SubscribeFailures) {
+        std::string root = NewRoot("failures");
+        WatchHub hub(16);
+        EXPECT_TRUE(absl::IsNotFound(hub.Subscribe(JoinPath(root, "none"), false)));
+        EXPECT_TRUE(absl::IsNotFound(hub.Subscribe("relative", false)));
+        WriteFile(JoinPath(root, "a"), "a");
+        EXPECT_TRUE(absl::IsNotFound(hub.Subscribe(JoinPath(root, "a"), false)));
+    }
+}  // namespace
@@ -1,18 +1,33 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <algorithm>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "cpp/internal/galaxy_client_internal.h"
 #include "cpp/core/galaxy_flag.h"
 #include "cpp/internal/galaxy_const.h"
+#include "cpp/internal/galaxy_fs_internal.h"
+#include "cpp/util/galaxy_compress.h"
+#include "cpp/util/galaxy_hash.h"
 #include "glog/logging.h"
 #include "absl/flags/flag.h"
+#include "absl/strings/ascii.h"
 
 using grpc::ClientContext;
 using grpc::Status;
 using grpc::ClientWriter;
+using grpc::ClientReader;
 
 using galaxy_schema::CopyRequest;
 using galaxy_schema::CopyResponse;
+using galaxy_schema::ChunkEncoding;
+using galaxy_schema::CompressionType;
+using galaxy_schema::ChecksumRequest;
+using galaxy_schema::ChecksumResponse;
+using galaxy_schema::FileSystem;
 using galaxy_schema::FileSystemStatus;
 using galaxy_schema::CreateDirRequest;
 using galaxy_schema::CreateDirResponse;
@@ -20,12 +35,21 @@ using galaxy_schema::CreateFileRequest;
 using galaxy_schema::CreateFileResponse;
 using galaxy_schema::CrossCellRequest;
 using galaxy_schema::CrossCellResponse;
+using galaxy_schema::Durability;
 using galaxy_schema::DirOrDieRequest;
 using galaxy_schema::DirOrDieResponse;
 using galaxy_schema::FileOrDieRequest;
 using galaxy_schema::FileOrDieResponse;
 using galaxy_schema::GetAttrRequest;
 using galaxy_schema::GetAttrResponse;
+using galaxy_schema::LinkBlobRequest;
+using galaxy_schema::PreallocateRequest;
+using galaxy_schema::PreallocateResponse;
+using galaxy_schema::TruncateRequest;
+using galaxy_schema::TruncateResponse;
+using galaxy_schema::WriteAtRequest;
+using galaxy_schema::WriteAtResponse;
+using galaxy_schema::LinkBlobResponse;
 using galaxy_schema::ListDirsInDirRequest;
 using galaxy_schema::ListDirsInDirResponse;
 using galaxy_schema::ListFilesInDirRequest;
@@ -36,10 +60,13 @@ using galaxy_schema::ReadRequest;
 using galaxy_schema::ReadResponse;
 using galaxy_schema::ReadMultipleRequest;
 using galaxy_schema::ReadMultipleResponse;
+using galaxy_schema::ScanRequest;
+using galaxy_schema::ScanResponse;
 using galaxy_schema::RenameFileRequest;
 using galaxy_schema::RenameFileResponse;
 using galaxy_schema::RemoteExecutionRequest;
 using galaxy_schema::RemoteExecutionResponse;
+using galaxy_schema::RemoteExecutionStreamResponse;
 using galaxy_schema::RmDirRecursiveRequest;
 using galaxy_schema::RmDirRecursiveResponse;
 using galaxy_schema::RmDirRequest;
@@ -54,6 +81,10 @@ using galaxy_schema::HealthCheckRequest;
 using galaxy_schema::HealthCheckResponse;
 using galaxy_schema::ModifyCellAvailabilityRequest;
 using galaxy_schema::ModifyCellAvailabilityResponse;
+using galaxy_schema::TailRequest;
+using galaxy_schema::TailResponse;
+using galaxy_schema::WatchRequest;
+using galaxy_schema::WatchResponse;
 
 namespace galaxy
 {
@@ -85,23 +116,294 @@ namespace galaxy
         }
     }
 
+    // Durability of a call writing data: the one set on the request, or else the one of fs_write_durability.
+    static Durability RequestedDurability(Durability requested)
+    {
+        std::string flag_durability = absl::GetFlag(FLAGS_fs_write_durability);
+        if (requested != Durability::DURABILITY_DEFAULT || flag_durability.empty())
+        {
+            return requested;
+        }
+        Durability durability;
+        if (!galaxy_schema::Durability_Parse(absl::AsciiStrToUpper(flag_durability), &durability))
+        {
+            LOG(WARNING) << "Unknown fs_write_durability " << flag_durability << ", the durability rules of the cell apply.";
+            return Durability::DURABILITY_DEFAULT;
+        }
+        return durability;
+    }
+
+    static CopyRequest NewCopyChunk(const CopyRequest &request, bool is_first_chunk)
+    {
+        CopyRequest sub_request;
+        sub_request.set_from_name(request.from_name());
+        sub_request.set_to_name(request.to_name());
+        sub_request.mutable_cred()->set_password(request.cred().password());
+        sub_request.set_from_cell(request.from_cell());
+        // The replication plan only needs to travel with the first chunk.
+        if (is_first_chunk)
+        {
+            *sub_request.mutable_replicate_cells() = request.replicate_cells();
+            sub_request.set_shared_name(request.shared_name());
+            sub_request.set_replicate_fanout(request.replicate_fanout());
+            sub_request.set_durability(RequestedDurability(request.durability()));
+        }
+        return sub_request;
+    }
+
+    // Replaces the data of a response by its decoded content, and checks it against the returned checksum.
+    static Status DecodeReadResponse(ReadResponse &response, const std::string &name, int64_t max_size)
+    {
+        if (response.has_encoding())
+        {
+            std::string data;
+            absl::Status status = galaxy::util::DecompressPayload(response.data(), response.encoding(), max_size, &data);
+            if (!status.ok())
+            {
+                LOG(ERROR) << "Fail to decode " << name << " with error " << status;
+                return Status(grpc::StatusCode::DATA_LOSS, "Fail to decode " + name + ".");
+            }
+            response.set_data(std::move(data));
+            response.clear_encoding();
+        }
+        if (response.has_checksum() && response.checksum().crc32c() != galaxy::util::Crc32c(response.data()))
+        {
+            LOG(ERROR) << "Checksum mismatch when reading " << name << ".";
+            return Status(grpc::StatusCode::DATA_LOSS, "Checksum mismatch when reading " + name + ".");
+        }
+        return Status::OK;
+    }
+
+    // Base of the calls in flight on the shared completion queue. The tag of a call is the call itself.
+    class AsyncCall
+    {
+    public:
+        virtual ~AsyncCall() = default;
+        virtual void Complete() = 0;
+    };
+
+    // A single completion queue, polled by a single thread, serves the asynchronous calls of the whole process. It is
+    // never destroyed so that callbacks may still be pending while the process exits.
+    class CompletionQueueLoop
+    {
+    public:
+        static CompletionQueueLoop &Instance()
+        {
+            static CompletionQueueLoop *loop = new CompletionQueueLoop();
+            return *loop;
+        }
+
+        grpc::CompletionQueue *cq() { return &cq_; }
+
+    private:
+        CompletionQueueLoop() : thread_([this]() { Poll(); })
+        {
+            thread_.detach();
+        }
+
+        void Poll()
+        {
+            void *tag;
+            bool ok;
+            while (cq_.Next(&tag, &ok))
+            {
+                AsyncCall *call = static_cast<AsyncCall *>(tag);
+                call->Complete();
+                delete call;
+            }
+        }
+
+        grpc::CompletionQueue cq_;
+        std::thread thread_;
+    };
+
+    namespace
+    {
+        thread_local std::shared_ptr<AsyncCallGroup> current_call_group;
+    }
+
+    void AsyncCallGroup::Cancel()
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        cancelled_ = true;
+        for (auto *context : contexts_)
+        {
+            context->TryCancel();
+        }
+    }
+
+    bool AsyncCallGroup::IsCancelled() const
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        return cancelled_;
+    }
+
+    void AsyncCallGroup::Add(ClientContext *context)
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        // A call not started yet is cancelled as soon as it starts.
+        if (cancelled_)
+        {
+            context->TryCancel();
+        }
+        contexts_.insert(context);
+    }
+
+    void AsyncCallGroup::Remove(ClientContext *context)
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        contexts_.erase(context);
+    }
+
+    ScopedAsyncCallGroup::ScopedAsyncCallGroup(std::shared_ptr<AsyncCallGroup> group)
+        : previous_(std::move(current_call_group))
+    {
+        current_call_group = std::move(group);
+    }
+
+    ScopedAsyncCallGroup::~ScopedAsyncCallGroup()
+    {
+        current_call_group = std::move(previous_);
+    }
+
+    std::shared_ptr<AsyncCallGroup> ScopedAsyncCallGroup::Current()
+    {
+        return current_call_group;
+    }
+
+    template <typename Response>
+    class AsyncUnaryCall : public AsyncCall
+    {
+    public:
+        explicit AsyncUnaryCall(AsyncCallback<Response> callback)
+            : callback_(std::move(callback)), group_(ScopedAsyncCallGroup::Current())
+        {
+            context_.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(absl::GetFlag(FLAGS_fs_rpc_ddl)));
+            if (group_)
+            {
+                group_->Add(&context_);
+            }
+        }
+
+        ClientContext *context() { return &context_; }
+
+        void Start(std::unique_ptr<grpc::ClientAsyncResponseReader<Response>> reader)
+        {
+            reader_ = std::move(reader);
+            reader_->StartCall();
+            reader_->Finish(&reply_, &status_, this);
+        }
+
+        void Complete() override
+        {
+            if (group_)
+            {
+                group_->Remove(&context_);
+            }
+            callback_(status_, reply_);
+        }
+
+    private:
+        AsyncCallback<Response> callback_;
+        std::shared_ptr<AsyncCallGroup> group_;
+        ClientContext context_;
+        Response reply_;
+        Status status_;
+        std::unique_ptr<grpc::ClientAsyncResponseReader<Response>> reader_;
+    };
+
+    template <typename Request, typename Response>
+    static void StartAsyncCall(FileSystem::Stub *stub,
+                               std::unique_ptr<grpc::ClientAsyncResponseReader<Response>> (FileSystem::Stub::*prepare)(
+                                   ClientContext *, const Request &, grpc::CompletionQueue *),
+                               const Request &request, AsyncCallback<Response> callback)
+    {
+        // The call owns its context and reply, and deletes itself once its callback has run.
+        AsyncUnaryCall<Response> *call = new AsyncUnaryCall<Response>(std::move(callback));
+        call->Start((stub->*prepare)(call->context(), request, CompletionQueueLoop::Instance().cq()));
+    }
+
+    void GalaxyClientInternal::SetCompression(CompressionType type, int64_t min_bytes)
+    {
+        compression_ = type;
+        compression_min_bytes_ = min_bytes;
+    }
+
+    void GalaxyClientInternal::SetMaxPayloadSize(int64_t max_bytes)
+    {
+        max_payload_bytes_ = max_bytes;
+    }
+
+    ReadRequest GalaxyClientInternal::EncodeReadRequest(const ReadRequest &request) const
+    {
+        ReadRequest checked_request(request);
+        checked_request.set_with_checksum(request.with_checksum() || absl::GetFlag(FLAGS_fs_verify_checksum));
+        checked_request.set_accept_compression(compression_ != CompressionType::UNCOMPRESSED);
+        return checked_request;
+    }
+
+    WriteRequest GalaxyClientInternal::EncodeWriteRequest(const WriteRequest &request) const
+    {
+        WriteRequest checked_request(request);
+        checked_request.set_durability(RequestedDurability(request.durability()));
+        if (absl::GetFlag(FLAGS_fs_verify_checksum) && !request.has_checksum())
+        {
+            checked_request.mutable_checksum()->set_crc32c(galaxy::util::Crc32c(request.data()));
+        }
+        std::string compressed;
+        ChunkEncoding encoding;
+        if (!request.has_encoding() &&
+            galaxy::util::CompressPayload(request.data(), compression_, compression_min_bytes_, &compressed, &encoding))
+        {
+            checked_request.set_data(std::move(compressed));
+            checked_request.mutable_encoding()->CopyFrom(encoding);
+        }
+        return checked_request;
+    }
+
+    void GalaxyClientInternal::SetChunkData(CopyRequest &sub_request, std::string data) const
+    {
+        if (absl::GetFlag(FLAGS_fs_verify_checksum))
+        {
+            sub_request.mutable_checksum()->set_crc32c(galaxy::util::Crc32c(data));
+        }
+        std::string compressed;
+        ChunkEncoding encoding;
+        if (galaxy::util::CompressPayload(data, compression_, compression_min_bytes_, &compressed, &encoding))
+        {
+            sub_request.mutable_encoding()->CopyFrom(encoding);
+            data.swap(compressed);
+        }
+        sub_request.set_data(std::move(data));
+    }
+
     CopyResponse GalaxyClientInternal::CopyFile(const CopyRequest &request)
     {
         CopyResponse reply;
         ClientContext context;
         context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(absl::GetFlag(FLAGS_fs_rpc_ddl)));
-        std::unique_ptr<ClientWriter<CopyRequest>> writer(stub_->CopyFile(&context, &reply));
+        struct stat statbuf;
+        if (stat(request.from_name().c_str(), &statbuf) == 0 && S_ISREG(statbuf.st_mode) &&
+            statbuf.st_blocks * 512 < statbuf.st_size)
+        {
+            return CopySparseFile(request);
+        }
         std::ifstream infile(request.from_name(), std::ifstream::binary);
+        if (!infile.is_open())
+        {
+            LOG(ERROR) << "Cannot open " << request.from_name() << " for CopyFile.";
+            throw "Cannot open " + request.from_name() + " for CopyFile.";
+        }
+        std::unique_ptr<ClientWriter<CopyRequest>> writer(stub_->CopyFile(&context, &reply));
         std::vector<char> buffer(galaxy::constant::kChunkSize, 0);
+        bool is_first_chunk = true;
         while (!infile.eof())
         {
-            infile.read(buffer.data(), sizeof(buffer));
+            infile.read(buffer.data(), buffer.size());
             std::streamsize s = infile.gcount();
-            CopyRequest sub_request;
-            sub_request.set_from_name(request.from_name());
-            sub_request.set_to_name(request.to_name());
-            sub_request.mutable_cred()->set_password(request.cred().password());
-            sub_request.set_data(std::string(buffer.begin(), buffer.begin() + s));
+            CopyRequest sub_request = NewCopyChunk(request, is_first_chunk);
+            SetChunkData(sub_request, std::string(buffer.begin(), buffer.begin() + s));
+            is_first_chunk = false;
             if (!writer->Write(sub_request))
             {
                 break;
@@ -121,6 +423,136 @@ namespace galaxy
         }
     }
 
+    CopyResponse GalaxyClientInternal::CopySparseFile(const CopyRequest &request)
+    {
+        CopyResponse reply;
+        ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(absl::GetFlag(FLAGS_fs_rpc_ddl)));
+        int fd = open(request.from_name().c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat statbuf;
+        if (fd < 0 || fstat(fd, &statbuf) != 0)
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+            LOG(ERROR) << "Cannot open " << request.from_name() << " for CopyFile.";
+            throw "Cannot open " + request.from_name() + " for CopyFile.";
+        }
+        absl::StatusOr<std::vector<std::pair<off_t, off_t>>> extents = internal::ListDataExtents(fd);
+        if (!extents.ok())
+        {
+            close(fd);
+            LOG(ERROR) << "Cannot list the extents of " << request.from_name() << " with error " << extents.status();
+            throw "Cannot list the extents of " + request.from_name() + " for CopyFile.";
+        }
+        // Chunks as offset and size. A file that is a single hole is still sent as one empty chunk.
+        std::vector<std::pair<off_t, off_t>> chunks;
+        for (const auto &extent : *extents)
+        {
+            for (off_t offset = extent.first; offset < extent.second; offset += galaxy::constant::kChunkSize)
+            {
+                chunks.emplace_back(offset, std::min<off_t>(extent.second - offset, galaxy::constant::kChunkSize));
+            }
+        }
+        if (chunks.empty())
+        {
+            chunks.emplace_back(0, 0);
+        }
+        std::unique_ptr<ClientWriter<CopyRequest>> writer(stub_->CopyFile(&context, &reply));
+        std::string buffer;
+        for (size_t i = 0; i < chunks.size(); ++i)
+        {
+            buffer.resize(chunks[i].second);
+            ssize_t num_read = buffer.empty() ? 0 : pread(fd, &buffer[0], buffer.size(), chunks[i].first);
+            if (num_read < 0)
+            {
+                // The copy is failed rather than completed with a hole in place of the chunk.
+                LOG(ERROR) << "Cannot read " << request.from_name() << " for CopyFile.";
+                context.TryCancel();
+                break;
+            }
+            buffer.resize(num_read);
+            CopyRequest sub_request = NewCopyChunk(request, i == 0);
+            if (i == 0)
+            {
+                sub_request.set_sparse(true);
+                sub_request.set_file_size(statbuf.st_size);
+            }
+            sub_request.set_offset(chunks[i].first);
+            SetChunkData(sub_request, buffer);
+            if (!writer->Write(sub_request))
+            {
+                break;
+            }
+        }
+        close(fd);
+        writer->WritesDone();
+        Status status = writer->Finish();
+        if (status.ok())
+        {
+            return reply;
+        }
+        else
+        {
+            LOG(ERROR) << status.error_code() << ": " << status.error_message();
+            throw status.error_message();
+        }
+    }
+
+    CopyResponse GalaxyClientInternal::CopyData(const CopyRequest &request)
+    {
+        CopyResponse reply;
+        ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(absl::GetFlag(FLAGS_fs_rpc_ddl)));
+        std::unique_ptr<ClientWriter<CopyRequest>> writer(stub_->CopyFile(&context, &reply));
+        const std::string &data = request.data();
+        size_t offset = 0;
+        do
+        {
+            CopyRequest sub_request = NewCopyChunk(request, offset == 0);
+            size_t size = std::min(data.size() - offset, static_cast<size_t>(galaxy::constant::kChunkSize));
+            SetChunkData(sub_request, data.substr(offset, size));
+            offset += size;
+            if (!writer->Write(sub_request))
+            {
+                break;
+            }
+        } while (offset < data.size());
+        writer->WritesDone();
+        Status status = writer->Finish();
+        if (status.ok())
+        {
+            return reply;
+        }
+        else
+        {
+            LOG(ERROR) << status.error_code() << ": " << status.error_message();
+            throw status.error_message();
+        }
+    }
+
+    std::unique_ptr<ClientWriter<CopyRequest>> GalaxyClientInternal::CopyFileStream(ClientContext *context, CopyResponse *reply)
+    {
+        return stub_->CopyFile(context, reply);
+    }
+
+    std::unique_ptr<ClientReader<WatchResponse>> GalaxyClientInternal::Watch(ClientContext *context, const WatchRequest &request)
+    {
+        return stub_->Watch(context, request);
+    }
+
+    std::unique_ptr<ClientReader<TailResponse>> GalaxyClientInternal::Tail(ClientContext *context, const TailRequest &request)
+    {
+        return stub_->Tail(context, request);
+    }
+
+    std::unique_ptr<ClientReader<RemoteExecutionStreamResponse>> GalaxyClientInternal::RemoteExecutionStream(
+        ClientContext *context, const RemoteExecutionRequest &request)
+    {
+        return stub_->RemoteExecutionStream(context, request);
+    }
+
     CrossCellResponse GalaxyClientInternal::CrossCellCall(const CrossCellRequest &request)
     {
         CrossCellResponse reply;
@@ -135,6 +567,19 @@ namespace galaxy
         }
     }
 
+    LinkBlobResponse GalaxyClientInternal::LinkBlob(const LinkBlobRequest &request)
+    {
+        LinkBlobResponse reply;
+        ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(absl::GetFlag(FLAGS_fs_rpc_ddl)));
+        Status status = stub_->LinkBlob(&context, request, &reply);
+        if (status.ok()) {
+            return reply;
+        } else {
+            LOG(ERROR) << status.error_code() << ": " << status.error_message();
+            throw status.error_message();
+        }
+    }
 
     DirOrDieResponse GalaxyClientInternal::DirOrDie(const DirOrDieRequest &request)
     {
@@ -279,8 +724,12 @@ namespace galaxy
         ReadResponse reply;
         ClientContext context;
         context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(absl::GetFlag(FLAGS_fs_rpc_ddl)));
-        Status status = stub_->Read(&context, request, &reply);
+        Status status = stub_->Read(&context, EncodeReadRequest(request), &reply);
         if (status.ok()) {
+            Status decode_status = DecodeReadResponse(reply, request.name(), max_payload_bytes_);
+            if (!decode_status.ok()) {
+                throw decode_status.error_message();
+            }
             return reply;
         } else {
             LOG(ERROR) << status.error_code() << ": " << status.error_message();
@@ -293,7 +742,34 @@ namespace galaxy
         ReadMultipleResponse reply;
         ClientContext context;
         context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(absl::GetFlag(FLAGS_fs_rpc_ddl)));
-        Status status = stub_->ReadMultiple(&context, request, &reply);
+        ReadMultipleRequest checked_request(request);
+        checked_request.set_with_checksum(request.with_checksum() || absl::GetFlag(FLAGS_fs_verify_checksum));
+        checked_request.set_accept_compression(compression_ != CompressionType::UNCOMPRESSED);
+        Status status = stub_->ReadMultiple(&context, checked_request, &reply);
+        if (status.ok()) {
+            // A corrupted file fails on its own, the rest of the batch is still usable.
+            for (auto &pair : *reply.mutable_data()) {
+                ReadResponse &read_response = pair.second;
+                Status decode_status = DecodeReadResponse(read_response, pair.first, max_payload_bytes_);
+                if (!decode_status.ok()) {
+                    read_response.clear_data();
+                    read_response.mutable_status()->set_return_code(0);
+                    read_response.mutable_status()->set_return_message(decode_status.error_message());
+                }
+            }
+            return reply;
+        } else {
+            LOG(ERROR) << status.error_code() << ": " << status.error_message();
+            throw status.error_message();
+        }
+    }
+
+    ScanResponse GalaxyClientInternal::Scan(const ScanRequest &request)
+    {
+        ScanResponse reply;
+        ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(absl::GetFlag(FLAGS_fs_rpc_ddl)));
+        Status status = stub_->Scan(&context, request, &reply);
         if (status.ok()) {
             return reply;
         } else {
@@ -307,7 +783,63 @@ namespace galaxy
         WriteResponse reply;
         ClientContext context;
         context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(absl::GetFlag(FLAGS_fs_rpc_ddl)));
-        Status status = stub_->Write(&context, request, &reply);
+        Status status = stub_->Write(&context, EncodeWriteRequest(request), &reply);
+        if (status.ok()) {
+            return reply;
+        } else {
+            LOG(ERROR) << status.error_code() << ": " << status.error_message();
+            throw status.error_message();
+        }
+    }
+
+    WriteAtResponse GalaxyClientInternal::WriteAt(const WriteAtRequest &request)
+    {
+        WriteAtResponse reply;
+        ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(absl::GetFlag(FLAGS_fs_rpc_ddl)));
+        WriteAtRequest checked_request(request);
+        checked_request.set_durability(RequestedDurability(request.durability()));
+        if (absl::GetFlag(FLAGS_fs_verify_checksum) && !request.has_checksum()) {
+            checked_request.mutable_checksum()->set_crc32c(galaxy::util::Crc32c(request.data()));
+        }
+        std::string compressed;
+        ChunkEncoding encoding;
+        if (!request.has_encoding() &&
+            galaxy::util::CompressPayload(request.data(), compression_, compression_min_bytes_, &compressed, &encoding)) {
+            checked_request.set_data(std::move(compressed));
+            checked_request.mutable_encoding()->CopyFrom(encoding);
+        }
+        Status status = stub_->WriteAt(&context, checked_request, &reply);
+        if (status.ok()) {
+            return reply;
+        } else {
+            LOG(ERROR) << status.error_code() << ": " << status.error_message();
+            throw status.error_message();
+        }
+    }
+
+    TruncateResponse GalaxyClientInternal::Truncate(const TruncateRequest &request)
+    {
+        TruncateResponse reply;
+        ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(absl::GetFlag(FLAGS_fs_rpc_ddl)));
+        TruncateRequest checked_request(request);
+        checked_request.set_durability(RequestedDurability(request.durability()));
+        Status status = stub_->Truncate(&context, checked_request, &reply);
+        if (status.ok()) {
+            return reply;
+        } else {
+            LOG(ERROR) << status.error_code() << ": " << status.error_message();
+            throw status.error_message();
+        }
+    }
+
+    PreallocateResponse GalaxyClientInternal::Preallocate(const PreallocateRequest &request)
+    {
+        PreallocateResponse reply;
+        ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(absl::GetFlag(FLAGS_fs_rpc_ddl)));
+        Status status = stub_->Preallocate(&context, request, &reply);
         if (status.ok()) {
             return reply;
         } else {
@@ -321,7 +853,33 @@ namespace galaxy
         WriteMultipleResponse reply;
         ClientContext context;
         context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(absl::GetFlag(FLAGS_fs_rpc_ddl)));
-        Status status = stub_->WriteMultiple(&context, request, &reply);
+        WriteMultipleRequest checked_request(request);
+        for (const auto &pair : request.data()) {
+            if (absl::GetFlag(FLAGS_fs_verify_checksum)) {
+                (*checked_request.mutable_checksums())[pair.first].set_crc32c(galaxy::util::Crc32c(pair.second));
+            }
+            std::string compressed;
+            ChunkEncoding encoding;
+            if (galaxy::util::CompressPayload(pair.second, compression_, compression_min_bytes_, &compressed, &encoding)) {
+                (*checked_request.mutable_data())[pair.first] = std::move(compressed);
+                (*checked_request.mutable_encodings())[pair.first] = encoding;
+            }
+        }
+        Status status = stub_->WriteMultiple(&context, checked_request, &reply);
+        if (status.ok()) {
+            return reply;
+        } else {
+            LOG(ERROR) << status.error_code() << ": " << status.error_message();
+            throw status.error_message();
+        }
+    }
+
+    ChecksumResponse GalaxyClientInternal::Checksum(const ChecksumRequest &request)
+    {
+        ChecksumResponse reply;
+        ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(absl::GetFlag(FLAGS_fs_rpc_ddl)));
+        Status status = stub_->Checksum(&context, request, &reply);
         if (status.ok()) {
             return reply;
         } else {
@@ -358,11 +916,12 @@ namespace galaxy
         }
     }
 
-    RemoteExecutionResponse GalaxyClientInternal::RemoteExecution(const RemoteExecutionRequest &request)
+    RemoteExecutionResponse GalaxyClientInternal::RemoteExecution(const RemoteExecutionRequest &request, int timeout_sec)
     {
         RemoteExecutionResponse reply;
         ClientContext context;
-        context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(absl::GetFlag(FLAGS_fs_rpc_ddl)));
+        context.set_deadline(std::chrono::system_clock::now() +
+                             std::chrono::seconds(timeout_sec > 0 ? timeout_sec : absl::GetFlag(FLAGS_fs_rpc_ddl)));
         Status status = stub_->RemoteExecution(&context, request, &reply);
         if (status.ok())
         {
@@ -374,4 +933,44 @@ namespace galaxy
             throw status.error_message();
         }
     }
+
+    void GalaxyClientInternal::AsyncGetAttr(const GetAttrRequest &request, AsyncCallback<GetAttrResponse> callback)
+    {
+        StartAsyncCall(stub_.get(), &FileSystem::Stub::PrepareAsyncGetAttr, request, std::move(callback));
+    }
+
+    void GalaxyClientInternal::AsyncCrossCellCall(const CrossCellRequest &request, AsyncCallback<CrossCellResponse> callback)
+    {
+        StartAsyncCall(stub_.get(), &FileSystem::Stub::PrepareAsyncCrossCellCall, request, std::move(callback));
+    }
+
+    void GalaxyClientInternal::AsyncListDirsInDir(const ListDirsInDirRequest &request, AsyncCallback<ListDirsInDirResponse> callback)
+    {
+        StartAsyncCall(stub_.get(), &FileSystem::Stub::PrepareAsyncListDirsInDir, request, std::move(callback));
+    }
+
+    void GalaxyClientInternal::AsyncListFilesInDir(const ListFilesInDirRequest &request, AsyncCallback<ListFilesInDirResponse> callback)
+    {
+        StartAsyncCall(stub_.get(), &FileSystem::Stub::PrepareAsyncListFilesInDir, request, std::move(callback));
+    }
+
+    void GalaxyClientInternal::AsyncRead(const ReadRequest &request, AsyncCallback<ReadResponse> callback)
+    {
+        std::string name = request.name();
+        int64_t max_size = max_payload_bytes_;
+        StartAsyncCall(stub_.get(), &FileSystem::Stub::PrepareAsyncRead, EncodeReadRequest(request),
+                       AsyncCallback<ReadResponse>([name, max_size, callback](const Status &status, ReadResponse &reply) {
+                           if (!status.ok())
+                           {
+                               callback(status, reply);
+                               return;
+                           }
+                           callback(DecodeReadResponse(reply, name, max_size), reply);
+                       }));
+    }
+
+    void GalaxyClientInternal::AsyncWrite(const WriteRequest &request, AsyncCallback<WriteResponse> callback)
+    {
+        StartAsyncCall(stub_.get(), &FileSystem::Stub::PrepareAsyncWrite, EncodeWriteRequest(request), std::move(callback));
+    }
 } // namespace galaxy
@@ -1,19 +1,75 @@
 #ifndef CPP_INTERNAL_GALAXY_CLIENT_INTERNAL_H_
 #define CPP_INTERNAL_GALAXY_CLIENT_INTERNAL_H_
 
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <grpcpp/grpcpp.h>
+#include "cpp/internal/galaxy_const.h"
 #include "schema/fileserver.grpc.pb.h"
 
 namespace galaxy
 {
+    // Completion of an asynchronous call. It runs on the thread polling the shared completion queue, so it must not
+    // block. The response is only meaningful when the status is OK.
+    template <typename Response>
+    using AsyncCallback = std::function<void(const grpc::Status &, Response &)>;
+
+    // Asynchronous calls cancelled together. The calls a thread starts while a ScopedAsyncCallGroup of the group is
+    // alive belong to it until they complete.
+    class AsyncCallGroup
+    {
+    public:
+        // Cancels the calls in flight, which then complete with a CANCELLED status, and the calls started later on.
+        void Cancel();
+        bool IsCancelled() const;
+        // Tracks the context of a call until it is removed, which must happen before the context is destroyed.
+        void Add(grpc::ClientContext *context);
+        void Remove(grpc::ClientContext *context);
+
+    private:
+        mutable std::mutex mu_;
+        bool cancelled_ = false;
+        std::set<grpc::ClientContext *> contexts_;
+    };
+
+    class ScopedAsyncCallGroup
+    {
+    public:
+        explicit ScopedAsyncCallGroup(std::shared_ptr<AsyncCallGroup> group);
+        ~ScopedAsyncCallGroup();
+        ScopedAsyncCallGroup(const ScopedAsyncCallGroup&) = delete;
+
+        // Group of the calls the current thread starts, null if there is none.
+        static std::shared_ptr<AsyncCallGroup> Current();
+
+    private:
+        std::shared_ptr<AsyncCallGroup> previous_;
+    };
+
     class GalaxyClientInternal
     {
     public:
         GalaxyClientInternal(std::shared_ptr<grpc::Channel> channel) : stub_(galaxy_schema::FileSystem::NewStub(channel)) {}
 
+        // Compresses the payloads of Write, WriteMultiple and CopyFile calls of at least min_bytes with type, and lets
+        // the server compress the data returned by Read and ReadMultiple. Payloads are not compressed by default.
+        void SetCompression(galaxy_schema::CompressionType type, int64_t min_bytes);
+        // Largest data a compressed response may expand to, usually the message size limit of the cell.
+        void SetMaxPayloadSize(int64_t max_bytes);
+
         galaxy_schema::GetAttrResponse GetAttr(const galaxy_schema::GetAttrRequest &request);
         galaxy_schema::CreateDirResponse CreateDirIfNotExist(const galaxy_schema::CreateDirRequest &request);
+        // Files with holes are sent as their data extents only, see CopyRequest.sparse.
         galaxy_schema::CopyResponse CopyFile(const galaxy_schema::CopyRequest &request);
+        // Same as CopyFile, but streams request.data() instead of the content of request.from_name().
+        galaxy_schema::CopyResponse CopyData(const galaxy_schema::CopyRequest &request);
+        // Raw CopyFile stream, for callers forwarding chunks as they receive them.
+        std::unique_ptr<grpc::ClientWriter<galaxy_schema::CopyRequest>> CopyFileStream(grpc::ClientContext *context,
+                                                                                      galaxy_schema::CopyResponse *reply);
+        // Asks the cell to materialize request.name() from its blob store. linked is false on a miss.
+        galaxy_schema::LinkBlobResponse LinkBlob(const galaxy_schema::LinkBlobRequest &request);
         galaxy_schema::CrossCellResponse CrossCellCall(const galaxy_schema::CrossCellRequest& request);
         galaxy_schema::DirOrDieResponse DirOrDie(const galaxy_schema::DirOrDieRequest &request);
         galaxy_schema::RmDirResponse RmDir(const galaxy_schema::RmDirRequest &request);
@@ -27,14 +83,52 @@ namespace galaxy
         galaxy_schema::RenameFileResponse RenameFile(const galaxy_schema::RenameFileRequest &request);
         galaxy_schema::ReadResponse Read(const galaxy_schema::ReadRequest &request);
         galaxy_schema::ReadMultipleResponse ReadMultiple(const galaxy_schema::ReadMultipleRequest &request);
+        galaxy_schema::ScanResponse Scan(const galaxy_schema::ScanRequest &request);
         galaxy_schema::WriteMultipleResponse WriteMultiple(const galaxy_schema::WriteMultipleRequest &request);
         galaxy_schema::WriteResponse Write(const galaxy_schema::WriteRequest &request);
+        galaxy_schema::WriteAtResponse WriteAt(const galaxy_schema::WriteAtRequest &request);
+        galaxy_schema::TruncateResponse Truncate(const galaxy_schema::TruncateRequest &request);
+        galaxy_schema::PreallocateResponse Preallocate(const galaxy_schema::PreallocateRequest &request);
+        galaxy_schema::ChecksumResponse Checksum(const galaxy_schema::ChecksumRequest &request);
         galaxy_schema::HealthCheckResponse CheckHealth(const galaxy_schema::HealthCheckRequest& request);
         galaxy_schema::ModifyCellAvailabilityResponse ChangeAvailability(const galaxy_schema::ModifyCellAvailabilityRequest & request);
-        galaxy_schema::RemoteExecutionResponse RemoteExecution(const galaxy_schema::RemoteExecutionRequest &request);
+        // Waits timeout_sec for the command if set, fs_rpc_ddl otherwise. The server does not stop the command when the
+        // call times out.
+        galaxy_schema::RemoteExecutionResponse RemoteExecution(const galaxy_schema::RemoteExecutionRequest &request, int timeout_sec=0);
+        // Raw Watch stream, read until the watch fails or context is cancelled. It has no deadline.
+        std::unique_ptr<grpc::ClientReader<galaxy_schema::WatchResponse>> Watch(grpc::ClientContext *context,
+                                                                                const galaxy_schema::WatchRequest &request);
+        // Raw Tail stream, read until the end of the file, or with follow until it fails or context is cancelled.
+        std::unique_ptr<grpc::ClientReader<galaxy_schema::TailResponse>> Tail(grpc::ClientContext *context,
+                                                                              const galaxy_schema::TailRequest &request);
+        // Raw RemoteExecutionStream stream, read until the command exits. Cancelling context kills the command.
+        std::unique_ptr<grpc::ClientReader<galaxy_schema::RemoteExecutionStreamResponse>> RemoteExecutionStream(
+            grpc::ClientContext *context, const galaxy_schema::RemoteExecutionRequest &request);
+
+        // Asynchronous variants, completed through a completion queue shared by the whole process. They return as soon
+        // as the call is sent and never throw; failures are reported to the callback. Reads are decoded and verified
+        // the same way as Read. Calls join the AsyncCallGroup of the calling thread, if any.
+        void AsyncGetAttr(const galaxy_schema::GetAttrRequest &request, AsyncCallback<galaxy_schema::GetAttrResponse> callback);
+        void AsyncCrossCellCall(const galaxy_schema::CrossCellRequest &request, AsyncCallback<galaxy_schema::CrossCellResponse> callback);
+        void AsyncListDirsInDir(const galaxy_schema::ListDirsInDirRequest &request, AsyncCallback<galaxy_schema::ListDirsInDirResponse> callback);
+        void AsyncListFilesInDir(const galaxy_schema::ListFilesInDirRequest &request, AsyncCallback<galaxy_schema::ListFilesInDirResponse> callback);
+        void AsyncRead(const galaxy_schema::ReadRequest &request, AsyncCallback<galaxy_schema::ReadResponse> callback);
+        void AsyncWrite(const galaxy_schema::WriteRequest &request, AsyncCallback<galaxy_schema::WriteResponse> callback);
 
     private:
+        // Requests as sent on the wire, with the checksum and compression settings of this client applied.
+        galaxy_schema::ReadRequest EncodeReadRequest(const galaxy_schema::ReadRequest &request) const;
+        galaxy_schema::WriteRequest EncodeWriteRequest(const galaxy_schema::WriteRequest &request) const;
+
+        // Sets the data of a CopyFile chunk along with its checksum and encoding.
+        void SetChunkData(galaxy_schema::CopyRequest &sub_request, std::string data) const;
+        // CopyFile of a sparse file, streaming its data extents at their offsets.
+        galaxy_schema::CopyResponse CopySparseFile(const galaxy_schema::CopyRequest &request);
+
         std::unique_ptr<galaxy_schema::FileSystem::Stub> stub_;
+        galaxy_schema::CompressionType compression_ = galaxy_schema::CompressionType::UNCOMPRESSED;
+        int64_t compression_min_bytes_ = 0;
+        int64_t max_payload_bytes_ = galaxy::constant::kMaxPayloadSize;
     };
 
 } // namespace galaxy
@@ -1,6 +1,8 @@
 #ifndef CPP_CORE_GALAXY_CONST_H_
 #define CPP_CORE_GALAXY_CONST_H_
 
+#include <cstdint>
+
 namespace galaxy {
     namespace constant {
         constexpr char kSeparator = '/';
@@ -11,6 +13,31 @@ namespace galaxy {
         constexpr char kSharedPrefix[] = "/SHARED";
         constexpr int kChunkSize = 1048576;  // 1MB
         constexpr int kLockRetrySec = 1;
+        constexpr char kCasDir[] = ".galaxy_cas";
+        constexpr int kCasMinBlobSize = 65536;  // 64KB
+        constexpr int kCasGcAgeSec = 604800;  // 7 days
+        constexpr char kTxnDir[] = ".galaxy_txn";
+        constexpr int kCompressionProbeSize = 4096;  // 4KB
+        constexpr double kCompressionMinSaving = 0.1;
+        constexpr int64_t kMaxPayloadSize = 1073741824;  // 1GB
+        constexpr int kAppendFdIdleSec = 5;
+        constexpr int kAppendMaxOpenFiles = 256;
+        constexpr int kFdCacheSize = 1024;
+        constexpr int kDirCacheSize = 256;
+        constexpr int kDirCacheRevalidateMs = 1000;
+        constexpr int kUnlockedReadMinAgeSec = 1;
+        constexpr int kWatchHistorySize = 65536;
+        constexpr int kWatchRetainSec = 60;
+        constexpr int kWatchHeartbeatSec = 10;
+        constexpr int kStreamReconnectMs = 1000;
+        constexpr int kStreamMaxReconnectMs = 30000;
+        constexpr int kStreamQueueSize = 4096;
+        constexpr int kScanNumThreads = 8;
+        constexpr int kScanDefaultLines = 10;
+        constexpr int kScanMaxLineSize = 1048576;  // 1MB
+        constexpr int kMaxExecutions = 16;
+        constexpr int kExecutionPollMs = 200;
+        constexpr int kExecutionGraceSec = 5;
     }  // namespace const
 }  // namespace galaxy
 
@@ -1,6 +1,10 @@
 #include "cpp/internal/galaxy_fs_internal.h"
 #include "cpp/internal/galaxy_const.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
 #include <iostream>
 #include <cstdio>
 #include <fstream>
@@ -8,8 +12,11 @@
 #include <streambuf>
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <signal.h>
 
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
@@ -230,6 +237,269 @@ namespace galaxy {
             return 0;
         }
 
+        int UnshareFile(const std::string& path, bool keep_content) {
+            struct stat statbuf;
+            if (stat(path.c_str(), &statbuf) != 0 || !S_ISREG(statbuf.st_mode) || statbuf.st_nlink <= 1) {
+                return 0;
+            }
+            if (!keep_content) {
+                // The file is about to be truncated, so dropping this link is enough.
+                return unlink(path.c_str());
+            }
+            std::string tmp_path = path + ".unshare_tmp";
+            absl::StatusOr<std::string> dir = GetFileAbsDir(path);
+            absl::StatusOr<std::string> name = GetFileName(path);
+            if (dir.ok() && name.ok()) {
+                tmp_path = JoinPath(*dir, "." + *name + ".unshare_tmp");
+            }
+            if (!CopySparse(path, tmp_path).ok()) {
+                LOG(ERROR) << "Unsharing file " << path << " failed.";
+                unlink(tmp_path.c_str());
+                return -1;
+            }
+            chmod(tmp_path.c_str(), statbuf.st_mode & 07777);
+            if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+                LOG(ERROR) << "Unsharing file " << path << " failed.";
+                unlink(tmp_path.c_str());
+                return -1;
+            }
+            return 0;
+        }
+
+        absl::StatusOr<std::vector<std::pair<off_t, off_t>>> ListDataExtents(int fd) {
+            struct stat statbuf;
+            if (fstat(fd, &statbuf) != 0) {
+                return absl::InternalError(std::string("fstat failed with error ") + std::strerror(errno) + ".");
+            }
+            std::vector<std::pair<off_t, off_t>> extents;
+            off_t offset = 0;
+            while (offset < statbuf.st_size) {
+                off_t data = lseek(fd, offset, SEEK_DATA);
+                if (data < 0 && errno == ENXIO) {
+                    // Only a hole is left up to the end of the file.
+                    break;
+                }
+                off_t hole = data < 0 ? statbuf.st_size : lseek(fd, data, SEEK_HOLE);
+                if (data < 0 || hole < 0) {
+                    data = offset;
+                    hole = statbuf.st_size;
+                }
+                extents.emplace_back(data, std::min<off_t>(hole, statbuf.st_size));
+                offset = hole;
+            }
+            return extents;
+        }
+
+        absl::Status PWriteAll(int fd, const std::string& data, off_t offset) {
+            size_t written = 0;
+            while (written < data.size()) {
+                ssize_t ret = pwrite(fd, data.data() + written, data.size() - written, offset + written);
+                if (ret < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return absl::InternalError(std::string("pwrite failed with error ") + std::strerror(errno) + ".");
+                }
+                written += ret;
+            }
+            return absl::OkStatus();
+        }
+
+        absl::Status CopySparse(const std::string& from_path, const std::string& to_path) {
+            int from_fd = open(from_path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (from_fd < 0) {
+                return absl::NotFoundError("Opening " + from_path + " failed with error " + std::strerror(errno) + ".");
+            }
+            int to_fd = open(to_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+            if (to_fd < 0) {
+                std::string error = std::strerror(errno);
+                close(from_fd);
+                return absl::InternalError("Opening " + to_path + " failed with error " + error + ".");
+            }
+            absl::StatusOr<std::vector<std::pair<off_t, off_t>>> extents = ListDataExtents(from_fd);
+            absl::Status status = extents.status();
+            std::string buffer;
+            for (size_t i = 0; status.ok() && i < extents->size(); ++i) {
+                off_t offset = extents->at(i).first;
+                while (status.ok() && offset < extents->at(i).second) {
+                    buffer.resize(std::min<off_t>(extents->at(i).second - offset, galaxy::constant::kChunkSize));
+                    ssize_t num_read = pread(from_fd, &buffer[0], buffer.size(), offset);
+                    if (num_read < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    if (num_read <= 0) {
+                        // The file shrank while being copied.
+                        break;
+                    }
+                    buffer.resize(num_read);
+                    status = PWriteAll(to_fd, buffer, offset);
+                    offset += num_read;
+                }
+            }
+            struct stat statbuf;
+            if (status.ok() && (fstat(from_fd, &statbuf) != 0 || ftruncate(to_fd, statbuf.st_size) != 0)) {
+                // Sizes the copy past a trailing hole.
+                status = absl::InternalError("Sizing " + to_path + " failed with error " + std::strerror(errno) + ".");
+            }
+            close(from_fd);
+            close(to_fd);
+            if (!status.ok()) {
+                return absl::InternalError("Copying " + from_path + " to " + to_path + " failed: " + std::string(status.message()));
+            }
+            return absl::OkStatus();
+        }
+
+        constexpr char kAtomicTmpInfix[] = ".atomic_tmp.";
+
+        // Name for a hidden sibling of path, unique within the cell.
+        static absl::StatusOr<std::string> NewTempPath(const std::string& path) {
+            static std::atomic<uint64_t> counter{0};
+            absl::StatusOr<std::string> dir = GetFileAbsDir(path);
+            absl::StatusOr<std::string> name = GetFileName(path);
+            if (!dir.ok() || !name.ok()) {
+                return absl::InvalidArgumentError("No temporary file can be named for " + path + ".");
+            }
+            return JoinPath(*dir, absl::StrCat(".", *name, kAtomicTmpInfix, getpid(), ".", counter++));
+        }
+
+        // Whether name was given by NewTempPath in a process that is gone.
+        static bool IsStaleTempName(const std::string& name) {
+            size_t infix = name.rfind(kAtomicTmpInfix);
+            if (name.empty() || name[0] != '.' || infix == std::string::npos) {
+                return false;
+            }
+            std::vector<std::string> parts = absl::StrSplit(name.substr(infix + strlen(kAtomicTmpInfix)), '.');
+            pid_t pid;
+            if (parts.size() != 2 || !absl::SimpleAtoi(parts[0], &pid) || pid <= 0) {
+                return false;
+            }
+            return pid != getpid() && kill(pid, 0) != 0 && errno == ESRCH;
+        }
+
+        int RemoveStaleTempFiles(const std::string& root) {
+            int num_removed = 0;
+            std::vector<std::string> dirs = {root};
+            while (!dirs.empty()) {
+                std::string dir = std::move(dirs.back());
+                dirs.pop_back();
+                DIR* dir_stream = opendir(dir.c_str());
+                if (dir_stream == nullptr) {
+                    LOG(WARNING) << "Fail to open " << dir << " to remove stale temporary files.";
+                    continue;
+                }
+                while (struct dirent* entry = readdir(dir_stream)) {
+                    std::string name = entry->d_name;
+                    if (name == "." || name == "..") {
+                        continue;
+                    }
+                    struct stat statbuf;
+                    if (fstatat(dirfd(dir_stream), entry->d_name, &statbuf, AT_SYMLINK_NOFOLLOW) != 0) {
+                        continue;
+                    }
+                    std::string path = JoinPath(dir, name);
+                    if (S_ISDIR(statbuf.st_mode)) {
+                        dirs.push_back(path);
+                    } else if (S_ISREG(statbuf.st_mode) && IsStaleTempName(name) && unlink(path.c_str()) == 0) {
+                        num_removed++;
+                    }
+                }
+                closedir(dir_stream);
+            }
+            return num_removed;
+        }
+
+        AtomicFile::AtomicFile(const std::string& path) : path_(path) {}
+
+        AtomicFile::~AtomicFile() {
+            if (fd_ >= 0) {
+                close(fd_);
+            }
+            if (!tmp_path_.empty()) {
+                unlink(tmp_path_.c_str());
+            }
+        }
+
+        absl::Status AtomicFile::Open() {
+            absl::StatusOr<std::string> dir = GetFileAbsDir(path_);
+            if (!dir.ok() || !impl::CreateDirIfNotExist(*dir, 0777).ok()) {
+                return absl::InternalError("Creating the directory of " + path_ + " failed.");
+            }
+            struct stat statbuf;
+            bool exists = stat(path_.c_str(), &statbuf) == 0;
+#ifdef O_TMPFILE
+            fd_ = open(dir->c_str(), O_TMPFILE | O_WRONLY | O_CLOEXEC, 0666);
+#endif
+            if (fd_ < 0) {
+                // Filesystems without O_TMPFILE support.
+                absl::StatusOr<std::string> tmp_path = NewTempPath(path_);
+                if (!tmp_path.ok()) {
+                    return tmp_path.status();
+                }
+                tmp_path_ = *tmp_path;
+                fd_ = open(tmp_path_.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+                if (fd_ < 0) {
+                    tmp_path_.clear();
+                    return absl::InternalError("Creating a temporary file for " + path_ + " failed with error " + std::strerror(errno) + ".");
+                }
+            }
+            if (exists) {
+                fchmod(fd_, statbuf.st_mode & 07777);
+            }
+            return absl::OkStatus();
+        }
+
+        absl::Status AtomicFile::Append(const std::string& data) {
+            size_t offset = 0;
+            while (offset < data.size()) {
+                ssize_t written = write(fd_, data.data() + offset, data.size() - offset);
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return absl::InternalError("Writing the new content of " + path_ + " failed with error " + std::strerror(errno) + ".");
+                }
+                offset += written;
+            }
+            return absl::OkStatus();
+        }
+
+        absl::Status AtomicFile::WriteAt(off_t offset, const std::string& data) {
+            absl::Status status = PWriteAll(fd_, data, offset);
+            if (!status.ok()) {
+                return absl::InternalError("Writing the new content of " + path_ + " failed: " + std::string(status.message()));
+            }
+            return absl::OkStatus();
+        }
+
+        absl::Status AtomicFile::Truncate(off_t size) {
+            if (ftruncate(fd_, size) != 0) {
+                return absl::InternalError("Sizing the new content of " + path_ + " failed with error " + std::strerror(errno) + ".");
+            }
+            return absl::OkStatus();
+        }
+
+        absl::Status AtomicFile::Commit() {
+            if (tmp_path_.empty()) {
+                // linkat cannot replace an existing path, so the O_TMPFILE is named first and renamed over path.
+                absl::StatusOr<std::string> tmp_path = NewTempPath(path_);
+                if (!tmp_path.ok()) {
+                    return tmp_path.status();
+                }
+                std::string fd_path = "/proc/self/fd/" + std::to_string(fd_);
+                if (linkat(AT_FDCWD, fd_path.c_str(), AT_FDCWD, tmp_path->c_str(), AT_SYMLINK_FOLLOW) != 0) {
+                    return absl::InternalError("Linking the new content of " + path_ + " failed with error " + std::strerror(errno) + ".");
+                }
+                tmp_path_ = *tmp_path;
+            }
+            close(fd_);
+            fd_ = -1;
+            if (rename(tmp_path_.c_str(), path_.c_str()) != 0) {
+                return absl::InternalError("Renaming the new content of " + path_ + " failed with error " + std::strerror(errno) + ".");
+            }
+            tmp_path_.clear();
+            return absl::OkStatus();
+        }
+
     }
 
     namespace impl {
@@ -247,14 +517,8 @@ namespace galaxy {
                 LOG(ERROR) << "Path " << from_path << " does not exist during function call CopyFile.";
                 return absl::NotFoundError("Path " + from_path + " does not exist for CopyFile.");
             } else {
-                std::ifstream source(from_path, std::ifstream::binary);
-                std::ofstream dest(to_path, std::ofstream::binary);
-
-                dest << source.rdbuf();
-
-                source.close();
-                dest.close();
-                return absl::OkStatus();
+                internal::UnshareFile(to_path, false);
+                return internal::CopySparse(from_path, to_path);
             }
         }
 
@@ -494,18 +758,23 @@ namespace galaxy {
             }
         }
 
-        absl::Status Read(const std::string& path, std::string& data) {
+        absl::Status Read(const std::string& path, std::string& data, bool require_lock) {
             if (!internal::ExistFile(path)) {
                 return absl::NotFoundError("Path " + path + " does not exist for Read.");
             }
-            absl::StatusOr<std::string> lock_name = internal::GetFileLockName(path);
-            if (!lock_name.ok()) {
-                return absl::InternalError("Fail to create lock file.");
+            absl::StatusOr<std::string> lock_name;
+            if (require_lock) {
+                lock_name = internal::GetFileLockName(path);
+                if (!lock_name.ok()) {
+                    return absl::InternalError("Fail to create lock file.");
+                }
+                LockFile(*lock_name);
             }
-            LockFile(*lock_name);
             std::ifstream infile(path, std::ifstream::binary);
             data = std::string((std::istreambuf_iterator<char>(infile)), std::istreambuf_iterator<char>());
-            UnlockFile(*lock_name);
+            if (require_lock) {
+                UnlockFile(*lock_name);
+            }
             return absl::OkStatus();
         }
 
@@ -519,6 +788,12 @@ namespace galaxy {
                 LockFile(*lock_name);
             }
 
+            if (internal::UnshareFile(path, mode == "a") != 0) {
+                if (require_lock) {
+                    UnlockFile(*lock_name);
+                }
+                return absl::InternalError("Unsharing file " + path + " failed.");
+            }
             if (!internal::ExistFile(path)) {
                 VLOG(1) << "Creating file " << path << ".";
                 if (!CreateFileIfNotExist(path, 0777).ok()) {
@@ -539,6 +814,121 @@ namespace galaxy {
             return absl::OkStatus();
         }
 
+        absl::Status WriteAtomic(const std::string& path, const std::string& data, bool require_lock) {
+            absl::StatusOr<std::string> lock_name;
+            if (require_lock) {
+                lock_name = internal::GetFileLockName(path);
+                if (!lock_name.ok()) {
+                    return absl::InternalError("Fail to create lock file.");
+                }
+                LockFile(*lock_name);
+            }
+            // The new content gets its own inode, so a blob sharing the old one is left untouched.
+            internal::AtomicFile file(path);
+            absl::Status status = file.Open();
+            if (status.ok()) {
+                status = file.Append(data);
+            }
+            if (status.ok()) {
+                status = file.Commit();
+            }
+            if (require_lock) {
+                UnlockFile(*lock_name);
+            }
+            return status;
+        }
+
+        absl::Status WriteAt(const std::string& path, off_t offset, const std::string& data, bool require_lock) {
+            if (offset < 0) {
+                return absl::InvalidArgumentError("Negative offset for WriteAt on " + path + ".");
+            }
+            absl::StatusOr<std::string> lock_name;
+            if (require_lock) {
+                lock_name = internal::GetFileLockName(path);
+                if (!lock_name.ok()) {
+                    return absl::InternalError("Fail to create lock file.");
+                }
+                LockFile(*lock_name);
+            }
+            absl::Status status;
+            int fd = -1;
+            if (internal::UnshareFile(path, true) != 0) {
+                status = absl::InternalError("Unsharing file " + path + " failed.");
+            } else if (!internal::ExistFile(path) && !CreateFileIfNotExist(path, 0777).ok()) {
+                status = absl::InternalError("Creating file " + path + " failed.");
+            } else if ((fd = open(path.c_str(), O_WRONLY | O_CLOEXEC)) < 0) {
+                status = absl::InternalError("Opening file " + path + " failed with error " + std::strerror(errno) + ".");
+            } else {
+                status = internal::PWriteAll(fd, data, offset);
+                close(fd);
+            }
+            if (require_lock) {
+                UnlockFile(*lock_name);
+            }
+            return status;
+        }
+
+        absl::Status Truncate(const std::string& path, off_t size, bool require_lock) {
+            if (size < 0) {
+                return absl::InvalidArgumentError("Negative size for Truncate on " + path + ".");
+            }
+            if (!internal::ExistFile(path)) {
+                return absl::NotFoundError("Path " + path + " does not exist for Truncate.");
+            }
+            absl::StatusOr<std::string> lock_name;
+            if (require_lock) {
+                lock_name = internal::GetFileLockName(path);
+                if (!lock_name.ok()) {
+                    return absl::InternalError("Fail to create lock file.");
+                }
+                LockFile(*lock_name);
+            }
+            absl::Status status;
+            if (internal::UnshareFile(path, size > 0) != 0) {
+                status = absl::InternalError("Unsharing file " + path + " failed.");
+            } else if (!internal::ExistFile(path) && !CreateFileIfNotExist(path, 0777).ok()) {
+                // Unsharing an emptied file drops its link.
+                status = absl::InternalError("Creating file " + path + " failed.");
+            } else if (truncate(path.c_str(), size) != 0) {
+                status = absl::InternalError("Truncating file " + path + " failed with error " + std::strerror(errno) + ".");
+            }
+            if (require_lock) {
+                UnlockFile(*lock_name);
+            }
+            return status;
+        }
+
+        absl::Status Preallocate(const std::string& path, off_t size, bool require_lock) {
+            if (size < 0) {
+                return absl::InvalidArgumentError("Negative size for Preallocate on " + path + ".");
+            }
+            absl::StatusOr<std::string> lock_name;
+            if (require_lock) {
+                lock_name = internal::GetFileLockName(path);
+                if (!lock_name.ok()) {
+                    return absl::InternalError("Fail to create lock file.");
+                }
+                LockFile(*lock_name);
+            }
+            absl::Status status;
+            int fd = -1;
+            if (!internal::ExistFile(path) && !CreateFileIfNotExist(path, 0777).ok()) {
+                status = absl::InternalError("Creating file " + path + " failed.");
+            } else if ((fd = open(path.c_str(), O_WRONLY | O_CLOEXEC)) < 0) {
+                status = absl::InternalError("Opening file " + path + " failed with error " + std::strerror(errno) + ".");
+            } else {
+                // Preallocation is only a hint for file systems without fallocate, so they are not an error.
+                if (size > 0 && fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, size) != 0 && errno != EOPNOTSUPP) {
+                    status = absl::InternalError("Preallocating file " + path + " failed with error " + std::strerror(errno) + ".");
+                }
+                close(fd);
+            }
+            if (require_lock) {
+                UnlockFile(*lock_name);
+            }
+            return status;
+        }
+
         absl::Status GetAttr(const std::string& path, struct stat *statbuf) {
             if (lstat(path.c_str(), statbuf) == 0) {
                 return absl::OkStatus();
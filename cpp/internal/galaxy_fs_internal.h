@@ -2,6 +2,7 @@
 #define CPP_INTERNAL_GALAXY_FS_INTERNAL_H_
 
 #include <string>
+#include <utility>
 #include <vector>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
@@ -30,6 +31,42 @@ namespace galaxy {
         bool IsEmpty(const std::string& path);
         int Mkdir(const std::string& path, mode_t mode);
         int MkdirRecursive(const std::string &path, mode_t mode, bool check_exist);
+        // Gives path its own inode if it shares one with a content-addressed blob, so that writing it in place
+        // does not modify the blob. Keeps the current content only if keep_content is set.
+        int UnshareFile(const std::string& path, bool keep_content);
+        // Data extents of fd as [start, end) offsets, without its holes. Without SEEK_DATA support, the whole file
+        // is one extent.
+        absl::StatusOr<std::vector<std::pair<off_t, off_t>>> ListDataExtents(int fd);
+        // Writes all of data at offset, resuming after short writes.
+        absl::Status PWriteAll(int fd, const std::string& data, off_t offset);
+        // Copies the data extents of from_path to to_path, so that the holes of a sparse file stay holes.
+        absl::Status CopySparse(const std::string& from_path, const std::string& to_path);
+        // Removes the hidden siblings left under root by the AtomicFiles of processes that are gone, e.g. after a
+        // crash before Commit, and returns how many.
+        int RemoveStaleTempFiles(const std::string& root);
+
+        // New content of path, which replaces it atomically on Commit, so that readers only ever see the old or the new
+        // content. It is written to an unnamed O_TMPFILE where supported, or to a hidden sibling otherwise, and is
+        // discarded if destroyed before Commit. The permissions of an existing path are kept.
+        class AtomicFile {
+        public:
+            explicit AtomicFile(const std::string& path);
+            AtomicFile(const AtomicFile&) = delete;
+            ~AtomicFile();
+
+            absl::Status Open();
+            absl::Status Append(const std::string& data);
+            // Positional writes, for content sent as extents of a sparse file.
+            absl::Status WriteAt(off_t offset, const std::string& data);
+            absl::Status Truncate(off_t size);
+            absl::Status Commit();
+
+        private:
+            std::string path_;
+            // Hidden sibling holding the content, empty while it is an unnamed O_TMPFILE.
+            std::string tmp_path_;
+            int fd_ = -1;
+        };
     }
 
     namespace impl {
@@ -52,8 +89,16 @@ namespace galaxy {
         absl::Status RmDirRecursive(const std::string& path, bool include_hidden=false);
         absl::Status RmFile(const std::string& path, bool require_lock);
         absl::Status RenameFile(const std::string& old_path, const std::string& new_path);
-        absl::Status Read(const std::string& path, std::string& data);
+        absl::Status Read(const std::string& path, std::string& data, bool require_lock);
         absl::Status Write(const std::string& path, const std::string& data, const std::string& mode, bool require_lock);
+        // Replaces path with data through an AtomicFile.
+        absl::Status WriteAtomic(const std::string& path, const std::string& data, bool require_lock);
+        // Writes data at offset in place, creating path if needed. Bytes past the end of the file are zero-filled.
+        absl::Status WriteAt(const std::string& path, off_t offset, const std::string& data, bool require_lock);
+        // Sets the size of path, dropping its end or extending it with a hole.
+        absl::Status Truncate(const std::string& path, off_t size, bool require_lock);
+        // Reserves the blocks of path up to size, without changing its size or content.
+        absl::Status Preallocate(const std::string& path, off_t size, bool require_lock);
         absl::Status GetAttr(const std::string& path, struct stat *statbuf);
         absl::Status GetDiskUsage(struct statvfs *statvfsbuf);
         absl::Status GetRamUsage(struct sysinfo *sysinfobuf);
@@ -1,4 +1,10 @@
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
 #include <string>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 #include <gtest/gtest.h>
 #include "cpp/internal/galaxy_fs_internal.h"
 
@@ -51,4 +57,59 @@ namespace {
         EXPECT_FALSE(output.ok());
     }
 
+    TEST(GalaxyFsInternalTest, CopySparse) {
+        std::string from_path = galaxy::internal::JoinPath(testing::TempDir(), "galaxy_fs_internal_test_sparse_" + std::to_string(getpid()));
+        std::string to_path = from_path + ".copy";
+        int fd = open(from_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        ASSERT_GE(fd, 0);
+        // Data, a hole of 8MB, more data and a trailing hole.
+        const off_t hole_size = 8 << 20;
+        ASSERT_TRUE(galaxy::internal::PWriteAll(fd, "head", 0).ok());
+        ASSERT_TRUE(galaxy::internal::PWriteAll(fd, "tail", 4 + hole_size).ok());
+        ASSERT_EQ(ftruncate(fd, 2 * hole_size), 0);
+        close(fd);
+
+        ASSERT_TRUE(galaxy::internal::CopySparse(from_path, to_path).ok());
+        struct stat from_stat;
+        struct stat to_stat;
+        ASSERT_EQ(stat(from_path.c_str(), &from_stat), 0);
+        ASSERT_EQ(stat(to_path.c_str(), &to_stat), 0);
+        EXPECT_EQ(to_stat.st_size, 2 * hole_size);
+        // The holes are not written out, as far as the file system of the copy keeps them.
+        EXPECT_LE(to_stat.st_blocks, from_stat.st_blocks + 16);
+        std::stringstream from_data;
+        std::stringstream to_data;
+        from_data << std::ifstream(from_path).rdbuf();
+        to_data << std::ifstream(to_path).rdbuf();
+        EXPECT_TRUE(from_data.str() == to_data.str());
+
+        EXPECT_TRUE(absl::IsNotFound(galaxy::internal::CopySparse(from_path + ".none", to_path)));
+    }
+
+    TEST(GalaxyFsInternalTest, RemoveStaleTempFiles) {
+        std::string root = galaxy::internal::JoinPath(testing::TempDir(), "galaxy_fs_internal_test_stale_" + std::to_string(getpid()));
+        ASSERT_TRUE(galaxy::impl::CreateDirIfNotExist(root + "/sub", 0777).ok());
+        pid_t dead_pid = fork();
+        if (dead_pid == 0) {
+            _exit(0);
+        }
+        ASSERT_GT(dead_pid, 0);
+        waitpid(dead_pid, nullptr, 0);
+        std::string dead = ".a.atomic_tmp." + std::to_string(dead_pid) + ".3";
+        std::string live = ".b.atomic_tmp." + std::to_string(getpid()) + ".1";
+        std::string visible = "c.atomic_tmp." + std::to_string(dead_pid) + ".1";
+        std::string malformed = ".d.atomic_tmp." + std::to_string(dead_pid);
+        for (const auto& name : {dead, live, visible, malformed}) {
+            std::ofstream(root + "/sub/" + name) << "x";
+        }
+        std::ofstream(root + "/" + dead) << "x";
+
+        EXPECT_EQ(galaxy::internal::RemoveStaleTempFiles(root), 2);
+        EXPECT_FALSE(galaxy::internal::ExistFile(root + "/" + dead));
+        EXPECT_FALSE(galaxy::internal::ExistFile(root + "/sub/" + dead));
+        EXPECT_TRUE(galaxy::internal::ExistFile(root + "/sub/" + live));
+        EXPECT_TRUE(galaxy::internal::ExistFile(root + "/sub/" + visible));
+        EXPECT_TRUE(galaxy::internal::ExistFile(root + "/sub/" + malformed));
+    }
+
 }  // namespace
\ No newline at end of file
@@ -26,6 +26,36 @@ namespace galaxy {
             return measure;
         }
 
+        opencensus::stats::MeasureInt64 internal::RawBytesMeasure() {
+            static const auto measure = opencensus::stats::MeasureInt64::Register(
+                internal::kRawBytesMeasureName, "Payload bytes before compression", "By");
+            return measure;
+        }
+
+        opencensus::stats::MeasureInt64 internal::WireBytesMeasure() {
+            static const auto measure = opencensus::stats::MeasureInt64::Register(
+                internal::kWireBytesMeasureName, "Payload bytes after compression", "By");
+            return measure;
+        }
+
+        opencensus::stats::MeasureInt64 internal::MetaCacheHitsMeasure() {
+            static const auto measure = opencensus::stats::MeasureInt64::Register(
+                internal::kMetaCacheHitsMeasureName, "Lookups served from the metadata cache", "1");
+            return measure;
+        }
+
+        opencensus::stats::MeasureInt64 internal::MetaCacheMissesMeasure() {
+            static const auto measure = opencensus::stats::MeasureInt64::Register(
+                internal::kMetaCacheMissesMeasureName, "Lookups not served from the metadata cache", "1");
+            return measure;
+        }
+
+        opencensus::stats::MeasureInt64 internal::MetaCacheBytesMeasure() {
+            static const auto measure = opencensus::stats::MeasureInt64::Register(
+                internal::kMetaCacheBytesMeasureName, "Memory taken by the metadata cache", "By");
+            return measure;
+        }
+
         opencensus::tags::TagKey internal::MethodKey() {
             static const auto key = opencensus::tags::TagKey::Register("method");
             return key;
@@ -12,10 +12,22 @@ namespace galaxy {
             ABSL_CONST_INIT const absl::string_view kCountMeasureName = "grpc/count";
             ABSL_CONST_INIT const absl::string_view kDiskUsageMeasureName = "grpc/disk_usage";
             ABSL_CONST_INIT const absl::string_view kRamUsageMeasureName = "grpc/RAM_usage";
+            ABSL_CONST_INIT const absl::string_view kRawBytesMeasureName = "grpc/raw_bytes";
+            ABSL_CONST_INIT const absl::string_view kWireBytesMeasureName = "grpc/wire_bytes";
+            ABSL_CONST_INIT const absl::string_view kMetaCacheHitsMeasureName = "grpc/meta_cache_hits";
+            ABSL_CONST_INIT const absl::string_view kMetaCacheMissesMeasureName = "grpc/meta_cache_misses";
+            ABSL_CONST_INIT const absl::string_view kMetaCacheBytesMeasureName = "grpc/meta_cache_bytes";
             opencensus::stats::MeasureDouble LatencyMsMeasure();
             opencensus::stats::MeasureInt64 QueryCountMeasure();
             opencensus::stats::MeasureDouble DiskUsageMeasure();
             opencensus::stats::MeasureDouble RamUsageMeasure();
+            // Payload bytes before and after compression, recorded for every compressed payload.
+            opencensus::stats::MeasureInt64 RawBytesMeasure();
+            opencensus::stats::MeasureInt64 WireBytesMeasure();
+            // Lookups of the metadata cache served from it or not, and the memory it takes.
+            opencensus::stats::MeasureInt64 MetaCacheHitsMeasure();
+            opencensus::stats::MeasureInt64 MetaCacheMissesMeasure();
+            opencensus::stats::MeasureInt64 MetaCacheBytesMeasure();
             opencensus::tags::TagKey MethodKey();
         }
     }
@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <future>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <google/protobuf/util/json_util.h>
+
+#include "cpp/placement.h"
+#include "cpp/client.h"
+#include "cpp/util/galaxy_util.h"
+#include "glog/logging.h"
+
+using galaxy_schema::FileAnalyzerResult;
+using galaxy_schema::HealthCheckResponse;
+
+namespace {
+    // An input resolved to where it lives.
+    struct Input {
+        std::string path;
+        // Path under the root of the cell holding it, or the path itself if it is in no cell.
+        std::string relative_path;
+        bool shared = false;
+        int64_t size = 0;
+    };
+
+    bool ResolveInput(const std::string& path, Input* input, std::string* error) {
+        // Checked like InitClient does, but reported as an error of the input rather than aborting.
+        absl::StatusOr<FileAnalyzerResult> analyzed = galaxy::util::RunFileAnalyzer(path);
+        if (!analyzed.ok()) {
+            *error = analyzed.status().ToString();
+            return false;
+        }
+        const FileAnalyzerResult& result = *analyzed;
+        if (result.configs().from_cell_config().disabled() || result.configs().to_cell_config().disabled()) {
+            *error = "Cell [" + (result.configs().to_cell_config().disabled() ? result.to_cell() : result.from_cell()) + "] is disabled.";
+            return false;
+        }
+        input->path = path;
+        input->shared = result.is_shared();
+        input->size = galaxy::util::ParseAttrSize(galaxy::client::GetAttr(path));
+        if (input->size < 0) {
+            *error = "Input cannot be found.";
+            return false;
+        }
+        if (input->shared) {
+            return true;
+        }
+        if (result.to_cell().empty()) {
+            input->relative_path = result.path();
+        } else {
+            std::string cell_path = galaxy::util::ConvertToCellPath(result.path(), result.configs().to_cell_config());
+            std::string prefix = galaxy::util::GetGalaxyFsPrefixPath(result.to_cell());
+            input->relative_path = cell_path.compare(0, prefix.size(), prefix) == 0 ? cell_path.substr(prefix.size()) : cell_path;
+        }
+        if (input->relative_path.empty() || input->relative_path[0] != '/') {
+            input->relative_path = "/" + input->relative_path;
+        }
+        return true;
+    }
+
+    // Where input is, or would be staged, on cell.
+    std::string CellPath(const std::string& cell, const Input& input) {
+        return galaxy::util::GetGalaxyFsPrefixPath(cell) + input.relative_path;
+    }
+
+    // Load of a cell, false if it is unhealthy or unreachable.
+    bool GetLocality(const std::string& cell, galaxy::placement::CellLocality* locality) {
+        std::string health = galaxy::client::CheckHealth(cell);
+        HealthCheckResponse response;
+        if (health.empty() || !google::protobuf::util::JsonStringToMessage(health, &response).ok() || !response.healthy()) {
+            return false;
+        }
+        // Usage is reported in MB.
+        const galaxy_schema::FileSystemUsage& usage = response.usage();
+        locality->ram_usage = usage.total_ram() > 0 ? usage.used_ram() / usage.total_ram() : 0;
+        locality->disk_usage = usage.total_disk() > 0 ? usage.used_disk() / usage.total_disk() : 0;
+        locality->free_disk_bytes = static_cast<int64_t>((usage.total_disk() - usage.used_disk()) * 1024 * 1024);
+        return true;
+    }
+}  // namespace
+
+namespace galaxy {
+    namespace placement {
+        int64_t Placement::MissingBytes() const {
+            auto it = cells.find(cell);
+            return it == cells.end() ? total_bytes : total_bytes - it->second.resident_bytes;
+        }
+
+        Placement Place(const std::vector<std::string>& paths, const PlacementOptions& options) {
+            Placement placement;
+            std::vector<Input> inputs;
+            for (const auto& path : paths) {
+                Input input;
+                std::string error;
+                if (!ResolveInput(path, &input, &error)) {
+                    placement.errors[path] = error;
+                    continue;
+                }
+                placement.total_bytes += input.size;
+                inputs.push_back(std::move(input));
+            }
+
+            std::vector<std::string> cells = client::ListCells();
+            std::vector<std::future<std::pair<bool, CellLocality>>> health;
+            for (const auto& cell : cells) {
+                health.push_back(std::async(std::launch::async, [cell]() {
+                    CellLocality locality;
+                    bool healthy = GetLocality(cell, &locality);
+                    return std::make_pair(healthy, locality);
+                }));
+            }
+            for (size_t i = 0; i < cells.size(); ++i) {
+                std::pair<bool, CellLocality> result = health[i].get();
+                if (result.first) {
+                    placement.cells[cells[i]] = result.second;
+                } else {
+                    LOG(WARNING) << "Cell " << cells[i] << " is left out of the placement as it is unhealthy.";
+                }
+            }
+
+            // One GetAttr per input and cell, all in flight at once. A copy of the same size counts as the input.
+            struct Probe {
+                std::string cell;
+                size_t input;
+                std::future<absl::StatusOr<std::string>> attr;
+            };
+            std::vector<Probe> probes;
+            for (auto& pair : placement.cells) {
+                for (size_t i = 0; i < inputs.size(); ++i) {
+                    if (inputs[i].shared) {
+                        pair.second.resident_bytes += inputs[i].size;
+                    } else {
+                        probes.push_back({pair.first, i, client::async::GetAttr(CellPath(pair.first, inputs[i]))});
+                    }
+                }
+            }
+            std::set<std::pair<std::string, size_t>> resident;
+            for (auto& probe : probes) {
+                absl::StatusOr<std::string> attr = probe.attr.get();
+                if (attr.ok() && galaxy::util::ParseAttrSize(*attr) == inputs[probe.input].size) {
+                    placement.cells[probe.cell].resident_bytes += inputs[probe.input].size;
+                    resident.insert({probe.cell, probe.input});
+                }
+            }
+
+            auto pick = [&placement, &options](bool within_limits) {
+                std::string best;
+                for (const auto& pair : placement.cells) {
+                    const CellLocality& locality = pair.second;
+                    if (within_limits && (locality.ram_usage > options.max_ram_usage || locality.disk_usage > options.max_disk_usage ||
+                                          locality.free_disk_bytes < placement.total_bytes - locality.resident_bytes)) {
+                        continue;
+                    }
+                    if (best.empty()) {
+                        best = pair.first;
+                        continue;
+                    }
+                    const CellLocality& best_locality = placement.cells.at(best);
+                    if (locality.resident_bytes > best_locality.resident_bytes ||
+                        (locality.resident_bytes == best_locality.resident_bytes && locality.ram_usage < best_locality.ram_usage)) {
+                        best = pair.first;
+                    }
+                }
+                return best;
+            };
+            placement.cell = pick(true);
+            if (placement.cell.empty()) {
+                placement.cell = pick(false);
+            }
+            if (placement.cell.empty()) {
+                LOG(ERROR) << "No healthy cell to place a job on.";
+                return placement;
+            }
+
+            std::vector<std::tuple<std::string, std::string, std::future<absl::Status>>> copies;
+            for (size_t i = 0; i < inputs.size(); ++i) {
+                const Input& input = inputs[i];
+                std::string cell_path = CellPath(placement.cell, input);
+                if (input.shared) {
+                    placement.paths[input.path] = input.path;
+                } else if (resident.count({placement.cell, i}) > 0) {
+                    placement.paths[input.path] = cell_path;
+                } else if (options.stage_inputs) {
+                    copies.emplace_back(input.path, cell_path, client::async::CopyFile(input.path, cell_path));
+                } else {
+                    placement.paths[input.path] = input.path;
+                }
+            }
+            for (auto& copy : copies) {
+                absl::Status status = std::get<2>(copy).get();
+                if (status.ok()) {
+                    placement.paths[std::get<0>(copy)] = std::get<1>(copy);
+                } else {
+                    placement.paths[std::get<0>(copy)] = std::get<0>(copy);
+                    placement.errors[std::get<0>(copy)] = "Fail to stage to " + std::get<1>(copy) + ": " + status.ToString();
+                }
+            }
+            return placement;
+        }
+
+        client::ExecutionResult RunNearData(const std::vector<std::string>& inputs, const std::string& home_dir, const std::string& main,
+                                            const std::vector<std::string>& program_args, const std::map<std::string, std::string>& env_kargs,
+                                            const PlacementOptions& options, Placement* placement) {
+            Placement chosen = Place(inputs, options);
+            client::ExecutionResult result;
+            if (chosen.cell.empty()) {
+                result.error = "No healthy cell to run on.";
+            } else if (!chosen.errors.empty()) {
+                result.error = "Input " + chosen.errors.begin()->first + ": " + chosen.errors.begin()->second;
+            } else {
+                LOG(INFO) << "Running [" << main << "] on cell " << chosen.cell << " with " << chosen.MissingBytes() << " of "
+                          << chosen.total_bytes << " input bytes elsewhere.";
+                result = client::RemoteExecuteAll({chosen.cell}, home_dir, main, program_args, env_kargs).at(chosen.cell);
+            }
+            if (placement != nullptr) {
+                *placement = std::move(chosen);
+            }
+            return result;
+        }
+    }  // namespace placement
+} // namespace galaxy
@@ -0,0 +1,56 @@
+#ifndef CPP_GALAXY_PLACEMENT_H
+#define CPP_GALAXY_PLACEMENT_H
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "cpp/client.h"
+
+namespace galaxy {
+    namespace placement {
+        struct PlacementOptions {
+            // Cells using more than these fractions of their RAM or disk are only picked if no other healthy cell is left.
+            double max_ram_usage = 0.9;
+            double max_disk_usage = 0.95;
+            // Copies the inputs the chosen cell lacks to it, under the same path relative to its root.
+            bool stage_inputs = false;
+        };
+
+        struct CellLocality {
+            // Bytes of the inputs the cell holds, as the files themselves or as copies of the same size.
+            int64_t resident_bytes = 0;
+            double ram_usage = 0;
+            double disk_usage = 0;
+            int64_t free_disk_bytes = 0;
+        };
+
+        struct Placement {
+            // Chosen cell, empty if no healthy cell was found.
+            std::string cell;
+            // Size of all the inputs that could be found.
+            int64_t total_bytes = 0;
+            // Healthy cells considered.
+            std::map<std::string, CellLocality> cells;
+            // Galaxy path of each input for a job on cell: its copy on cell if there is one, e.g. once staged, or the input itself.
+            std::map<std::string, std::string> paths;
+            // Inputs that could not be found or staged, with why.
+            std::map<std::string, std::string> errors;
+
+            // Bytes of the inputs that are not on cell, sent over the network if the job reads them.
+            int64_t MissingBytes() const;
+        };
+
+        // Picks the healthy cell holding the most bytes of inputs, so that a job run there moves the least data. Sizes come
+        // from GetAttr, the load of the cells from CheckHealth, and ties go to the cell using the least RAM. Inputs under
+        // /SHARED are on every cell.
+        Placement Place(const std::vector<std::string>& inputs, const PlacementOptions& options);
+        // Runs main with its arguments on the cell picked for inputs, with RemoteExecuteAll, after staging the missing
+        // inputs there if options ask for it. placement, if given, receives the placement used.
+        client::ExecutionResult RunNearData(const std::vector<std::string>& inputs, const std::string& home_dir, const std::string& main,
+                                            const std::vector<std::string>& program_args, const std::map<std::string, std::string>& env_kargs,
+                                            const PlacementOptions& options, Placement* placement=nullptr);
+    }  // namespace placement
+} // namespace galaxy
+
+#endif // CPP_GALAXY_PLACEMENT_H
@@ -47,6 +47,7 @@ void RunGalaxyServer(const galaxy_schema::CellConfig& config)
     std::string server_address("0.0.0.0:" + std::to_string(config.fs_port()));
     GalaxyServerImpl galaxy_service;
     galaxy_service.SetPassword(config.fs_password());
+    galaxy_service.SetCellConfig(config);
 
     grpc::reflection::InitProtoReflectionServerBuilderPlugin();
     grpc::channelz::experimental::InitChannelzService();
@@ -3,11 +3,11 @@
 #include <iostream>
 #include <fstream>
 #include <string>
-#include <thread>
 
 #include "absl/flags/flag.h"
 #include "glog/logging.h"
 #include "cpp/client.h"
+#include "cpp/transfer.h"
 
 namespace galaxy
 {
@@ -60,25 +60,11 @@ namespace galaxy
 
     void CopyDirCmd(const std::string& from_path, const std::string& to_path, bool overwrite) {
         try {
-            std::map<std::string, std::string> sub_files = client::ListFilesInDirRecursive(from_path);
-            // Needs to push back from_path in case from_path is a file name.
-            std::vector<std::string> all_files;
-            for (const auto& sub_file : sub_files) {
-                all_files.push_back(sub_file.first);
-            }
-            if (all_files.empty()) {
-                all_files.push_back(from_path);
-            }
-            std::vector<std::thread> threads;
-            for (auto& file : all_files) {
-                std::string new_file(file);
-                new_file.replace(0, from_path.length(), to_path);
-                threads.push_back(std::thread(CopyFileCmd, file, new_file, overwrite));
-            }
-
-            for (auto& th : threads) {
-                th.join();
-            }
+            transfer::TransferOptions options = transfer::TransferOptions::FromFlags();
+            options.overwrite = overwrite;
+            options.show_progress = true;
+            transfer::TransferSummary summary = transfer::CopyDir(from_path, to_path, options);
+            std::cout << summary.ToString() << std::endl;
         }
         catch (std::string errorMsg)
         {
@@ -88,10 +74,14 @@ namespace galaxy
 
     void MoveDirCmd(const std::string& from_path, const std::string& to_path, bool overwrite) {
         try {
-            CopyDirCmd(from_path, to_path, overwrite);
-            client::RmDirRecursive(from_path);
-            client::RmFile(from_path);
-            std::cout << "Done moving from " << from_path << " to " << to_path << std::endl;
+            transfer::TransferOptions options = transfer::TransferOptions::FromFlags();
+            options.overwrite = overwrite;
+            options.show_progress = true;
+            transfer::TransferSummary summary = transfer::MoveDir(from_path, to_path, options);
+            std::cout << summary.ToString() << std::endl;
+            if (summary.num_failed == 0) {
+                std::cout << "Done moving from " << from_path << " to " << to_path << std::endl;
+            }
         }
         catch (std::string errorMsg)
         {
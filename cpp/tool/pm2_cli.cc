@@ -1,5 +1,6 @@
 #include "cpp/tool/pm2_cli.h"
 #include <iostream>
+#include <map>
 #include <fstream>
 #include <string>
 #include "absl/flags/flag.h"
@@ -9,6 +10,23 @@
 
 namespace galaxy
 {
+    namespace
+    {
+        // Prints the output of a command run on every cell, cell by cell.
+        void PrintResults(const std::map<std::string, client::ExecutionResult> &results)
+        {
+            for (const auto &pair : results)
+            {
+                std::cout << "Checking cell: [" << pair.first << "]" << std::endl;
+                std::cout << pair.second.out << std::flush;
+                std::cerr << pair.second.err << std::flush;
+                if (!pair.second.error.empty())
+                {
+                    std::cout << "Failed on cell [" << pair.first << "] with error " << pair.second.error << std::endl;
+                }
+            }
+        }
+    } // namespace
 
     void Pm2List(const std::string &cell)
     {
@@ -17,11 +35,7 @@ namespace galaxy
 
     void Pm2List()
     {
-        std::vector<std::string> cells = client::ListCells();
-        for (const auto& cell : cells) {
-            std::cout << "Checking cell: [" << cell << "]" << std::endl;
-            Pm2List(cell);
-        }
+        PrintResults(client::RemoteExecuteAll(client::ListCells(), "", "pm2", {"list"}));
     }
 
     void Pm2Start(const std::string &cell, const std::string &home_dir, const std::string &json_file, const std::string &job_name)
@@ -35,11 +49,7 @@ namespace galaxy
     }
 
     void Pm2Stop(const std::string &job_name) {
-        std::vector<std::string> cells = client::ListCells();
-        for (const auto& cell : cells) {
-            std::cout << "Checking cell: [" << cell << "]" << std::endl;
-            Pm2Stop(cell, job_name);
-        }
+        PrintResults(client::RemoteExecuteAll(client::ListCells(), "", "pm2", {"stop", job_name}));
     }
 
     void Pm2Restart(const std::string &cell, const std::string &job_name)
@@ -48,10 +58,6 @@ namespace galaxy
     }
 
     void Pm2Restart(const std::string &job_name) {
-        std::vector<std::string> cells = client::ListCells();
-        for (const auto& cell : cells) {
-            std::cout << "Checking cell: [" << cell << "]" << std::endl;
-            Pm2Restart(cell, job_name);
-        }
+        PrintResults(client::RemoteExecuteAll(client::ListCells(), "", "pm2", {"restart", job_name}));
     }
 }
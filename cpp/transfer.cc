@@ -0,0 +1,446 @@
+#include <algorithm>
+#include <cstdio>
+#include <future>
+#include <iomanip>
+#include <set>
+#include <sstream>
+
+#include "cpp/transfer.h"
+#include "cpp/client.h"
+#include "cpp/core/galaxy_flag.h"
+#include "cpp/util/galaxy_util.h"
+#include "absl/flags/flag.h"
+#include "glog/logging.h"
+
+using galaxy_schema::FileAnalyzerResult;
+
+namespace {
+    // A resolved source or destination root of a transfer.
+    struct Endpoint {
+        std::string path;
+        // The prefix used by the keys returned from the listing calls, which may differ from path (e.g. /LOCAL/..).
+        std::string listing_root;
+        // Remote cell of the endpoint, empty for local paths.
+        std::string cell;
+    };
+
+    Endpoint ResolveEndpoint(const std::string& path) {
+        FileAnalyzerResult result = galaxy::util::InitClient(path);
+        Endpoint endpoint;
+        endpoint.path = path;
+        if (result.is_remote()) {
+            endpoint.cell = result.configs().to_cell_config().cell();
+            endpoint.listing_root = galaxy::util::ConvertToCellPath(result.path(), result.configs().to_cell_config());
+        } else {
+            endpoint.listing_root = galaxy::util::ConvertToCellPath(result.path(), result.configs().from_cell_config());
+        }
+        return endpoint;
+    }
+
+    // Returns the part of a listed file name relative to the endpoint root.
+    std::string RelativeName(const std::string& file, const Endpoint& endpoint) {
+        if (file.compare(0, endpoint.listing_root.length(), endpoint.listing_root) == 0) {
+            return file.substr(endpoint.listing_root.length());
+        }
+        if (file.compare(0, endpoint.path.length(), endpoint.path) == 0) {
+            return file.substr(endpoint.path.length());
+        }
+        return file;
+    }
+
+    std::string HumanBytes(double bytes) {
+        const char* units[] = {"B", "KB", "MB", "GB", "TB"};
+        int unit = 0;
+        while (bytes >= 1024 && unit < 4) {
+            bytes /= 1024;
+            unit++;
+        }
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(unit == 0 ? 0 : 1) << bytes << " " << units[unit];
+        return oss.str();
+    }
+
+    class LimiterGuard {
+    public:
+        explicit LimiterGuard(std::vector<galaxy::transfer::CellLimiter*> limiters) : limiters_(std::move(limiters)) {
+            for (auto* limiter : limiters_) {
+                limiter->Acquire();
+            }
+        }
+        ~LimiterGuard() {
+            for (auto it = limiters_.rbegin(); it != limiters_.rend(); it++) {
+                (*it)->Release();
+            }
+        }
+
+    private:
+        std::vector<galaxy::transfer::CellLimiter*> limiters_;
+    };
+}  // namespace
+
+namespace galaxy {
+    namespace transfer {
+
+        TransferOptions TransferOptions::FromFlags() {
+            TransferOptions options;
+            options.num_workers = std::max(1, absl::GetFlag(FLAGS_fs_transfer_num_worker));
+            options.cell_concurrency = std::max(1, absl::GetFlag(FLAGS_fs_transfer_cell_concurrency));
+            options.small_file_bytes = static_cast<int64_t>(absl::GetFlag(FLAGS_fs_transfer_small_file_kb)) * 1024;
+            options.max_batch_bytes = static_cast<int64_t>(absl::GetFlag(FLAGS_fs_transfer_batch_kb)) * 1024;
+            return options;
+        }
+
+        double TransferSummary::Throughput() const {
+            return elapsed_sec > 0 ? num_bytes / elapsed_sec : 0;
+        }
+
+        std::string TransferSummary::ToString() const {
+            std::ostringstream oss;
+            oss << "Transferred " << num_copied << "/" << num_files << " files (" << HumanBytes(num_bytes) << ") in "
+                << std::fixed << std::setprecision(1) << elapsed_sec << "s at " << HumanBytes(Throughput()) << "/s, "
+                << num_skipped << " skipped, " << num_failed << " failed.";
+            for (const auto& file : failed_files) {
+                oss << std::endl << "\tFailed: " << file;
+            }
+            return oss.str();
+        }
+
+        void CellLimiter::Acquire() {
+            std::unique_lock<std::mutex> lock(mu_);
+            cv_.wait(lock, [this] { return available_ > 0; });
+            available_--;
+        }
+
+        void CellLimiter::Release() {
+            {
+                std::lock_guard<std::mutex> lock(mu_);
+                available_++;
+            }
+            cv_.notify_one();
+        }
+
+        TransferEngine::TransferEngine(const TransferOptions& options) : options_(options) {
+            options_.num_workers = std::max(1, options_.num_workers);
+            options_.cell_concurrency = std::max(1, options_.cell_concurrency);
+        }
+
+        std::vector<TransferTask> TransferEngine::Plan(const std::string& from_path, const std::string& to_path) {
+            FileAnalyzerResult from_result = galaxy::util::InitClient(from_path);
+            std::string source_path = from_result.is_shared() ? galaxy::util::BroadcastSharedPath(from_path, {}).at(0) : from_path;
+            Endpoint source = ResolveEndpoint(source_path);
+
+            // Relative name to size. An empty listing means from_path is a single file.
+            std::map<std::string, int64_t> files;
+            bool single_file = false;
+            for (const auto& sub_file : client::ListFilesInDirRecursive(source_path)) {
+                files[RelativeName(sub_file.first, source)] = galaxy::util::ParseAttrSize(sub_file.second);
+            }
+            if (files.empty()) {
+                single_file = true;
+                files[""] = galaxy::util::ParseAttrSize(client::GetAttr(source_path));
+            }
+
+            // A shared destination is expanded into one destination per cell, so that every cell is
+            // written in parallel under its own limiter instead of broadcasting file by file.
+            std::vector<Endpoint> destinations;
+            FileAnalyzerResult to_result = galaxy::util::InitClient(to_path);
+            if (to_result.is_shared()) {
+                for (const auto& path : galaxy::util::BroadcastSharedPath(to_path, client::ListCells())) {
+                    destinations.push_back(ResolveEndpoint(path));
+                }
+            } else {
+                destinations.push_back(ResolveEndpoint(to_path));
+            }
+
+            std::vector<Endpoint> endpoints(destinations);
+            endpoints.push_back(source);
+            for (const auto& endpoint : endpoints) {
+                if (!endpoint.cell.empty() && limiters_.find(endpoint.cell) == limiters_.end()) {
+                    limiters_[endpoint.cell] = std::make_unique<CellLimiter>(options_.cell_concurrency);
+                }
+            }
+
+            std::vector<TransferTask> tasks;
+            for (const auto& destination : destinations) {
+                // Fetch the existing destination files with a single listing instead of one FileOrDie per file.
+                std::set<std::string> existing;
+                if (!options_.overwrite) {
+                    if (single_file) {
+                        if (!client::FileOrDie(destination.path).empty()) {
+                            existing.insert("");
+                        }
+                    } else {
+                        for (const auto& sub_file : client::ListFilesInDirRecursive(destination.path)) {
+                            existing.insert(RelativeName(sub_file.first, destination));
+                        }
+                    }
+                }
+
+                std::set<std::string> cells;
+                if (!source.cell.empty()) {
+                    cells.insert(source.cell);
+                }
+                if (!destination.cell.empty()) {
+                    cells.insert(destination.cell);
+                }
+
+                TransferTask batch;
+                batch.batched = true;
+                batch.cells.assign(cells.begin(), cells.end());
+                for (const auto& file : files) {
+                    num_total_++;
+                    if (existing.find(file.first) != existing.end()) {
+                        VLOG(1) << destination.path + file.first << " already exists. Pass.";
+                        num_skipped_++;
+                        continue;
+                    }
+                    std::pair<std::string, std::string> from_to = {source.path + file.first, destination.path + file.first};
+                    int64_t size = std::max<int64_t>(file.second, 0);
+                    num_total_bytes_ += size;
+                    // Files with unknown size go through the streaming path as well.
+                    if (file.second < 0 || size >= options_.small_file_bytes) {
+                        TransferTask task;
+                        task.files.push_back(from_to);
+                        task.cells = batch.cells;
+                        task.num_bytes = file.second;
+                        tasks.push_back(std::move(task));
+                        continue;
+                    }
+                    if (!batch.files.empty() && (batch.num_bytes + size > options_.max_batch_bytes ||
+                                                 static_cast<int>(batch.files.size()) >= options_.max_batch_files)) {
+                        tasks.push_back(batch);
+                        batch.files.clear();
+                        batch.num_bytes = 0;
+                    }
+                    batch.files.push_back(from_to);
+                    batch.num_bytes += size;
+                }
+                if (!batch.files.empty()) {
+                    tasks.push_back(batch);
+                }
+            }
+            return tasks;
+        }
+
+        bool TransferEngine::PopTask(size_t worker_id, TransferTask& task) {
+            {
+                std::lock_guard<std::mutex> lock(*queue_mus_[worker_id]);
+                if (!queues_[worker_id].empty()) {
+                    task = std::move(queues_[worker_id].back());
+                    queues_[worker_id].pop_back();
+                    return true;
+                }
+            }
+            // Own queue is drained, steal from the front of the other queues.
+            for (size_t i = 1; i < queues_.size(); i++) {
+                size_t victim = (worker_id + i) % queues_.size();
+                std::lock_guard<std::mutex> lock(*queue_mus_[victim]);
+                if (!queues_[victim].empty()) {
+                    task = std::move(queues_[victim].front());
+                    queues_[victim].pop_front();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void TransferEngine::WorkerLoop(size_t worker_id) {
+            TransferTask task;
+            // All tasks are known upfront, so a worker is done once every queue is empty.
+            while (PopTask(worker_id, task)) {
+                Execute(task);
+            }
+        }
+
+        void TransferEngine::Execute(const TransferTask& task) {
+            std::vector<CellLimiter*> limiters;
+            for (const auto& cell : task.cells) {
+                limiters.push_back(limiters_.at(cell).get());
+            }
+            LimiterGuard guard(limiters);
+            if (task.batched) {
+                ExecuteBatch(task);
+                return;
+            }
+            const auto& from_to = task.files.front();
+            if (ExecuteSingle(from_to.first, from_to.second)) {
+                num_bytes_ += std::max<int64_t>(task.num_bytes, 0);
+            } else {
+                MarkFailed(from_to.first);
+            }
+            num_done_++;
+        }
+
+        void TransferEngine::ExecuteBatch(const TransferTask& task) {
+            std::vector<std::string> from_files;
+            for (const auto& from_to : task.files) {
+                from_files.push_back(from_to.first);
+            }
+            std::map<std::string, std::string> data_map;
+            try {
+                data_map = client::ReadMultiple(from_files);
+            }
+            catch (std::string errorMsg)
+            {
+                LOG(ERROR) << errorMsg;
+            }
+
+            std::map<std::string, std::string> path_data_map;
+            std::vector<std::pair<std::string, std::string>> written;
+            std::vector<std::pair<std::string, std::string>> leftovers;
+            for (const auto& from_to : task.files) {
+                auto it = data_map.find(from_to.first);
+                if (it == data_map.end()) {
+                    leftovers.push_back(from_to);
+                    continue;
+                }
+                written.push_back(from_to);
+                path_data_map[from_to.second] = std::move(it->second);
+            }
+            if (!path_data_map.empty()) {
+                try {
+                    client::WriteMultiple(path_data_map, "w");
+                }
+                catch (std::string errorMsg)
+                {
+                    LOG(ERROR) << errorMsg;
+                }
+            }
+            // WriteMultiple only logs on failure, so every destination is confirmed to hold the size that was read,
+            // with all the GetAttr calls in flight at once. Files that are not go one by one like the missing ones.
+            std::vector<std::future<absl::StatusOr<std::string>>> attrs;
+            for (const auto& from_to : written) {
+                attrs.push_back(client::async::GetAttr(from_to.second));
+            }
+            for (size_t i = 0; i < written.size(); ++i) {
+                absl::StatusOr<std::string> attr = attrs[i].get();
+                int64_t size = static_cast<int64_t>(path_data_map[written[i].second].size());
+                if (attr.ok() && galaxy::util::ParseAttrSize(*attr) == size) {
+                    num_bytes_ += size;
+                    num_done_++;
+                } else {
+                    LOG(WARNING) << "Batched copy of " << written[i].first << " to " << written[i].second
+                                 << " could not be confirmed, copying it alone.";
+                    leftovers.push_back(written[i]);
+                }
+            }
+            // Files missing from the batched read or write are retried one by one.
+            for (const auto& from_to : leftovers) {
+                if (!ExecuteSingle(from_to.first, from_to.second)) {
+                    MarkFailed(from_to.first);
+                }
+                num_done_++;
+            }
+        }
+
+        bool TransferEngine::ExecuteSingle(const std::string& from_file, const std::string& to_file) {
+            try {
+                client::CopyFile(from_file, to_file);
+            }
+            catch (std::string errorMsg)
+            {
+                LOG(ERROR) << errorMsg;
+                return false;
+            }
+            // CopyFile only logs on failure, so confirm the destination landed with the expected size.
+            int64_t from_size = galaxy::util::ParseAttrSize(client::GetAttr(from_file));
+            int64_t to_size = galaxy::util::ParseAttrSize(client::GetAttr(to_file));
+            return to_size >= 0 && to_size == from_size;
+        }
+
+        void TransferEngine::MarkFailed(const std::string& file) {
+            num_failed_++;
+            std::lock_guard<std::mutex> lock(failed_mu_);
+            failed_files_.push_back(file);
+        }
+
+        void TransferEngine::ReportProgress(bool final_report) {
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+            double throughput = elapsed > 0 ? num_bytes_ / elapsed : 0;
+            fprintf(stderr, "\r[transfer] %lld/%lld files, %s/%s, %s/s, %lld failed",
+                    static_cast<long long>(num_done_ + num_skipped_), static_cast<long long>(num_total_),
+                    HumanBytes(num_bytes_).c_str(), HumanBytes(num_total_bytes_).c_str(),
+                    HumanBytes(throughput).c_str(), static_cast<long long>(num_failed_.load()));
+            if (final_report) {
+                fprintf(stderr, "\n");
+            }
+            fflush(stderr);
+        }
+
+        void TransferEngine::ProgressLoop() {
+            std::unique_lock<std::mutex> lock(progress_mu_);
+            while (!progress_cv_.wait_for(lock, std::chrono::seconds(1), [this] { return finished_; })) {
+                ReportProgress(false);
+            }
+            ReportProgress(true);
+        }
+
+        void TransferEngine::Run(std::vector<TransferTask>& tasks) {
+            size_t num_workers = std::min<size_t>(options_.num_workers, std::max<size_t>(tasks.size(), 1));
+            queues_.assign(num_workers, std::deque<TransferTask>());
+            queue_mus_.clear();
+            for (size_t i = 0; i < num_workers; i++) {
+                queue_mus_.push_back(std::make_unique<std::mutex>());
+            }
+            // Large files first, so they start early and the small batches fill in the gaps.
+            std::stable_sort(tasks.begin(), tasks.end(), [](const TransferTask& a, const TransferTask& b) {
+                return a.num_bytes > b.num_bytes;
+            });
+            for (size_t i = 0; i < tasks.size(); i++) {
+                queues_[i % num_workers].push_front(std::move(tasks[i]));
+            }
+
+            std::thread progress;
+            if (options_.show_progress) {
+                progress = std::thread(&TransferEngine::ProgressLoop, this);
+            }
+            std::vector<std::thread> workers;
+            for (size_t i = 0; i < num_workers; i++) {
+                workers.push_back(std::thread(&TransferEngine::WorkerLoop, this, i));
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            if (progress.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock(progress_mu_);
+                    finished_ = true;
+                }
+                progress_cv_.notify_all();
+                progress.join();
+            }
+        }
+
+        TransferSummary TransferEngine::CopyDir(const std::string& from_path, const std::string& to_path) {
+            start_ = std::chrono::steady_clock::now();
+            std::vector<TransferTask> tasks = Plan(from_path, to_path);
+            Run(tasks);
+
+            TransferSummary summary;
+            summary.num_files = num_total_;
+            summary.num_skipped = num_skipped_;
+            summary.num_failed = num_failed_;
+            summary.num_copied = num_done_ - num_failed_;
+            summary.num_bytes = num_bytes_;
+            summary.elapsed_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+            summary.failed_files = failed_files_;
+            return summary;
+        }
+
+        TransferSummary CopyDir(const std::string& from_path, const std::string& to_path, const TransferOptions& options) {
+            TransferEngine engine(options);
+            return engine.CopyDir(from_path, to_path);
+        }
+
+        TransferSummary MoveDir(const std::string& from_path, const std::string& to_path, const TransferOptions& options) {
+            TransferSummary summary = CopyDir(from_path, to_path, options);
+            if (summary.num_failed > 0) {
+                LOG(ERROR) << "Keeping " << from_path << " since " << summary.num_failed << " files failed to move.";
+                return summary;
+            }
+            client::RmDirRecursive(from_path);
+            client::RmFile(from_path);
+            return summary;
+        }
+    }  // namespace transfer
+}  // namespace galaxy
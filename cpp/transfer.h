@@ -0,0 +1,120 @@
+#ifndef CPP_GALAXY_TRANSFER_H
+#define CPP_GALAXY_TRANSFER_H
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace galaxy {
+    namespace transfer {
+        struct TransferOptions {
+            // Number of worker threads. Workers steal from each other once their own queue is drained.
+            int num_workers = 16;
+            // Maximum number of in-flight tasks touching the same remote cell.
+            int cell_concurrency = 8;
+            // Files smaller than this are grouped into ReadMultiple/WriteMultiple batches.
+            int64_t small_file_bytes = 1 << 20;
+            // Upper bounds of a single batch.
+            int64_t max_batch_bytes = 16 << 20;
+            int max_batch_files = 256;
+            bool overwrite = false;
+            // Prints a live progress line to stderr while transferring.
+            bool show_progress = false;
+
+            // Options initialized from the fs_transfer_* flags.
+            static TransferOptions FromFlags();
+        };
+
+        struct TransferSummary {
+            int64_t num_files = 0;
+            int64_t num_copied = 0;
+            int64_t num_skipped = 0;
+            int64_t num_failed = 0;
+            int64_t num_bytes = 0;
+            double elapsed_sec = 0;
+            std::vector<std::string> failed_files;
+
+            double Throughput() const;
+            std::string ToString() const;
+        };
+
+        // A unit of work: either a batch of small files or a single large file.
+        struct TransferTask {
+            std::vector<std::pair<std::string, std::string>> files;
+            // Remote cells touched by this task, sorted so limiters are always acquired in the same order.
+            std::vector<std::string> cells;
+            int64_t num_bytes = 0;
+            bool batched = false;
+        };
+
+        // Bounded counting semaphore used to cap the concurrency against a single cell.
+        class CellLimiter {
+        public:
+            explicit CellLimiter(int limit) : available_(limit) {}
+            void Acquire();
+            void Release();
+
+        private:
+            std::mutex mu_;
+            std::condition_variable cv_;
+            int available_;
+        };
+
+        // Fixed pool of workers with one deque per worker. A worker pops from the back of its own deque
+        // and steals from the front of the others, so a few slow large files do not stall the rest.
+        class TransferEngine {
+        public:
+            explicit TransferEngine(const TransferOptions& options);
+            TransferEngine(const TransferEngine&) = delete;
+
+            TransferSummary CopyDir(const std::string& from_path, const std::string& to_path);
+
+        private:
+            std::vector<TransferTask> Plan(const std::string& from_path, const std::string& to_path);
+            void Run(std::vector<TransferTask>& tasks);
+            void WorkerLoop(size_t worker_id);
+            bool PopTask(size_t worker_id, TransferTask& task);
+            void Execute(const TransferTask& task);
+            void ExecuteBatch(const TransferTask& task);
+            bool ExecuteSingle(const std::string& from_file, const std::string& to_file);
+            void ProgressLoop();
+            void ReportProgress(bool final_report);
+            void MarkFailed(const std::string& file);
+
+            TransferOptions options_;
+            std::map<std::string, std::unique_ptr<CellLimiter>> limiters_;
+
+            std::vector<std::deque<TransferTask>> queues_;
+            std::vector<std::unique_ptr<std::mutex>> queue_mus_;
+
+            std::atomic<int64_t> num_done_{0};
+            std::atomic<int64_t> num_failed_{0};
+            std::atomic<int64_t> num_bytes_{0};
+            int64_t num_total_ = 0;
+            int64_t num_skipped_ = 0;
+            int64_t num_total_bytes_ = 0;
+            std::mutex failed_mu_;
+            std::vector<std::string> failed_files_;
+            std::chrono::steady_clock::time_point start_;
+            bool finished_ = false;
+            std::mutex progress_mu_;
+            std::condition_variable progress_cv_;
+        };
+
+        // Copies every file under from_path to to_path. If from_path is a file, copies that single file.
+        TransferSummary CopyDir(const std::string& from_path, const std::string& to_path, const TransferOptions& options);
+        // Same as CopyDir, and removes from_path once every file has been copied successfully.
+        TransferSummary MoveDir(const std::string& from_path, const std::string& to_path, const TransferOptions& options);
+    }  // namespace transfer
+} // namespace galaxy
+
+#endif // CPP_GALAXY_TRANSFER_H
@@ -0,0 +1,180 @@
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "cpp/core/galaxy_test_cells.h"
+#include "cpp/transfer.h"
+
+namespace {
+    using galaxy::TestCells;
+    using galaxy::transfer::CellLimiter;
+    using galaxy::transfer::TransferOptions;
+    using galaxy::transfer::TransferSummary;
+
+    void WriteFile(const std::string& path, const std::string& data) {
+        std::ofstream file(path);
+        file << data;
+    }
+
+    std::string ReadFile(const std::string& path) {
+        std::ifstream file(path);
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        return buffer.str();
+    }
+
+    bool Exists(const std::string& path) {
+        struct stat statbuf;
+        return stat(path.c_str(), &statbuf) == 0;
+    }
+
+    // Small files batched together and large ones copied alone, under a nested directory.
+    std::vector<std::pair<std::string, std::string>> MakeTree(const std::string& dir) {
+        mkdir(dir.c_str(), 0777);
+        mkdir((dir + "/sub").c_str(), 0777);
+        std::vector<std::pair<std::string, std::string>> files;
+        for (int i = 0; i < 20; i++) {
+            files.push_back({(i % 2 == 0 ? "/small_" : "/sub/small_") + std::to_string(i), std::string(100 + i, 'a' + i)});
+        }
+        for (int i = 0; i < 3; i++) {
+            files.push_back({"/sub/large_" + std::to_string(i), std::string(10000 + i, 'A' + i)});
+        }
+        for (const auto& file : files) {
+            WriteFile(dir + file.first, file.second);
+        }
+        return files;
+    }
+
+    TransferOptions TestOptions() {
+        TransferOptions options;
+        options.num_workers = 4;
+        options.cell_concurrency = 2;
+        options.small_file_bytes = 1024;
+        options.max_batch_bytes = 1000;
+        options.max_batch_files = 4;
+        return options;
+    }
+
+    int64_t TotalBytes(const std::vector<std::pair<std::string, std::string>>& files) {
+        int64_t num_bytes = 0;
+        for (const auto& file : files) {
+            num_bytes += file.second.size();
+        }
+        return num_bytes;
+    }
+
+    TEST(TransferTest, CopiesBetweenCells) {
+        TestCells cells("transfer_copy", {"aa", "bb"});
+        auto files = MakeTree(cells.Root("aa") + "/src");
+        TransferSummary summary = galaxy::transfer::CopyDir("/galaxy/aa-d/src", "/galaxy/bb-d/dst", TestOptions());
+        EXPECT_EQ(summary.num_files, files.size());
+        EXPECT_EQ(summary.num_copied, files.size());
+        EXPECT_EQ(summary.num_skipped, 0);
+        EXPECT_EQ(summary.num_failed, 0);
+        EXPECT_TRUE(summary.failed_files.empty());
+        EXPECT_EQ(summary.num_bytes, TotalBytes(files));
+        for (const auto& file : files) {
+            EXPECT_EQ(ReadFile(cells.Root("bb") + "/dst" + file.first), file.second) << file.first;
+        }
+    }
+
+    TEST(TransferTest, CopiesFromLocal) {
+        TestCells cells("transfer_local", {"aa"});
+        std::string local_dir = testing::TempDir() + "/transfer_local_src_" + std::to_string(getpid());
+        auto files = MakeTree(local_dir);
+        TransferSummary summary = galaxy::transfer::CopyDir(local_dir, "/galaxy/aa-d/dst", TestOptions());
+        EXPECT_EQ(summary.num_copied, files.size());
+        EXPECT_EQ(summary.num_failed, 0);
+        for (const auto& file : files) {
+            EXPECT_EQ(ReadFile(cells.Root("aa") + "/dst" + file.first), file.second) << file.first;
+        }
+    }
+
+    TEST(TransferTest, SkipsExistingFiles) {
+        TestCells cells("transfer_skip", {"aa", "bb"});
+        auto files = MakeTree(cells.Root("aa") + "/src");
+        mkdir((cells.Root("bb") + "/dst").c_str(), 0777);
+        mkdir((cells.Root("bb") + "/dst/sub").c_str(), 0777);
+        WriteFile(cells.Root("bb") + "/dst" + files[0].first, "kept");
+        WriteFile(cells.Root("bb") + "/dst" + files.back().first, "kept");
+
+        TransferSummary summary = galaxy::transfer::CopyDir("/galaxy/aa-d/src", "/galaxy/bb-d/dst", TestOptions());
+        EXPECT_EQ(summary.num_files, files.size());
+        EXPECT_EQ(summary.num_skipped, 2);
+        EXPECT_EQ(summary.num_copied, files.size() - 2);
+        EXPECT_EQ(summary.num_failed, 0);
+        EXPECT_EQ(ReadFile(cells.Root("bb") + "/dst" + files[0].first), "kept");
+        EXPECT_EQ(ReadFile(cells.Root("bb") + "/dst" + files.back().first), "kept");
+        EXPECT_EQ(ReadFile(cells.Root("bb") + "/dst" + files[1].first), files[1].second);
+
+        TransferOptions options = TestOptions();
+        options.overwrite = true;
+        summary = galaxy::transfer::CopyDir("/galaxy/aa-d/src", "/galaxy/bb-d/dst", options);
+        EXPECT_EQ(summary.num_skipped, 0);
+        EXPECT_EQ(summary.num_copied, files.size());
+        EXPECT_EQ(ReadFile(cells.Root("bb") + "/dst" + files[0].first), files[0].second);
+        EXPECT_EQ(ReadFile(cells.Root("bb") + "/dst" + files.back().first), files.back().second);
+    }
+
+    TEST(TransferTest, CopiesSingleFile) {
+        TestCells cells("transfer_single", {"aa", "bb"});
+        WriteFile(cells.Root("aa") + "/file", "data");
+        TransferSummary summary = galaxy::transfer::CopyDir("/galaxy/aa-d/file", "/galaxy/bb-d/file", TestOptions());
+        EXPECT_EQ(summary.num_files, 1);
+        EXPECT_EQ(summary.num_copied, 1);
+        EXPECT_EQ(ReadFile(cells.Root("bb") + "/file"), "data");
+    }
+
+    TEST(TransferTest, MoveDirRemovesSource) {
+        TestCells cells("transfer_move", {"aa", "bb"});
+        auto files = MakeTree(cells.Root("aa") + "/src");
+        TransferSummary summary = galaxy::transfer::MoveDir("/galaxy/aa-d/src", "/galaxy/bb-d/dst", TestOptions());
+        EXPECT_EQ(summary.num_copied, files.size());
+        EXPECT_EQ(summary.num_failed, 0);
+        EXPECT_FALSE(Exists(cells.Root("aa") + "/src"));
+        for (const auto& file : files) {
+            EXPECT_EQ(ReadFile(cells.Root("bb") + "/dst" + file.first), file.second) << file.first;
+        }
+    }
+
+    TEST(TransferTest, FailedFilesKeepSource) {
+        galaxy::TestCellsOptions options;
+        options.down = {"bb"};
+        TestCells cells("transfer_failed", {"aa", "bb"}, options);
+        auto files = MakeTree(cells.Root("aa") + "/src");
+        TransferSummary summary = galaxy::transfer::MoveDir("/galaxy/aa-d/src", "/galaxy/bb-d/dst", TestOptions());
+        EXPECT_EQ(summary.num_failed, files.size());
+        EXPECT_EQ(summary.failed_files.size(), files.size());
+        EXPECT_EQ(summary.num_copied, 0);
+        EXPECT_TRUE(Exists(cells.Root("aa") + "/src" + files[0].first));
+    }
+
+    TEST(CellLimiterTest, CapsConcurrency) {
+        CellLimiter limiter(2);
+        std::atomic<int> running{0};
+        std::atomic<int> max_running{0};
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 8; i++) {
+            threads.emplace_back([&]() {
+                limiter.Acquire();
+                int now = ++running;
+                int max = max_running.load();
+                while (now > max && !max_running.compare_exchange_weak(max, now)) {
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                running--;
+                limiter.Release();
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        EXPECT_EQ(max_running.load(), 2);
+    }
+}  // namespace
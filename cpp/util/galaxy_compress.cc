@@ -0,0 +1,85 @@
+#include <algorithm>
+
+#include "cpp/util/galaxy_compress.h"
+#include "cpp/internal/galaxy_const.h"
+#include "zlib.h"
+
+using galaxy_schema::ChunkEncoding;
+using galaxy_schema::CompressionType;
+
+namespace {
+    bool ZlibCompress(const char* data, size_t size, std::string* compressed) {
+        uLongf compressed_size = compressBound(size);
+        compressed->resize(compressed_size);
+        // The fastest level: payloads are compressed on every call, and most of the gain is in the first level.
+        int ret = compress2(reinterpret_cast<Bytef*>(&(*compressed)[0]), &compressed_size,
+                            reinterpret_cast<const Bytef*>(data), size, Z_BEST_SPEED);
+        if (ret != Z_OK) {
+            return false;
+        }
+        compressed->resize(compressed_size);
+        return true;
+    }
+}  // namespace
+
+bool galaxy::util::IsWorthCompressing(const std::string& data, int64_t min_bytes) {
+    if (data.empty() || static_cast<int64_t>(data.size()) < min_bytes) {
+        return false;
+    }
+    // Probe the head and the middle of the data, which catches both compressed formats and mixed content.
+    const size_t probe_size = galaxy::constant::kCompressionProbeSize;
+    std::string sample;
+    if (data.size() <= 2 * probe_size) {
+        sample = data;
+    } else {
+        sample = data.substr(0, probe_size) + data.substr(data.size() / 2, probe_size);
+    }
+    std::string compressed;
+    if (!ZlibCompress(sample.data(), sample.size(), &compressed)) {
+        return false;
+    }
+    return compressed.size() <= sample.size() * (1 - galaxy::constant::kCompressionMinSaving);
+}
+
+bool galaxy::util::CompressPayload(const std::string& data, CompressionType type, int64_t min_bytes,
+                                   std::string* compressed, ChunkEncoding* encoding) {
+    if (type == CompressionType::UNCOMPRESSED || !IsWorthCompressing(data, min_bytes)) {
+        return false;
+    }
+    std::string buffer;
+    if (!ZlibCompress(data.data(), data.size(), &buffer) || buffer.size() >= data.size()) {
+        return false;
+    }
+    compressed->swap(buffer);
+    encoding->set_compression(type);
+    encoding->set_raw_size(data.size());
+    return true;
+}
+
+absl::Status galaxy::util::DecompressPayload(const std::string& compressed, const ChunkEncoding& encoding,
+                                             int64_t max_size, std::string* data) {
+    switch (encoding.compression()) {
+        case CompressionType::UNCOMPRESSED:
+            *data = compressed;
+            return absl::OkStatus();
+        case CompressionType::ZLIB: {
+            if (encoding.raw_size() < 0) {
+                return absl::InvalidArgumentError("Invalid raw size for a compressed payload.");
+            }
+            if (encoding.raw_size() > max_size) {
+                return absl::InvalidArgumentError("Raw size " + std::to_string(encoding.raw_size()) +
+                                                  " of a compressed payload is over the limit of " + std::to_string(max_size) + ".");
+            }
+            uLongf raw_size = encoding.raw_size();
+            data->resize(raw_size);
+            int ret = uncompress(reinterpret_cast<Bytef*>(&(*data)[0]), &raw_size,
+                                 reinterpret_cast<const Bytef*>(compressed.data()), compressed.size());
+            if (ret != Z_OK || raw_size != static_cast<uLongf>(encoding.raw_size())) {
+                return absl::DataLossError("Failed to decompress a zlib payload.");
+            }
+            return absl::OkStatus();
+        }
+        default:
+            return absl::InvalidArgumentError("Unsupported compression " + std::to_string(encoding.compression()) + ".");
+    }
+}
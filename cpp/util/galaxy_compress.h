@@ -0,0 +1,27 @@
+#ifndef CPP_UTIL_GALAXY_COMPRESS_H_
+#define CPP_UTIL_GALAXY_COMPRESS_H_
+
+#include <cstdint>
+#include <string>
+
+#include "absl/status/status.h"
+#include "schema/fileserver.pb.h"
+
+namespace galaxy {
+    namespace util {
+        // Whether data is at least min_bytes and a sample of it shrinks by kCompressionMinSaving, so that
+        // already compressed data (images, archives, ...) is sent as is.
+        bool IsWorthCompressing(const std::string& data, int64_t min_bytes);
+
+        // Compresses data into compressed and fills encoding, if data is worth compressing with type.
+        // Returns false, leaving both untouched, otherwise.
+        bool CompressPayload(const std::string& data, galaxy_schema::CompressionType type, int64_t min_bytes,
+                             std::string* compressed, galaxy_schema::ChunkEncoding* encoding);
+        // Reverses CompressPayload. Payloads claiming more than max_size raw bytes are rejected before anything is
+        // allocated for them.
+        absl::Status DecompressPayload(const std::string& compressed, const galaxy_schema::ChunkEncoding& encoding,
+                                       int64_t max_size, std::string* data);
+    }  // namespace util
+} // namespace galaxy
+
+#endif  // CPP_UTIL_GALAXY_COMPRESS_H_
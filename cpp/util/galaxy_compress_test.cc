@@ -0,0 +1,84 @@
+#include <random>
+#include <string>
+#include <gtest/gtest.h>
+#include "cpp/util/galaxy_compress.h"
+
+namespace {
+    using galaxy_schema::ChunkEncoding;
+    using galaxy_schema::CompressionType;
+
+    std::string RandomData(size_t size) {
+        std::mt19937 rng(42);
+        std::string data(size, '\0');
+        for (auto& c : data) {
+            c = static_cast<char>(rng());
+        }
+        return data;
+    }
+
+    TEST(GalaxyCompressTest, RoundTrip) {
+        std::string data;
+        for (int i = 0; i < 10000; i++) {
+            data += "line " + std::to_string(i % 100) + "\n";
+        }
+        std::string compressed;
+        ChunkEncoding encoding;
+        ASSERT_TRUE(galaxy::util::CompressPayload(data, CompressionType::ZLIB, 1024, &compressed, &encoding));
+        EXPECT_LT(compressed.size(), data.size());
+        EXPECT_EQ(encoding.compression(), CompressionType::ZLIB);
+        EXPECT_EQ(encoding.raw_size(), data.size());
+
+        std::string output;
+        EXPECT_TRUE(galaxy::util::DecompressPayload(compressed, encoding, data.size(), &output).ok());
+        EXPECT_EQ(output, data);
+    }
+
+    TEST(GalaxyCompressTest, SkipsPayloadsNotWorthIt) {
+        std::string compressed;
+        ChunkEncoding encoding;
+        std::string text(100000, 'a');
+        EXPECT_FALSE(galaxy::util::CompressPayload(text, CompressionType::UNCOMPRESSED, 0, &compressed, &encoding));
+        EXPECT_FALSE(galaxy::util::CompressPayload(text, CompressionType::ZLIB, text.size() + 1, &compressed, &encoding));
+        EXPECT_FALSE(galaxy::util::CompressPayload(RandomData(100000), CompressionType::ZLIB, 0, &compressed, &encoding));
+        EXPECT_TRUE(compressed.empty());
+        EXPECT_EQ(encoding.compression(), CompressionType::UNCOMPRESSED);
+
+        EXPECT_TRUE(galaxy::util::IsWorthCompressing(text, 0));
+        EXPECT_FALSE(galaxy::util::IsWorthCompressing("", 0));
+        // Compressible past a random head, which the probe of the middle catches.
+        std::string mixed = RandomData(4096) + std::string(100000, 'a');
+        EXPECT_TRUE(galaxy::util::IsWorthCompressing(mixed, 0));
+    }
+
+    TEST(GalaxyCompressTest, UncompressedPassesThrough) {
+        std::string output;
+        EXPECT_TRUE(galaxy::util::DecompressPayload("raw", ChunkEncoding(), 0, &output).ok());
+        EXPECT_EQ(output, "raw");
+    }
+
+    TEST(GalaxyCompressTest, RejectsBadPayloads) {
+        std::string data(100000, 'a');
+        std::string compressed;
+        ChunkEncoding encoding;
+        ASSERT_TRUE(galaxy::util::CompressPayload(data, CompressionType::ZLIB, 0, &compressed, &encoding));
+        std::string output;
+
+        // Over the limit, rejected before anything is allocated for it.
+        EXPECT_TRUE(absl::IsInvalidArgument(galaxy::util::DecompressPayload(compressed, encoding, data.size() - 1, &output)));
+        EXPECT_TRUE(output.empty());
+
+        ChunkEncoding wrong_size = encoding;
+        wrong_size.set_raw_size(data.size() - 1);
+        EXPECT_TRUE(absl::IsDataLoss(galaxy::util::DecompressPayload(compressed, wrong_size, data.size(), &output)));
+        wrong_size.set_raw_size(-1);
+        EXPECT_TRUE(absl::IsInvalidArgument(galaxy::util::DecompressPayload(compressed, wrong_size, data.size(), &output)));
+
+        EXPECT_TRUE(absl::IsDataLoss(galaxy::util::DecompressPayload(compressed.substr(0, compressed.size() / 2), encoding,
+                                                                     data.size(), &output)));
+
+        ChunkEncoding unknown;
+        unknown.set_compression(static_cast<CompressionType>(7));
+        EXPECT_TRUE(absl::IsInvalidArgument(galaxy::util::DecompressPayload(compressed, unknown, data.size(), &output)));
+    }
+
+}  // namespace
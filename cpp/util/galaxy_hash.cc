@@ -0,0 +1,172 @@
+#include <cstring>
+#include <fstream>
+#include <vector>
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+#include "cpp/util/galaxy_hash.h"
+#include "cpp/internal/galaxy_const.h"
+#include "xxhash.h"
+
+namespace {
+    std::string ToHex(const XXH128_hash_t& hash) {
+        static const char kDigits[] = "0123456789abcdef";
+        std::string hex(32, '0');
+        for (int i = 0; i < 16; i++) {
+            uint64_t word = i < 8 ? hash.high64 : hash.low64;
+            int shift = (7 - i % 8) * 8;
+            unsigned char byte = (word >> shift) & 0xff;
+            hex[2 * i] = kDigits[byte >> 4];
+            hex[2 * i + 1] = kDigits[byte & 0xf];
+        }
+        return hex;
+    }
+
+    // Reflected CRC32C polynomial.
+    constexpr uint32_t kCrc32cPoly = 0x82f63b78;
+
+    struct Crc32cTable {
+        uint32_t table[8][256];
+
+        Crc32cTable() {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t crc = i;
+                for (int j = 0; j < 8; j++) {
+                    crc = (crc >> 1) ^ (crc & 1 ? kCrc32cPoly : 0);
+                }
+                table[0][i] = crc;
+            }
+            for (uint32_t i = 0; i < 256; i++) {
+                for (int k = 1; k < 8; k++) {
+                    table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xff];
+                }
+            }
+        }
+    };
+
+    // Slicing-by-8: eight table lookups per 8 bytes.
+    uint32_t Crc32cSoftware(const unsigned char* data, size_t size, uint32_t crc) {
+        static const Crc32cTable kTable;
+        const auto& t = kTable.table;
+        while (size >= 8) {
+            uint64_t word;
+            memcpy(&word, data, 8);
+            word ^= crc;
+            crc = t[7][word & 0xff] ^ t[6][(word >> 8) & 0xff] ^ t[5][(word >> 16) & 0xff] ^
+                  t[4][(word >> 24) & 0xff] ^ t[3][(word >> 32) & 0xff] ^ t[2][(word >> 40) & 0xff] ^
+                  t[1][(word >> 48) & 0xff] ^ t[0][word >> 56];
+            data += 8;
+            size -= 8;
+        }
+        while (size-- > 0) {
+            crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xff];
+        }
+        return crc;
+    }
+
+#if defined(__x86_64__)
+    __attribute__((target("sse4.2")))
+    uint32_t Crc32cHardware(const unsigned char* data, size_t size, uint32_t crc) {
+        uint64_t crc64 = crc;
+        while (size >= 8) {
+            uint64_t word;
+            memcpy(&word, data, 8);
+            crc64 = _mm_crc32_u64(crc64, word);
+            data += 8;
+            size -= 8;
+        }
+        uint32_t crc32 = static_cast<uint32_t>(crc64);
+        while (size-- > 0) {
+            crc32 = _mm_crc32_u8(crc32, *data++);
+        }
+        return crc32;
+    }
+#endif
+
+    using Crc32cFn = uint32_t (*)(const unsigned char*, size_t, uint32_t);
+
+    Crc32cFn ResolveCrc32c() {
+#if defined(__x86_64__)
+        if (__builtin_cpu_supports("sse4.2")) {
+            return Crc32cHardware;
+        }
+#endif
+        return Crc32cSoftware;
+    }
+}  // namespace
+
+uint32_t galaxy::util::Crc32c(const char* data, size_t size, uint32_t crc) {
+    static const Crc32cFn kCrc32c = ResolveCrc32c();
+    return ~kCrc32c(reinterpret_cast<const unsigned char*>(data), size, ~crc);
+}
+
+uint32_t galaxy::util::Crc32c(const std::string& data, uint32_t crc) {
+    return Crc32c(data.data(), data.size(), crc);
+}
+
+absl::StatusOr<uint32_t> galaxy::util::FileCrc32c(const std::string& path) {
+    std::ifstream infile(path, std::ifstream::binary);
+    if (!infile.is_open()) {
+        return absl::NotFoundError("Cannot open " + path + " for checksum.");
+    }
+    uint32_t crc = 0;
+    std::vector<char> buffer(galaxy::constant::kChunkSize, 0);
+    while (infile) {
+        infile.read(buffer.data(), buffer.size());
+        crc = Crc32c(buffer.data(), infile.gcount(), crc);
+    }
+    if (infile.bad()) {
+        return absl::InternalError("Failed to read " + path + " for checksum.");
+    }
+    return crc;
+}
+
+std::string galaxy::util::HashData(const std::string& data) {
+    return ToHex(XXH3_128bits(data.data(), data.size()));
+}
+
+absl::StatusOr<std::string> galaxy::util::HashFile(const std::string& path) {
+    std::ifstream infile(path, std::ifstream::binary);
+    if (!infile.is_open()) {
+        return absl::NotFoundError("Cannot open " + path + " for hashing.");
+    }
+    StreamingHash hash;
+    std::vector<char> buffer(galaxy::constant::kChunkSize, 0);
+    while (infile) {
+        infile.read(buffer.data(), buffer.size());
+        hash.Update(std::string(buffer.data(), infile.gcount()));
+    }
+    if (infile.bad()) {
+        return absl::InternalError("Failed to read " + path + " for hashing.");
+    }
+    return hash.HexDigest();
+}
+
+bool galaxy::util::IsValidHash(const std::string& hash) {
+    if (hash.size() != 32) {
+        return false;
+    }
+    for (char c : hash) {
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+galaxy::util::StreamingHash::StreamingHash() : state_(XXH3_createState()) {
+    XXH3_128bits_reset(state_);
+}
+
+galaxy::util::StreamingHash::~StreamingHash() {
+    XXH3_freeState(state_);
+}
+
+void galaxy::util::StreamingHash::Update(const std::string& data) {
+    XXH3_128bits_update(state_, data.data(), data.size());
+}
+
+std::string galaxy::util::StreamingHash::HexDigest() const {
+    return ToHex(XXH3_128bits_digest(state_));
+}
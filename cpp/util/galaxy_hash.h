@@ -0,0 +1,43 @@
+#ifndef CPP_UTIL_GALAXY_HASH_H_
+#define CPP_UTIL_GALAXY_HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "absl/status/statusor.h"
+
+struct XXH3_state_s;
+
+namespace galaxy {
+    namespace util {
+        // Hex digest of the xxh3-128 hash of data. xxh3 uses the widest SIMD instructions the build targets, e.g. SSE2
+        // for a default x86-64 build, as xxh_x86dispatch.c is not built to pick them at run time.
+        std::string HashData(const std::string& data);
+        absl::StatusOr<std::string> HashFile(const std::string& path);
+        // Whether hash looks like a digest returned by HashData, i.e. is safe to use as a file name.
+        bool IsValidHash(const std::string& hash);
+
+        // CRC32C (Castagnoli) of data, continuing from crc so that chunks can be checksummed incrementally.
+        // Uses the SSE4.2 crc32 instruction when the CPU supports it, and a table-driven fallback otherwise.
+        uint32_t Crc32c(const char* data, size_t size, uint32_t crc = 0);
+        uint32_t Crc32c(const std::string& data, uint32_t crc = 0);
+        absl::StatusOr<uint32_t> FileCrc32c(const std::string& path);
+
+        // Incremental xxh3-128 hash, e.g. over the chunks of a CopyFile stream.
+        class StreamingHash {
+        public:
+            StreamingHash();
+            ~StreamingHash();
+            StreamingHash(const StreamingHash&) = delete;
+
+            void Update(const std::string& data);
+            std::string HexDigest() const;
+
+        private:
+            XXH3_state_s* state_;
+        };
+    }  // namespace util
+} // namespace galaxy
+
+#endif  // CPP_UTIL_GALAXY_HASH_H_
@@ -0,0 +1,59 @@
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "cpp/util/galaxy_hash.h"
+
+namespace {
+
+    TEST(GalaxyHashTest, Crc32cKnownValues) {
+        EXPECT_EQ(galaxy::util::Crc32c(""), 0);
+        EXPECT_EQ(galaxy::util::Crc32c("123456789"), 0xe3069283);
+        EXPECT_EQ(galaxy::util::Crc32c(std::string(32, '\0')), 0x8a9136aa);
+        EXPECT_EQ(galaxy::util::Crc32c(std::string(32, '\xff')), 0x62a8ab43);
+    }
+
+    TEST(GalaxyHashTest, Crc32cIncremental) {
+        std::string data;
+        for (int i = 0; i < 1000; i++) {
+            data.push_back(static_cast<char>(i * 31));
+        }
+        uint32_t whole = galaxy::util::Crc32c(data);
+        // Split at every offset, so that both halves start at any alignment and end with any tail.
+        for (size_t split = 0; split <= 17; split++) {
+            uint32_t crc = galaxy::util::Crc32c(data.data(), split);
+            EXPECT_EQ(galaxy::util::Crc32c(data.data() + split, data.size() - split, crc), whole);
+        }
+        EXPECT_EQ(galaxy::util::Crc32c(data.substr(500), galaxy::util::Crc32c(data.substr(0, 500))), whole);
+    }
+
+    TEST(GalaxyHashTest, FileCrc32c) {
+        std::string path = absl::StrCat(testing::TempDir(), "/galaxy_hash_test_", getpid());
+        // Larger than a chunk, so the file is checksummed in several reads.
+        std::string data(3 * 1024 * 1024 + 7, 'x');
+        std::ofstream(path, std::ios::binary) << data;
+        auto crc = galaxy::util::FileCrc32c(path);
+        ASSERT_TRUE(crc.ok());
+        EXPECT_EQ(*crc, galaxy::util::Crc32c(data));
+        EXPECT_TRUE(absl::IsNotFound(galaxy::util::FileCrc32c(path + ".none").status()));
+    }
+
+    TEST(GalaxyHashTest, StreamingHashMatchesHashData) {
+        std::string data = "some data to hash in pieces";
+        galaxy::util::StreamingHash hash;
+        hash.Update(data.substr(0, 5));
+        hash.Update("");
+        hash.Update(data.substr(5));
+        EXPECT_EQ(hash.HexDigest(), galaxy::util::HashData(data));
+        EXPECT_NE(galaxy::util::HashData(data), galaxy::util::HashData(data + "."));
+    }
+
+    TEST(GalaxyHashTest, IsValidHash) {
+        EXPECT_TRUE(galaxy::util::IsValidHash(galaxy::util::HashData("a")));
+        EXPECT_FALSE(galaxy::util::IsValidHash(""));
+        EXPECT_FALSE(galaxy::util::IsValidHash("../../etc/passwd"));
+        EXPECT_FALSE(galaxy::util::IsValidHash(galaxy::util::HashData("a") + "0"));
+    }
+
+}  // namespace
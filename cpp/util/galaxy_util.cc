@@ -6,6 +6,8 @@
 
 #include "absl/flags/flag.h"
 #include "absl/status/status.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/str_join.h"
 #include "cpp/util/galaxy_util.h"
@@ -62,6 +64,25 @@ std::string galaxy::util::ConvertToCellPath(const std::string& path, const CellC
     return out_path;
 }
 
+int64_t galaxy::util::ParseAttrSize(const std::string& attr) {
+    if (attr.empty()) {
+        return -1;
+    }
+    rapidjson::Document doc;
+    if (doc.Parse(attr.c_str()).HasParseError() || !doc.IsObject()) {
+        return -1;
+    }
+    if (!doc.HasMember("size")) {
+        return 0;
+    }
+    const rapidjson::Value& size = doc["size"];
+    if (size.IsString()) {
+        int64_t parsed;
+        return absl::SimpleAtoi(size.GetString(), &parsed) && parsed >= 0 ? parsed : -1;
+    }
+    return size.IsInt64() && size.GetInt64() >= 0 ? size.GetInt64() : -1;
+}
+
 std::string NormalizeDir(const std::string& dir) {
     std::string output_dir(dir);
     if (!output_dir.empty() && output_dir[-1] == '/') {
@@ -120,6 +141,75 @@ absl::StatusOr<CellConfig> ParseCellConfigInternal(const rapidjson::Value& cell_
     } else {
         config.set_disabled(false);
     }
+
+    if (cell_config.HasMember("fs_enable_cas")) {
+        config.set_fs_enable_cas(cell_config["fs_enable_cas"].GetBool());
+    } else {
+        config.set_fs_enable_cas(false);
+    }
+
+    galaxy_schema::CompressionType compression = galaxy_schema::CompressionType::UNCOMPRESSED;
+    if (cell_config.HasMember("fs_compression") &&
+        !galaxy_schema::CompressionType_Parse(absl::AsciiStrToUpper(cell_config["fs_compression"].GetString()), &compression)) {
+        LOG(WARNING) << "Unknown fs_compression " << cell_config["fs_compression"].GetString() << ", payloads are not compressed.";
+        compression = galaxy_schema::CompressionType::UNCOMPRESSED;
+    }
+    config.set_fs_compression(compression);
+
+    if (cell_config.HasMember("fs_compression_min_kb")) {
+        config.set_fs_compression_min_kb(cell_config["fs_compression_min_kb"].GetInt());
+    } else {
+        config.set_fs_compression_min_kb(4);
+    }
+
+    if (cell_config.HasMember("fs_durability_rules")) {
+        for (auto it = cell_config["fs_durability_rules"].MemberBegin(); it != cell_config["fs_durability_rules"].MemberEnd(); it++) {
+            galaxy_schema::Durability durability;
+            if (!galaxy_schema::Durability_Parse(absl::AsciiStrToUpper(it->value.GetString()), &durability)) {
+                LOG(WARNING) << "Unknown durability " << it->value.GetString() << " for prefix " << it->name.GetString() << ", the rule is ignored.";
+                continue;
+            }
+            galaxy_schema::DurabilityRule* rule = config.add_fs_durability_rules();
+            rule->set_prefix(it->name.GetString());
+            rule->set_durability(durability);
+        }
+    }
+
+    if (cell_config.HasMember("fs_sync_window_ms")) {
+        config.set_fs_sync_window_ms(cell_config["fs_sync_window_ms"].GetInt());
+    } else {
+        config.set_fs_sync_window_ms(2);
+    }
+
+    if (cell_config.HasMember("fs_atomic_write")) {
+        config.set_fs_atomic_write(cell_config["fs_atomic_write"].GetBool());
+    } else {
+        config.set_fs_atomic_write(false);
+    }
+
+    if (cell_config.HasMember("fs_io_backend")) {
+        config.set_fs_io_backend(cell_config["fs_io_backend"].GetString());
+    } else {
+        config.set_fs_io_backend("posix");
+    }
+
+    if (cell_config.HasMember("fs_io_queue_depth")) {
+        config.set_fs_io_queue_depth(cell_config["fs_io_queue_depth"].GetInt());
+    } else {
+        config.set_fs_io_queue_depth(32);
+    }
+
+    if (cell_config.HasMember("fs_meta_cache_mb")) {
+        config.set_fs_meta_cache_mb(cell_config["fs_meta_cache_mb"].GetInt());
+    } else {
+        config.set_fs_meta_cache_mb(0);
+    }
+
+    if (cell_config.HasMember("fs_max_executions")) {
+        config.set_fs_max_executions(cell_config["fs_max_executions"].GetInt());
+    } else {
+        config.set_fs_max_executions(galaxy::constant::kMaxExecutions);
+    }
     return config;
 }
 
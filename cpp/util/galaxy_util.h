@@ -1,6 +1,7 @@
 #ifndef CPP_UTIL_GALAXY_UTIL_H_
 #define CPP_UTIL_GALAXY_UTIL_H_
 
+#include <cstdint>
 #include <vector>
 
 #include "absl/status/statusor.h"
@@ -17,6 +18,9 @@ namespace galaxy {
         bool IsLocalPath(const std::string& path);
         galaxy_schema::FileAnalyzerResult InitClient(const std::string& path, const bool bypass=false);
         std::string ConvertToCellPath(const std::string& path, const galaxy_schema::CellConfig& config);
+        // Parses the size out of the attribute json returned by client::GetAttr or the listing calls, -1 if there is none.
+        // Remote attributes are proto json, where uint64 values are strings and zero values are omitted.
+        int64_t ParseAttrSize(const std::string& attr);
     }  // namespace util
 
 } // namespace galaxy
@@ -160,4 +160,17 @@ namespace {
         EXPECT_EQ(paths.at(0), "/galaxy/zz-d/test");
     }
 
+    TEST(GalaxyUtilTest, ParseAttrSize) {
+        EXPECT_EQ(galaxy::util::ParseAttrSize("{\"size\": 42}"), 42);
+        // Proto json of remote attributes, with uint64 values as strings and zero values left out.
+        EXPECT_EQ(galaxy::util::ParseAttrSize("{\"size\": \"8589934592\"}"), 8589934592);
+        EXPECT_EQ(galaxy::util::ParseAttrSize("{\"mode\": 33188}"), 0);
+        EXPECT_EQ(galaxy::util::ParseAttrSize(""), -1);
+        EXPECT_EQ(galaxy::util::ParseAttrSize("not json"), -1);
+        EXPECT_EQ(galaxy::util::ParseAttrSize("[42]"), -1);
+        EXPECT_EQ(galaxy::util::ParseAttrSize("{\"size\": \"abc\"}"), -1);
+        EXPECT_EQ(galaxy::util::ParseAttrSize("{\"size\": 1.5}"), -1);
+        EXPECT_EQ(galaxy::util::ParseAttrSize("{\"size\": -1}"), -1);
+    }
+
 }  // namespace
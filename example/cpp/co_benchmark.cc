@@ -0,0 +1,93 @@
+/* Example cmd
+* GALAXY_fs_global_config=/home/pslx/galaxy/example/cpp/server_config_example.json \
+* bazel run -c opt //example/cpp:co_benchmark -- --bench_dir=/galaxy/aa-d/co_benchmark --bench_num_files=256
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cpp/client.h"
+#include "cpp/co_client.h"
+#include "glog/logging.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+
+ABSL_FLAG(std::string, bench_dir, "", "The galaxy directory holding the benchmark files.");
+ABSL_FLAG(int, bench_num_files, 256, "The number of files read, transformed and written back per run.");
+ABSL_FLAG(int, bench_file_kb, 64, "The size of each benchmark file in KB.");
+
+namespace co = galaxy::client::co;
+
+std::string Transform(std::string data) {
+    std::transform(data.begin(), data.end(), data.begin(), [](unsigned char c) { return std::toupper(c); });
+    return data;
+}
+
+// One file at a time, each call blocking the thread until its response arrives.
+int BlockingPipeline(const std::vector<std::string>& paths) {
+    int num_failed = 0;
+    for (const auto& path : paths) {
+        std::string data = galaxy::client::Read(path);
+        if (data.empty()) {
+            ++num_failed;
+            continue;
+        }
+        galaxy::client::Write(path + ".out", Transform(std::move(data)));
+    }
+    return num_failed;
+}
+
+co::Task<absl::Status> CoPipeline(std::string path) {
+    absl::StatusOr<std::string> data = co_await co::Read(path);
+    if (!data.ok()) {
+        co_return data.status();
+    }
+    co_return co_await co::Write(path + ".out", Transform(std::move(*data)));
+}
+
+// Every file in flight at once, on the threads of the default executor.
+int CoroutinePipeline(const std::vector<std::string>& paths) {
+    std::vector<co::Task<absl::Status>> tasks;
+    for (const auto& path : paths) {
+        tasks.push_back(CoPipeline(path));
+    }
+    int num_failed = 0;
+    for (const auto& status : co::SyncWait(co::WhenAll(std::move(tasks)))) {
+        if (!status.ok()) {
+            ++num_failed;
+        }
+    }
+    return num_failed;
+}
+
+template <typename Fn>
+void Run(const std::string& name, const std::vector<std::string>& paths, Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    int num_failed = fn(paths);
+    double elapsed_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << paths.size() << " files in " << elapsed_sec << "s, "
+              << paths.size() / elapsed_sec << " files/s, " << num_failed << " failed." << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    absl::ParseCommandLine(argc, argv);
+    google::InitGoogleLogging(argv[0]);
+    std::string dir = absl::GetFlag(FLAGS_bench_dir);
+    CHECK(!dir.empty()) << "--bench_dir is required.";
+
+    galaxy::client::CreateDirIfNotExist(dir);
+    std::string data(static_cast<size_t>(absl::GetFlag(FLAGS_bench_file_kb)) * 1024, 'a');
+    std::vector<std::string> paths;
+    for (int i = 0; i < absl::GetFlag(FLAGS_bench_num_files); ++i) {
+        paths.push_back(dir + "/file_" + std::to_string(i));
+        galaxy::client::Write(paths.back(), data);
+    }
+
+    Run("blocking", paths, BlockingPipeline);
+    Run("coroutine", paths, CoroutinePipeline);
+    return 0;
+}
@@ -162,7 +162,28 @@ def get_type(mode):
     return type
 
 
+def tail_response(path, last_n_lines, follow):
+    # Streams the last lines of a file, e.g. a log, and with follow what is appended to it, without reading it whole.
+    def generate():
+        reader = gclient.TailReader(path=path, last_n_lines=last_n_lines, follow=follow)
+        try:
+            for chunk in reader:
+                yield chunk['data']
+        finally:
+            reader.cancel()
+
+    return Response(generate(), mimetype='text/plain')
+
+
 def file_response(path):
+    if 'tail' in request.args:
+        try:
+            last_n_lines = int(request.args.get('tail') or 100)
+        except ValueError:
+            return make_response('Invalid tail', 400)
+        if last_n_lines < 0:
+            return make_response('Invalid tail', 400)
+        return tail_response(path, last_n_lines, request.args.get('follow') == '1')
     data = gclient.read(path)
 
     response = Response(
@@ -71,29 +71,16 @@ class gclient_ext:
         return {**gclient.list_dirs_in_dir_recursive(path), **gclient.list_files_in_dir_recursive(path)}
 
     @classmethod
-    def copy_folder(cls, from_path, to_path):
-        import warnings
-        warnings.warn("Please consider using fileutil binary for better performance.", RuntimeWarning)
+    def copy_folder(cls, from_path, to_path, overwrite=True, show_progress=False):
         if not gclient.dir_or_die(from_path):
-            return
-
-        all_files = gclient.list_files_in_dir_recursive(from_path)
-        for old_file in all_files:
-            new_file = old_file.replace(from_path, to_path)
-            gclient.copy_file(old_file, new_file)
+            return None
+        return gclient.copy_dir(from_path, to_path, overwrite=overwrite, show_progress=show_progress)
 
     @classmethod
-    def move_folder(cls, from_path, to_path):
-        import warnings
-        warnings.warn("Please consider using fileutil binary for better performance.", RuntimeWarning)
+    def move_folder(cls, from_path, to_path, overwrite=True, show_progress=False):
         if not gclient.dir_or_die(from_path):
-            return
-
-        all_files = gclient.list_files_in_dir_recursive(from_path)
-        for old_file in all_files:
-            new_file = old_file.replace(from_path, to_path)
-            gclient.move_file(old_file, new_file)
-        gclient.rm_dir_recursive(from_path)
+            return None
+        return gclient.move_dir(from_path, to_path, overwrite=overwrite, show_progress=show_progress)
 
 
 __all__ = [
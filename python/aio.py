@@ -0,0 +1,116 @@
+import asyncio
+import functools
+import weakref
+
+try:
+    from python import _gclient_async
+except ImportError:
+    import _gclient_async
+
+
+class GalaxyError(OSError):
+    pass
+
+
+class _LoopClient(object):
+    """Native client bound to one event loop. Calls are multiplexed over the shared gRPC channels, and their
+    completions are collected on the loop through a single eventfd, without a thread per call. Calls on local and
+    /SHARED paths are served by the native client before it returns, so they are run on the default executor."""
+
+    def __init__(self, loop):
+        # No reference to the loop is kept, so that the loop can be collected along with its client.
+        self._client = _gclient_async.AsyncClient()
+        self._futures = {}
+        # Completions of executor calls drained before their call id was known.
+        self._unclaimed = {}
+        loop.add_reader(self._client.fileno(), self._drain)
+
+    async def call(self, paths, method, *args):
+        if not any(self._client.serves_inline(path) for path in paths):
+            return await self._wait(getattr(self._client, method)(*args))
+        job = asyncio.get_running_loop().run_in_executor(None, functools.partial(getattr(self._client, method), *args))
+        try:
+            call_id = await asyncio.shield(job)
+        except asyncio.CancelledError:
+            job.add_done_callback(self._drop)
+            raise
+        return await self._claim(call_id)
+
+    def _wait(self, call_id):
+        future = asyncio.get_running_loop().create_future()
+        self._futures[call_id] = future
+        return future
+
+    async def _claim(self, call_id):
+        # Inline completions are queued before the call returns, and may have been drained already.
+        self._drain()
+        if call_id not in self._unclaimed:
+            # Part of the call, e.g. the remote paths of read_multiple, is still in flight.
+            return await self._wait(call_id)
+        error, result = self._unclaimed.pop(call_id)
+        if error is not None:
+            raise GalaxyError(error)
+        return result
+
+    def _drop(self, job):
+        if job.cancelled() or job.exception() is not None:
+            return
+        self._drain()
+        if self._unclaimed.pop(job.result(), None) is None:
+            # Dropped once it completes, as _drain skips finished futures.
+            future = asyncio.get_running_loop().create_future()
+            future.cancel()
+            self._futures[job.result()] = future
+
+    def _drain(self):
+        for call_id, error, result in self._client.drain():
+            future = self._futures.pop(call_id, None)
+            if future is None:
+                self._unclaimed[call_id] = (error, result)
+                continue
+            if future.done():
+                continue
+            if error is not None:
+                future.set_exception(GalaxyError(error))
+            else:
+                future.set_result(result)
+
+
+_loop_clients = weakref.WeakKeyDictionary()
+
+
+def _call(paths, method, *args):
+    loop = asyncio.get_running_loop()
+    client = _loop_clients.get(loop)
+    if client is None:
+        client = _loop_clients[loop] = _LoopClient(loop)
+    return client.call(paths, method, *args)
+
+
+async def read(path):
+    return await _call([path], 'read', path)
+
+
+async def read_multiple(paths):
+    paths = list(paths)
+    return await _call(paths, 'read_multiple', paths)
+
+
+async def write(path, data, mode='w'):
+    await _call([path], 'write', path, data, mode)
+
+
+async def list_dirs_in_dir(path):
+    return await _call([path], 'list_dirs_in_dir', path)
+
+
+async def list_files_in_dir(path, include_hidden=False):
+    return await _call([path], 'list_files_in_dir', path, include_hidden)
+
+
+async def get_attr(path):
+    return await _call([path], 'get_attr', path)
+
+
+async def copy_file(from_path, to_path):
+    await _call([from_path, to_path], 'copy_file', from_path, to_path)
@@ -0,0 +1,30 @@
+#ifndef PYTHON_BUFFER_UTIL_H_
+#define PYTHON_BUFFER_UTIL_H_
+
+#include <string>
+#include <pybind11/pybind11.h>
+
+namespace galaxy
+{
+    namespace python
+    {
+        // Copies the content of a buffer, which must be contiguous. The GIL is released while copying.
+        inline std::string BufferToString(const pybind11::buffer &data)
+        {
+            Py_buffer view;
+            if (PyObject_GetBuffer(data.ptr(), &view, PyBUF_C_CONTIGUOUS) != 0)
+            {
+                throw pybind11::error_already_set();
+            }
+            std::string data_str;
+            {
+                pybind11::gil_scoped_release release;
+                data_str.assign(static_cast<const char *>(view.buf), static_cast<size_t>(view.len));
+            }
+            PyBuffer_Release(&view);
+            return data_str;
+        }
+    } // namespace python
+} // namespace galaxy
+
+#endif // PYTHON_BUFFER_UTIL_H_
@@ -1,53 +1,384 @@
 #include <map>
 #include <vector>
+#include "absl/strings/ascii.h"
+#include "absl/strings/strip.h"
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include "cpp/buffered_writer.h"
 #include "cpp/client.h"
+#include "cpp/placement.h"
+#include "cpp/transfer.h"
 #include "cpp/util/galaxy_util.h"
+#include "python/buffer_util.h"
 #include "glog/logging.h"
 
 namespace py = pybind11;
+using galaxy::python::BufferToString;
+
+// Owns the data of a read, and exposes it through the buffer protocol so that it is handed to Python without a copy.
+struct ReadBuffer {
+    std::string data;
+};
+
+py::memoryview ToMemoryview(ReadBuffer buffer) {
+    return py::memoryview(py::cast(std::move(buffer)));
+}
+
+// Scan options from the name of the operator, e.g. "grep" or "count_lines".
+galaxy::client::ScanOptions ToScanOptions(const std::string& op, const std::string& pattern, bool regex, int64_t max_lines, int64_t max_bytes) {
+    galaxy::client::ScanOptions options;
+    if (!galaxy_schema::ScanOperator_Parse("SCAN_" + absl::AsciiStrToUpper(op), &options.op)) {
+        throw std::invalid_argument("Unknown scan operator " + op);
+    }
+    options.pattern = pattern;
+    options.regex = regex;
+    options.max_lines = max_lines;
+    options.max_bytes = max_bytes;
+    return options;
+}
+
+py::dict ToScanDict(const std::map<std::string, galaxy::client::ScanResult>& results) {
+    py::dict output;
+    for (const auto& pair : results) {
+        py::dict result;
+        result["data"] = py::bytes(pair.second.data);
+        result["count"] = pair.second.count;
+        result["truncated"] = pair.second.truncated;
+        result["error"] = pair.second.error;
+        output[py::str(pair.first)] = result;
+    }
+    return output;
+}
 
 PYBIND11_MODULE(_gclient, m)
 {
     google::InitGoogleLogging("GALAXY_CLIENT");
     m.doc() = "galaxy client"; // optional module docstring
+    py::class_<ReadBuffer>(m, "ReadBuffer", py::buffer_protocol())
+        .def_buffer([](ReadBuffer& buffer) {
+            return py::buffer_info(&buffer.data[0], 1, py::format_descriptor<uint8_t>::format(),
+                                   static_cast<py::ssize_t>(buffer.data.size()));
+        });
     // Functions from client namespace
-    m.def("create_dir_if_not_exist", &galaxy::client::CreateDirIfNotExist, "Wrapper for CreateDirIfNotExist",
+    m.def("create_dir_if_not_exist", &galaxy::client::CreateDirIfNotExist, "Wrapper for CreateDirIfNotExist", py::call_guard<py::gil_scoped_release>(),
         py::arg("path"), py::arg("mode") = 0777);
-    m.def("dir_or_die", &galaxy::client::DirOrDie, "Wrapper for DirOrDie", py::arg("path"));
-    m.def("rm_dir", &galaxy::client::RmDir, "Wrapper for RmDir", py::arg("path"), py::arg("include_hidden")=false);
-    m.def("rm_dir_recursive", &galaxy::client::RmDirRecursive, "Wrapper for RmDirRecursive", py::arg("path"), py::arg("include_hidden")=false);
-    m.def("list_dirs_in_dir", &galaxy::client::ListDirsInDir, "Wrapper for ListDirsInDir", py::arg("path"));
-    m.def("list_files_in_dir", &galaxy::client::ListFilesInDir, "Wrapper for ListFilesInDir", py::arg("path"), py::arg("include_hidden")=false);
-    m.def("list_dirs_in_dir_recursive", &galaxy::client::ListDirsInDirRecursive, "Wrapper for ListDirsInDirRecursive", py::arg("path"));
-    m.def("list_files_in_dir_recursive", &galaxy::client::ListFilesInDirRecursive, "Wrapper for ListFilesInDirRecursive", py::arg("path"), py::arg("include_hidden")=false);
-    m.def("create_file_if_not_exist", &galaxy::client::CreateFileIfNotExist, "Wrapper for CreateFileIfNotExist",
+    m.def("dir_or_die", &galaxy::client::DirOrDie, "Wrapper for DirOrDie", py::call_guard<py::gil_scoped_release>(), py::arg("path"));
+    m.def("rm_dir", &galaxy::client::RmDir, "Wrapper for RmDir", py::call_guard<py::gil_scoped_release>(), py::arg("path"), py::arg("include_hidden")=false);
+    m.def("rm_dir_recursive", &galaxy::client::RmDirRecursive, "Wrapper for RmDirRecursive", py::call_guard<py::gil_scoped_release>(), py::arg("path"), py::arg("include_hidden")=false);
+    m.def("list_dirs_in_dir", &galaxy::client::ListDirsInDir, "Wrapper for ListDirsInDir", py::call_guard<py::gil_scoped_release>(), py::arg("path"));
+    m.def("list_files_in_dir", &galaxy::client::ListFilesInDir, "Wrapper for ListFilesInDir", py::call_guard<py::gil_scoped_release>(), py::arg("path"), py::arg("include_hidden")=false);
+    m.def("list_dirs_in_dir_recursive", &galaxy::client::ListDirsInDirRecursive, "Wrapper for ListDirsInDirRecursive", py::call_guard<py::gil_scoped_release>(), py::arg("path"));
+    m.def("list_files_in_dir_recursive", &galaxy::client::ListFilesInDirRecursive, "Wrapper for ListFilesInDirRecursive", py::call_guard<py::gil_scoped_release>(), py::arg("path"), py::arg("include_hidden")=false);
+    m.def("create_file_if_not_exist", &galaxy::client::CreateFileIfNotExist, "Wrapper for CreateFileIfNotExist", py::call_guard<py::gil_scoped_release>(),
         py::arg("path"), py::arg("mode") = 0777);
-    m.def("file_or_die", &galaxy::client::FileOrDie, "Wrapper for FileOrDie", py::arg("path"));
-    m.def("rm_file", &galaxy::client::RmFile, "Wrapper for RmFile", py::arg("path"), py::arg("is_hidden")=false);
-    m.def("rename_file", &galaxy::client::RenameFile, "Wrapper for RenameFile", py::arg("old_path"), py::arg("new_path"));
+    m.def("file_or_die", &galaxy::client::FileOrDie, "Wrapper for FileOrDie", py::call_guard<py::gil_scoped_release>(), py::arg("path"));
+    m.def("rm_file", &galaxy::client::RmFile, "Wrapper for RmFile", py::call_guard<py::gil_scoped_release>(), py::arg("path"), py::arg("is_hidden")=false);
+    m.def("rename_file", &galaxy::client::RenameFile, "Wrapper for RenameFile", py::call_guard<py::gil_scoped_release>(), py::arg("old_path"), py::arg("new_path"));
     m.def("read", [](const std::string path) {
-        std::string data = galaxy::client::Read(path);
+        std::string data;
+        {
+            py::gil_scoped_release release;
+            data = galaxy::client::Read(path);
+        }
         return py::bytes(data);
     },  "Wrapper for Read", py::arg("path"));
-    m.def("read_multiple", [](const std::vector<std::string> paths) {
-        std::map<std::string, std::string> data = galaxy::client::ReadMultiple(paths);
+    m.def("read_buffer", [](const std::string path) {
+        ReadBuffer buffer;
+        {
+            py::gil_scoped_release release;
+            buffer.data = galaxy::client::Read(path);
+        }
+        return ToMemoryview(std::move(buffer));
+    },  "Same as read, but returns a memoryview over the data instead of a copy of it", py::arg("path"));
+    m.def("read_multiple", [](const std::vector<std::string> paths, bool consistent) {
+        std::map<std::string, std::string> data;
+        {
+            py::gil_scoped_release release;
+            data = galaxy::client::ReadMultiple(paths, consistent);
+        }
         std::map<std::string, py::bytes> result;
         for (const auto& val : data) {
             result.insert({val.first, py::bytes(val.second)});
         }
         return result;
-    }, "Wrapper for ReadMultiple", py::arg("paths"));
-    m.def("write", &galaxy::client::Write, "Wrapper for Write", py::arg("path"), py::arg("data"), py::arg("mode")="w");
-    m.def("write_multiple", &galaxy::client::WriteMultiple, "Wrapper for WriteMultiple", py::arg("path_data_map"), py::arg("mode")="w");
-    m.def("get_attr", &galaxy::client::GetAttr, "Wrapper for GetAttr", py::arg("path"));
-    m.def("list_cells", &galaxy::client::ListCells, "Wrapper for ListCells", py::arg("bypass")=false);
-    m.def("check_health", &galaxy::client::CheckHealth, "Wrapper for CheckHealth", py::arg("cell"));
-    m.def("copy_file", &galaxy::client::CopyFile, "Wrapper for CopyFile", py::arg("from_path"), py::arg("to_path"));
-    m.def("move_file", &galaxy::client::MoveFile, "Wrapper for MoveFile", py::arg("from_path"), py::arg("to_path"));
-    m.def("remote_execute", &galaxy::client::RemoteExecute, "Wrapper for RemoteExecute", py::arg("cell"), py::arg("home_dir"), py::arg("main"), py::arg("program_args"), py::arg("env_kargs"));
-    m.def("change_availability", &galaxy::client::ChangeAvailability, "Wrapper for ChangeAvailability", py::arg("cell"), py::arg("status"));
+    }, "Wrapper for ReadMultiple", py::arg("paths"), py::arg("consistent")=false);
+    m.def("read_multiple_buffers", [](const std::vector<std::string> paths, bool consistent) {
+        std::map<std::string, std::string> data;
+        {
+            py::gil_scoped_release release;
+            data = galaxy::client::ReadMultiple(paths, consistent);
+        }
+        std::map<std::string, py::memoryview> result;
+        for (auto& val : data) {
+            result.insert({val.first, ToMemoryview({std::move(val.second)})});
+        }
+        return result;
+    }, "Same as read_multiple, but returns memoryviews over the data instead of copies of it", py::arg("paths"), py::arg("consistent")=false);
+    m.def("write", &galaxy::client::Write, "Wrapper for Write", py::call_guard<py::gil_scoped_release>(), py::arg("path"), py::arg("data"), py::arg("mode")="w");
+    // Overloads for any other object exposing a contiguous buffer, e.g. bytearray, memoryview or numpy arrays.
+    m.def("write", [](const std::string& path, py::buffer data, const std::string& mode) {
+        std::string data_str = BufferToString(data);
+        py::gil_scoped_release release;
+        galaxy::client::Write(path, data_str, mode);
+    }, "Wrapper for Write", py::arg("path"), py::arg("data"), py::arg("mode")="w");
+    m.def("write_multiple", &galaxy::client::WriteMultiple, "Wrapper for WriteMultiple", py::call_guard<py::gil_scoped_release>(), py::arg("path_data_map"), py::arg("mode")="w");
+    m.def("write_multiple", [](const std::map<std::string, py::buffer>& path_data_map, const std::string& mode) {
+        std::map<std::string, std::string> data_map;
+        for (const auto& val : path_data_map) {
+            data_map.insert({val.first, BufferToString(val.second)});
+        }
+        py::gil_scoped_release release;
+        galaxy::client::WriteMultiple(data_map, mode);
+    }, "Wrapper for WriteMultiple", py::arg("path_data_map"), py::arg("mode")="w");
+    m.def("write_multiple_atomic", [](const std::map<std::string, py::buffer>& path_data_map) {
+        std::map<std::string, std::string> data_map;
+        for (const auto& val : path_data_map) {
+            data_map.insert({val.first, BufferToString(val.second)});
+        }
+        py::gil_scoped_release release;
+        return galaxy::client::WriteMultipleAtomic(data_map);
+    }, "Wrapper for WriteMultipleAtomic", py::arg("path_data_map"));
+    m.def("write_at", &galaxy::client::WriteAt, "Wrapper for WriteAt", py::call_guard<py::gil_scoped_release>(), py::arg("path"), py::arg("offset"), py::arg("data"));
+    m.def("write_at", [](const std::string& path, int64_t offset, py::buffer data) {
+        std::string data_str = BufferToString(data);
+        py::gil_scoped_release release;
+        galaxy::client::WriteAt(path, offset, data_str);
+    }, "Wrapper for WriteAt", py::arg("path"), py::arg("offset"), py::arg("data"));
+    m.def("truncate", &galaxy::client::Truncate, "Wrapper for Truncate", py::call_guard<py::gil_scoped_release>(), py::arg("path"), py::arg("size"));
+    m.def("preallocate", &galaxy::client::Preallocate, "Wrapper for Preallocate", py::call_guard<py::gil_scoped_release>(), py::arg("path"), py::arg("size"));
+    m.def("get_attr", &galaxy::client::GetAttr, "Wrapper for GetAttr", py::call_guard<py::gil_scoped_release>(), py::arg("path"));
+    m.def("checksum", &galaxy::client::Checksum, "Wrapper for Checksum", py::call_guard<py::gil_scoped_release>(), py::arg("path"));
+    m.def("list_cells", &galaxy::client::ListCells, "Wrapper for ListCells", py::call_guard<py::gil_scoped_release>(), py::arg("bypass")=false);
+    m.def("check_health", &galaxy::client::CheckHealth, "Wrapper for CheckHealth", py::call_guard<py::gil_scoped_release>(), py::arg("cell"));
+    m.def("copy_file", &galaxy::client::CopyFile, "Wrapper for CopyFile", py::call_guard<py::gil_scoped_release>(), py::arg("from_path"), py::arg("to_path"));
+    m.def("move_file", &galaxy::client::MoveFile, "Wrapper for MoveFile", py::call_guard<py::gil_scoped_release>(), py::arg("from_path"), py::arg("to_path"));
+    m.def("broadcast_copy_file", &galaxy::client::BroadcastCopyFile, "Wrapper for BroadcastCopyFile", py::call_guard<py::gil_scoped_release>(), py::arg("from_path"), py::arg("to_path"));
+    m.def("broadcast_write", &galaxy::client::BroadcastWrite, "Wrapper for BroadcastWrite", py::call_guard<py::gil_scoped_release>(), py::arg("path"), py::arg("data"));
+    m.def("remote_execute", &galaxy::client::RemoteExecute, "Wrapper for RemoteExecute", py::call_guard<py::gil_scoped_release>(), py::arg("cell"), py::arg("home_dir"), py::arg("main"), py::arg("program_args"), py::arg("env_kargs"));
+    py::class_<galaxy::client::ExecutionResult>(m, "ExecutionResult")
+        .def_readonly("raw_cmd", &galaxy::client::ExecutionResult::raw_cmd)
+        .def_readonly("exit_code", &galaxy::client::ExecutionResult::exit_code)
+        .def_readonly("term_signal", &galaxy::client::ExecutionResult::term_signal)
+        .def_readonly("wall_sec", &galaxy::client::ExecutionResult::wall_sec)
+        .def_readonly("user_sec", &galaxy::client::ExecutionResult::user_sec)
+        .def_readonly("system_sec", &galaxy::client::ExecutionResult::system_sec)
+        .def_readonly("max_rss_kb", &galaxy::client::ExecutionResult::max_rss_kb)
+        .def_readonly("error", &galaxy::client::ExecutionResult::error)
+        .def_property_readonly("out", [](const galaxy::client::ExecutionResult& result) { return py::bytes(result.out); })
+        .def_property_readonly("err", [](const galaxy::client::ExecutionResult& result) { return py::bytes(result.err); });
+    // callback(out, err) gets the output as bytes while the command runs, and kills it by returning False.
+    m.def("remote_execute_stream", [](const std::string& cell, const std::string& home_dir, const std::string& main, const std::vector<std::string>& program_args,
+                                      const std::map<std::string, std::string>& env_kargs, py::function callback) {
+        py::gil_scoped_release release;
+        return galaxy::client::RemoteExecuteStream(cell, home_dir, main, program_args, env_kargs, [&callback](const std::string& out, const std::string& err) {
+            py::gil_scoped_acquire acquire;
+            py::object keep_going = callback(py::bytes(out), py::bytes(err));
+            return keep_going.is_none() || keep_going.cast<bool>();
+        });
+    }, "Wrapper for RemoteExecuteStream", py::arg("cell"), py::arg("home_dir"), py::arg("main"), py::arg("program_args"), py::arg("env_kargs"), py::arg("callback"));
+    m.def("remote_execute_all", [](const std::vector<std::string>& cells, const std::string& home_dir, const std::string& main, const std::vector<std::string>& program_args,
+                                   const std::map<std::string, std::string>& env_kargs, int parallelism, int timeout_sec) {
+        galaxy::client::ExecuteAllOptions options = galaxy::client::ExecuteAllOptions::FromFlags();
+        options.parallelism = parallelism > 0 ? parallelism : options.parallelism;
+        options.timeout_sec = timeout_sec >= 0 ? timeout_sec : options.timeout_sec;
+        return galaxy::client::RemoteExecuteAll(cells, home_dir, main, program_args, env_kargs, options);
+    }, "Wrapper for RemoteExecuteAll", py::call_guard<py::gil_scoped_release>(), py::arg("cells"), py::arg("home_dir"), py::arg("main"), py::arg("program_args"),
+       py::arg("env_kargs")=std::map<std::string, std::string>(), py::arg("parallelism")=0, py::arg("timeout_sec")=-1);
+    m.def("scan", [](const std::vector<std::string>& paths, const std::string& op, const std::string& pattern, bool regex, int64_t max_lines, int64_t max_bytes) {
+        galaxy::client::ScanOptions options = ToScanOptions(op, pattern, regex, max_lines, max_bytes);
+        std::map<std::string, galaxy::client::ScanResult> results;
+        {
+            py::gil_scoped_release release;
+            results = galaxy::client::Scan(paths, options);
+        }
+        return ToScanDict(results);
+    }, "Wrapper for Scan", py::arg("paths"), py::arg("op")="grep", py::arg("pattern")="", py::arg("regex")=false, py::arg("max_lines")=0, py::arg("max_bytes")=0);
+    m.def("scan_dir", [](const std::string& path, bool recursive, const std::string& op, const std::string& pattern, bool regex, int64_t max_lines, int64_t max_bytes) {
+        galaxy::client::ScanOptions options = ToScanOptions(op, pattern, regex, max_lines, max_bytes);
+        std::map<std::string, galaxy::client::ScanResult> results;
+        {
+            py::gil_scoped_release release;
+            results = galaxy::client::ScanDir(path, recursive, options);
+        }
+        return ToScanDict(results);
+    }, "Wrapper for ScanDir", py::arg("path"), py::arg("recursive")=false, py::arg("op")="grep", py::arg("pattern")="", py::arg("regex")=false, py::arg("max_lines")=0, py::arg("max_bytes")=0);
+    m.def("change_availability", &galaxy::client::ChangeAvailability, "Wrapper for ChangeAvailability", py::call_guard<py::gil_scoped_release>(), py::arg("cell"), py::arg("status"));
+
+    // Functions from placement namespace
+    py::class_<galaxy::placement::CellLocality>(m, "CellLocality")
+        .def_readonly("resident_bytes", &galaxy::placement::CellLocality::resident_bytes)
+        .def_readonly("ram_usage", &galaxy::placement::CellLocality::ram_usage)
+        .def_readonly("disk_usage", &galaxy::placement::CellLocality::disk_usage)
+        .def_readonly("free_disk_bytes", &galaxy::placement::CellLocality::free_disk_bytes);
+    py::class_<galaxy::placement::Placement>(m, "Placement")
+        .def_readonly("cell", &galaxy::placement::Placement::cell)
+        .def_readonly("total_bytes", &galaxy::placement::Placement::total_bytes)
+        .def_readonly("cells", &galaxy::placement::Placement::cells)
+        .def_readonly("paths", &galaxy::placement::Placement::paths)
+        .def_readonly("errors", &galaxy::placement::Placement::errors)
+        .def("missing_bytes", &galaxy::placement::Placement::MissingBytes);
+    m.def("place", [](const std::vector<std::string>& inputs, bool stage_inputs, double max_ram_usage, double max_disk_usage) {
+        galaxy::placement::PlacementOptions options;
+        options.stage_inputs = stage_inputs;
+        options.max_ram_usage = max_ram_usage;
+        options.max_disk_usage = max_disk_usage;
+        return galaxy::placement::Place(inputs, options);
+    }, "Wrapper for placement::Place", py::call_guard<py::gil_scoped_release>(), py::arg("inputs"), py::arg("stage_inputs")=false,
+       py::arg("max_ram_usage")=0.9, py::arg("max_disk_usage")=0.95);
+    m.def("run_near_data", [](const std::vector<std::string>& inputs, const std::string& home_dir, const std::string& main, const std::vector<std::string>& program_args,
+                              const std::map<std::string, std::string>& env_kargs, bool stage_inputs) {
+        galaxy::placement::PlacementOptions options;
+        options.stage_inputs = stage_inputs;
+        galaxy::placement::Placement placement;
+        galaxy::client::ExecutionResult result = galaxy::placement::RunNearData(inputs, home_dir, main, program_args, env_kargs, options, &placement);
+        return std::make_pair(placement, result);
+    }, "Wrapper for placement::RunNearData, returning the placement and the result", py::call_guard<py::gil_scoped_release>(), py::arg("inputs"),
+       py::arg("home_dir"), py::arg("main"), py::arg("program_args"), py::arg("env_kargs")=std::map<std::string, std::string>(), py::arg("stage_inputs")=true);
+
+    // Functions from transfer namespace
+    py::class_<galaxy::transfer::TransferSummary>(m, "TransferSummary")
+        .def_readonly("num_files", &galaxy::transfer::TransferSummary::num_files)
+        .def_readonly("num_copied", &galaxy::transfer::TransferSummary::num_copied)
+        .def_readonly("num_skipped", &galaxy::transfer::TransferSummary::num_skipped)
+        .def_readonly("num_failed", &galaxy::transfer::TransferSummary::num_failed)
+        .def_readonly("num_bytes", &galaxy::transfer::TransferSummary::num_bytes)
+        .def_readonly("elapsed_sec", &galaxy::transfer::TransferSummary::elapsed_sec)
+        .def_readonly("failed_files", &galaxy::transfer::TransferSummary::failed_files)
+        .def("throughput", &galaxy::transfer::TransferSummary::Throughput)
+        .def("__repr__", &galaxy::transfer::TransferSummary::ToString);
+    m.def("copy_dir", [](const std::string& from_path, const std::string& to_path, bool overwrite, bool show_progress) {
+        galaxy::transfer::TransferOptions options = galaxy::transfer::TransferOptions::FromFlags();
+        options.overwrite = overwrite;
+        options.show_progress = show_progress;
+        return galaxy::transfer::CopyDir(from_path, to_path, options);
+    }, "Wrapper for transfer::CopyDir", py::call_guard<py::gil_scoped_release>(), py::arg("from_path"), py::arg("to_path"), py::arg("overwrite")=true, py::arg("show_progress")=false);
+    m.def("move_dir", [](const std::string& from_path, const std::string& to_path, bool overwrite, bool show_progress) {
+        galaxy::transfer::TransferOptions options = galaxy::transfer::TransferOptions::FromFlags();
+        options.overwrite = overwrite;
+        options.show_progress = show_progress;
+        return galaxy::transfer::MoveDir(from_path, to_path, options);
+    }, "Wrapper for transfer::MoveDir", py::call_guard<py::gil_scoped_release>(), py::arg("from_path"), py::arg("to_path"), py::arg("overwrite")=true, py::arg("show_progress")=false);
+
+    // Buffered writer, options left to -1 default to the fs_buffered_* flags.
+    py::class_<galaxy::client::BufferedWriter>(m, "BufferedWriter")
+        .def(py::init([](int64_t flush_kb, int flush_interval_ms, int64_t max_kb, int drop_when_full) {
+            galaxy::client::BufferedWriterOptions options = galaxy::client::BufferedWriterOptions::FromFlags();
+            if (flush_kb >= 0) {
+                options.flush_bytes = flush_kb * 1024;
+            }
+            if (flush_interval_ms >= 0) {
+                options.flush_interval_ms = flush_interval_ms;
+            }
+            if (max_kb >= 0) {
+                options.max_buffered_bytes = max_kb * 1024;
+            }
+            if (drop_when_full >= 0) {
+                options.drop_when_full = drop_when_full;
+            }
+            return new galaxy::client::BufferedWriter(options);
+        }), py::arg("flush_kb")=-1, py::arg("flush_interval_ms")=-1, py::arg("max_kb")=-1, py::arg("drop_when_full")=-1)
+        .def("append", &galaxy::client::BufferedWriter::Append, py::call_guard<py::gil_scoped_release>(), py::arg("path"), py::arg("data"))
+        .def("flush", [](galaxy::client::BufferedWriter& writer) {
+            absl::Status status;
+            {
+                py::gil_scoped_release release;
+                status = writer.Flush();
+            }
+            if (!status.ok()) {
+                throw std::runtime_error(status.ToString());
+            }
+        })
+        .def("close", [](galaxy::client::BufferedWriter& writer) {
+            absl::Status status;
+            {
+                py::gil_scoped_release release;
+                status = writer.Close();
+            }
+            if (!status.ok()) {
+                throw std::runtime_error(status.ToString());
+            }
+        })
+        .def("num_dropped", &galaxy::client::BufferedWriter::num_dropped);
+
+    // Changes of a directory as an iterator of dicts, e.g. {"type": "create", "path": ..., "attr": ...}. Waits in
+    // short slices so that Ctrl-C interrupts it, and raises RuntimeError if the watch fails.
+    py::class_<galaxy::client::Watcher>(m, "Watcher")
+        .def(py::init<const std::string&, bool, uint32_t, const std::string&>(), py::arg("path"), py::arg("recursive")=false,
+             py::arg("event_mask")=0, py::arg("resume_token")="")
+        .def("__iter__", [](galaxy::client::Watcher& watcher) -> galaxy::client::Watcher& { return watcher; })
+        .def("__next__", [](galaxy::client::Watcher& watcher) {
+            galaxy::client::WatchEvent event;
+            while (true) {
+                bool found = false;
+                {
+                    py::gil_scoped_release release;
+                    found = watcher.Next(&event, 200);
+                }
+                if (found) {
+                    break;
+                }
+                if (watcher.done()) {
+                    absl::Status status = watcher.status();
+                    if (status.ok() || absl::IsCancelled(status)) {
+                        throw py::stop_iteration();
+                    }
+                    throw std::runtime_error(status.ToString());
+                }
+                if (PyErr_CheckSignals() != 0) {
+                    throw py::error_already_set();
+                }
+            }
+            std::string type = galaxy_schema::WatchEventType_Name(event.type);
+            absl::ConsumePrefix(&type, "WATCH_");
+            py::dict result;
+            result["type"] = absl::AsciiStrToLower(type);
+            result["path"] = event.path;
+            result["old_path"] = event.old_path;
+            result["is_dir"] = event.is_dir;
+            result["attr"] = event.attr;
+            result["resume_token"] = event.resume_token;
+            return result;
+        })
+        .def("cancel", &galaxy::client::Watcher::Cancel, py::call_guard<py::gil_scoped_release>())
+        .def("resume_token", &galaxy::client::Watcher::resume_token);
+
+    // Content of a file and what is appended to it as an iterator of dicts, e.g. {"cell": ..., "data": b"...",
+    // "offset": ...}, on every cell at once for a /SHARED path. Interruptible and failing like Watcher.
+    py::class_<galaxy::client::TailReader>(m, "TailReader")
+        .def(py::init<const std::string&, int64_t, int64_t, bool>(), py::arg("path"), py::arg("from_offset")=0,
+             py::arg("last_n_lines")=0, py::arg("follow")=true)
+        .def("__iter__", [](galaxy::client::TailReader& reader) -> galaxy::client::TailReader& { return reader; })
+        .def("__next__", [](galaxy::client::TailReader& reader) {
+            galaxy::client::TailChunk chunk;
+            while (true) {
+                bool found = false;
+                {
+                    py::gil_scoped_release release;
+                    found = reader.Next(&chunk, 200);
+                }
+                if (found) {
+                    break;
+                }
+                if (reader.done()) {
+                    absl::Status status = reader.status();
+                    if (status.ok() || absl::IsCancelled(status)) {
+                        throw py::stop_iteration();
+                    }
+                    throw std::runtime_error(status.ToString());
+                }
+                if (PyErr_CheckSignals() != 0) {
+                    throw py::error_already_set();
+                }
+            }
+            py::dict result;
+            result["cell"] = chunk.cell;
+            result["path"] = chunk.path;
+            result["data"] = py::bytes(chunk.data);
+            result["offset"] = chunk.offset;
+            result["reset"] = chunk.reset;
+            return result;
+        })
+        .def("cancel", &galaxy::client::TailReader::Cancel, py::call_guard<py::gil_scoped_release>());
 
     // Functions from util namespace
     m.def("is_local_path", &galaxy::util::IsLocalPath, "Wrapper for IsLocalPath", py::arg("path"));
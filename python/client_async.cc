@@ -0,0 +1,238 @@
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include "cpp/client.h"
+#include "cpp/util/galaxy_util.h"
+#include "python/buffer_util.h"
+#include "glog/logging.h"
+
+namespace py = pybind11;
+using galaxy::python::BufferToString;
+
+// A finished call. result builds the Python value of the call, and is only run on the loop thread with the GIL held.
+struct Completion {
+    uint64_t id;
+    absl::Status status;
+    std::function<py::object()> result;
+};
+
+// Completions waiting for the event loop. The completion queue thread of galaxy::client::async only queues them and
+// signals the eventfd, so it never takes the GIL. It is shared with the callbacks of the calls in flight, so that it
+// outlives its client.
+class CompletionState {
+public:
+    CompletionState() : event_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+        if (event_fd_ < 0) {
+            throw std::runtime_error("Fail to create eventfd.");
+        }
+    }
+    ~CompletionState() {
+        close(event_fd_);
+    }
+
+    int event_fd() const { return event_fd_; }
+
+    void Push(Completion completion) {
+        uint64_t id = completion.id;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            completions_.push_back(std::move(completion));
+        }
+        uint64_t one = 1;
+        if (write(event_fd_, &one, sizeof(one)) != sizeof(one)) {
+            LOG(ERROR) << "Fail to signal completion of call " << id << ".";
+        }
+    }
+
+    std::vector<Completion> Pop() {
+        uint64_t count;
+        // Resets the eventfd before taking the completions, so that a completion pushed in between signals again.
+        if (read(event_fd_, &count, sizeof(count)) < 0) {
+            VLOG(3) << "No completion signaled.";
+        }
+        std::vector<Completion> completions;
+        std::lock_guard<std::mutex> lock(mu_);
+        completions.swap(completions_);
+        return completions;
+    }
+
+private:
+    int event_fd_;
+    std::mutex mu_;
+    std::vector<Completion> completions_;
+};
+
+// Starts galaxy::client::async calls and returns their id. The asyncio loop watches fileno() and collects the
+// finished calls with drain(), as (id, error, result) tuples where error is None on success.
+class AsyncClient {
+public:
+    AsyncClient() : state_(std::make_shared<CompletionState>()) {}
+
+    int FileNo() const { return state_->event_fd(); }
+
+    // Whether calls on path are served before they return, i.e. path is local or under /SHARED, so that the loop
+    // runs them on an executor instead.
+    bool ServesInline(const std::string& path) const {
+        absl::StatusOr<galaxy_schema::FileAnalyzerResult> result = galaxy::util::RunFileAnalyzer(path);
+        return result.ok() && (result->is_shared() || !result->is_remote());
+    }
+
+    py::list Drain() {
+        py::list drained;
+        for (auto& completion : state_->Pop()) {
+            if (completion.status.ok()) {
+                drained.append(py::make_tuple(completion.id, py::none(), completion.result()));
+            } else {
+                drained.append(py::make_tuple(completion.id, std::string(completion.status.message()), py::none()));
+            }
+        }
+        return drained;
+    }
+
+    uint64_t Read(const std::string& path) {
+        uint64_t id = next_id_++;
+        py::gil_scoped_release release;
+        galaxy::client::async::Read(path, ValueCompletion<std::string>(id, [](const std::string& data) {
+            return py::bytes(data);
+        }));
+        return id;
+    }
+
+    // Reads the files concurrently. As with read_multiple, files that cannot be read are left out of the result.
+    uint64_t ReadMultiple(const std::vector<std::string>& paths) {
+        uint64_t id = next_id_++;
+        std::shared_ptr<CompletionState> state = state_;
+        struct Gather {
+            std::mutex mu;
+            size_t remaining;
+            std::map<std::string, std::string> data;
+        };
+        auto gather = std::make_shared<Gather>();
+        gather->remaining = paths.size();
+        auto to_python = [gather]() -> py::object {
+            py::dict result;
+            for (const auto& val : gather->data) {
+                result[py::str(val.first)] = py::bytes(val.second);
+            }
+            return result;
+        };
+        if (paths.empty()) {
+            state->Push({id, absl::OkStatus(), to_python});
+            return id;
+        }
+        py::gil_scoped_release release;
+        for (const auto& path : paths) {
+            galaxy::client::async::Read(path, [state, id, gather, path, to_python](absl::StatusOr<std::string> data) {
+                std::lock_guard<std::mutex> lock(gather->mu);
+                if (data.ok()) {
+                    gather->data[path] = std::move(*data);
+                } else {
+                    LOG(ERROR) << "Failed to read data for file " << path << ": " << data.status();
+                }
+                if (--gather->remaining == 0) {
+                    state->Push({id, absl::OkStatus(), to_python});
+                }
+            });
+        }
+        return id;
+    }
+
+    uint64_t Write(const std::string& path, const std::string& data, const std::string& mode) {
+        uint64_t id = next_id_++;
+        py::gil_scoped_release release;
+        galaxy::client::async::Write(path, data, mode, StatusCompletion(id));
+        return id;
+    }
+
+    uint64_t ListDirsInDir(const std::string& path) {
+        uint64_t id = next_id_++;
+        py::gil_scoped_release release;
+        galaxy::client::async::ListDirsInDir(path, ValueCompletion<std::map<std::string, std::string>>(id, MapToPython));
+        return id;
+    }
+
+    uint64_t ListFilesInDir(const std::string& path, bool include_hidden) {
+        uint64_t id = next_id_++;
+        py::gil_scoped_release release;
+        galaxy::client::async::ListFilesInDir(path, include_hidden,
+                                              ValueCompletion<std::map<std::string, std::string>>(id, MapToPython));
+        return id;
+    }
+
+    uint64_t GetAttr(const std::string& path) {
+        uint64_t id = next_id_++;
+        py::gil_scoped_release release;
+        galaxy::client::async::GetAttr(path, ValueCompletion<std::string>(id, [](const std::string& attr) {
+            return py::str(attr);
+        }));
+        return id;
+    }
+
+    uint64_t CopyFile(const std::string& from_path, const std::string& to_path) {
+        uint64_t id = next_id_++;
+        py::gil_scoped_release release;
+        galaxy::client::async::CopyFile(from_path, to_path, StatusCompletion(id));
+        return id;
+    }
+
+private:
+    static py::object MapToPython(const std::map<std::string, std::string>& value) {
+        return py::cast(value);
+    }
+
+    // Callback of a call returning a T, whose Python value is built by to_python once drained.
+    template <typename T, typename ToPython>
+    std::function<void(absl::StatusOr<T>)> ValueCompletion(uint64_t id, ToPython to_python) {
+        std::shared_ptr<CompletionState> state = state_;
+        return [state, id, to_python](absl::StatusOr<T> result) {
+            if (!result.ok()) {
+                state->Push({id, result.status(), nullptr});
+                return;
+            }
+            auto value = std::make_shared<T>(std::move(*result));
+            state->Push({id, absl::OkStatus(), [value, to_python]() -> py::object { return to_python(*value); }});
+        };
+    }
+
+    std::function<void(absl::Status)> StatusCompletion(uint64_t id) {
+        std::shared_ptr<CompletionState> state = state_;
+        return [state, id](absl::Status status) {
+            state->Push({id, status, []() -> py::object { return py::none(); }});
+        };
+    }
+
+    std::shared_ptr<CompletionState> state_;
+    std::atomic<uint64_t> next_id_{0};
+};
+
+PYBIND11_MODULE(_gclient_async, m)
+{
+    if (!google::IsGoogleLoggingInitialized()) {
+        google::InitGoogleLogging("GALAXY_CLIENT");
+    }
+    m.doc() = "galaxy asyncio client, see galaxy_py.aio";
+    py::class_<AsyncClient>(m, "AsyncClient")
+        .def(py::init<>())
+        .def("fileno", &AsyncClient::FileNo)
+        .def("drain", &AsyncClient::Drain)
+        .def("serves_inline", &AsyncClient::ServesInline, py::call_guard<py::gil_scoped_release>(), py::arg("path"))
+        .def("read", &AsyncClient::Read, py::arg("path"))
+        .def("read_multiple", &AsyncClient::ReadMultiple, py::arg("paths"))
+        .def("write", &AsyncClient::Write, py::arg("path"), py::arg("data"), py::arg("mode")="w")
+        .def("write", [](AsyncClient& client, const std::string& path, py::buffer data, const std::string& mode) {
+            return client.Write(path, BufferToString(data), mode);
+        }, py::arg("path"), py::arg("data"), py::arg("mode")="w")
+        .def("list_dirs_in_dir", &AsyncClient::ListDirsInDir, py::arg("path"))
+        .def("list_files_in_dir", &AsyncClient::ListFilesInDir, py::arg("path"), py::arg("include_hidden")=false)
+        .def("get_attr", &AsyncClient::GetAttr, py::arg("path"))
+        .def("copy_file", &AsyncClient::CopyFile, py::arg("from_path"), py::arg("to_path"));
+}
@@ -2,6 +2,7 @@ import time
 import logging
 import threading
 import struct
+import sys
 import traceback
 import os
 
@@ -106,14 +107,50 @@ class GalaxyLoggingHandler(logging.StreamHandler):
             super(GalaxyLoggingHandler, self).emit(record)
 
 
+class BufferedGalaxyLoggingHandler(GalaxyLoggingHandler):
+    """Same as GalaxyLoggingHandler, but hands the records to a native writer that coalesces them per file and appends
+    them from a background thread. Records not flushed yet are lost if the process dies, call flush() at checkpoints.
+    Thresholds and the policy when the writer is full default to the GALAXY_fs_buffered_* environment variables."""
+
+    def __init__(self, log_prefix, disk_only, disable_disk_logging, **writer_options):
+        super().__init__(log_prefix, disk_only, disable_disk_logging)
+        self._writer = gclient.BufferedWriter(**writer_options)
+
+    def emit(self, record):
+        if not self._disable_disk_logging:
+            msg = self.format(record) + '\n'
+            level_file, self._filename = self._get_file_name_from_record(record)
+            self._writer.append(level_file, msg)
+            self._writer.append(self._filename, msg)
+        if not self._disk_only:
+            logging.StreamHandler.emit(self, record)
+
+    def flush(self):
+        super().flush()
+        try:
+            self._writer.flush()
+        except RuntimeError as err:
+            # The records that failed are kept by the writer and retried.
+            sys.stderr.write('Fail to flush log records: %s\n' % err)
+
+    def close(self):
+        try:
+            self._writer.close()
+        except RuntimeError as err:
+            sys.stderr.write('Fail to flush log records on close: %s\n' % err)
+        super().close()
+
+
 class glogging(object):
 
     @classmethod
     def get_logger(cls, log_name, log_dir, disk_only=os.getenv('GALAXY_logging_disk_only', False),
-                   disable_disk_logging=os.getenv('GALAXY_disable_disk_logging', False)):
+                   disable_disk_logging=os.getenv('GALAXY_disable_disk_logging', False),
+                   buffered=os.getenv('GALAXY_logging_buffered', False)):
         logger = logging.getLogger(log_name)
         logger.setLevel(logging.DEBUG)
-        handler = GalaxyLoggingHandler(os.path.join(log_dir, log_name), disk_only, disable_disk_logging)
+        handler_class = BufferedGalaxyLoggingHandler if buffered else GalaxyLoggingHandler
+        handler = handler_class(os.path.join(log_dir, log_name), disk_only, disable_disk_logging)
         handler.setLevel(logging.DEBUG)
         logger.addHandler(handler)
         return logger
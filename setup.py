@@ -73,6 +73,9 @@ class BuildBazelExtension(build_ext.build_ext):
         shutil.copyfile(
             "python/logging.py", os.path.join(package_dir, "logging.py")
         )
+        shutil.copyfile(
+            "python/aio.py", os.path.join(package_dir, "aio.py")
+        )
 
 
 setuptools.setup(
@@ -88,7 +91,8 @@ setuptools.setup(
     packages=setuptools.find_packages(where="python"),
     include_package_data=True,
     ext_modules=[
-        BazelExtension("gclient", "//python:gclient",)
+        BazelExtension("gclient", "//python:gclient",),
+        BazelExtension("gclient_async", "//python:gclient_async",),
     ],
     zip_safe=False,
     author="Francis Chen",